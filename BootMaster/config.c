@@ -58,6 +58,7 @@
 #include "apple.h"
 #include "mystrings.h"
 #include "scan.h"
+#include "crc32.h"
 #include "../include/refit_call_wrapper.h"
 #include "../mok/mok.h"
 
@@ -76,6 +77,8 @@ UINTN   ReadLoops       = 0;
 UINTN   TotalEntryCount = 0;
 UINTN   ValidEntryCount = 0;
 
+UINT32  ConfigFileCrc   = 0;
+
 BOOLEAN OuterLoop      =  TRUE;
 BOOLEAN SilenceAPFS    =  TRUE;
 BOOLEAN FirstInclude   =  TRUE;
@@ -115,6 +118,41 @@ VOID SetLinuxMatchPatterns (
     GlobalConfig.LinuxMatchPatterns = PatternSet;
 } // VOID SetLinuxMatchPatterns()
 
+static
+VOID CompileScanList (
+    IN OUT STRING_SET **Set,
+    IN     CHAR16      *List,
+    IN     UINTN        Kind
+) {
+    StringSetFree (Set);
+    *Set = StringSetCompile (List, Kind);
+    if (*Set != NULL) {
+        (*Set)->Shared = TRUE;
+    }
+} // static VOID CompileScanList()
+
+// Drops the sets built by CompileScanLists(). Must be called before any of
+// their lists is changed, as sets are found by list address alone. Until
+// CompileScanLists() is called again, lookups work from the lists as they are.
+VOID FreeScanLists (VOID) {
+    StringSetFree (&GlobalConfig.DontScanVolumesSet);
+    StringSetFree (&GlobalConfig.DontScanDirsSet);
+    StringSetFree (&GlobalConfig.DontScanFilesSet);
+    StringSetFree (&GlobalConfig.LinuxPrefixesSet);
+    StringSetFree (&GlobalConfig.LinuxMatchPatternsSet);
+} // VOID FreeScanLists()
+
+// Parses the GlobalConfig lists consulted for every volume and file during
+// scans into STRING_SET form. Must be called again after any of these lists
+// is changed. See FreeScanLists() and StringSetAcquire().
+VOID CompileScanLists (VOID) {
+    CompileScanList (&GlobalConfig.DontScanVolumesSet,    GlobalConfig.DontScanVolumes,    STRING_SET_PLAIN);
+    CompileScanList (&GlobalConfig.DontScanDirsSet,       GlobalConfig.DontScanDirs,       STRING_SET_DIRS );
+    CompileScanList (&GlobalConfig.DontScanFilesSet,      GlobalConfig.DontScanFiles,      STRING_SET_FILES);
+    CompileScanList (&GlobalConfig.LinuxPrefixesSet,      GlobalConfig.LinuxPrefixes,      STRING_SET_PLAIN);
+    CompileScanList (&GlobalConfig.LinuxMatchPatternsSet, GlobalConfig.LinuxMatchPatterns, STRING_SET_PLAIN);
+} // VOID CompileScanLists()
+
 EFI_STATUS RefitReadFile (
     IN     EFI_FILE_HANDLE  BaseDir,
     IN     CHAR16          *FileName,
@@ -754,6 +792,12 @@ VOID ReadConfig (
     }
 
     AllowIncludes = OuterLoop;
+    if (AllowIncludes) {
+        ConfigFileCrc = 0;
+
+        // The 'Dont Scan' and Linux lists are rebuilt below
+        FreeScanLists();
+    }
 
     #if REFIT_DEBUG > 0
     if (AllowIncludes) LOG_MSG("R E A D   C O N F I G U R A T I O N   T O K E N S");
@@ -796,6 +840,8 @@ VOID ReadConfig (
 
         MY_FREE_POOL(GlobalConfig.LinuxPrefixes);
         GlobalConfig.LinuxPrefixes = StrDuplicate (L"+");
+
+        ClearBootcodeSignatures();
     } // if
 
     if (!FileExists (SelfDir, FileName)) {
@@ -850,6 +896,9 @@ VOID ReadConfig (
         return;
     }
 
+    // Rescans compare this with the value from the last loader scan to spot changes
+    ConfigFileCrc = crc32refit (ConfigFileCrc, File.Buffer, File.BufferSize);
+
     MaxLogLevel = (ForensicLogging) ? MAXLOGLEVEL + 1 : MAXLOGLEVEL;
     for (;;) {
         TokenCount = ReadTokenLine (&File, &TokenList);
@@ -1648,6 +1697,17 @@ VOID ReadConfig (
             }
             #endif
         }
+        else if (MyStriCmp (TokenList[0], L"verify_fs_checksums")) {
+            GlobalConfig.VerifyFsChecksums = HandleBoolean (TokenList, TokenCount);
+
+            #if REFIT_DEBUG > 0
+            if (!AllowIncludes) {
+                MuteLogger = FALSE;
+                LOG_MSG("%s  - Updated:- 'verify_fs_checksums'", OffsetNext);
+                MuteLogger = TRUE;
+            }
+            #endif
+        }
         else if (MyStriCmp (TokenList[0], L"unicode_collation")) {
             GlobalConfig.UnicodeCollation = HandleBoolean (TokenList, TokenCount);
 
@@ -1809,6 +1869,28 @@ VOID ReadConfig (
             }
             #endif
         }
+        else if (MyStriCmp (TokenList[0], L"renderer_framebuffer")) {
+            GlobalConfig.PaintFramebuffer = HandleBoolean (TokenList, TokenCount);
+
+            #if REFIT_DEBUG > 0
+            if (!AllowIncludes) {
+                MuteLogger = FALSE;
+                LOG_MSG("%s  - Updated:- 'renderer_framebuffer'", OffsetNext);
+                MuteLogger = TRUE;
+            }
+            #endif
+        }
+        else if (MyStriCmp (TokenList[0], L"preload_loaders")) {
+            GlobalConfig.PreloadLoaders = HandleBoolean (TokenList, TokenCount);
+
+            #if REFIT_DEBUG > 0
+            if (!AllowIncludes) {
+                MuteLogger = FALSE;
+                LOG_MSG("%s  - Updated:- 'preload_loaders'", OffsetNext);
+                MuteLogger = TRUE;
+            }
+            #endif
+        }
         else if (
             MyStriCmp (TokenList[0], L"force_trim") ||
             MyStriCmp (TokenList[0], L"trim_force")
@@ -2081,6 +2163,50 @@ VOID ReadConfig (
             }
             #endif
         }
+        else if (MyStriCmp (TokenList[0], L"scan_cache")) {
+            GlobalConfig.ScanCache = HandleBoolean (TokenList, TokenCount);
+
+            #if REFIT_DEBUG > 0
+            if (!AllowIncludes) {
+                MuteLogger = FALSE;
+                LOG_MSG("%s  - Updated:- 'scan_cache'", OffsetNext);
+                MuteLogger = TRUE;
+            }
+            #endif
+        }
+        else if (MyStriCmp (TokenList[0], L"prefetch_volumes")) {
+            GlobalConfig.PrefetchVolumes = HandleBoolean (TokenList, TokenCount);
+
+            #if REFIT_DEBUG > 0
+            if (!AllowIncludes) {
+                MuteLogger = FALSE;
+                LOG_MSG("%s  - Updated:- 'prefetch_volumes'", OffsetNext);
+                MuteLogger = TRUE;
+            }
+            #endif
+        }
+        else if (MyStriCmp (TokenList[0], L"legacy_signature") && (TokenCount == 4)) {
+            AddBootcodeSignature (TokenList[1], TokenList[2], TokenList[3]);
+
+            #if REFIT_DEBUG > 0
+            if (!AllowIncludes) {
+                MuteLogger = FALSE;
+                LOG_MSG("%s  - Updated:- 'legacy_signature'", OffsetNext);
+                MuteLogger = TRUE;
+            }
+            #endif
+        }
+        else if (MyStriCmp (TokenList[0], L"cached_first_paint")) {
+            GlobalConfig.CachedFirstPaint = HandleBoolean (TokenList, TokenCount);
+
+            #if REFIT_DEBUG > 0
+            if (!AllowIncludes) {
+                MuteLogger = FALSE;
+                LOG_MSG("%s  - Updated:- 'cached_first_paint'", OffsetNext);
+                MuteLogger = TRUE;
+            }
+            #endif
+        }
         else if (MyStriCmp (TokenList[0], L"prefer_uga")) {
             GlobalConfig.PreferUGA = HandleBoolean (TokenList, TokenCount);
 
@@ -2234,6 +2360,7 @@ VOID ReadConfig (
     MY_FREE_POOL(File.Buffer);
 
     SetLinuxMatchPatterns (GlobalConfig.LinuxPrefixes);
+    CompileScanLists();
 
     if (!FileExists (SelfDir, L"icons") && !FileExists (SelfDir, GlobalConfig.IconsDir)) {
         #if REFIT_DEBUG > 0
@@ -2769,6 +2896,8 @@ LOADER_ENTRY * AddStanzaEntries (
         SetLoaderDefaults (Entry, L"\\EFI\\BOOT\\nemo.efi", CurrentVolume);
     }
 
+    // Resolve icon hints from SetLoaderDefaults() now ... Not deferred for stanzas
+    LoadEntryIcon (&Entry->me);
     if (AllowGraphicsMode && Entry->me.Image == NULL) {
         // Still no icon ... set dummy image
         Entry->me.Image = DummyImage (GlobalConfig.IconSizes[ICON_SIZE_BIG]);
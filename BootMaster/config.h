@@ -84,6 +84,8 @@ typedef struct {
 
 EFI_STATUS RefitReadFile (IN EFI_FILE_HANDLE BaseDir, CHAR16 *FileName, REFIT_FILE *File, UINTN *size);
 VOID ReadConfig (CHAR16 *FileName);
+VOID FreeScanLists (VOID);
+VOID CompileScanLists (VOID);
 VOID ScanUserConfigured (CHAR16 *FileName);
 UINTN ReadTokenLine (IN REFIT_FILE *File, OUT CHAR16 ***TokenList);
 VOID FreeTokenLine (IN OUT CHAR16 ***TokenList, IN OUT UINTN *TokenCount);
@@ -62,6 +62,7 @@
 #include "driver_support.h"
 #include "lib.h"
 #include "mystrings.h"
+#include "profile.h"
 #include "screenmgt.h"
 #include "launch_efi.h"
 #include "../include/refit_call_wrapper.h"
@@ -669,6 +670,32 @@ UINTN ScanDriverDir (
     return (NumFound);
 } // static UINTN ScanDriverDir()
 
+// Pass options to the filesystem drivers supplied with RefindPlus.
+// These read the volatile 'VerifyFsChecksums' variable when mounting and
+// verify metadata checksums if it is set. It is not stored to file with
+// the other RefindPlus variables, as the drivers only look in NVRAM.
+static
+VOID SetDriverOptions (VOID) {
+    EFI_STATUS  Status;
+    UINT8       Value;
+
+    Value  = 1;
+    Status = REFIT_CALL_5_WRAPPER(
+        gRT->SetVariable, L"VerifyFsChecksums",
+        &RefindPlusGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS,
+        (GlobalConfig.VerifyFsChecksums) ? sizeof (Value) : 0, &Value
+    );
+
+    #if REFIT_DEBUG > 0
+    if (GlobalConfig.VerifyFsChecksums) {
+        ALT_LOG(1, LOG_LINE_NORMAL,
+            L"Pass 'Verify Filesystem Checksums' to Drivers:- '%r'",
+            Status
+        );
+    }
+    #endif
+} // static VOID SetDriverOptions()
+
 
 // Load all UEFI drivers from RefindPlus' "drivers" subdirectory and from the
 // directories specified by the user in the "scan_driver_dirs" configuration
@@ -710,6 +737,8 @@ BOOLEAN LoadDrivers (VOID) {
     #endif
 
 
+    SetDriverOptions();
+
     SelfDirectory = NULL;
     DriversListProg = DriversListUser = DriversListAll = NULL;
     NumFound = CurFound = i = 0;
@@ -726,7 +755,7 @@ BOOLEAN LoadDrivers (VOID) {
         CleanUpPathNameSlashes (SelfDirectory);
         MergeStrings (&SelfDirectory, Directory, L'\\');
 
-        CurFound = ScanDriverDir (SelfDirectory, &DriversListProg);
+        PROFILE_FUNCTION(L"ScanDriverDir", CurFound = ScanDriverDir (SelfDirectory, &DriversListProg));
         if (CurFound > 0) {
             // We only process one default folder
             // Increment 'NumFound' and exit loop if drivers were found
@@ -777,7 +806,7 @@ BOOLEAN LoadDrivers (VOID) {
                     MergeStrings (&SelfDirectory, Directory, L'\\');
                 }
 
-                CurFound = ScanDriverDir (SelfDirectory, &DriversListUser);
+                PROFILE_FUNCTION(L"ScanDriverDir", CurFound = ScanDriverDir (SelfDirectory, &DriversListUser));
                 if (CurFound > 0) {
                     NumFound = NumFound + CurFound;
                 }
@@ -60,6 +60,7 @@
 
 #include "../EfiLib/GenericBdsLib.h"
 #include "../libeg/libeg.h"
+#include "mystrings.h"
 
 // Tag classifications ... Used in various ways.
 #define TAG_GENERIC               (0)
@@ -369,6 +370,7 @@ typedef struct {
     MBR_PARTITION_INFO           *MbrPartitionTable;
     BOOLEAN                      IsReadable;
     UINT32                       FSType;
+    BOOLEAN                      IsNewOnRescan; // Not present, or changed, before the last rescan
 } REFIT_VOLUME;
 
 typedef struct _refit_menu_entry {
@@ -380,6 +382,7 @@ typedef struct _refit_menu_entry {
     EG_IMAGE    *Image;
     EG_IMAGE    *BadgeImage;
     struct _refit_menu_screen *SubScreen;
+    CHAR16      *IconName;    // Icon hints 'Image' is loaded from when first needed
 } REFIT_MENU_ENTRY;
 
 typedef struct _refit_menu_screen {
@@ -406,6 +409,7 @@ typedef struct {
     CHAR16                    *InitrdPath;       // Linux stub loader
     CHAR8                      OSType;
     UINTN                      DiscoveryType;
+    BOOLEAN                    FoundOnVolume;    // Found by a loader scan of 'Volume' ... Kept on rescans if unchanged
     EFI_DEVICE_PATH_PROTOCOL  *EfiLoaderPath;    // Path to NVRAM-defined loader
     UINT16                     EfiBootNum;       // Boot#### number for NVRAM-defined loader
 } LOADER_ENTRY;
@@ -468,6 +472,12 @@ typedef struct {
     BOOLEAN                    UnicodeCollation;
     BOOLEAN                    SupplyAppleFB;
     BOOLEAN                    MitigatePrimedBuffer;
+    BOOLEAN                    ScanCache;
+    BOOLEAN                    PrefetchVolumes;
+    BOOLEAN                    CachedFirstPaint;
+    BOOLEAN                    VerifyFsChecksums;
+    BOOLEAN                    PaintFramebuffer;
+    BOOLEAN                    PreloadLoaders;
     UINTN                      RequestedScreenWidth;
     UINTN                      RequestedScreenHeight;
     UINTN                      BannerBottomEdge;
@@ -515,6 +525,11 @@ typedef struct {
     CHAR16                    *ExtraKernelVersionStrings;
     CHAR16                    *SpoofOSXVersion;
     UINT32_LIST               *CsrValues;
+    STRING_SET                *DontScanVolumesSet;    // Parsed forms of the matching lists
+    STRING_SET                *DontScanDirsSet;       // See CompileScanLists()
+    STRING_SET                *DontScanFilesSet;
+    STRING_SET                *LinuxPrefixesSet;
+    STRING_SET                *LinuxMatchPatternsSet;
     UINTN                      ShowTools[NUM_TOOLS];
     CHAR8                      ScanFor[NUM_SCAN_OPTIONS];
 } REFIT_CONFIG;
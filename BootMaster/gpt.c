@@ -29,6 +29,7 @@
  #include "lib.h"
  #include "screenmgt.h"
  #include "crc32.h"
+ #include "prefetch.h"
  #include "../include/refit_call_wrapper.h"
 
  #ifdef __MAKEWITH_TIANO
@@ -176,8 +177,8 @@ EFI_STATUS ReadGptData (REFIT_VOLUME *Volume, GPT_DATA **Data) {
 
     // Read the MBR and store it in GptData->ProtectiveMBR.
     if (!EFI_ERROR(Status)) {
-        Status = REFIT_CALL_5_WRAPPER(
-            Volume->BlockIO->ReadBlocks, Volume->BlockIO,
+        Status = PrefetchReadBlocks (
+            Volume->BlockIO,
             Volume->BlockIO->Media->MediaId, 0,
             sizeof (MBR_RECORD), (VOID*) GptData->ProtectiveMBR
         );
@@ -185,8 +186,8 @@ EFI_STATUS ReadGptData (REFIT_VOLUME *Volume, GPT_DATA **Data) {
 
     // Read the GPT header and store it in GptData->Header.
     if (!EFI_ERROR(Status)) {
-        Status = REFIT_CALL_5_WRAPPER(
-            Volume->BlockIO->ReadBlocks, Volume->BlockIO,
+        Status = PrefetchReadBlocks (
+            Volume->BlockIO,
             Volume->BlockIO->Media->MediaId, 1,
             sizeof (GPT_HEADER), GptData->Header
         );
@@ -204,8 +205,8 @@ EFI_STATUS ReadGptData (REFIT_VOLUME *Volume, GPT_DATA **Data) {
             }
 
             if (!EFI_ERROR(Status))
-                Status = REFIT_CALL_5_WRAPPER(
-                    Volume->BlockIO->ReadBlocks, Volume->BlockIO,
+                Status = PrefetchReadBlocks (
+                    Volume->BlockIO,
                     Volume->BlockIO->Media->MediaId, GptData->Header->entry_lba,
                     BufferSize, GptData->Entries
                 );
@@ -233,6 +233,31 @@ EG_IMAGE * LoadOSIcon (
     return egCopyImage (Image);
 } // EG_IMAGE * LoadOSIcon()
 
+// Load the icon of an entry created with icon hints in 'IconName' instead of
+// an image. Icons are only searched for and decoded once an entry is painted,
+// or prefetched while the menu is idle, as most entries may never be shown.
+VOID LoadEntryIcon (
+    IN REFIT_MENU_ENTRY *Entry
+) {
+    if (Entry == NULL || Entry->IconName == NULL) {
+        // Early Return
+        return;
+    }
+
+    if (Entry->Image == NULL) {
+        #if REFIT_DEBUG > 0
+        ALT_LOG(1, LOG_LINE_NORMAL,
+            L"Load Icon for '%s' Based on Hints:- '%s'",
+            Entry->Title, Entry->IconName
+        );
+        #endif
+
+        Entry->Image = LoadOSIcon (Entry->IconName, L"unknown", FALSE);
+    }
+
+    MY_FREE_POOL(Entry->IconName);
+} // VOID LoadEntryIcon()
+
 EG_IMAGE * DummyImage (
     IN UINTN PixelSize
 ) {
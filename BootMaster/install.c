@@ -24,6 +24,7 @@
 #include "scan.h"
 #include "menu.h"
 #include "mystrings.h"
+#include "crc32.h"
 #include "../include/refit_call_wrapper.h"
 #include "../include/Handle.h"
 
@@ -313,7 +314,6 @@ EFI_STATUS RenameFile (
     REFIT_CALL_1_WRAPPER(FilePtr->Close, FilePtr);
 
     MY_FREE_POOL(NewInfo);
-    MY_FREE_POOL(FilePtr);
     MY_FREE_POOL(Buffer);
 
     return Status;
@@ -381,6 +381,139 @@ EFI_STATUS CreateDirectories (
     return Status;
 } // CreateDirectories()
 
+// Size of each half of the double buffer used by CopyOneFile()
+#define COPY_CHUNK_SIZE  (256 * 1024)
+
+// Start reading the next chunk of File into Buffer.
+// Uses non-blocking ReadEx when Token->Event is set and falls back to a
+// blocking Read, for this and all later chunks, if the driver refuses it.
+static
+EFI_STATUS CopyReadStart (
+    EFI_FILE_PROTOCOL  *File,
+    EFI_FILE_IO_TOKEN  *Token,
+    VOID               *Buffer
+) {
+    EFI_STATUS Status;
+
+    Token->Status     = EFI_SUCCESS;
+    Token->Buffer     = Buffer;
+    Token->BufferSize = COPY_CHUNK_SIZE;
+
+    if (Token->Event != NULL) {
+        Status = REFIT_CALL_2_WRAPPER(File->ReadEx, File, Token);
+        if (!EFI_ERROR(Status)) {
+            return EFI_SUCCESS;
+        }
+
+        REFIT_CALL_1_WRAPPER(gBS->CloseEvent, Token->Event);
+        Token->Event      = NULL;
+        Token->BufferSize = COPY_CHUNK_SIZE;
+    }
+
+    Token->Status = REFIT_CALL_3_WRAPPER(
+        File->Read, File,
+        &Token->BufferSize, Buffer
+    );
+
+    return Token->Status;
+} // static EFI_STATUS CopyReadStart()
+
+// Wait for a chunk read started by CopyReadStart() to complete.
+static
+EFI_STATUS CopyReadFinish (
+    EFI_FILE_IO_TOKEN  *Token
+) {
+    EFI_STATUS Status;
+    UINTN      Index;
+
+    if (Token->Event != NULL) {
+        Status = REFIT_CALL_3_WRAPPER(
+            gBS->WaitForEvent, 1,
+            &Token->Event, &Index
+        );
+        if (EFI_ERROR(Status)) {
+            return Status;
+        }
+    }
+
+    return Token->Status;
+} // static EFI_STATUS CopyReadFinish()
+
+// Compute the CRC32 of File from its current position to the end.
+static
+EFI_STATUS CopyFileCrc (
+    EFI_FILE_PROTOCOL  *File,
+    VOID               *Buffer,
+    UINT32             *Crc
+) {
+    EFI_STATUS Status;
+    UINTN      ReadSize;
+
+    *Crc = 0;
+    do {
+        ReadSize = COPY_CHUNK_SIZE;
+        Status = REFIT_CALL_3_WRAPPER(
+            File->Read, File,
+            &ReadSize, Buffer
+        );
+        if (EFI_ERROR(Status)) {
+            return Status;
+        }
+
+        *Crc = crc32refit (*Crc, Buffer, ReadSize);
+    } while (ReadSize > 0);
+
+    return EFI_SUCCESS;
+} // static EFI_STATUS CopyFileCrc()
+
+// Delete FileName from BaseDir if it exists.
+static
+EFI_STATUS CopyDeleteFile (
+    EFI_FILE_PROTOCOL  *BaseDir,
+    CHAR16             *FileName
+) {
+    EFI_STATUS          Status;
+    EFI_FILE_PROTOCOL  *FilePtr;
+
+    Status = REFIT_CALL_5_WRAPPER(
+        BaseDir->Open, BaseDir,
+        &FilePtr, FileName,
+        EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0
+    );
+    if (EFI_ERROR(Status)) {
+        // Early Return
+        return Status;
+    }
+
+    // Note: Delete closes the handle and only warns on failure.
+    return REFIT_CALL_1_WRAPPER(FilePtr->Delete, FilePtr);
+} // static EFI_STATUS CopyDeleteFile()
+
+// Check whether two file times match to the two seconds that FAT records.
+static
+BOOLEAN CopySameTime (
+    EFI_TIME *Time1,
+    EFI_TIME *Time2
+) {
+    return (
+        Time1->Year          == Time2->Year   &&
+        Time1->Month         == Time2->Month  &&
+        Time1->Day           == Time2->Day    &&
+        Time1->Hour          == Time2->Hour   &&
+        Time1->Minute        == Time2->Minute &&
+        (Time1->Second >> 1) == (Time2->Second >> 1)
+    );
+} // static BOOLEAN CopySameTime()
+
+// Copy a single file in COPY_CHUNK_SIZE pieces through a double buffer, so that
+// the next chunk is read (asynchronously where the file system driver supports
+// ReadEx) while the current one is written. Copies take the modification time of
+// the source. Destination files with the same size and modification time as the
+// source are hashed, and left alone if the CRC32 also matches, which makes
+// reinstalls incremental. New copies are written under a temporary name, then
+// read back and checked against the size and CRC32 of the streamed source data.
+// The old file is then moved aside, and is only deleted once the new copy has
+// been renamed into place.
 static
 EFI_STATUS CopyOneFile (
     EFI_FILE_PROTOCOL *SourceDir,
@@ -389,13 +522,29 @@ EFI_STATUS CopyOneFile (
     CHAR16            *DestName
 ) {
     EFI_STATUS          Status;
-    UINTN              *Buffer;
-    UINTN               FileSize;
+    EFI_STATUS          ReadStatus;
+    UINT8              *Buffer[2];
+    UINTN               Current;
+    UINTN               WriteSize;
+    UINT64              FileSize;
+    UINT64              ReadTotal;
+    UINT64              WriteTotal;
+    UINT32              SourceCrc;
+    UINT32              DestCrc;
+    BOOLEAN             Unchanged;
+    BOOLEAN             Replace;
+    CHAR16             *MsgStr;
+    CHAR16             *TempName;
+    CHAR16             *LeafName;
+    CHAR16             *AsideName;
+    CHAR16             *AsideLeaf;
+    EFI_TIME            SourceTime;
     EFI_FILE_INFO      *FileInfo;
+    EFI_FILE_IO_TOKEN   Token;
     EFI_FILE_PROTOCOL  *SourceFile;
     EFI_FILE_PROTOCOL  *DestFile;
 
-    // Read the original file.
+    // Open the original file.
     SourceFile = NULL;
     Status = REFIT_CALL_5_WRAPPER(
         SourceDir->Open, SourceDir,
@@ -422,79 +571,285 @@ EFI_STATUS CopyOneFile (
         return EFI_NO_RESPONSE;
     }
 
-    FileSize = FileInfo->FileSize;
+    FileSize   = FileInfo->FileSize;
+    SourceTime = FileInfo->ModificationTime;
     MY_FREE_POOL(FileInfo);
 
-    Buffer = AllocateZeroPool (FileSize);
-    if (Buffer == NULL) {
+    Buffer[0] = AllocatePool (2 * COPY_CHUNK_SIZE);
+    if (Buffer[0] == NULL) {
+        REFIT_CALL_1_WRAPPER(SourceFile->Close, SourceFile);
+
         // Early Return
         return EFI_OUT_OF_RESOURCES;
     }
-
-    Status = REFIT_CALL_3_WRAPPER(
-        SourceFile->Read, SourceFile,
-        &FileSize, Buffer
-    );
-    if (EFI_ERROR(Status)) {
-        #if REFIT_DEBUG > 0
-        ALT_LOG(1, LOG_LINE_NORMAL,
-            L"Error:- '%r' When Reading SourceFile in 'CopyOneFile'",
-            Status
+    Buffer[1] = Buffer[0] + COPY_CHUNK_SIZE;
+
+    DestFile    = NULL;
+    MsgStr      = NULL;
+    TempName    = NULL;
+    LeafName    = NULL;
+    AsideName   = NULL;
+    AsideLeaf   = NULL;
+    Unchanged   = FALSE;
+    Replace     = FALSE;
+    Token.Event = NULL;
+    do {
+        // Skip the copy if the destination already matches.
+        Status = REFIT_CALL_5_WRAPPER(
+            DestDir->Open, DestDir,
+            &DestFile, DestName,
+            EFI_FILE_MODE_READ, 0
         );
-        #endif
+        if (!EFI_ERROR(Status)) {
+            // Only hash files that look the same ... Others are copied right away.
+            Replace  = TRUE;
+            FileInfo = LibFileInfo (DestFile);
+            if (FileInfo != NULL                 &&
+                FileInfo->FileSize == FileSize   &&
+                CopySameTime (&FileInfo->ModificationTime, &SourceTime)
+            ) {
+                Status = CopyFileCrc (DestFile, Buffer[0], &DestCrc);
+                if (!EFI_ERROR(Status)) {
+                    Status = CopyFileCrc (SourceFile, Buffer[0], &SourceCrc);
+                }
+                if (!EFI_ERROR(Status) && DestCrc == SourceCrc) {
+                    MY_FREE_POOL(FileInfo);
+                    Unchanged = TRUE;
 
-        // Early Return
-        return Status;
-    }
+                    break;
+                }
 
-    REFIT_CALL_1_WRAPPER(SourceFile->Close, SourceFile);
+                REFIT_CALL_2_WRAPPER(SourceFile->SetPosition, SourceFile, 0);
+            }
+            MY_FREE_POOL(FileInfo);
 
-    // Write the file to a new location.
-    DestFile = NULL;
-    Status = REFIT_CALL_5_WRAPPER(
-        DestDir->Open, DestDir,
-        &DestFile, DestName,
-        ReadWriteCreate, 0
-    );
-    if (EFI_ERROR(Status)) {
-        #if REFIT_DEBUG > 0
-        ALT_LOG(1, LOG_LINE_NORMAL,
-            L"Error:- '%r' When Opening DestDir in 'CopyOneFile'",
-            Status
+            REFIT_CALL_1_WRAPPER(DestFile->Close, DestFile);
+            DestFile = NULL;
+        }
+
+        // Copy to a temporary file so the old file survives a failed copy.
+        TempName = PoolPrint (L"%s.tmp", DestName);
+        LeafName = Basename (DestName);
+        if (TempName == NULL || LeafName == NULL) {
+            Status = EFI_OUT_OF_RESOURCES;
+            MsgStr = L"Naming TempFile";
+
+            break;
+        }
+
+        // Clear any leftover from an earlier attempt so no stale tail remains.
+        CopyDeleteFile (DestDir, TempName);
+
+        // Write the file to a new location.
+        Status = REFIT_CALL_5_WRAPPER(
+            DestDir->Open, DestDir,
+            &DestFile, TempName,
+            ReadWriteCreate, 0
         );
-        #endif
+        if (EFI_ERROR(Status)) {
+            DestFile = NULL;
+            MsgStr   = L"Opening DestDir";
 
-        // Early Return
-        return Status;
-    }
+            break;
+        }
 
-    Status = REFIT_CALL_3_WRAPPER(
-        DestFile->Write, DestFile,
-        &FileSize, Buffer
-    );
-    if (EFI_ERROR(Status)) {
-        #if REFIT_DEBUG > 0
-        ALT_LOG(1, LOG_LINE_NORMAL,
-            L"Error:- '%r' When Writing to DestDir in 'CopyOneFile'",
-            Status
+        // Read asynchronously if the driver offers ReadEx.
+        if (SourceFile->Revision >= EFI_FILE_PROTOCOL_REVISION2) {
+            Status = REFIT_CALL_5_WRAPPER(
+                gBS->CreateEvent, 0,
+                0, NULL,
+                NULL, &Token.Event
+            );
+            if (EFI_ERROR(Status)) {
+                Token.Event = NULL;
+            }
+        }
+
+        Status     = EFI_SUCCESS;
+        SourceCrc  = 0;
+        ReadTotal  = WriteTotal = 0;
+        Current    = 0;
+        ReadStatus = CopyReadStart (SourceFile, &Token, Buffer[Current]);
+        while (!EFI_ERROR(ReadStatus)) {
+            ReadStatus = CopyReadFinish (&Token);
+            if (EFI_ERROR(ReadStatus) || Token.BufferSize == 0) {
+                break;
+            }
+
+            WriteSize  = Token.BufferSize;
+            ReadTotal += WriteSize;
+            SourceCrc  = crc32refit (SourceCrc, Buffer[Current], WriteSize);
+
+            // Fetch chunk N+1 while chunk N is being written.
+            ReadStatus = CopyReadStart (SourceFile, &Token, Buffer[Current ^ 1]);
+
+            Status = REFIT_CALL_3_WRAPPER(
+                DestFile->Write, DestFile,
+                &WriteSize, Buffer[Current]
+            );
+            if (EFI_ERROR(Status)) {
+                // Let any outstanding read land before the buffer is released.
+                CopyReadFinish (&Token);
+                MsgStr = L"Writing to DestDir";
+
+                break;
+            }
+
+            // Only count what the driver reports as written.
+            WriteTotal += WriteSize;
+
+            Current ^= 1;
+        } // while
+        if (EFI_ERROR(Status)) {
+            break;
+        }
+
+        if (EFI_ERROR(ReadStatus)) {
+            Status = ReadStatus;
+            MsgStr = L"Reading SourceFile";
+
+            break;
+        }
+
+        // Give the copy the time of the source so that unchanged files can be spotted later.
+        FileInfo = LibFileInfo (DestFile);
+        if (FileInfo != NULL) {
+            FileInfo->ModificationTime = SourceTime;
+            REFIT_CALL_4_WRAPPER(
+                DestFile->SetInfo, DestFile,
+                &gEfiFileInfoGuid, FileInfo->Size, (VOID *) FileInfo
+            );
+            MY_FREE_POOL(FileInfo);
+        }
+
+        Status   = REFIT_CALL_1_WRAPPER(DestFile->Close, DestFile);
+        DestFile = NULL;
+        if (EFI_ERROR(Status)) {
+            CopyDeleteFile (DestDir, TempName);
+            Status = EFI_DEVICE_ERROR;
+            MsgStr = L"Closing DestDir";
+
+            break;
+        }
+
+        // Read the copy back and check it against the streamed source data.
+        Status = REFIT_CALL_5_WRAPPER(
+            DestDir->Open, DestDir,
+            &DestFile, TempName,
+            EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0
         );
-        #endif
+        if (EFI_ERROR(Status)) {
+            DestFile = NULL;
+            CopyDeleteFile (DestDir, TempName);
+        }
+        else {
+            FileInfo = LibFileInfo (DestFile);
+            if (FileInfo == NULL) {
+                Status = EFI_NO_RESPONSE;
+            }
+            else if (
+                ReadTotal  != FileSize  ||
+                WriteTotal != ReadTotal ||
+                FileInfo->FileSize != WriteTotal
+            ) {
+                Status = EFI_CRC_ERROR;
+            }
+            else {
+                Status = CopyFileCrc (DestFile, Buffer[0], &DestCrc);
+                if (!EFI_ERROR(Status) && DestCrc != SourceCrc) {
+                    Status = EFI_CRC_ERROR;
+                }
+            }
+            MY_FREE_POOL(FileInfo);
+        }
+        if (EFI_ERROR(Status)) {
+            // DestFile, if open, is deleted below.
+            MsgStr = L"Verifying DestDir";
 
-        // Early Return
-        return Status;
+            break;
+        }
+
+        REFIT_CALL_1_WRAPPER(DestFile->Close, DestFile);
+        DestFile = NULL;
+
+        if (!Replace) {
+            Status = RenameFile (DestDir, TempName, LeafName);
+            if (EFI_ERROR(Status)) {
+                CopyDeleteFile (DestDir, TempName);
+                MsgStr = L"Renaming TempFile";
+            }
+
+            break;
+        }
+
+        // The copy is good ... Move the old file aside before putting the copy in its place.
+        AsideName = PoolPrint (L"%s.old", DestName);
+        AsideLeaf = PoolPrint (L"%s.old", LeafName);
+        if (AsideName == NULL || AsideLeaf == NULL) {
+            CopyDeleteFile (DestDir, TempName);
+            Status = EFI_OUT_OF_RESOURCES;
+            MsgStr = L"Naming OldFile";
+
+            break;
+        }
+
+        CopyDeleteFile (DestDir, AsideName);
+        Status = RenameFile (DestDir, DestName, AsideLeaf);
+        if (EFI_ERROR(Status)) {
+            CopyDeleteFile (DestDir, TempName);
+            MsgStr = L"Moving DestFile Aside";
+
+            break;
+        }
+
+        Status = RenameFile (DestDir, TempName, LeafName);
+        if (EFI_ERROR(Status)) {
+            // Put the old file back ... It is still the installed copy.
+            RenameFile (DestDir, AsideName, LeafName);
+            CopyDeleteFile (DestDir, TempName);
+            MsgStr = L"Renaming TempFile";
+
+            break;
+        }
+
+        // The new copy is in place ... The old file is no longer needed.
+        CopyDeleteFile (DestDir, AsideName);
+    } while (0); // This 'loop' only runs once
+
+    if (Token.Event != NULL) {
+        REFIT_CALL_1_WRAPPER(gBS->CloseEvent, Token.Event);
     }
 
-    Status = REFIT_CALL_1_WRAPPER(DestFile->Close, DestFile);
+    REFIT_CALL_1_WRAPPER(SourceFile->Close, SourceFile);
+
+    if (DestFile != NULL) {
+        if (Unchanged) {
+            REFIT_CALL_1_WRAPPER(DestFile->Close, DestFile);
+        }
+        else {
+            // Discard the incomplete copy ... The old file is untouched.
+            // Note: Delete closes the handle.
+            REFIT_CALL_1_WRAPPER(DestFile->Delete, DestFile);
+        }
+    }
 
-    MY_FREE_POOL(SourceFile);
-    MY_FREE_POOL(DestFile);
-    MY_FREE_POOL(Buffer);
+    MY_FREE_POOL(TempName);
+    MY_FREE_POOL(LeafName);
+    MY_FREE_POOL(AsideName);
+    MY_FREE_POOL(AsideLeaf);
+    MY_FREE_POOL(Buffer[0]);
 
     #if REFIT_DEBUG > 0
     if (EFI_ERROR(Status)) {
         ALT_LOG(1, LOG_LINE_NORMAL,
-            L"Error:- '%r' When Closing DestDir in 'CopyOneFile'",
-            Status
+            L"Error:- '%r' When %s in 'CopyOneFile'",
+            Status, MsgStr
+        );
+    }
+    else if (Unchanged) {
+        ALT_LOG(1, LOG_LINE_NORMAL,
+            L"Skipped Unchanged '%s'",
+            DestName
         );
     }
     #endif
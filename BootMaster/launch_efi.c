@@ -346,12 +346,24 @@ VOID LogAssumedValid (
 #endif
 
 // Returns TRUE if this file is a valid EFI loader file, and is proper ARCH
-BOOLEAN IsValidLoader (
-    EFI_FILE_PROTOCOL *RootDir,
-    CHAR16            *FileName
+// If 'ImageData' is provided, the whole file is read and checked, and is
+// returned there when valid. 'ImageData' may still be NULL on return.
+static
+BOOLEAN IsValidLoaderImage (
+    IN  EFI_FILE_PROTOCOL  *RootDir,
+    IN  CHAR16             *FileName,
+    OUT UINT8             **ImageData OPTIONAL,
+    OUT UINTN              *ImageSize OPTIONAL
 ) {
     //UINTN            LoaderType;
 
+    if (ImageData != NULL) {
+        *ImageData = NULL;
+    }
+    if (ImageSize != NULL) {
+        *ImageSize = 0;
+    }
+
     if (AppleFirmware &&
         (RootDir == NULL || FileName == NULL)
     ) {
@@ -383,6 +395,8 @@ BOOLEAN IsValidLoader (
     BOOLEAN          ApplePlainBinary;
     UINTN            SignaturePosition;
     UINTN            Size;
+    UINTN            DataSize;
+    UINT8           *Data;
     CHAR8           *Header;
     EFI_FILE_HANDLE  FileHandle;
 
@@ -409,6 +423,8 @@ BOOLEAN IsValidLoader (
         return FALSE;
     }
 
+    Data     = NULL;
+    DataSize = 0;
     do {
         IsValid = AppleFatBinary = ApplePlainBinary = FALSE;
 
@@ -427,28 +443,52 @@ BOOLEAN IsValidLoader (
             break;
         }
 
-        Status = REFIT_CALL_5_WRAPPER(
-            RootDir->Open, RootDir,
-            &FileHandle, FileName,
-            EFI_FILE_MODE_READ, 0
-        );
+        Status = EFI_NOT_STARTED;
+        if (ImageData != NULL) {
+            // Read the whole file in one go and check the copy in memory
+            Status = egLoadFile (RootDir, FileName, &Data, &DataSize);
+            if (!EFI_ERROR(Status)) {
+                Size = (DataSize < EFI_HEADER_SIZE) ? DataSize : EFI_HEADER_SIZE;
+                CopyMem (Header, Data, Size);
+            }
+            else {
+                // DA-TAG: Large images such as UKIs may not fit a pool allocation
+                //         Check the header only and leave LoadImage() to read the file
+                #if REFIT_DEBUG > 0
+                ALT_LOG(1, LOG_THREE_STAR_MID,
+                    L"'%r' When Pre-Loading Image ... Reading Header Only",
+                    Status
+                );
+                #endif
+
+                Data     = NULL;
+                DataSize = 0;
+            }
+        }
         if (EFI_ERROR(Status)) {
-            #if REFIT_DEBUG > 0
-            AbortReason = L":- 'File Handle *NOT* Accessible'";
-            #endif
+            Status = REFIT_CALL_5_WRAPPER(
+                RootDir->Open, RootDir,
+                &FileHandle, FileName,
+                EFI_FILE_MODE_READ, 0
+            );
+            if (EFI_ERROR(Status)) {
+                #if REFIT_DEBUG > 0
+                AbortReason = L":- 'File Handle *NOT* Accessible'";
+                #endif
 
-            //LoaderType = LOADER_TYPE_INVALID;
+                //LoaderType = LOADER_TYPE_INVALID;
 
-            // Early Return
-            break;
-        }
+                // Early Return
+                break;
+            }
 
-        Size = EFI_HEADER_SIZE;
-        Status = REFIT_CALL_3_WRAPPER(
-            FileHandle->Read, FileHandle,
-            &Size, Header
-        );
-        REFIT_CALL_1_WRAPPER(FileHandle->Close, FileHandle);
+            Size = EFI_HEADER_SIZE;
+            Status = REFIT_CALL_3_WRAPPER(
+                FileHandle->Read, FileHandle,
+                &Size, Header
+            );
+            REFIT_CALL_1_WRAPPER(FileHandle->Close, FileHandle);
+        }
         if (EFI_ERROR(Status)) {
             #if REFIT_DEBUG > 0
             AbortReason = L":- 'File is *NOT* Readable'";
@@ -577,8 +617,26 @@ BOOLEAN IsValidLoader (
 
     MY_FREE_POOL(Header);
 
+    if (IsValid && ImageData != NULL) {
+        *ImageData = Data;
+        if (ImageSize != NULL) {
+            *ImageSize = DataSize;
+        }
+    }
+    else {
+        MY_FREE_POOL(Data);
+    }
+
     return IsValid;
 #endif
+} // static BOOLEAN IsValidLoaderImage()
+
+// Returns TRUE if this file is a valid EFI loader file, and is proper ARCH
+BOOLEAN IsValidLoader (
+    EFI_FILE_PROTOCOL *RootDir,
+    CHAR16            *FileName
+) {
+    return IsValidLoaderImage (RootDir, FileName, NULL, NULL);
 } // BOOLEAN IsValidLoader()
 
 // Launch an EFI binary
@@ -600,11 +658,16 @@ EFI_STATUS StartEFIImage (
     CHAR16                              *MsgStr;
     CHAR16                              *EspGUID;
     CHAR16                              *FullLoadOptions;
+    UINT8                               *ImageData;
+    UINTN                                ImageSize;
     BOOLEAN                              LoaderValid;
+    BOOLEAN                              Preloaded;
     EFI_HANDLE                           ChildImageHandle;
     EFI_HANDLE                           ChildImageHandle2;
     EFI_DEVICE_PATH_PROTOCOL            *DevicePath;
+    EFI_DEVICE_PATH_PROTOCOL            *ChildFilePath;
     EFI_LOADED_IMAGE_PROTOCOL           *ChildLoadedImage;
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL     *FileSystem;
 
     #if REFIT_DEBUG > 0
     CHAR16  *ConstMsgStr;
@@ -667,7 +730,17 @@ EFI_STATUS StartEFIImage (
         // Some EFIs crash if attempting to load drivers for an invalid architecture, so
         // protect for this condition; but sometimes Volume comes back NULL, so provide
         // an exception. (TODO: Handle this special condition better.)
-        LoaderValid = IsValidLoader (Volume->RootDir, Filename);
+        // DA-TAG: Shim hooks LoadImage() and is left to read the file itself
+        //         Drivers stay resident and are always loaded from file
+        ImageData     = NULL;
+        ImageSize     = 0;
+        ChildFilePath = NULL;
+        Preloaded     = !IsDriver && GlobalConfig.PreloadLoaders && !(secure_mode() && ShimLoaded());
+        LoaderValid = IsValidLoaderImage (
+            Volume->RootDir, Filename,
+            (Preloaded) ? &ImageData : NULL, &ImageSize
+        );
+        Preloaded   = (ImageData != NULL);
         if (!LoaderValid) {
             #if REFIT_DEBUG > 0
             MsgStr = StrDuplicate (L"ERROR: Invalid Binary!!");
@@ -708,25 +781,46 @@ EFI_STATUS StartEFIImage (
         }
 
         ChildImageHandle = NULL;
-        // DA-TAG: Investigate This
-        //         Commented-out lines below could be more efficient if file were read ahead of
-        //         time and passed as a pre-loaded image to LoadImage(), but it does not work on my
-        //         32-bit Mac Mini or my 64-bit Intel box when launching a Linux kernel.
-        //         The kernel returns a "Failed to handle fs_proto" error message.
-        //
-        //         Track down the cause of this error and fix it, if possible.
-        /*
-        Status = REFIT_CALL_6_WRAPPER(
-            gBS->LoadImage, FALSE,
-            SelfImageHandle, DevicePath,
-            ImageData, ImageSize, &ChildImageHandle
-        );
-        */
-        Status = REFIT_CALL_6_WRAPPER(
-            gBS->LoadImage, FALSE,
-            SelfImageHandle, DevicePath,
-            NULL, 0, &ChildImageHandle
-        );
+        if (Preloaded) {
+            // Pass the copy read by IsValidLoaderImage() ... 'DevicePath' still
+            // sets the file path of the image, but some firmware then leaves
+            // its device handle unset (See "fs_proto" below)
+            #if REFIT_DEBUG > 0
+            ALT_LOG(1, LOG_LINE_NORMAL,
+                L"Loading Pre-Loaded Image (%d Bytes)",
+                ImageSize
+            );
+            #endif
+
+            Status = REFIT_CALL_6_WRAPPER(
+                gBS->LoadImage, FALSE,
+                SelfImageHandle, DevicePath,
+                ImageData, ImageSize, &ChildImageHandle
+            );
+            MY_FREE_POOL(ImageData);
+
+            if (EFI_ERROR(Status) &&
+                Status != EFI_ACCESS_DENIED &&
+                Status != EFI_SECURITY_VIOLATION
+            ) {
+                #if REFIT_DEBUG > 0
+                ALT_LOG(1, LOG_THREE_STAR_MID,
+                    L"'%r' When Loading Pre-Loaded Image ... Loading from File",
+                    Status
+                );
+                #endif
+
+                Preloaded = FALSE;
+            }
+        }
+        if (!Preloaded) {
+            ChildImageHandle = NULL;
+            Status = REFIT_CALL_6_WRAPPER(
+                gBS->LoadImage, FALSE,
+                SelfImageHandle, DevicePath,
+                NULL, 0, &ChildImageHandle
+            );
+        }
         MY_FREE_POOL(DevicePath);
         ReturnStatus = Status;
 
@@ -792,6 +886,33 @@ EFI_STATUS StartEFIImage (
                 break;
             }
 
+            if (Preloaded) {
+                // DA-TAG: Linux kernels look for the SimpleFileSystem protocol on the
+                //         device handle of their image to load initrd files from. Some
+                //         firmware does not set this for pre-loaded images and kernels
+                //         then fail with "Failed to handle fs_proto" ... Point it at the
+                //         volume the loader was read from in such cases
+                Status = REFIT_CALL_3_WRAPPER(
+                    gBS->HandleProtocol, ChildLoadedImage->DeviceHandle,
+                    &gEfiSimpleFileSystemProtocolGuid, (VOID **) &FileSystem
+                );
+                if (EFI_ERROR(Status)) {
+                    ChildLoadedImage->DeviceHandle = Volume->DeviceHandle;
+
+                    #if REFIT_DEBUG > 0
+                    ALT_LOG(1, LOG_THREE_STAR_MID,
+                        L"Set Device Handle of Pre-Loaded Image to Loader Volume"
+                    );
+                    #endif
+                }
+                if (ChildLoadedImage->FilePath == NULL) {
+                    // DA-TAG: Firmware that left this unset does not own it
+                    //         Freed here once the image has returned
+                    ChildFilePath = FileDevicePath (NULL, Filename);
+                    ChildLoadedImage->FilePath = ChildFilePath;
+                }
+            }
+
             ChildLoadedImage->LoadOptions     = (VOID *) FullLoadOptions;
             ChildLoadedImage->LoadOptionsSize = FullLoadOptions
                 ? ((UINT32) StrLen (FullLoadOptions) + 1) * sizeof (CHAR16) : 0;
@@ -902,6 +1023,7 @@ EFI_STATUS StartEFIImage (
         // DA-TAG: bailout_unload:
         // Unload the image ... we do not care if it works or not
         if (!IsDriver) REFIT_CALL_1_WRAPPER(gBS->UnloadImage, ChildImageHandle);
+        MY_FREE_POOL(ChildFilePath);
     } while (0); // This 'loop' only runs once
 
     // DA-TAG: bailout:
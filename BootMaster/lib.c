@@ -58,6 +58,8 @@
 #include "apple.h"
 #include "scan.h"
 #include "mystrings.h"
+#include "prefetch.h"
+#include "profile.h"
 
 #ifdef __MAKEWITH_GNUEFI
 #define EfiReallocatePool ReallocatePool
@@ -143,6 +145,13 @@ UINTN                       DataVolumesCount        = 0;
 UINTN                       HfsRecoveryCount        = 0;
 UINTN                       VolumesCount            = 0;
 
+static DIR_SNAPSHOT       **DirSnapshots            = NULL;
+static UINTN                DirSnapshotCount        = 0;
+static DIR_SNAPSHOT       **StaleDirSnapshots       = NULL;
+static UINTN                StaleDirSnapshotCount   = 0;
+static BOOLEAN              DirSnapshotsActive      = FALSE;
+static CHAR16              *VarsFolderName          = NULL;
+
 UINT64                      ReadWriteCreate     = EFI_FILE_MODE_READ|EFI_FILE_MODE_WRITE|EFI_FILE_MODE_CREATE;
 
 BOOLEAN                     FoundExternalDisk   = FALSE;
@@ -603,6 +612,10 @@ EFI_STATUS FindVarsDir (VOID) {
         #endif
     }
 
+    if (!EFI_ERROR(Status)) {
+        VarsFolderName = VarsFolder;
+    }
+
     return Status;
 } // EFI_STATUS FindVarsDir()
 
@@ -833,6 +846,9 @@ EFI_STATUS EfivarSetRaw (
                 gVarsDir, VariableName,
                 (UINT8 *) VariableData, VariableSize
             );
+
+            // Files have changed ... Reread the vars folder when next used
+            MarkDirSnapshotsStale (VarsFolderName);
         }
 
         #if REFIT_DEBUG > 0
@@ -1309,6 +1325,223 @@ VOID SetFilesystemData (
     } // if ((Buffer != NULL) && (Volume != NULL))
 } // UINT32 SetFilesystemData()
 
+// Boot code signatures searched for by ScanVolumeBootcode(). Each entry
+// must lie in the first 'Window' bytes of the boot sector sample. Built-in
+// entries are indexed by the BOOTCODE_SIG_* values in lib.h and entries
+// from 'legacy_signature' tokens follow them.
+typedef struct {
+    CHAR8   *Pattern;
+    UINTN    Length;
+    UINTN    Window;
+    CHAR16  *IconName;
+    CHAR16  *OSName;
+} BOOTCODE_SIG;
+
+#define SIG_ENTRY(Pattern, Window) { (CHAR8 *) Pattern, sizeof (Pattern) - 1, Window, NULL, NULL }
+
+static BOOTCODE_SIG BootcodeSigs[BOOTCODE_SIG_MAX] = {
+    SIG_ENTRY("EXFAT",                                          512),
+    SIG_ENTRY("ISOLINUX",                               SECTOR_SIZE),
+    SIG_ENTRY("Geom\0Hard Disk\0Read\0 Error",                  512),
+    SIG_ENTRY("Starting the BTX loader",                SECTOR_SIZE),
+    SIG_ENTRY("Boot loader too large",                  SECTOR_SIZE),
+    SIG_ENTRY("I/O error loading boot loader",          SECTOR_SIZE),
+    SIG_ENTRY("!Loading",                                       512),
+    SIG_ENTRY("/cdboot\0/CDBOOT\0",                     SECTOR_SIZE),
+    SIG_ENTRY("Not a bootxx image",                             512),
+    SIG_ENTRY("NTLDR",                                  SECTOR_SIZE),
+    SIG_ENTRY("BOOTMGR",                                SECTOR_SIZE),
+    SIG_ENTRY("CPUBOOT SYS",                                    512),
+    SIG_ENTRY("KERNEL  SYS",                                    512),
+    SIG_ENTRY("OS2LDR",                                         512),
+    SIG_ENTRY("OS2BOOT",                                        512),
+    SIG_ENTRY("Be Boot Loader",                                 512),
+    SIG_ENTRY("yT Boot Loader",                                 512),
+    SIG_ENTRY("\x04" "beos\x06" "system\x05" "zbeos",           512),
+    SIG_ENTRY("\x06" "system\x0c" "haiku_loader",               512),
+    SIG_ENTRY("Non-system disk",                                512),
+    SIG_ENTRY("This is not a bootable disk",                    512),
+    SIG_ENTRY("Press any key to restart",                       512)
+};
+static UINTN    BootcodeSigCount   = BOOTCODE_SIG_BUILTIN;
+
+// Table indices grouped by first pattern byte ... Rebuilt on table changes
+static UINT8    BootcodeSigOrder[BOOTCODE_SIG_MAX];
+static UINT8    BootcodeSigStart[257];
+static UINTN    BootcodeSigLimit   = 0;
+static BOOLEAN  BootcodeSigIndexed = FALSE;
+
+static
+VOID IndexBootcodeSignatures (VOID) {
+    UINTN i;
+    UINT8 First;
+    UINT8 Next[256];
+
+    ZeroMem (BootcodeSigStart, sizeof (BootcodeSigStart));
+    BootcodeSigLimit = 0;
+    for (i = 0; i < BootcodeSigCount; i++) {
+        BootcodeSigStart[(UINT8) BootcodeSigs[i].Pattern[0] + 1]++;
+        if (BootcodeSigLimit < BootcodeSigs[i].Window) {
+            BootcodeSigLimit = BootcodeSigs[i].Window;
+        }
+    }
+    for (i = 0; i < 256; i++) {
+        BootcodeSigStart[i + 1] += BootcodeSigStart[i];
+    }
+
+    CopyMem (Next, BootcodeSigStart, sizeof (Next));
+    for (i = 0; i < BootcodeSigCount; i++) {
+        First = (UINT8) BootcodeSigs[i].Pattern[0];
+        BootcodeSigOrder[Next[First]++] = (UINT8) i;
+    }
+
+    BootcodeSigIndexed = TRUE;
+} // static VOID IndexBootcodeSignatures()
+
+// Sets 'Matched[i]' for every signature found in 'Buffer' in one pass.
+// Only signatures starting with the byte at each offset are compared.
+// A signature matches at 'Offset' if 'Offset + Length' is below its
+// window, as with FindMem().
+VOID MatchBootcodeSignatures (
+    IN  UINT8    *Buffer,
+    IN  UINTN     BufferSize,
+    OUT BOOLEAN  *Matched
+) {
+    UINTN          Offset;
+    UINTN          Limit;
+    UINTN          Index;
+    UINTN          j;
+    UINT8          First;
+    BOOTCODE_SIG  *Sig;
+
+    ZeroMem (Matched, sizeof (BOOLEAN) * BOOTCODE_SIG_MAX);
+
+    if (!BootcodeSigIndexed) {
+        IndexBootcodeSignatures();
+    }
+
+    Limit = (BufferSize < BootcodeSigLimit) ? BufferSize : BootcodeSigLimit;
+    for (Offset = 0; Offset < Limit; Offset++) {
+        First = Buffer[Offset];
+        for (j = BootcodeSigStart[First]; j < BootcodeSigStart[First + 1]; j++) {
+            Index = BootcodeSigOrder[j];
+            Sig   = &BootcodeSigs[Index];
+            if (Matched[Index]                          ||
+                (Offset + Sig->Length) >= Sig->Window   ||
+                (Offset + Sig->Length) >= BufferSize
+            ) {
+                continue;
+            }
+
+            if (CompareMem (Buffer + Offset + 1, Sig->Pattern + 1, Sig->Length - 1) == 0) {
+                Matched[Index] = TRUE;
+            }
+        } // for j
+    } // for Offset
+} // VOID MatchBootcodeSignatures()
+
+// Drops signatures added by 'legacy_signature' tokens. Their strings are
+// kept, and reused by AddBootcodeSignature() where unchanged, as volumes
+// scanned earlier may still point to them.
+VOID ClearBootcodeSignatures (VOID) {
+    BootcodeSigCount   = BOOTCODE_SIG_BUILTIN;
+    BootcodeSigIndexed = FALSE;
+} // VOID ClearBootcodeSignatures()
+
+// Adds a signature for ScanVolumeBootcode(). 'Pattern' is ASCII text in
+// which '\xHH' gives a raw byte. It is searched for in the first sector.
+BOOLEAN AddBootcodeSignature (
+    IN CHAR16 *Pattern,
+    IN CHAR16 *IconName,
+    IN CHAR16 *OSLabel
+) {
+    UINTN          i;
+    UINTN          Length;
+    UINT8          Bytes[SECTOR_SIZE];
+    CHAR16         Digits[3];
+    CHAR8         *NewPattern;
+    CHAR16        *NewIconName;
+    CHAR16        *OSName;
+    BOOTCODE_SIG  *Sig;
+
+    if (Pattern == NULL || IconName == NULL || OSLabel == NULL ||
+        BootcodeSigCount >= BOOTCODE_SIG_MAX
+    ) {
+        // Early Return
+        return FALSE;
+    }
+
+    Length = 0;
+    for (i = 0; Pattern[i] != L'\0' && Length < (SECTOR_SIZE - 1); i++) {
+        if (Pattern[i] == L'\\' && (Pattern[i + 1] == L'x' || Pattern[i + 1] == L'X')) {
+            // Escapes take exactly two hex digits
+            Digits[0] = Pattern[i + 2];
+            Digits[1] = (Digits[0] == L'\0') ? L'\0' : Pattern[i + 3];
+            Digits[2] = L'\0';
+            if (Digits[1] == L'\0' || !IsValidHex (Digits)) {
+                // Early Return ... Malformed escape
+                return FALSE;
+            }
+
+            Bytes[Length++] = (UINT8) StrToHex (Digits, 0, 2);
+            i += 3;
+        }
+        else if (Pattern[i] < 0x80) {
+            Bytes[Length++] = (UINT8) Pattern[i];
+        }
+        else {
+            // Early Return ... Not ASCII
+            return FALSE;
+        }
+    } // for
+
+    if (Length == 0 || Pattern[i] != L'\0') {
+        // Early Return ... Empty or too long
+        return FALSE;
+    }
+
+    OSName = PoolPrint (L"Instance: %s (Legacy)", OSLabel);
+    if (OSName == NULL) {
+        // Early Return
+        return FALSE;
+    }
+
+    Sig = &BootcodeSigs[BootcodeSigCount];
+    if (Sig->Pattern == NULL                            ||
+        Sig->Length  != Length                          ||
+        CompareMem (Sig->Pattern, Bytes, Length) != 0   ||
+        StrCmp (Sig->IconName, IconName) != 0           ||
+        StrCmp (Sig->OSName, OSName) != 0
+    ) {
+        // Allocate everything first ... A failure leaves the slot as it was
+        NewPattern  = AllocateCopyPool (Length, Bytes);
+        NewIconName = StrDuplicate (IconName);
+        if (NewPattern == NULL || NewIconName == NULL) {
+            MY_FREE_POOL(NewPattern);
+            MY_FREE_POOL(NewIconName);
+            MY_FREE_POOL(OSName);
+
+            // Early Return
+            return FALSE;
+        }
+
+        // Only the pattern is private ... Volumes may still point to the old strings
+        MY_FREE_POOL(Sig->Pattern);
+        Sig->Pattern  = NewPattern;
+        Sig->IconName = NewIconName;
+        Sig->OSName   = OSName;
+        OSName        = NULL;
+    }
+    MY_FREE_POOL(OSName);
+
+    Sig->Length  = Length;
+    Sig->Window  = SECTOR_SIZE;
+    BootcodeSigCount++;
+    BootcodeSigIndexed = FALSE;
+
+    return TRUE;
+} // BOOLEAN AddBootcodeSignature()
+
 static
 VOID ScanVolumeBootcode (
     IN OUT REFIT_VOLUME  *Volume,
@@ -1318,6 +1551,7 @@ VOID ScanVolumeBootcode (
     UINTN                i, SizeMBR;
     UINT8                Buffer[SAMPLE_SIZE];
     BOOLEAN              MbrTableFound;
+    BOOLEAN              Matched[BOOTCODE_SIG_MAX];
     MBR_PARTITION_INFO  *MbrTable;
 
     #if REFIT_DEBUG > 0
@@ -1360,8 +1594,8 @@ VOID ScanVolumeBootcode (
     }
 
     // Look at the boot sector (this is used for both hard disks and El Torito images!)
-    Status = REFIT_CALL_5_WRAPPER(
-        Volume->BlockIO->ReadBlocks, Volume->BlockIO,
+    Status = PrefetchReadBlocks (
+        Volume->BlockIO,
         Volume->BlockIO->Media->MediaId, Volume->BlockIOOffset,
         SAMPLE_SIZE, Buffer
     );
@@ -1389,9 +1623,12 @@ VOID ScanVolumeBootcode (
         return;
     }
 
+    // Search for all signatures at once
+    MatchBootcodeSignatures (Buffer, SECTOR_SIZE, Matched);
+
     if ((Buffer[0] != 0) &&
         (*((UINT16 *)(Buffer + 510)) == 0xaa55) &&
-        (FindMem (Buffer, 512, "EXFAT", 5) == -1)
+        !Matched[BOOTCODE_SIG_EXFAT]
     ) {
         *Bootable = Volume->HasBootCode = TRUE;
     }
@@ -1400,13 +1637,13 @@ VOID ScanVolumeBootcode (
     if (CompareMem (Buffer + 2, "LILO",           4) == 0 ||
         CompareMem (Buffer + 6, "LILO",           4) == 0 ||
         CompareMem (Buffer + 3, "SYSLINUX",       8) == 0 ||
-        FindMem (Buffer, SECTOR_SIZE, "ISOLINUX", 8) >= 0
+        Matched[BOOTCODE_SIG_ISOLINUX]
     ) {
         Volume->HasBootCode  = TRUE;
         Volume->OSIconName   = L"linux";
         Volume->OSName       = L"Instance: Linux (Legacy)";
     }
-    else if (FindMem (Buffer, 512, "Geom\0Hard Disk\0Read\0 Error", 26) >= 0) {
+    else if (Matched[BOOTCODE_SIG_GRUB]) {
         // GRUB
         Volume->HasBootCode  = TRUE;
         Volume->OSIconName   = L"grub,linux";
@@ -1418,7 +1655,7 @@ VOID ScanVolumeBootcode (
             *((UINT32 *)(Buffer + 506)) == 50000 &&
             *((UINT16 *)(Buffer + 510)) == 0xaa55
         ) || (
-            FindMem (Buffer, SECTOR_SIZE, "Starting the BTX loader", 23) >= 0
+            Matched[BOOTCODE_SIG_BTX]
         )
     ) {
         Volume->HasBootCode  = TRUE;
@@ -1427,8 +1664,8 @@ VOID ScanVolumeBootcode (
     }
     else if (
         (*((UINT16 *)(Buffer + 510)) == 0xaa55) &&
-        (FindMem (Buffer, SECTOR_SIZE, "Boot loader too large",         21) >= 0) &&
-        (FindMem (Buffer, SECTOR_SIZE, "I/O error loading boot loader", 29) >= 0)
+        Matched[BOOTCODE_SIG_FBSD_LARGE] &&
+        Matched[BOOTCODE_SIG_FBSD_IO_ERROR]
     ) {
         // If more differentiation needed, also search for
         // "Invalid Partition Table" &/or "Missing boot loader".
@@ -1437,66 +1674,77 @@ VOID ScanVolumeBootcode (
         Volume->OSName       = L"Instance: FreeBSD (Legacy)";
     }
     else if (
-        FindMem (Buffer, 512,         "!Loading",            8) >= 0 ||
-        FindMem (Buffer, SECTOR_SIZE, "/cdboot\0/CDBOOT\0", 16) >= 0
+        Matched[BOOTCODE_SIG_OBSD_LOADING] ||
+        Matched[BOOTCODE_SIG_OBSD_CDBOOT]
     ) {
         Volume->HasBootCode  = TRUE;
         Volume->OSIconName   = L"openbsd";
         Volume->OSName       = L"Instance: OpenBSD (Legacy)";
     }
     else if (
-        FindMem (Buffer, 512, "Not a bootxx image", 18) >= 0 ||
+        Matched[BOOTCODE_SIG_NBSD_BOOTXX] ||
         *((UINT32 *)(Buffer + 1028)) == 0x7886b6d1
     ) {
         Volume->HasBootCode  = TRUE;
         Volume->OSIconName   = L"netbsd";
         Volume->OSName       = L"Instance: NetBSD (Legacy)";
     }
-    else if (FindMem (Buffer, SECTOR_SIZE, "NTLDR", 5) >= 0) {
+    else if (Matched[BOOTCODE_SIG_NTLDR]) {
         // Windows NT/200x/XP
         Volume->HasBootCode  = TRUE;
         Volume->OSIconName   = L"win";
         Volume->OSName       = L"Instance: Windows (NT/XP)";
     }
-    else if (FindMem (Buffer, SECTOR_SIZE, "BOOTMGR", 7) >= 0) {
+    else if (Matched[BOOTCODE_SIG_BOOTMGR]) {
         // Windows Vista/7/8/10
         Volume->HasBootCode  = TRUE;
         Volume->OSIconName   = L"win8,win";
         Volume->OSName       = L"Instance: Windows (Legacy)";
     }
     else if (
-        FindMem (Buffer, 512, "CPUBOOT SYS", 11) >= 0 ||
-        FindMem (Buffer, 512, "KERNEL  SYS", 11) >= 0
+        Matched[BOOTCODE_SIG_CPUBOOT] ||
+        Matched[BOOTCODE_SIG_KERNEL]
     ) {
         Volume->HasBootCode  = TRUE;
         Volume->OSIconName   = L"freedos";
         Volume->OSName       = L"Instance: FreeDOS (Legacy)";
     }
     else if (
-        FindMem (Buffer, 512, "OS2LDR",  6) >= 0 ||
-        FindMem (Buffer, 512, "OS2BOOT", 7) >= 0
+        Matched[BOOTCODE_SIG_OS2LDR] ||
+        Matched[BOOTCODE_SIG_OS2BOOT]
     ) {
         Volume->HasBootCode  = TRUE;
         Volume->OSIconName   = L"ecomstation";
         Volume->OSName       = L"Instance: eComStation (Legacy)";
     }
-    else if (FindMem (Buffer, 512, "Be Boot Loader", 14) >= 0) {
+    else if (Matched[BOOTCODE_SIG_BEOS]) {
         Volume->HasBootCode  = TRUE;
         Volume->OSIconName   = L"beos";
         Volume->OSName       = L"Instance: BeOS (Legacy)";
     }
-    else if (FindMem (Buffer, 512, "yT Boot Loader", 14) >= 0) {
+    else if (Matched[BOOTCODE_SIG_ZETA]) {
         Volume->HasBootCode  = TRUE;
         Volume->OSIconName   = L"zeta,beos";
         Volume->OSName       = L"Instance: ZETA (Legacy)";
     }
     else if (
-        FindMem (Buffer, 512, "\x04" "beos\x06" "system\x05" "zbeos", 18) >= 0 ||
-        FindMem (Buffer, 512, "\x06" "system\x0c" "haiku_loader",     20) >= 0
+        Matched[BOOTCODE_SIG_ZBEOS] ||
+        Matched[BOOTCODE_SIG_HAIKU]
     ) {
         Volume->HasBootCode  = TRUE;
         Volume->OSIconName   = L"haiku,beos";
         Volume->OSName       = L"Instance: Haiku (Legacy)";
+    }
+    else {
+        // Signatures from 'legacy_signature' tokens
+        for (i = BOOTCODE_SIG_BUILTIN; i < BootcodeSigCount; i++) {
+            if (Matched[i]) {
+                Volume->HasBootCode  = TRUE;
+                Volume->OSIconName   = BootcodeSigs[i].IconName;
+                Volume->OSName       = BootcodeSigs[i].OSName;
+                break;
+            }
+        }
     } // CompareMem
 
     /**
@@ -1510,15 +1758,15 @@ VOID ScanVolumeBootcode (
         if (GlobalConfig.LegacyType == LEGACY_TYPE_MAC && Volume->FSType == FS_TYPE_NTFS) {
             Volume->HasBootCode = HasWindowsBiosBootFiles (Volume);
         }
-        else if (FindMem (Buffer, 512, "Non-system disk", 15) >= 0) {
+        else if (Matched[BOOTCODE_SIG_NON_SYSTEM]) {
             // Dummy FAT boot sector (created by OS X's newfs_msdos)
             Volume->HasBootCode = FALSE;
         }
-        else if (FindMem (Buffer, 512, "This is not a bootable disk", 27) >= 0) {
+        else if (Matched[BOOTCODE_SIG_NOT_BOOTABLE]) {
             // Dummy FAT boot sector (created by Linux's mkdosfs)
             Volume->HasBootCode = FALSE;
         }
-        else if (FindMem (Buffer, 512, "Press any key to restart", 24) >= 0) {
+        else if (Matched[BOOTCODE_SIG_PRESS_KEY]) {
             // Dummy FAT boot sector (created by Windows)
             Volume->HasBootCode = FALSE;
         }
@@ -2121,8 +2369,8 @@ VOID ScanExtendedPartition (
     ExtBase = MbrEntry->StartLBA;
     for (ExtCurrent = ExtBase; ExtCurrent; ExtCurrent = NextExtCurrent) {
         // read current EMBR
-        Status = REFIT_CALL_5_WRAPPER(
-            WholeDiskVolume->BlockIO->ReadBlocks, WholeDiskVolume->BlockIO,
+        Status = PrefetchReadBlocks (
+            WholeDiskVolume->BlockIO,
             WholeDiskVolume->BlockIO->Media->MediaId, ExtCurrent,
             512, SectorBuffer
         );
@@ -2466,11 +2714,91 @@ CHAR16 * GetApfsRoleString (
 } // static CHAR16 * GetApfsRoleString()
 #endif
 
+// Check whether two volume records describe the same volume.
+// Volumes match if they share the device handle, device path, volume UUID and partition GUID.
+BOOLEAN SameVolume (
+    IN REFIT_VOLUME *Volume1,
+    IN REFIT_VOLUME *Volume2
+) {
+    UINTN PathSize;
+
+    if (Volume1 == NULL                     ||
+        Volume2 == NULL                     ||
+        Volume1->DevicePath == NULL         ||
+        Volume2->DevicePath == NULL         ||
+        Volume1->DeviceHandle != Volume2->DeviceHandle
+    ) {
+        return FALSE;
+    }
+
+    PathSize = GetDevicePathSize (Volume1->DevicePath);
+    if (GetDevicePathSize (Volume2->DevicePath) != PathSize                     ||
+        CompareMem (Volume1->DevicePath, Volume2->DevicePath, PathSize) != 0    ||
+        !GuidsAreEqual (&(Volume1->VolUuid),  &(Volume2->VolUuid))               ||
+        !GuidsAreEqual (&(Volume1->PartGuid), &(Volume2->PartGuid))
+    ) {
+        return FALSE;
+    }
+
+    return TRUE;
+} // BOOLEAN SameVolume()
+
+// Compare the volumes found by a rescan with those found before it.
+// Volumes in 'NewList' that were not in 'OldList', or have changed, are flagged
+// as 'IsNewOnRescan'. Unchanged volumes take over the volume icon already loaded
+// for them. Returns the number of volumes in 'OldList' that are no longer present.
+UINTN DiffVolumes (
+    IN     REFIT_VOLUME **OldList,
+    IN     UINTN          OldCount,
+    IN OUT REFIT_VOLUME **NewList,
+    IN     UINTN          NewCount
+) {
+    UINTN     i, j;
+    UINTN     GoneCount;
+    BOOLEAN  *Matched;
+
+    Matched = (OldCount > 0) ? AllocateZeroPool (sizeof (BOOLEAN) * OldCount) : NULL;
+    if (Matched == NULL) {
+        // Treat every volume as new
+        OldCount = 0;
+    }
+
+    for (i = 0; i < NewCount; i++) {
+        NewList[i]->IsNewOnRescan = TRUE;
+        for (j = 0; j < OldCount; j++) {
+            if (Matched[j] || !SameVolume (OldList[j], NewList[i])) {
+                continue;
+            }
+
+            Matched[j] = TRUE;
+            NewList[i]->IsNewOnRescan = FALSE;
+
+            if (NewList[i]->VolIconImage == NULL) {
+                NewList[i]->VolIconImage = OldList[j]->VolIconImage;
+                OldList[j]->VolIconImage = NULL;
+            }
+
+            break;
+        } // for j
+    } // for i
+
+    GoneCount = 0;
+    for (j = 0; j < OldCount; j++) {
+        if (!Matched[j]) {
+            GoneCount++;
+        }
+    }
+    MY_FREE_POOL(Matched);
+
+    return GoneCount;
+} // UINTN DiffVolumes()
+
 VOID ScanVolumes (VOID) {
     EFI_STATUS              Status;
     EFI_HANDLE             *Handles;
     REFIT_VOLUME           *Volume;
     REFIT_VOLUME           *WholeDiskVolume;
+    REFIT_VOLUME          **PrevVolumes;
     MBR_PARTITION_INFO     *MbrTable;
     UINTN                   SectorSum, i;
     UINTN                   HandleIndex;
@@ -2478,6 +2806,7 @@ VOID ScanVolumes (VOID) {
     UINTN                   VolumeIndex2;
     UINTN                   PartitionIndex;
     UINTN                   HandleCount;
+    UINTN                   PrevVolumesCount;
     UINT8                  *SectorBuffer1;
     UINT8                  *SectorBuffer2;
     CHAR16                 *RoleStr;
@@ -2490,6 +2819,7 @@ VOID ScanVolumes (VOID) {
     APPLE_APFS_VOLUME_ROLE  VolumeRole;
 
     #if REFIT_DEBUG > 0
+    UINTN    GoneCount;
     CHAR16  *MsgStr;
     CHAR16  *PartName;
     CHAR16  *PartGUID;
@@ -2510,12 +2840,15 @@ VOID ScanVolumes (VOID) {
     MY_FREE_POOL(MsgStr);
     #endif
 
+    PrevVolumes      = NULL;
+    PrevVolumesCount = 0;
     if (SelfVolRun) {
         // Clear Volume Lists if not Scanning for Self Volume
-        FreeVolumes (
-            &Volumes,
-            &VolumesCount
-        );
+        // Keep the current volumes until the rescanned ones have been compared with them
+        PrevVolumes      = Volumes;
+        PrevVolumesCount = VolumesCount;
+        Volumes          = NULL;
+        VolumesCount     = 0;
         FreeSyncVolumes();
         ForgetPartitionTables();
     }
@@ -2540,6 +2873,8 @@ VOID ScanVolumes (VOID) {
         MY_FREE_POOL(MsgStr);
         #endif
 
+        FreeVolumes (&PrevVolumes, &PrevVolumesCount);
+
         return;
     }
 
@@ -2550,8 +2885,14 @@ VOID ScanVolumes (VOID) {
     );
     #endif
 
+    // Start reading all boot sectors now if 'prefetch_volumes' is set
+    PrefetchVolumes (Handles, HandleCount);
+
     UuidList = AllocateZeroPool (sizeof (EFI_GUID) * HandleCount);
     if (UuidList == NULL) {
+        PrefetchFree();
+        FreeVolumes (&PrevVolumes, &PrevVolumesCount);
+
         #if REFIT_DEBUG > 0
         Status = EFI_BUFFER_TOO_SMALL;
 
@@ -2591,6 +2932,8 @@ VOID ScanVolumes (VOID) {
         Volume = AllocateZeroPool (sizeof (REFIT_VOLUME));
         if (Volume == NULL) {
             MY_FREE_POOL(UuidList);
+            PrefetchFree();
+            FreeVolumes (&PrevVolumes, &PrevVolumesCount);
 
             #if REFIT_DEBUG > 0
             Status = EFI_BUFFER_TOO_SMALL;
@@ -2612,7 +2955,7 @@ VOID ScanVolumes (VOID) {
 
         Volume->DeviceHandle = Handles[HandleIndex];
         AddPartitionTable (Volume);
-        ScanVolume (Volume);
+        PROFILE_FUNCTION(L"ScanVolume", ScanVolume (Volume));
 
         UuidList[HandleIndex] = Volume->VolUuid;
         // Deduplicate filesystem UUID so that we do not add duplicate entries for file systems
@@ -2769,9 +3112,11 @@ VOID ScanVolumes (VOID) {
                         CheckedAPFS = TRUE;
                         // DA-TAG: Do not scan any volumes called "Recovery" if APFS is present
                         //         Apply the same to 'Update' and 'VM'
+                        FreeScanLists();
                         MergeUniqueStrings (&GlobalConfig.DontScanVolumes, L"Recovery", L',');
                         MergeUniqueStrings (&GlobalConfig.DontScanVolumes, L"Update", L','  );
                         MergeUniqueStrings (&GlobalConfig.DontScanVolumes, L"VM", L','      );
+                        CompileScanLists();
                     }
 
                     PartType        = L"APFS";
@@ -2943,6 +3288,32 @@ VOID ScanVolumes (VOID) {
 
     MY_FREE_POOL(UuidList);
     MY_FREE_POOL(Handles);
+    PrefetchFree();
+
+    if (SelfVolRun) {
+        // Flag new or changed volumes so that rescans only look for loaders on those
+        #if REFIT_DEBUG == 0
+        DiffVolumes (PrevVolumes, PrevVolumesCount, Volumes, VolumesCount);
+        #else
+        GoneCount = DiffVolumes (PrevVolumes, PrevVolumesCount, Volumes, VolumesCount);
+        if (PrevVolumesCount > 0) {
+            for (i = 0, VolumeIndex = 0; VolumeIndex < VolumesCount; VolumeIndex++) {
+                if (Volumes[VolumeIndex]->IsNewOnRescan) {
+                    i++;
+                }
+            }
+
+            MsgStr = PoolPrint (
+                L"Volume Changes on Rescan:- %d New/Changed, %d Removed, %d Unchanged",
+                i, GoneCount, VolumesCount - i
+            );
+            ALT_LOG(1, LOG_LINE_NORMAL, L"%s", MsgStr);
+            MY_FREE_POOL(MsgStr);
+        }
+        #endif
+
+        FreeVolumes (&PrevVolumes, &PrevVolumesCount);
+    }
 
     if (!SelfVolSet || !SelfVolRun) {
         SelfVolRun = TRUE;
@@ -3352,29 +3723,6 @@ VOID SetVolumeIcons (VOID) {
 // file and dir functions
 //
 
-BOOLEAN FileExists (
-    IN EFI_FILE_PROTOCOL *BaseDir,
-    IN CHAR16            *RelativePath
-) {
-    EFI_STATUS      Status;
-    EFI_FILE_HANDLE TestFile;
-
-    if (BaseDir != NULL) {
-        Status = REFIT_CALL_5_WRAPPER(
-            BaseDir->Open, BaseDir,
-            &TestFile, RelativePath,
-            EFI_FILE_MODE_READ, 0
-        );
-        if (!EFI_ERROR(Status)) {
-            REFIT_CALL_1_WRAPPER(TestFile->Close, TestFile);
-
-            return TRUE;
-        }
-    }
-
-    return FALSE;
-}
-
 static
 EFI_STATUS DirNextEntry (
     IN     EFI_FILE_PROTOCOL      *Directory,
@@ -3564,11 +3912,18 @@ EFI_STATUS DirNextEntry (
                 break;
             }
         }
+        else {
+            //BREAD_CRUMB(L"%s:  2a 7c 1 - FOR LOOP:- BREAK ... No Filter or Unknown Filter", FuncTag);
+            //LOG_SEP(L"X");
+
+            // No Filter or Unknown Filter -> Return Everything
+            break;
+        }
 
-        //BREAD_CRUMB(L"%s:  3a 8 - FOR LOOP:- END ... No Filter or Unknown Filter", FuncTag);
+        //BREAD_CRUMB(L"%s:  3a 8 - FOR LOOP:- END ... Entry Filtered Out", FuncTag);
         //LOG_SEP(L"X");
 
-        // No Filter or Unknown Filter -> Return Everything
+        MY_FREE_POOL(Buffer);
     } // for ;;
 
     //BREAD_CRUMB(L"%s:  3 - END:- return EFI_STATUS Status = '%r'", FuncTag,
@@ -3580,6 +3935,432 @@ EFI_STATUS DirNextEntry (
     return Status;
 } // EFI_STATUS DirNextEntry()
 
+// Directory snapshots
+//
+// While scanning for loaders, the same directories are probed repeatedly with
+// 'FileExists' and are enumerated by several 'DirIterOpen' loops. When enabled,
+// each directory is read once into a snapshot that answers these requests until
+// 'FreeDirSnapshots' is called. Any request that a snapshot cannot answer with
+// certainty, such as a case-insensitive match on a file system that may be case
+// sensitive, falls through to the file system.
+
+#define DIR_SNAPSHOT_MAX_ENTRIES  1024
+
+static
+CHAR16 DirSnapshotFold (
+    IN CHAR16 Char
+) {
+    return (Char >= L'A' && Char <= L'Z') ? (Char + (L'a' - L'A')) : Char;
+} // static CHAR16 DirSnapshotFold()
+
+// Case-insensitive (ASCII) ordering used to sort and search snapshots
+static
+INTN DirSnapshotNameCmp (
+    IN CHAR16 *Name1,
+    IN CHAR16 *Name2
+) {
+    while (*Name1 != L'\0' && DirSnapshotFold (*Name1) == DirSnapshotFold (*Name2)) {
+        Name1++;
+        Name2++;
+    }
+
+    return (INTN) DirSnapshotFold (*Name1) - (INTN) DirSnapshotFold (*Name2);
+} // static INTN DirSnapshotNameCmp()
+
+static
+VOID FreeDirSnapshot (
+    IN OUT DIR_SNAPSHOT **Snapshot
+) {
+    if (*Snapshot == NULL) {
+        // Early Return
+        return;
+    }
+
+    FreeList ((VOID ***) &(*Snapshot)->Entries, &(*Snapshot)->Count);
+    MY_FREE_POOL((*Snapshot)->Sorted);
+    MY_FREE_POOL((*Snapshot)->DirPath);
+    MY_FREE_POOL(*Snapshot);
+} // static VOID FreeDirSnapshot()
+
+// Read a directory into a new snapshot.
+// Failures are recorded in the snapshot's 'Status' field.
+static
+DIR_SNAPSHOT * CreateDirSnapshot (
+    IN EFI_FILE_PROTOCOL *BaseDir,
+    IN CHAR16            *DirPath
+) {
+    EFI_STATUS          Status;
+    EFI_FILE_HANDLE     DirHandle;
+    EFI_FILE_INFO      *DirEntry;
+    EFI_FILE_INFO      *Entry;
+    DIR_SNAPSHOT       *Snapshot;
+    UINTN               EntrySize;
+    UINTN               i, j, k;
+
+    Snapshot = AllocateZeroPool (sizeof (DIR_SNAPSHOT));
+    if (Snapshot == NULL) {
+        // Early Return
+        return NULL;
+    }
+
+    Snapshot->BaseDir = BaseDir;
+    Snapshot->DirPath = StrDuplicate (DirPath);
+
+    Status = REFIT_CALL_5_WRAPPER(
+        BaseDir->Open, BaseDir,
+        &DirHandle, DirPath,
+        EFI_FILE_MODE_READ, 0
+    );
+    if (EFI_ERROR(Status)) {
+        Snapshot->Status = Status;
+
+        // Early Return
+        return Snapshot;
+    }
+
+    for (;;) {
+        Status = DirNextEntry (DirHandle, &DirEntry, 0);
+        if (EFI_ERROR(Status) || DirEntry == NULL) {
+            break;
+        }
+
+        if (Snapshot->Count >= DIR_SNAPSHOT_MAX_ENTRIES) {
+            MY_FREE_POOL(DirEntry);
+            Status = EFI_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        // Keep a compact copy as DirNextEntry buffers are usually oversized
+        EntrySize = SIZE_OF_EFI_FILE_INFO + StrSize (DirEntry->FileName);
+        Entry     = AllocatePool (EntrySize);
+        if (Entry == NULL) {
+            MY_FREE_POOL(DirEntry);
+            Status = EFI_OUT_OF_RESOURCES;
+            break;
+        }
+        CopyMem (Entry, DirEntry, EntrySize);
+        Entry->Size = EntrySize;
+        MY_FREE_POOL(DirEntry);
+
+        AddListElement ((VOID ***) &Snapshot->Entries, &Snapshot->Count, Entry);
+    } // for
+
+    REFIT_CALL_1_WRAPPER(DirHandle->Close, DirHandle);
+
+    if (!EFI_ERROR(Status) && Snapshot->Count > 0) {
+        Snapshot->Sorted = AllocatePool (sizeof (UINTN) * Snapshot->Count);
+        if (Snapshot->Sorted == NULL) {
+            Status = EFI_OUT_OF_RESOURCES;
+        }
+        else {
+            // Insertion sort ... Directories are small
+            for (i = 0; i < Snapshot->Count; i++) {
+                k = i;
+                for (j = i; j > 0; j--) {
+                    if (DirSnapshotNameCmp (
+                            Snapshot->Entries[Snapshot->Sorted[j - 1]]->FileName,
+                            Snapshot->Entries[i]->FileName
+                        ) <= 0
+                    ) {
+                        break;
+                    }
+                    Snapshot->Sorted[j] = Snapshot->Sorted[j - 1];
+                    k = j - 1;
+                }
+                Snapshot->Sorted[k] = i;
+            } // for
+        }
+    }
+    Snapshot->Status = Status;
+
+    return Snapshot;
+} // static DIR_SNAPSHOT * CreateDirSnapshot()
+
+// Return the snapshot for a directory, reading the directory if required
+static
+DIR_SNAPSHOT * GetDirSnapshot (
+    IN EFI_FILE_PROTOCOL *BaseDir,
+    IN CHAR16            *DirPath
+) {
+    DIR_SNAPSHOT *Snapshot;
+    UINTN         i;
+
+    for (i = 0; i < DirSnapshotCount; i++) {
+        if (DirSnapshots[i]->BaseDir == BaseDir &&
+            StrCmp (DirSnapshots[i]->DirPath, DirPath) == 0
+        ) {
+            if (!DirSnapshots[i]->Stale) {
+                return DirSnapshots[i];
+            }
+
+            // Replace stale snapshots but keep them for open iterators
+            Snapshot = CreateDirSnapshot (BaseDir, DirPath);
+            if (Snapshot == NULL) {
+                // Early Return
+                return NULL;
+            }
+            AddListElement (
+                (VOID ***) &StaleDirSnapshots, &StaleDirSnapshotCount,
+                DirSnapshots[i]
+            );
+            DirSnapshots[i] = Snapshot;
+
+            return Snapshot;
+        }
+    } // for
+
+    Snapshot = CreateDirSnapshot (BaseDir, DirPath);
+    if (Snapshot != NULL) {
+        AddListElement ((VOID ***) &DirSnapshots, &DirSnapshotCount, Snapshot);
+    }
+
+    return Snapshot;
+} // static DIR_SNAPSHOT * GetDirSnapshot()
+
+// Flag snapshots of folders named 'DirName' as they may no longer match the
+// file system after files were written there. Snapshots are keyed by the
+// volume root they were taken on, which writers such as the emulated NVRAM
+// code do not hold, so matching folders on every volume are flagged. Flagged
+// snapshots are reread when next requested. Snapshots are not freed here as
+// a scan may still be iterating over them.
+VOID MarkDirSnapshotsStale (
+    IN CHAR16 *DirName
+) {
+    CHAR16 *Leaf;
+    UINTN   i, j;
+
+    if (DirName == NULL) {
+        // Early Return
+        return;
+    }
+
+    for (i = 0; i < DirSnapshotCount; i++) {
+        Leaf = DirSnapshots[i]->DirPath;
+        for (j = 0; DirSnapshots[i]->DirPath[j] != L'\0'; j++) {
+            if (DirSnapshots[i]->DirPath[j] == L'\\') {
+                Leaf = &DirSnapshots[i]->DirPath[j + 1];
+            }
+        }
+
+        if (DirSnapshotNameCmp (Leaf, DirName) == 0) {
+            DirSnapshots[i]->Stale = TRUE;
+        }
+    } // for
+} // VOID MarkDirSnapshotsStale()
+
+// Check whether 'RelativePath' exists using a directory snapshot.
+// Returns EFI_SUCCESS with 'Exists' set if the snapshot gives a definite
+// answer, or an error if the file system needs to be asked instead.
+static
+EFI_STATUS DirSnapshotLookup (
+    IN  EFI_FILE_PROTOCOL *BaseDir,
+    IN  CHAR16            *RelativePath,
+    OUT BOOLEAN           *Exists
+) {
+    DIR_SNAPSHOT  *Snapshot;
+    CHAR16        *DirPath;
+    CHAR16        *Leaf;
+    CHAR16        *Name;
+    UINTN          Low, High, Mid;
+    UINTN          i, Split, Start;
+    INTN           Cmp;
+
+    *Exists = FALSE;
+
+    if (RelativePath == NULL || RelativePath[0] == L'\0') {
+        // Early Return
+        return EFI_UNSUPPORTED;
+    }
+
+    // Only plain ASCII paths without '.' or '..' components are handled
+    Split = 0;
+    Start = 0;
+    for (i = 0; ; i++) {
+        if (RelativePath[i] > 0x7F) {
+            // Early Return
+            return EFI_UNSUPPORTED;
+        }
+
+        if (RelativePath[i] == L'\\' || RelativePath[i] == L'\0') {
+            if (RelativePath[Start] == L'.' &&
+                (i - Start == 1 || (i - Start == 2 && RelativePath[Start + 1] == L'.'))
+            ) {
+                // Early Return
+                return EFI_UNSUPPORTED;
+            }
+
+            if (RelativePath[i] == L'\0') {
+                break;
+            }
+
+            Split = i;
+            Start = i + 1;
+        }
+    } // for
+
+    // Names in the base directory itself and trailing separators are not handled
+    if (RelativePath[Split] != L'\\' || RelativePath[Split + 1] == L'\0') {
+        // Early Return
+        return EFI_UNSUPPORTED;
+    }
+
+    DirPath = (Split == 0)
+        ? StrDuplicate (L"\\")
+        : AllocateZeroPool ((Split + 1) * sizeof (CHAR16));
+    if (DirPath == NULL) {
+        // Early Return
+        return EFI_OUT_OF_RESOURCES;
+    }
+    if (Split > 0) {
+        CopyMem (DirPath, RelativePath, Split * sizeof (CHAR16));
+    }
+    Leaf = &RelativePath[Split + 1];
+
+    Snapshot = GetDirSnapshot (BaseDir, DirPath);
+    MY_FREE_POOL(DirPath);
+
+    if (Snapshot == NULL) {
+        // Early Return
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    if (Snapshot->Status == EFI_NOT_FOUND) {
+        // Early Return ... Parent directory does not exist
+        return EFI_SUCCESS;
+    }
+
+    if (EFI_ERROR(Snapshot->Status)) {
+        // Early Return
+        return Snapshot->Status;
+    }
+
+    Low  = 0;
+    High = Snapshot->Count;
+    while (Low < High) {
+        Mid = Low + (High - Low) / 2;
+        Cmp = DirSnapshotNameCmp (Snapshot->Entries[Snapshot->Sorted[Mid]]->FileName, Leaf);
+        if (Cmp < 0) {
+            Low = Mid + 1;
+        }
+        else {
+            High = Mid;
+        }
+    } // while
+
+    // Check every entry matching without regard to case for an exact match
+    for (i = Low; i < Snapshot->Count; i++) {
+        Name = Snapshot->Entries[Snapshot->Sorted[i]]->FileName;
+        if (DirSnapshotNameCmp (Name, Leaf) != 0) {
+            break;
+        }
+
+        if (StrCmp (Name, Leaf) == 0) {
+            *Exists = TRUE;
+
+            return EFI_SUCCESS;
+        }
+    } // for
+
+    if (i > Low) {
+        // Early Return ... Only differs in case ... Ask the file system
+        return EFI_UNSUPPORTED;
+    }
+
+    return EFI_SUCCESS;
+} // static EFI_STATUS DirSnapshotLookup()
+
+// Return a copy of the next snapshot entry allowed by 'FilterMode' (as DirNextEntry)
+static
+EFI_STATUS DirSnapshotNext (
+    IN OUT REFIT_DIR_ITER  *DirIter,
+    OUT    EFI_FILE_INFO  **DirEntry,
+    IN     UINTN            FilterMode
+) {
+    EFI_FILE_INFO *Entry;
+
+    *DirEntry = NULL;
+    while (DirIter->SnapshotIndex < DirIter->Snapshot->Count) {
+        Entry = DirIter->Snapshot->Entries[DirIter->SnapshotIndex++];
+
+        if ((FilterMode == 1 && (Entry->Attribute & EFI_FILE_DIRECTORY) == 0) ||
+            (FilterMode == 2 && (Entry->Attribute & EFI_FILE_DIRECTORY) != 0)
+        ) {
+            continue;
+        }
+
+        *DirEntry = AllocateCopyPool ((UINTN) Entry->Size, Entry);
+
+        return (*DirEntry == NULL) ? EFI_OUT_OF_RESOURCES : EFI_SUCCESS;
+    } // while
+
+    return EFI_SUCCESS;
+} // static EFI_STATUS DirSnapshotNext()
+
+// Start answering 'FileExists' and 'DirIterOpen' requests from snapshots
+VOID EnableDirSnapshots (VOID) {
+    FreeDirSnapshots();
+    DirSnapshotsActive = TRUE;
+} // VOID EnableDirSnapshots()
+
+// Release all snapshots and return to direct file system access.
+// Must be called whenever files may have been created or deleted.
+VOID FreeDirSnapshots (VOID) {
+    UINTN i;
+
+    #if REFIT_DEBUG > 0
+    if (DirSnapshotCount > 0) {
+        ALT_LOG(1, LOG_LINE_NORMAL,
+            L"Released %d Directory Snapshot%s",
+            DirSnapshotCount, (DirSnapshotCount == 1) ? L"" : L"s"
+        );
+    }
+    #endif
+
+    for (i = 0; i < DirSnapshotCount; i++) {
+        FreeDirSnapshot (&DirSnapshots[i]);
+    }
+    for (i = 0; i < StaleDirSnapshotCount; i++) {
+        FreeDirSnapshot (&StaleDirSnapshots[i]);
+    }
+    MY_FREE_POOL(DirSnapshots);
+    MY_FREE_POOL(StaleDirSnapshots);
+    DirSnapshotCount      = 0;
+    StaleDirSnapshotCount = 0;
+    DirSnapshotsActive    = FALSE;
+} // VOID FreeDirSnapshots()
+
+BOOLEAN FileExists (
+    IN EFI_FILE_PROTOCOL *BaseDir,
+    IN CHAR16            *RelativePath
+) {
+    EFI_STATUS      Status;
+    EFI_FILE_HANDLE TestFile;
+    BOOLEAN         Exists;
+
+    if (DirSnapshotsActive && BaseDir != NULL) {
+        Status = DirSnapshotLookup (BaseDir, RelativePath, &Exists);
+        if (!EFI_ERROR(Status)) {
+            // Early Return ... Answered from snapshot
+            return Exists;
+        }
+    }
+
+    if (BaseDir != NULL) {
+        Status = REFIT_CALL_5_WRAPPER(
+            BaseDir->Open, BaseDir,
+            &TestFile, RelativePath,
+            EFI_FILE_MODE_READ, 0
+        );
+        if (!EFI_ERROR(Status)) {
+            REFIT_CALL_1_WRAPPER(TestFile->Close, TestFile);
+
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
 VOID DirIterOpen (
     IN  EFI_FILE_PROTOCOL       *BaseDir,
     IN  CHAR16                  *RelativePath OPTIONAL,
@@ -3596,14 +4377,27 @@ VOID DirIterOpen (
 
 
     BREAD_CRUMB(L"%s:  2", FuncTag);
+    DirIter->Snapshot      = NULL;
+    DirIter->SnapshotIndex = 0;
+    DirIter->Patterns      = NULL;
     if (RelativePath == NULL) {
         BREAD_CRUMB(L"%s:  2a 1 - RelativePath == NULL", FuncTag);
         DirIter->LastStatus     = EFI_SUCCESS;
         DirIter->DirHandle      = BaseDir;
         DirIter->CloseDirHandle = FALSE;
     }
+    else if (DirSnapshotsActive &&
+        (DirIter->Snapshot = GetDirSnapshot (BaseDir, RelativePath)) != NULL &&
+        (DirIter->Snapshot->Status == EFI_SUCCESS || DirIter->Snapshot->Status == EFI_NOT_FOUND)
+    ) {
+        BREAD_CRUMB(L"%s:  2b 1 - RelativePath != NULL ... Use Snapshot", FuncTag);
+        DirIter->LastStatus     = DirIter->Snapshot->Status;
+        DirIter->DirHandle      = NULL;
+        DirIter->CloseDirHandle = FALSE;
+    }
     else {
-        BREAD_CRUMB(L"%s:  2b 1 - RelativePath != NULL", FuncTag);
+        DirIter->Snapshot = NULL;
+        BREAD_CRUMB(L"%s:  2c 1 - RelativePath != NULL", FuncTag);
         DirIter->LastStatus = REFIT_CALL_5_WRAPPER(
             BaseDir->Open, BaseDir,
             &(DirIter->DirHandle), RelativePath,
@@ -3666,7 +4460,6 @@ BOOLEAN DirIterNext (
 ) {
     UINTN          i;
     BOOLEAN        Found;
-    CHAR16        *OnePattern;
     EFI_FILE_INFO *LastFileInfo;
 
     #if REFIT_DEBUG > 1
@@ -3693,15 +4486,14 @@ BOOLEAN DirIterNext (
         BREAD_CRUMB(L"%s:  3a 1 - FOR LOOP:- START", FuncTag);
 
         BREAD_CRUMB(L"%s:  3a 2", FuncTag);
-        DirIter->LastStatus = DirNextEntry (
-            DirIter->DirHandle,
-            &LastFileInfo,
-            FilterMode
-        );
+        DirIter->LastStatus = (DirIter->Snapshot != NULL)
+            ? DirSnapshotNext (DirIter, &LastFileInfo, FilterMode)
+            : DirNextEntry (DirIter->DirHandle, &LastFileInfo, FilterMode);
 
         BREAD_CRUMB(L"%s:  3a 3", FuncTag);
         if (EFI_ERROR(DirIter->LastStatus) || LastFileInfo == NULL) {
             BREAD_CRUMB(L"%s:  3a 3a 1 - END:- return BOOLEAN FALSE ... ERROR DirIter->LastStatus", FuncTag);
+            StringSetRelease (&DirIter->Patterns);
             LOG_DECREMENT();
             LOG_SEP(L"X");
 
@@ -3719,15 +4511,21 @@ BOOLEAN DirIterNext (
         }
 
         BREAD_CRUMB(L"%s:  3a 5", FuncTag);
+        if (DirIter->Patterns == NULL || DirIter->Patterns->Source != FilePattern) {
+            // Split the pattern list once per iteration rather than per file
+            StringSetRelease (&DirIter->Patterns);
+            DirIter->Patterns = StringSetAcquire (FilePattern, STRING_SET_PLAIN);
+        }
+
         i     =     0;
         Found = FALSE;
-        while (!Found && (OnePattern = FindCommaDelimited (FilePattern, i++)) != NULL) {
+        while (!Found && DirIter->Patterns != NULL && i < DirIter->Patterns->Count) {
             BREAD_CRUMB(L"%s:  3a 5a 1 - WHILE LOOP:- START ... Seek MetaiMatch Pattern", FuncTag);
-            if (RP_MetaiMatch (LastFileInfo->FileName, OnePattern)) {
+            if (RP_MetaiMatch (LastFileInfo->FileName, DirIter->Patterns->Items[i].Value)) {
                 BREAD_CRUMB(L"%s:  3a 5a 1a 1", FuncTag);
                 Found = TRUE;
             }
-            MY_FREE_POOL(OnePattern);
+            i++;
             BREAD_CRUMB(L"%s:  3a 5a 2 - WHILE LOOP:- END", FuncTag);
         } // while
 
@@ -3765,6 +4563,7 @@ EFI_STATUS DirIterClose (
     BREAD_CRUMB(L"%s:  1 - START", FuncTag);
 
     BREAD_CRUMB(L"%s:  2", FuncTag);
+    StringSetRelease (&DirIter->Patterns);
     if ((DirIter->CloseDirHandle) && (DirIter->DirHandle->Close)) {
         //BREAD_CRUMB(L"%s:  2a 1", FuncTag);
         REFIT_CALL_1_WRAPPER(DirIter->DirHandle->Close, DirIter->DirHandle);
@@ -4157,35 +4956,33 @@ BOOLEAN FilenameIn (
     IN CHAR16       *Filename,
     IN CHAR16       *List
 ) {
-    UINTN      i;
-    CHAR16    *OneElement;
-    CHAR16    *TargetPath;
-    CHAR16    *TargetVolName;
-    CHAR16    *TargetFilename;
-    BOOLEAN    Found;
+    UINTN             i;
+    BOOLEAN           Found;
+    STRING_SET       *Set;
+    STRING_SET_ITEM  *Item;
 
     if (!Filename || !List) {
         return FALSE;
     }
 
-    TargetPath = TargetVolName = TargetFilename = NULL;
+    Set = StringSetAcquire (List, STRING_SET_FILES);
+    if (Set == NULL) {
+        // Early Return
+        return FALSE;
+    }
 
-    i = 0;
     Found = FALSE;
-    while (!Found && (OneElement = FindCommaDelimited (List, i++))) {
+    for (i = 0; !Found && i < Set->Count; i++) {
+        Item  = &Set->Items[i];
         Found = TRUE;
-        SplitPathName (OneElement, &TargetVolName, &TargetPath, &TargetFilename);
-        if ((TargetVolName  != NULL && !VolumeMatchesDescription (Volume, TargetVolName)) ||
-            (TargetPath     != NULL && !MyStriCmp (TargetPath, Directory)) ||
-            (TargetFilename != NULL && !MyStriCmp (TargetFilename, Filename))
+        if ((Item->VolName  != NULL && !VolumeMatchesDescription (Volume, Item->VolName)) ||
+            (Item->Path     != NULL && !MyStriCmp (Item->Path, Directory)) ||
+            (Item->Filename != NULL && !MyStriCmp (Item->Filename, Filename))
         ) {
             Found = FALSE;
         }
-        MY_FREE_POOL(OneElement);
-        MY_FREE_POOL(TargetPath);
-        MY_FREE_POOL(TargetVolName);
-        MY_FREE_POOL(TargetFilename);
-    } // while
+    } // for
+    StringSetRelease (&Set);
 
     return Found;
 } // BOOLEAN FilenameIn()
@@ -71,10 +71,24 @@
 
 // types
 
+// Contents of a directory read once during a scan
+typedef struct {
+    EFI_FILE_PROTOCOL  *BaseDir;
+    CHAR16             *DirPath;
+    EFI_STATUS          Status;   // Result of reading the directory
+    BOOLEAN             Stale;    // Files may have changed since reading
+    UINTN               Count;
+    EFI_FILE_INFO     **Entries;  // In directory order
+    UINTN              *Sorted;   // Indices into 'Entries' sorted by name
+} DIR_SNAPSHOT;
+
 typedef struct {
     EFI_STATUS          LastStatus;
     EFI_FILE_HANDLE     DirHandle;
     BOOLEAN             CloseDirHandle;
+    DIR_SNAPSHOT       *Snapshot;
+    UINTN               SnapshotIndex;
+    PATTERN_SET        *Patterns;  // FilePattern as last split by DirIterNext()
 } REFIT_DIR_ITER;
 
 #define DISK_KIND_INTERNAL  (0)
@@ -99,6 +113,34 @@ typedef struct {
 
 extern EFI_GUID gFreedesktopRootGuid;
 
+// Built-in boot code signatures ... Indices for MatchBootcodeSignatures()
+#define BOOTCODE_SIG_EXFAT              (0)
+#define BOOTCODE_SIG_ISOLINUX           (1)
+#define BOOTCODE_SIG_GRUB               (2)
+#define BOOTCODE_SIG_BTX                (3)
+#define BOOTCODE_SIG_FBSD_LARGE         (4)
+#define BOOTCODE_SIG_FBSD_IO_ERROR      (5)
+#define BOOTCODE_SIG_OBSD_LOADING       (6)
+#define BOOTCODE_SIG_OBSD_CDBOOT        (7)
+#define BOOTCODE_SIG_NBSD_BOOTXX        (8)
+#define BOOTCODE_SIG_NTLDR              (9)
+#define BOOTCODE_SIG_BOOTMGR           (10)
+#define BOOTCODE_SIG_CPUBOOT           (11)
+#define BOOTCODE_SIG_KERNEL            (12)
+#define BOOTCODE_SIG_OS2LDR            (13)
+#define BOOTCODE_SIG_OS2BOOT           (14)
+#define BOOTCODE_SIG_BEOS              (15)
+#define BOOTCODE_SIG_ZETA              (16)
+#define BOOTCODE_SIG_ZBEOS             (17)
+#define BOOTCODE_SIG_HAIKU             (18)
+#define BOOTCODE_SIG_NON_SYSTEM        (19)
+#define BOOTCODE_SIG_NOT_BOOTABLE      (20)
+#define BOOTCODE_SIG_PRESS_KEY         (21)
+#define BOOTCODE_SIG_BUILTIN           (22)
+
+// Built-in signatures plus up to 16 from 'legacy_signature' tokens
+#define BOOTCODE_SIG_MAX               (BOOTCODE_SIG_BUILTIN + 16)
+
 INTN FindMem (
     IN VOID  *Buffer,
     IN UINTN  BufferLength,
@@ -106,6 +148,18 @@ INTN FindMem (
     IN UINTN  SearchStringLength
 );
 
+VOID MatchBootcodeSignatures (
+    IN  UINT8    *Buffer,
+    IN  UINTN     BufferSize,
+    OUT BOOLEAN  *Matched
+);
+VOID ClearBootcodeSignatures (VOID);
+BOOLEAN AddBootcodeSignature (
+    IN CHAR16 *Pattern,
+    IN CHAR16 *IconName,
+    IN CHAR16 *OSLabel
+);
+
 EFI_STATUS FindVarsDir (VOID);
 EFI_STATUS ReinitRefitLib (VOID);
 EFI_STATUS InitRefitLib (IN EFI_HANDLE ImageHandle);
@@ -125,6 +179,21 @@ EFI_STATUS EfivarSetRaw (
 );
 
 VOID ScanVolumes (VOID);
+BOOLEAN SameVolume (
+    IN REFIT_VOLUME *Volume1,
+    IN REFIT_VOLUME *Volume2
+);
+UINTN DiffVolumes (
+    IN     REFIT_VOLUME **OldList,
+    IN     UINTN          OldCount,
+    IN OUT REFIT_VOLUME **NewList,
+    IN     UINTN          NewCount
+);
+VOID FreeDirSnapshots (VOID);
+VOID EnableDirSnapshots (VOID);
+VOID MarkDirSnapshotsStale (
+    IN CHAR16 *DirName
+);
 VOID ReinitVolumes (VOID);
 VOID UninitRefitLib (VOID);
 VOID SetVolumeIcons (VOID);
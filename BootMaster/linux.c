@@ -194,6 +194,7 @@ CHAR16 * FindInitrd (
         BREAD_CRUMB(L"%s:  8a 3 - WHILE LOOP:- END", FuncTag);
         LOG_SEP(L"X");
     } // while
+    DirIterClose (&DirIter);
 
     BREAD_CRUMB(L"%s:  9", FuncTag);
     InitrdName = NULL;
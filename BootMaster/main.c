@@ -54,11 +54,14 @@
 #include "lib.h"
 #include "icns.h"
 #include "menu.h"
+#include "menu_cache.h"
 #include "mok.h"
 #include "scan.h"
+#include "scan_cache.h"
 #include "apple.h"
 #include "install.h"
 #include "mystrings.h"
+#include "profile.h"
 #include "launch_efi.h"
 #include "driver_support.h"
 #include "security_policy.h"
@@ -131,6 +134,12 @@ REFIT_CONFIG GlobalConfig = {
     /* UnicodeCollation = */ FALSE,
     /* SupplyAppleFB = */ TRUE,
     /* MitigatePrimedBuffer = */ FALSE,
+    /* ScanCache = */ FALSE,
+    /* PrefetchVolumes = */ FALSE,
+    /* CachedFirstPaint = */ FALSE,
+    /* VerifyFsChecksums = */ FALSE,
+    /* PaintFramebuffer = */ FALSE,
+    /* PreloadLoaders = */ FALSE,
     /* RequestedScreenWidth = */ 0,
     /* RequestedScreenHeight = */ 0,
     /* BannerBottomEdge = */ 0,
@@ -183,6 +192,11 @@ REFIT_CONFIG GlobalConfig = {
     /* *ExtraKernelVersionStrings = */ NULL,
     /* *SpoofOSXVersion = */ NULL,
     /* CsrValues = */ NULL,
+    /* *DontScanVolumesSet = */ NULL,
+    /* *DontScanDirsSet = */ NULL,
+    /* *DontScanFilesSet = */ NULL,
+    /* *LinuxPrefixesSet = */ NULL,
+    /* *LinuxMatchPatternsSet = */ NULL,
     /* ShowTools = */ {
         TAG_SHELL,
         TAG_MEMTEST,
@@ -265,6 +279,7 @@ extern EFI_GUID                      AppleVendorOsGuid;
 extern EFI_FILE_PROTOCOL            *gVarsDir;
 
 extern BOOLEAN                       HasMacOS;
+extern BOOLEAN                       PartialLoaderScan;
 extern BOOLEAN                       SetSysTab;
 extern BOOLEAN                       SelfVolSet;
 extern BOOLEAN                       SelfVolRun;
@@ -311,6 +326,21 @@ VOID InitMainMenu (VOID) {
     MainMenu->TimeoutSeconds = GlobalConfig.Timeout;
 } // static VOID InitMainMenu()
 
+// Disable DirectBoot ... Fill the main menu if only the default loader volume was scanned
+static
+VOID EndDirectBoot (VOID) {
+    GlobalConfig.DirectBoot = FALSE;
+    MainMenu->TimeoutSeconds = GlobalConfig.Timeout = 0;
+
+    if (PartialLoaderScan) {
+        InitMainMenu();
+        ScanForBootloaders();
+        ScanForTools();
+    }
+
+    DrawScreenHeader (MainMenu->Title);
+} // static VOID EndDirectBoot()
+
 static
 EFI_STATUS GetHardwareNvramVariable (
     IN  CHAR16    *VariableName,
@@ -1662,6 +1692,10 @@ VOID AboutRefindPlus (VOID) {
     AddMenuInfoLine (AboutMenu, PoolPrint(L"Screen Output : %s", TmpStr),  TRUE);
     MY_FREE_POOL(TmpStr);
 
+    #if REFIT_PROFILE > 0
+    ProfileAddInfoLines (AboutMenu);
+    #endif
+
     AddMenuInfoLine (AboutMenu, L"",                                                        FALSE);
     AddMenuInfoLine (AboutMenu, L"Copyright (c) 2020-2023 Dayo Akanji and Others",          FALSE);
     AddMenuInfoLine (AboutMenu, L"Portions Copyright (c) 2012-2023 Roderick W. Smith",      FALSE);
@@ -1731,6 +1765,11 @@ VOID RescanAll (
     MY_NATIVELOGGER_SET;
     #endif
 
+    if (Reconnect) {
+        // Keep the loader entries of volumes that turn out to be unchanged
+        KeepScannedEntries();
+    }
+
     // Reset MainMenu
     InitMainMenu();
 
@@ -1776,6 +1815,9 @@ VOID RescanAll (
     }
 
     SetVolumeIcons();
+
+    // Rescans requested by the user probe loader directories afresh and rewrite the scan cache
+    ScanCacheBypass = Reconnect;
     ScanForBootloaders();
 
     #if REFIT_DEBUG > 0
@@ -2326,6 +2368,10 @@ EFI_STATUS EFIAPI efi_main (
         return Status;
     }
 
+    #if REFIT_PROFILE > 0
+    ProfileInit();
+    #endif
+
     /* Stash SystemTable */
     OrigSetVariableRT  =  gRT->SetVariable;
     OrigOpenProtocolBS = gBS->OpenProtocol;
@@ -2470,7 +2516,7 @@ EFI_STATUS EFIAPI efi_main (
     #if REFIT_DEBUG > 0
     MY_MUTELOGGER_SET;
     #endif
-    ScanVolumes();
+    PROFILE_PHASE(L"ScanVolumes", ScanVolumes());
     #if REFIT_DEBUG > 0
     MY_MUTELOGGER_OFF;
     if (!SelfVolSet) {
@@ -2507,7 +2553,7 @@ EFI_STATUS EFIAPI efi_main (
     }
 
     /* Load config tokens */
-    ReadConfig (GlobalConfig.ConfigFilename);
+    PROFILE_PHASE(L"ReadConfig", ReadConfig (GlobalConfig.ConfigFilename));
 
     /* Unlock partitions if required */
     #ifdef __MAKEWITH_TIANO
@@ -2646,7 +2692,7 @@ EFI_STATUS EFIAPI efi_main (
     #endif
 
     // Load Drivers
-    LoadDrivers();
+    PROFILE_PHASE(L"LoadDrivers", LoadDrivers());
 
     #if REFIT_DEBUG > 0
     // DA-TAG: Prime Status for SupplyAPFS
@@ -2678,7 +2724,7 @@ EFI_STATUS EFIAPI efi_main (
         TempLevelFlip = TRUE;
     }
     #endif
-    ScanVolumes();
+    PROFILE_PHASE(L"ScanVolumes", ScanVolumes());
     #if REFIT_DEBUG > 1
     if (TempLevelFlip) {
         GlobalConfig.LogLevel = ThislogLevel;
@@ -2777,7 +2823,7 @@ EFI_STATUS EFIAPI efi_main (
     MY_FREE_POOL(MsgStr);
     #endif
 
-    InitScreen();
+    PROFILE_PHASE(L"InitScreen", InitScreen());
 
     // Disable the EFI watchdog timer
     REFIT_CALL_4_WRAPPER(
@@ -2876,9 +2922,11 @@ EFI_STATUS EFIAPI efi_main (
     }
 
     // Continue Bootstrap
-    SetVolumeIcons();
-    ScanForBootloaders();
-    ScanForTools();
+    PROFILE_PHASE(L"SetVolumeIcons", SetVolumeIcons());
+    MenuCachePaint();
+    PROFILE_PHASE(L"ScanForBootloaders", ScanForBootloaders());
+    PROFILE_PHASE(L"ScanForTools", ScanForTools());
+    MenuCacheSave (MainMenu);
 
     if (GlobalConfig.ShutdownAfterTimeout) {
         MainMenu->TimeoutText = StrDuplicate (L"Shutdown");
@@ -3025,6 +3073,22 @@ EFI_STATUS EFIAPI efi_main (
 
         MenuExit = RunMainMenu (MainMenu, &SelectionName, &ChosenEntry);
 
+        // A key was pressed after a partial DirectBoot scan ... Show the full menu
+        if (MenuExit == MENU_EXIT_FILL_MENU) {
+            // Flag at least one loop done
+            OneMainLoop = TRUE;
+
+            #if REFIT_DEBUG > 0
+            LOG_MSG("Received User Input:");
+            LOG_MSG("%s  - Key Pressed ... Fill Main Menu", OffsetNext);
+            LOG_MSG("\n\n");
+            #endif
+
+            EndDirectBoot();
+
+            continue;
+        }
+
         // The ESC key triggers a rescan ... if allowed
         if (MenuExit == MENU_EXIT_ESCAPE) {
             // Flag at least one loop done
@@ -3939,9 +4003,7 @@ EFI_STATUS EFIAPI efi_main (
 
         // Disable DirectBoot if still active after first loop
         if (GlobalConfig.DirectBoot) {
-            GlobalConfig.DirectBoot = FALSE;
-            MainMenu->TimeoutSeconds = GlobalConfig.Timeout = 0;
-            DrawScreenHeader (MainMenu->Title);
+            EndDirectBoot();
         }
 
         // Flag at least one loop done
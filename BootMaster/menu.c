@@ -59,6 +59,7 @@
 #include "icns.h"
 #include "scan.h"
 #include "apple.h"
+#include "profile.h"
 #include "../include/version.h"
 #include "../include/refit_call_wrapper.h"
 
@@ -91,6 +92,20 @@ static UINTN  TileSizes[2] = {144, 64};
 #define ALIGN_RIGHT 1
 #define ALIGN_LEFT  0
 
+// Main menu entry as last composed in one state ... Reused while the
+// entry, the screen background and the entry's position are unchanged
+typedef struct {
+    REFIT_MENU_ENTRY *Entry;
+    EG_IMAGE         *Background;
+    UINTN             XPos;
+    UINTN             YPos;
+    EG_IMAGE         *Tile;
+} MENU_TILE;
+
+// Unselected and selected tiles of each main menu entry
+static MENU_TILE *MenuTiles     = NULL;
+static UINTN      MenuTileCount = 0;
+
 EG_IMAGE *SelectionImages[2] = {NULL, NULL};
 
 EFI_EVENT *WaitList          = NULL;
@@ -108,13 +123,15 @@ REFIT_MENU_ENTRY MenuEntryNo = {
     L"No",
     TAG_RETURN,
     1, 0, 0,
-    NULL, NULL, NULL
+    NULL, NULL, NULL,
+    NULL
 };
 REFIT_MENU_ENTRY MenuEntryYes = {
     L"Yes",
     TAG_RETURN,
     1, 0, 0,
-    NULL, NULL, NULL
+    NULL, NULL, NULL,
+    NULL
 };
 
 extern UINT64              GetCurrentMS (VOID);
@@ -125,7 +142,9 @@ extern BOOLEAN             FlushFailReset;
 extern BOOLEAN             ClearedBuffer;
 extern BOOLEAN             BlockRescan;
 extern BOOLEAN             OneMainLoop;
+extern BOOLEAN             PartialLoaderScan;
 extern EFI_GUID            RefindPlusGuid;
+extern BOOLEAN             GraphicsScreenDirty;
 
 
 //
@@ -440,6 +459,7 @@ CHAR16 * MenuExitInfo (
         case  4:  MenuExitData = L"TIMEOUT"; break;
         case  5:  MenuExitData = L"EJECT";   break;
         case  6:  MenuExitData = L"REMOVE";  break;
+        case  8:  MenuExitData = L"FILL";    break;
         default:  MenuExitData = L"RETURN";  // Actually '99'
     } // switch
 
@@ -769,6 +789,50 @@ VOID SaveScreen (VOID) {
     ReadAllKeyStrokes();
 } // VOID SaveScreen()
 
+// Loads the icon of one entry on the main menu pages either side of the visible
+// one, if any has yet to be loaded, so that these are ready when scrolled to.
+// The time taken, in milliseconds, is added to 'LoadTime'.
+// Returns TRUE when an icon was loaded.
+static
+BOOLEAN PrefetchEntryIcon (
+    IN     REFIT_MENU_SCREEN *Screen,
+    IN     SCROLL_STATE      *State,
+    IN OUT UINTN             *LoadTime
+) {
+    INTN   i;
+    UINT64 LoadStart;
+
+    for (i = State->LastVisible + 1;
+        i <= State->MaxIndex && i <= State->LastVisible + State->MaxVisible + 1;
+        i++
+    ) {
+        if (Screen->Entries[i]->Row == 0 && Screen->Entries[i]->IconName != NULL) {
+            LoadStart = GetCurrentMS();
+            LoadEntryIcon (Screen->Entries[i]);
+            *LoadTime += (UINTN) (GetCurrentMS() - LoadStart);
+
+            // Early Return
+            return TRUE;
+        }
+    }
+
+    for (i = State->FirstVisible - 1;
+        i >= 0 && i >= State->FirstVisible - State->MaxVisible - 1;
+        i--
+    ) {
+        if (Screen->Entries[i]->Row == 0 && Screen->Entries[i]->IconName != NULL) {
+            LoadStart = GetCurrentMS();
+            LoadEntryIcon (Screen->Entries[i]);
+            *LoadTime += (UINTN) (GetCurrentMS() - LoadStart);
+
+            // Early Return
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+} // static BOOLEAN PrefetchEntryIcon()
+
 //
 // Generic menu function
 //
@@ -820,6 +884,7 @@ UINTN RunGenericMenu (
     INTN           CurrentTime;
     INTN           ShortcutEntry;
     UINTN          ElapsCount;
+    UINTN          PrefetchTime;
     UINTN          MenuExit;
     UINTN          Input;
     UINTN          Item;
@@ -858,6 +923,8 @@ UINTN RunGenericMenu (
         TimeoutCountdown = 0;
     }
 
+    PrefetchTime = 0;
+
     StyleFunc (Screen, &State, MENU_FUNCTION_INIT, NULL);
     IdentifyRows (&State, Screen);
 
@@ -880,7 +947,10 @@ UINTN RunGenericMenu (
             KeyAsString[0] = key.UnicodeChar;
             KeyAsString[1] = 0;
 
-            ShortcutEntry = FindMenuShortcutEntry (Screen, KeyAsString);
+            // Shortcut keys only hold for the full menu
+            ShortcutEntry = (PartialLoaderScan)
+                ? -1
+                : FindMenuShortcutEntry (Screen, KeyAsString);
             if (ShortcutEntry >= 0) {
                 State.CurrentSelection = ShortcutEntry;
                 MenuExit = MENU_EXIT_ENTER;
@@ -900,6 +970,22 @@ UINTN RunGenericMenu (
         //         Also disable Timeout just in case
         BlockRescan = FALSE;
         Screen->TimeoutSeconds = 0;
+
+        if (PartialLoaderScan) {
+            // DA-TAG: Only the default loader volume was scanned
+            //         Exit to have the main loop fill the menu before showing it
+            if (ChosenEntry) {
+                *ChosenEntry = Screen->Entries[State.CurrentSelection];
+            }
+
+            BREAD_CRUMB(L"%s:  1a 1 - END:- return UINTN MENU_EXIT_FILL_MENU ... Partial Scan", FuncTag);
+            LOG_DECREMENT();
+            LOG_SEP(L"X");
+
+            // Early Return
+            return MENU_EXIT_FILL_MENU;
+        }
+
         DrawScreenHeader (Screen->Title);
     }
 
@@ -915,6 +1001,12 @@ UINTN RunGenericMenu (
         if (State.PaintAll && (GlobalConfig.ScreensaverTime != -1)) {
             StyleFunc (Screen, &State, MENU_FUNCTION_PAINT_ALL, NULL);
             State.PaintAll = FALSE;
+
+            #if REFIT_PROFILE > 0
+            if (Screen == MainMenu) {
+                PROFILE_FIRST_PAINT();
+            }
+            #endif
         }
         else if (State.PaintSelection) {
             StyleFunc (Screen, &State, MENU_FUNCTION_PAINT_SELECTION, NULL);
@@ -1012,6 +1104,21 @@ UINTN RunGenericMenu (
                 MenuExit = MENU_EXIT_TIMEOUT;
                 break;
             }
+            else if (StyleFunc == MainMenuStyle && PrefetchEntryIcon (Screen, &State, &PrefetchTime)) {
+                // Loaded an icon while idle ... Count whole tenths of a second
+                // spent on this against the timeout and screensaver
+                ElapsCount    = PrefetchTime / 100;
+                PrefetchTime -= ElapsCount * 100;
+
+                TimeSinceKeystroke += ElapsCount;
+                if (HaveTimeout) {
+                    TimeoutCountdown = (TimeoutCountdown > ElapsCount)
+                        ? TimeoutCountdown - ElapsCount : 0;
+                }
+
+                // Check for input again before the next
+                continue;
+            }
             else if (HaveTimeout || GlobalConfig.ScreensaverTime > 0) {
                 ElapsCount = 1;
                 Input      = WaitForInput (1000); // 1s Timeout
@@ -2001,53 +2108,129 @@ VOID GraphicsMenuStyle (
 // Graphical main menu style
 //
 
+static
+VOID FreeMenuTiles (VOID) {
+    UINTN i;
+
+    for (i = 0; i < MenuTileCount * 2; i++) {
+        MY_FREE_IMAGE(MenuTiles[i].Tile);
+    }
+    MY_FREE_POOL(MenuTiles);
+    MenuTileCount = 0;
+} // static VOID FreeMenuTiles()
+
+static
+VOID InitMenuTiles (
+    IN UINTN EntryCount
+) {
+    FreeMenuTiles();
+
+    // Tiles are optional ... Entries are composed on each paint without them
+    MenuTiles = AllocateZeroPool (sizeof (MENU_TILE) * 2 * EntryCount);
+    if (MenuTiles != NULL) {
+        MenuTileCount = EntryCount;
+    }
+} // static VOID InitMenuTiles()
+
 static
 VOID DrawMainMenuEntry (
     REFIT_MENU_ENTRY *Entry,
+    UINTN             Index,
     BOOLEAN           selected,
     UINTN             XPos,
     UINTN             YPos
 ) {
-    EG_IMAGE *Background;
+    EG_IMAGE  *Background;
+    EG_IMAGE  *Tile;
+    MENU_TILE *Slot;
+
+    LoadEntryIcon (Entry);
 
     // Do not draw selection image when not hoverin if using pointer
     if (!selected || !DrawSelection) {
-        // Image not selected ... copy background
-        egDrawImageWithTransparency (
-            Entry->Image,
-            Entry->BadgeImage,
-            XPos, YPos,
-            SelectionImages[Entry->Row]->Width,
-            SelectionImages[Entry->Row]->Height
+        selected = FALSE;
+    }
+
+    Slot = (Index < MenuTileCount) ? &MenuTiles[Index * 2 + (selected ? 1 : 0)] : NULL;
+    if (Slot             != NULL                          &&
+        Slot->Tile       != NULL                          &&
+        Slot->Entry      == Entry                         &&
+        Slot->Background == GlobalConfig.ScreenBackground &&
+        Slot->XPos       == XPos                          &&
+        Slot->YPos       == YPos
+    ) {
+        // Unchanged since composed ... Blit as is
+        egDrawImageArea (
+            Slot->Tile,
+            0, 0,
+            Slot->Tile->Width, Slot->Tile->Height,
+            XPos, YPos
         );
+        GraphicsScreenDirty = TRUE;
 
         // Early Return
         return;
     }
 
+    // Copy background
     Background = egCropImage (
         GlobalConfig.ScreenBackground,
         XPos, YPos,
         SelectionImages[Entry->Row]->Width,
         SelectionImages[Entry->Row]->Height
     );
+    if (Background == NULL) {
+        // Early Return
+        return;
+    }
 
-    if (Background) {
+    if (selected) {
         egComposeImage (
             Background,
             SelectionImages[Entry->Row],
             0, 0
         );
+    }
 
-        BltImageCompositeBadge (
-            Background,
-            Entry->Image,
-            Entry->BadgeImage,
-            XPos, YPos
-        );
+    Tile = ComposeImageBadge (
+        Background,
+        Entry->Image,
+        Entry->BadgeImage
+    );
+    MY_FREE_IMAGE(Background);
+    if (Tile == NULL) {
+        // Early Return
+        return;
+    }
+
+    // Tiles with transparency are composed onto the screen background once more
+    // when drawn, so these, and any falling outside the screen, are not kept
+    if (Slot == NULL    ||
+        Tile->HasAlpha  ||
+        XPos > ScreenW  || Tile->Width  > ScreenW - XPos ||
+        YPos > ScreenH  || Tile->Height > ScreenH - YPos
+    ) {
+        BltImageCompositeBadge (Tile, NULL, NULL, XPos, YPos);
+        MY_FREE_IMAGE(Tile);
 
-        MY_FREE_IMAGE(Background);
+        // Early Return
+        return;
     }
+
+    egDrawImageArea (
+        Tile,
+        0, 0,
+        Tile->Width, Tile->Height,
+        XPos, YPos
+    );
+    GraphicsScreenDirty = TRUE;
+
+    MY_FREE_IMAGE(Slot->Tile);
+    Slot->Entry      = Entry;
+    Slot->Background = GlobalConfig.ScreenBackground;
+    Slot->XPos       = XPos;
+    Slot->YPos       = YPos;
+    Slot->Tile       = Tile;
 } // VOID DrawMainMenuEntry()
 
 static
@@ -2069,7 +2252,7 @@ VOID PaintAll (
         if (Screen->Entries[i]->Row == 0) {
             if (i <= State->LastVisible) {
                 DrawMainMenuEntry (
-                    Screen->Entries[i],
+                    Screen->Entries[i], i,
                     (i == State->CurrentSelection) ? TRUE : FALSE,
                     itemPosX[i - State->FirstVisible],
                     row0PosY
@@ -2078,7 +2261,7 @@ VOID PaintAll (
         }
         else {
             DrawMainMenuEntry (
-                Screen->Entries[i],
+                Screen->Entries[i], i,
                 (i == State->CurrentSelection) ? TRUE : FALSE,
                 itemPosX[i],
                 row1PosY
@@ -2161,6 +2344,7 @@ VOID PaintSelection (
 
     DrawMainMenuEntry (
         Screen->Entries[State->PreviousSelection],
+        State->PreviousSelection,
         FALSE,
         itemPosX[XSelectPrev],
         YPosPrev
@@ -2168,6 +2352,7 @@ VOID PaintSelection (
 
     DrawMainMenuEntry (
         Screen->Entries[State->CurrentSelection],
+        State->CurrentSelection,
         TRUE,
         itemPosX[XSelectCur],
         YPosCur
@@ -2420,6 +2605,7 @@ VOID MainMenuStyle (
 
             // Initial painting
             InitSelection();
+            InitMenuTiles (Screen->EntryCount);
 
             #if REFIT_DEBUG > 0
             MY_MUTELOGGER_SET;
@@ -2432,6 +2618,7 @@ VOID MainMenuStyle (
         break;
         case MENU_FUNCTION_CLEANUP:
             MY_FREE_POOL(itemPosX);
+            FreeMenuTiles();
 
         break;
         case MENU_FUNCTION_PAINT_ALL:
@@ -3581,6 +3768,38 @@ UINTN RunMenu (
     return MenuExit;
 } // UINTN RunMenu()
 
+// Paint 'Screen' as the main menu, without waiting for input, with the
+// first entry matching 'DefaultSelection' highlighted.
+VOID PaintMenuPreview (
+    IN REFIT_MENU_SCREEN *Screen,
+    IN CHAR16            *DefaultSelection
+) {
+    INTN             DefaultEntryIndex;
+    SCROLL_STATE     State;
+    MENU_STYLE_FUNC  StyleFunc;
+
+    if (Screen == NULL || Screen->EntryCount == 0) {
+        // Early Return
+        return;
+    }
+
+    TileSizes[0] = (GlobalConfig.IconSizes[ICON_SIZE_BIG]   * 9) / 8;
+    TileSizes[1] = (GlobalConfig.IconSizes[ICON_SIZE_SMALL] * 4) / 3;
+
+    StyleFunc = (AllowGraphicsMode) ? MainMenuStyle : TextMenuStyle;
+    StyleFunc (Screen, &State, MENU_FUNCTION_INIT, NULL);
+    IdentifyRows (&State, Screen);
+
+    DefaultEntryIndex = FindMenuShortcutEntry (Screen, DefaultSelection);
+    if (DefaultEntryIndex >= 0 && DefaultEntryIndex <= State.MaxIndex) {
+        State.CurrentSelection = DefaultEntryIndex;
+        UpdateScroll (&State, SCROLL_NONE);
+    }
+
+    StyleFunc (Screen, &State, MENU_FUNCTION_PAINT_ALL, NULL);
+    StyleFunc (Screen, &State, MENU_FUNCTION_CLEANUP, NULL);
+} // VOID PaintMenuPreview()
+
 UINTN RunMainMenu (
     REFIT_MENU_SCREEN  *Screen,
     CHAR16            **DefaultSelection,
@@ -3739,6 +3958,14 @@ UINTN RunMainMenu (
             else {
                 SubScreenBoot = TRUE;
 
+                if (TempChosenEntry->Tag == TAG_LOADER &&
+                    TempChosenEntry->SubScreen->TitleImage == NULL
+                ) {
+                    // Loader icons may not have been loaded when the subscreen was built
+                    LoadEntryIcon (TempChosenEntry);
+                    TempChosenEntry->SubScreen->TitleImage = egCopyImage (TempChosenEntry->Image);
+                }
+
                 BREAD_CRUMB(L"%s:  9a 3a 1b 1", FuncTag);
                 DefaultSubmenuIndex = -1;
                 MenuExit = RunGenericMenu (
@@ -3925,6 +4152,7 @@ VOID FreeLegacyEntry (
     }
 
     MY_FREE_POOL((*Entry)->me.Title);
+    MY_FREE_POOL((*Entry)->me.IconName);
     MY_FREE_IMAGE((*Entry)->me.Image);
     MY_FREE_IMAGE((*Entry)->me.BadgeImage);
     FreeMenuScreen (&(*Entry)->me.SubScreen);
@@ -3961,6 +4189,7 @@ VOID FreeLoaderEntry (
 
     BREAD_CRUMB(L"%s:  3", FuncTag);
     MY_FREE_POOL((*Entry)->me.Title);
+    MY_FREE_POOL((*Entry)->me.IconName);
     MY_FREE_IMAGE((*Entry)->me.Image);
     MY_FREE_IMAGE((*Entry)->me.BadgeImage);
 
@@ -4039,6 +4268,7 @@ VOID FreeMenuEntry (
     else {
         BREAD_CRUMB(L"%s:  3b 1 - EntryType = EntryTypeRefitMenuEntry ... TagType = '%s'", FuncTag, TagType);
         MY_FREE_POOL((*Entry)->Title);
+        MY_FREE_POOL((*Entry)->IconName);
         MY_FREE_IMAGE((*Entry)->Image);
         MY_FREE_IMAGE((*Entry)->BadgeImage);
 
@@ -73,6 +73,7 @@
 #define MENU_EXIT_EJECT      (5)
 #define MENU_EXIT_HIDE       (6)
 #define MENU_EXIT_SCREENSHOT (7)
+#define MENU_EXIT_FILL_MENU  (8)
 
 #define TAG_RETURN          (99)
 
@@ -173,6 +174,10 @@ UINTN RunMenu (
     IN REFIT_MENU_SCREEN  *Screen,
     OUT REFIT_MENU_ENTRY **ChosenEntry
 );
+VOID PaintMenuPreview (
+    IN REFIT_MENU_SCREEN *Screen,
+    IN CHAR16            *DefaultSelection
+);
 UINTN FindMainMenuItem (
     IN REFIT_MENU_SCREEN *Screen,
     IN SCROLL_STATE      *State,
@@ -0,0 +1,274 @@
+/*
+ * BootMaster/menu_cache.c
+ * Provisional main menu shown while scanning
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+/*
+ * The main menu can only be shown once loaders and tools have been scanned
+ * for. When 'cached_first_paint' is set, the loader row of the main menu
+ * is saved in the 'MenuCache' RefindPlus variable after each startup scan,
+ * and the saved row is painted before the next startup scan begins. This
+ * only brings the first paint forward. The scan still runs as one pass and
+ * input is not read until it is done. The painted entries only hold titles
+ * and generic icons and are never run. The scanned menu replaces them,
+ * whatever changed, before any input is read.
+ */
+
+#include "global.h"
+#include "lib.h"
+#include "icns.h"
+#include "menu.h"
+#include "menu_cache.h"
+#include "screenmgt.h"
+#include "../include/refit_call_wrapper.h"
+
+#define MENU_CACHE_VAR_NAME     L"MenuCache"
+#define MENU_CACHE_SIGNATURE    0x434D5052   /* 'RPMC' */
+#define MENU_CACHE_VERSION      1
+#define MENU_CACHE_MAX_SIZE     4096
+#define MENU_CACHE_MAX_ENTRIES  32
+
+#pragma pack(1)
+typedef struct {
+    UINT32  Signature;
+    UINT32  Version;
+    UINT32  EntryCount;
+} MENU_CACHE_HEADER;
+
+// Each record is followed by 'TitleLength' unterminated CHAR16 characters
+typedef struct {
+    UINT8   Tag;
+    CHAR8   OSType;
+    UINT16  TitleLength;
+} MENU_CACHE_RECORD;
+#pragma pack()
+
+// Generic icon for a saved entry ... The icons of the scanned entries
+// depend on the loader files and volumes, which are not looked at here
+static
+CHAR16 * MenuCacheIconName (
+    IN MENU_CACHE_RECORD *Record
+) {
+    if (Record->Tag == TAG_LEGACY || Record->Tag == TAG_LEGACY_UEFI) {
+        // Early Return
+        return L"legacy";
+    }
+
+    switch (Record->OSType) {
+        case 'M':           return L"mac";
+        case 'L':           return L"linux";
+        case 'W': case 'X': return L"win";
+        case 'R':           return L"refit";
+    } // switch
+
+    return L"unknown";
+} // static CHAR16 * MenuCacheIconName()
+
+// Paint the saved main menu, if any, ahead of the startup loader scan
+VOID MenuCachePaint (VOID) {
+    EFI_STATUS          Status;
+    UINTN               Offset;
+    UINTN               CacheSize;
+    UINT8              *Cache;
+    UINT32              i;
+    MENU_CACHE_HEADER   Header;
+    MENU_CACHE_RECORD   Record;
+    REFIT_MENU_ENTRY   *Entry;
+    REFIT_MENU_SCREEN  *Screen;
+
+    #if REFIT_DEBUG > 0
+    BOOLEAN CheckMute = FALSE;
+    #endif
+
+    if (!GlobalConfig.CachedFirstPaint || GlobalConfig.DirectBoot) {
+        // Early Return
+        return;
+    }
+
+    Cache     = NULL;
+    CacheSize = 0;
+
+    #if REFIT_DEBUG > 0
+    MY_MUTELOGGER_SET;
+    #endif
+    Status = EfivarGetRaw (
+        &RefindPlusGuid, MENU_CACHE_VAR_NAME,
+        (VOID **) &Cache, &CacheSize
+    );
+    #if REFIT_DEBUG > 0
+    MY_MUTELOGGER_OFF;
+    #endif
+
+    if (EFI_ERROR(Status) || CacheSize < sizeof (MENU_CACHE_HEADER)) {
+        MY_FREE_POOL(Cache);
+
+        // Early Return
+        return;
+    }
+
+    CopyMem (&Header, Cache, sizeof (MENU_CACHE_HEADER));
+    if (Header.Signature  != MENU_CACHE_SIGNATURE ||
+        Header.Version    != MENU_CACHE_VERSION   ||
+        Header.EntryCount == 0                    ||
+        Header.EntryCount > MENU_CACHE_MAX_ENTRIES
+    ) {
+        MY_FREE_POOL(Cache);
+
+        // Early Return
+        return;
+    }
+
+    Screen = AllocateZeroPool (sizeof (REFIT_MENU_SCREEN));
+    if (Screen == NULL) {
+        MY_FREE_POOL(Cache);
+
+        // Early Return
+        return;
+    }
+    Screen->Title = StrDuplicate (L"Main Menu");
+    Screen->Hint1 = StrDuplicate (L"");
+    Screen->Hint2 = StrDuplicate (L"Checking for Changes ... Please Wait");
+
+    Offset = sizeof (MENU_CACHE_HEADER);
+    for (i = 0; i < Header.EntryCount; i++) {
+        if (CacheSize - Offset < sizeof (MENU_CACHE_RECORD)) {
+            break;
+        }
+
+        CopyMem (&Record, Cache + Offset, sizeof (MENU_CACHE_RECORD));
+        Offset += sizeof (MENU_CACHE_RECORD);
+        if (Record.TitleLength == 0 ||
+            Record.TitleLength > (CacheSize - Offset) / sizeof (CHAR16)
+        ) {
+            break;
+        }
+
+        Entry = AllocateZeroPool (sizeof (REFIT_MENU_ENTRY));
+        if (Entry == NULL) {
+            break;
+        }
+
+        Entry->Title = AllocateZeroPool ((Record.TitleLength + 1) * sizeof (CHAR16));
+        if (Entry->Title == NULL) {
+            MY_FREE_POOL(Entry);
+            break;
+        }
+        CopyMem (Entry->Title, Cache + Offset, Record.TitleLength * sizeof (CHAR16));
+        Offset += Record.TitleLength * sizeof (CHAR16);
+
+        // Generic entries that free as plain menu entries
+        Entry->Tag = TAG_GENERIC;
+        Entry->Row = 0;
+        if (AllowGraphicsMode) {
+            Entry->Image = LoadOSIcon (MenuCacheIconName (&Record), L"unknown", FALSE);
+        }
+
+        AddMenuEntry (Screen, Entry);
+    } // for
+    MY_FREE_POOL(Cache);
+
+    #if REFIT_DEBUG > 0
+    ALT_LOG(1, LOG_LINE_NORMAL,
+        L"Painting Saved Main Menu (%d Entr%s) While Scanning",
+        Screen->EntryCount, (Screen->EntryCount == 1) ? L"y" : L"ies"
+    );
+    #endif
+
+    PaintMenuPreview (Screen, GlobalConfig.DefaultSelection);
+    FreeMenuScreen (&Screen);
+} // VOID MenuCachePaint()
+
+// Save the loader row of the scanned main menu for the next startup
+VOID MenuCacheSave (
+    IN REFIT_MENU_SCREEN *Screen
+) {
+    EFI_STATUS          Status;
+    UINTN               i;
+    UINTN               Length;
+    UINTN               Offset;
+    UINT8              *Cache;
+    MENU_CACHE_HEADER   Header;
+    MENU_CACHE_RECORD   Record;
+    REFIT_MENU_ENTRY   *Entry;
+
+    if (!GlobalConfig.CachedFirstPaint || GlobalConfig.DirectBoot || Screen == NULL) {
+        // Early Return
+        return;
+    }
+
+    Cache = AllocateZeroPool (MENU_CACHE_MAX_SIZE);
+    if (Cache == NULL) {
+        // Early Return
+        return;
+    }
+
+    Header.Signature  = MENU_CACHE_SIGNATURE;
+    Header.Version    = MENU_CACHE_VERSION;
+    Header.EntryCount = 0;
+
+    Offset = sizeof (MENU_CACHE_HEADER);
+    for (i = 0; i < Screen->EntryCount; i++) {
+        Entry = Screen->Entries[i];
+        if (Entry->Row != 0 || Entry->Title == NULL) {
+            continue;
+        }
+
+        Length = StrLen (Entry->Title);
+        if (Length == 0) {
+            continue;
+        }
+
+        if (Header.EntryCount == MENU_CACHE_MAX_ENTRIES ||
+            MENU_CACHE_MAX_SIZE - Offset < sizeof (MENU_CACHE_RECORD) + Length * sizeof (CHAR16)
+        ) {
+            break;
+        }
+
+        Record.Tag         = (UINT8) Entry->Tag;
+        Record.OSType      = (Entry->Tag == TAG_LOADER || Entry->Tag == TAG_FIRMWARE_LOADER)
+            ? ((LOADER_ENTRY *) Entry)->OSType
+            : 0;
+        Record.TitleLength = (UINT16) Length;
+
+        CopyMem (Cache + Offset, &Record, sizeof (MENU_CACHE_RECORD));
+        Offset += sizeof (MENU_CACHE_RECORD);
+        CopyMem (Cache + Offset, Entry->Title, Length * sizeof (CHAR16));
+        Offset += Length * sizeof (CHAR16);
+
+        Header.EntryCount++;
+    } // for
+
+    CopyMem (Cache, &Header, sizeof (MENU_CACHE_HEADER));
+
+    Status = EfivarSetRaw (
+        &RefindPlusGuid, MENU_CACHE_VAR_NAME,
+        Cache, Offset, TRUE
+    );
+
+    #if REFIT_DEBUG > 0
+    ALT_LOG(1, LOG_LINE_NORMAL,
+        L"Saved Main Menu (%d Entr%s, %d Bytes):- '%r'",
+        Header.EntryCount, (Header.EntryCount == 1) ? L"y" : L"ies",
+        Offset, (Status == EFI_ALREADY_STARTED) ? EFI_SUCCESS : Status
+    );
+    #endif
+
+    MY_FREE_POOL(Cache);
+} // VOID MenuCacheSave()
+
+/* EOF */
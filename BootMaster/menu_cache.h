@@ -0,0 +1,30 @@
+/*
+ * BootMaster/menu_cache.h
+ * Headers related to the provisional main menu shown while scanning
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MENU_CACHE_H_
+#define __MENU_CACHE_H_
+
+VOID MenuCachePaint (VOID);
+VOID MenuCacheSave (IN REFIT_MENU_SCREEN *Screen);
+
+#endif
+
+/* EOF */
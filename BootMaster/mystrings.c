@@ -1016,20 +1016,281 @@ BOOLEAN DeleteItemFromCsvList (
     return FALSE;
 } // BOOLEAN DeleteItemFromCsvList()
 
+// Fold a character the way MyStriCmp() compares characters
+#define STRING_SET_FOLD(c)  ((c) & ~0x20)
+
+static
+UINT32 StringSetHash (
+    IN CHAR16 *String,
+    IN UINTN   Length
+) {
+    UINTN   i;
+    UINT32  Hash;
+
+    // FNV-1a
+    Hash = 2166136261U;
+    for (i = 0; i < Length; i++) {
+        Hash = (Hash ^ (UINT32) STRING_SET_FOLD(String[i])) * 16777619U;
+    }
+
+    return Hash;
+} // static UINT32 StringSetHash()
+
+VOID StringSetFree (
+    IN OUT STRING_SET **Set
+) {
+    UINTN i;
+
+    if (Set == NULL || *Set == NULL) {
+        return;
+    }
+
+    if ((*Set)->Items != NULL) {
+        for (i = 0; i < (*Set)->Count; i++) {
+            MY_FREE_POOL((*Set)->Items[i].VolName);
+            MY_FREE_POOL((*Set)->Items[i].Path);
+            MY_FREE_POOL((*Set)->Items[i].Filename);
+        }
+    }
+
+    MY_FREE_POOL((*Set)->Items);
+    MY_FREE_POOL((*Set)->Table);
+    MY_FREE_POOL((*Set)->Buffer);
+    MY_FREE_POOL(*Set);
+} // VOID StringSetFree()
+
+// Parses the comma-delimited List once into a STRING_SET.
+// Elements are split further as specified by Kind (STRING_SET_*).
+// Returns NULL if List is NULL or memory runs out. The set refers back to
+// List to allow StringSetAcquire() to match it, but holds its own copy.
+STRING_SET * StringSetCompile (
+    IN CHAR16 *List,
+    IN UINTN   Kind
+) {
+    UINTN             i;
+    UINTN             Slot;
+    UINTN             Count;
+    UINTN             TableSize;
+    CHAR16           *Walk;
+    STRING_SET       *Set;
+    STRING_SET_ITEM  *Item;
+
+    if (List == NULL) {
+        return NULL;
+    }
+
+    Set = AllocateZeroPool (sizeof (STRING_SET));
+    if (Set == NULL) {
+        return NULL;
+    }
+
+    Set->Source = List;
+    Set->Kind   = Kind;
+
+    // As with FindCommaDelimited(), there is always one
+    // more element than there are commas, including when empty
+    Count = 1;
+    for (i = 0; List[i] != L'\0'; i++) {
+        if (List[i] == L',') {
+            Count++;
+        }
+    }
+
+    TableSize = 8;
+    while (TableSize < Count * 2) {
+        TableSize <<= 1;
+    }
+
+    Set->Buffer = StrDuplicate (List);
+    Set->Items  = AllocateZeroPool (Count * sizeof (STRING_SET_ITEM));
+    Set->Table  = AllocateZeroPool (TableSize * sizeof (UINTN));
+    if (Set->Buffer == NULL || Set->Items == NULL || Set->Table == NULL) {
+        StringSetFree (&Set);
+
+        return NULL;
+    }
+    Set->TableMask = TableSize - 1;
+
+    // Split the copy in place ... Items point into it
+    Walk = Set->Buffer;
+    for (i = 0; i < Count; i++) {
+        Item        = &Set->Items[i];
+        Item->Value = Walk;
+        while (*Walk != L'\0' && *Walk != L',') {
+            Walk++;
+        }
+        Item->Length = (UINTN) (Walk - Item->Value);
+        if (*Walk == L',') {
+            *Walk++ = L'\0';
+        }
+        Item->Hash = StringSetHash (Item->Value, Item->Length);
+
+        if (Kind == STRING_SET_FILES) {
+            SplitPathName (Item->Value, &Item->VolName, &Item->Path, &Item->Filename);
+        }
+        else if (Kind == STRING_SET_DIRS) {
+            Item->Path = StrDuplicate (Item->Value);
+            SplitVolumeAndFilename (&Item->Path, &Item->VolName);
+            CleanUpPathNameSlashes (Item->Path);
+        }
+
+        Slot = Item->Hash & Set->TableMask;
+        while (Set->Table[Slot] != 0) {
+            Slot = (Slot + 1) & Set->TableMask;
+        }
+        Set->Table[Slot] = i + 1;
+        Set->Count++;
+    } // for
+
+    return Set;
+} // STRING_SET * StringSetCompile()
+
+// Returns the set compiled from List by CompileScanLists(), or NULL if
+// there is none. Sets are matched by address: they are dropped with
+// FreeScanLists() while their lists change, so a match is current.
+static
+STRING_SET * StringSetFindShared (
+    IN CHAR16 *List,
+    IN UINTN   Kind
+) {
+    UINTN        i;
+    STRING_SET  *Shared[] = {
+        GlobalConfig.DontScanVolumesSet,
+        GlobalConfig.DontScanDirsSet,
+        GlobalConfig.DontScanFilesSet,
+        GlobalConfig.LinuxPrefixesSet,
+        GlobalConfig.LinuxMatchPatternsSet
+    };
+
+    for (i = 0; i < sizeof (Shared) / sizeof (Shared[0]); i++) {
+        if (Shared[i] != NULL        &&
+            Shared[i]->Source == List &&
+            (Shared[i]->Kind == Kind || Kind == STRING_SET_PLAIN)
+        ) {
+            return Shared[i];
+        }
+    } // for
+
+    return NULL;
+} // static STRING_SET * StringSetFindShared()
+
+// Returns the GlobalConfig set compiled from List if there is one,
+// otherwise compiles a transient set. Either way, StringSetRelease()
+// must be called when done. Returns NULL if List is NULL.
+STRING_SET * StringSetAcquire (
+    IN CHAR16 *List,
+    IN UINTN   Kind
+) {
+    STRING_SET  *Set;
+
+    if (List == NULL) {
+        return NULL;
+    }
+
+    Set = StringSetFindShared (List, Kind);
+    if (Set != NULL) {
+        return Set;
+    }
+
+    return StringSetCompile (List, Kind);
+} // STRING_SET * StringSetAcquire()
+
+VOID StringSetRelease (
+    IN OUT STRING_SET **Set
+) {
+    if (Set == NULL || *Set == NULL) {
+        return;
+    }
+
+    if ((*Set)->Shared) {
+        *Set = NULL;
+    }
+    else {
+        StringSetFree (Set);
+    }
+} // VOID StringSetRelease()
+
+// Returns TRUE if SmallString is an element of Set, FALSE otherwise.
+// Performs comparison case-insensitively.
+BOOLEAN StringSetHas (
+    IN STRING_SET *Set,
+    IN CHAR16     *SmallString
+) {
+    UINTN             Slot;
+    UINTN             Index;
+    UINTN             Length;
+    UINT32            Hash;
+    STRING_SET_ITEM  *Item;
+
+    if (!Set || !SmallString) {
+        return FALSE;
+    }
+
+    Length = StrLen (SmallString);
+    Hash   = StringSetHash (SmallString, Length);
+    Slot   = Hash & Set->TableMask;
+    while ((Index = Set->Table[Slot]) != 0) {
+        Item = &Set->Items[Index - 1];
+        if (Item->Hash   == Hash   &&
+            Item->Length == Length &&
+            MyStriCmp (Item->Value, SmallString)
+        ) {
+            return TRUE;
+        }
+
+        Slot = (Slot + 1) & Set->TableMask;
+    } // while
+
+    return FALSE;
+} // BOOLEAN StringSetHas()
+
+// Returns TRUE if any element of Set can be found as a substring of
+// BigString, FALSE otherwise. Performs comparisons case-insensitively.
+BOOLEAN StringSetHasSubstring (
+    IN STRING_SET *Set,
+    IN CHAR16     *BigString
+) {
+    UINTN  i;
+    UINTN  BigLength;
+
+    if (!Set || !BigString) {
+        return FALSE;
+    }
+
+    BigLength = StrLen (BigString);
+    for (i = 0; i < Set->Count; i++) {
+        if (Set->Items[i].Length <= BigLength &&
+            StriSubCmp (Set->Items[i].Value, BigString)
+        ) {
+            return TRUE;
+        }
+    } // for
+
+    return FALSE;
+} // BOOLEAN StringSetHasSubstring()
+
 // Returns TRUE if SmallString is an element in the comma-delimited List,
 // FALSE otherwise. Performs comparison case-insensitively.
 BOOLEAN IsIn (
     IN CHAR16 *SmallString,
     IN CHAR16 *List
 ) {
-    UINTN     i;
-    BOOLEAN   Found;
-    CHAR16   *OneElement;
+    UINTN        i;
+    BOOLEAN      Found;
+    CHAR16      *OneElement;
+    STRING_SET  *Set;
 
     if (!SmallString || !List) {
         return FALSE;
     }
 
+    // Lists compiled by CompileScanLists() are looked up in their set
+    // Others are scanned in place, as they are often only checked once
+    Set = StringSetFindShared (List, STRING_SET_PLAIN);
+    if (Set != NULL) {
+        return StringSetHas (Set, SmallString);
+    }
+
     i = 0;
     Found = FALSE;
     while (!Found && (OneElement = FindCommaDelimited (List, i++))) {
@@ -1049,14 +1310,20 @@ BOOLEAN IsInSubstring (
     IN CHAR16 *BigString,
     IN CHAR16 *List
 ) {
-    BOOLEAN  Found;
-    UINTN    ElementLength, i;
-    CHAR16  *OneElement;
+    BOOLEAN      Found;
+    UINTN        ElementLength, i;
+    CHAR16      *OneElement;
+    STRING_SET  *Set;
 
     if (!BigString || !List) {
         return FALSE;
     }
 
+    Set = StringSetFindShared (List, STRING_SET_PLAIN);
+    if (Set != NULL) {
+        return StringSetHasSubstring (Set, BigString);
+    }
+
     i = 0;
     Found = FALSE;
     while (!Found && (OneElement = FindCommaDelimited (List, i++))) {
@@ -45,6 +45,36 @@ typedef struct _string_list {
     struct _string_list  *Next;
 } STRING_LIST;
 
+// STRING_SET 'Kind' values ... how elements are pre-split
+#define STRING_SET_PLAIN  0   // Whole elements only
+#define STRING_SET_FILES  1   // Also split as by SplitPathName()
+#define STRING_SET_DIRS   2   // Also split into volume and cleaned-up path
+
+typedef struct {
+    CHAR16   *Value;      // Points into the owning set's Buffer
+    UINTN     Length;
+    UINT32    Hash;       // Case-folded hash of Value
+    CHAR16   *VolName;    // Split parts, per the set's Kind, else NULL
+    CHAR16   *Path;
+    CHAR16   *Filename;
+} STRING_SET_ITEM;
+
+// A comma-delimited list parsed once for repeated lookups.
+// Items keep list order and empty elements, as with FindCommaDelimited().
+typedef struct {
+    CHAR16           *Source;       // List the set was compiled from
+    UINTN             Kind;
+    BOOLEAN           Shared;       // Owned by GlobalConfig ... Not freed on release
+    CHAR16           *Buffer;
+    UINTN             Count;
+    STRING_SET_ITEM  *Items;
+    UINTN             TableMask;
+    UINTN            *Table;        // Item index + 1 ... Zero marks a free slot
+} STRING_SET;
+
+// Glob pattern lists for DirIterNext() are held in the same form
+typedef STRING_SET PATTERN_SET;
+
 // DA-TAG: See here for more if needed:
 //         https://www.virtualbox.org/svn/vbox/trunk/src/VBox/Devices/EFI/Firmware/MdePkg/Library/BaseLib/String.c
 BOOLEAN FindSubStr (IN CHAR16 *RawString, IN CHAR16 *RawStrCharSet);
@@ -55,6 +85,8 @@ BOOLEAN LimitStringLength (CHAR16 *TheString, UINTN Limit);
 BOOLEAN DeleteItemFromCsvList (CHAR16 *ToDelete, CHAR16 *List);
 BOOLEAN IsIn (IN CHAR16 *SmallString, IN CHAR16 *List);
 BOOLEAN IsInSubstring (IN CHAR16 *BigString, IN CHAR16 *List);
+BOOLEAN StringSetHas (IN STRING_SET *Set, IN CHAR16 *SmallString);
+BOOLEAN StringSetHasSubstring (IN STRING_SET *Set, IN CHAR16 *BigString);
 BOOLEAN IsValidHex (CHAR16 *Input);
 BOOLEAN IsGuid (CHAR16 *UnknownString);
 BOOLEAN ReplaceSubstring (
@@ -79,6 +111,8 @@ CHAR16 * MyAsciiStrCopyToUnicode (
 );
 
 VOID DeleteStringList (STRING_LIST *StringList);
+VOID StringSetFree (IN OUT STRING_SET **Set);
+VOID StringSetRelease (IN OUT STRING_SET **Set);
 VOID ToUpper (CHAR16 *MyString);
 VOID ToLower (CHAR16 * MyString);
 VOID MergeStrings (IN OUT CHAR16 **First, IN CHAR16 *Second, IN CHAR16 AddChar);
@@ -90,6 +124,9 @@ VOID MyUnicodeFilterString (
     IN     BOOLEAN   SingleLine
 );
 
+STRING_SET * StringSetCompile (IN CHAR16 *List, IN UINTN Kind);
+STRING_SET * StringSetAcquire (IN CHAR16 *List, IN UINTN Kind);
+
 CHAR8 * MyAsciiStrStr (IN const CHAR8 *String, IN const CHAR8 *SearchString);
 
 UINTN NumCharsInCommon (IN CHAR16 *String1, IN CHAR16 *String2);
@@ -0,0 +1,255 @@
+/*
+ * BootMaster/prefetch.c
+ * Prefetch volume boot sectors with asynchronous BlockIo2 reads
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+/*
+ * ScanVolumes probes each BlockIo handle in turn and most of the time is
+ * spent waiting on the device. When 'prefetch_volumes' is set, a read of
+ * the first PREFETCH_SIZE bytes is queued on every handle that offers
+ * BlockIo2 before any probing starts, so that the devices work in
+ * parallel. Reads through PrefetchReadBlocks that fall within a queued
+ * range then wait for, and copy from, that buffer. Anything else, and
+ * every read on a handle without BlockIo2, goes to ReadBlocks as before.
+ *
+ * Firmware services may only be called from the boot processor, so other
+ * processors are not used for the reads.
+ */
+
+#include "global.h"
+#include "lib.h"
+#include "prefetch.h"
+#include "../include/refit_call_wrapper.h"
+
+typedef struct {
+    EFI_BLOCK_IO_PROTOCOL  *BlockIO;
+    UINT32                  MediaId;
+    UINT32                  BlockSize;
+    UINTN                   Size;
+    UINT8                  *Buffer;
+    EFI_STATUS              Status;
+    #ifdef __MAKEWITH_TIANO
+    EFI_BLOCK_IO2_TOKEN     Token;
+    #endif
+    BOOLEAN                 Pending;
+} PREFETCH_ENTRY;
+
+static PREFETCH_ENTRY  *PrefetchList  = NULL;
+static UINTN            PrefetchCount = 0;
+
+// Waits for the read on 'Entry' if still in flight
+static
+VOID PrefetchWait (
+    IN OUT PREFETCH_ENTRY *Entry
+) {
+    #ifdef __MAKEWITH_TIANO
+    EFI_STATUS Status;
+    UINTN      Index;
+
+    if (!Entry->Pending) {
+        // Early Return
+        return;
+    }
+
+    Status = REFIT_CALL_3_WRAPPER(
+        gBS->WaitForEvent, 1,
+        &Entry->Token.Event, &Index
+    );
+    Entry->Status  = (EFI_ERROR(Status)) ? Status : Entry->Token.TransactionStatus;
+    Entry->Pending = FALSE;
+
+    REFIT_CALL_1_WRAPPER(gBS->CloseEvent, Entry->Token.Event);
+    Entry->Token.Event = NULL;
+
+    if (EFI_ERROR(Entry->Status)) {
+        MY_FREE_POOL(Entry->Buffer);
+    }
+    #endif
+} // static VOID PrefetchWait()
+
+VOID PrefetchFree (VOID) {
+    UINTN i;
+
+    for (i = 0; i < PrefetchCount; i++) {
+        // Buffers must not be released while a read is in flight
+        PrefetchWait (&PrefetchList[i]);
+        MY_FREE_POOL(PrefetchList[i].Buffer);
+    }
+
+    MY_FREE_POOL(PrefetchList);
+    PrefetchCount = 0;
+} // VOID PrefetchFree()
+
+VOID PrefetchVolumes (
+    IN EFI_HANDLE *Handles,
+    IN UINTN       HandleCount
+) {
+    #ifdef __MAKEWITH_TIANO
+    EFI_STATUS              Status;
+    UINTN                   i;
+    UINTN                   Size;
+    EFI_BLOCK_IO_MEDIA     *Media;
+    EFI_BLOCK_IO_PROTOCOL  *BlockIO;
+    EFI_BLOCK_IO2_PROTOCOL *BlockIO2;
+    PREFETCH_ENTRY         *Entry;
+
+    PrefetchFree();
+
+    if (!GlobalConfig.PrefetchVolumes || HandleCount == 0) {
+        // Early Return
+        return;
+    }
+
+    PrefetchList = AllocateZeroPool (sizeof (PREFETCH_ENTRY) * HandleCount);
+    if (PrefetchList == NULL) {
+        // Early Return
+        return;
+    }
+
+    for (i = 0; i < HandleCount; i++) {
+        Status = REFIT_CALL_3_WRAPPER(
+            gBS->HandleProtocol, Handles[i],
+            &gEfiBlockIoProtocolGuid, (VOID **) &BlockIO
+        );
+        if (EFI_ERROR(Status)) {
+            continue;
+        }
+
+        Status = REFIT_CALL_3_WRAPPER(
+            gBS->HandleProtocol, Handles[i],
+            &gEfiBlockIo2ProtocolGuid, (VOID **) &BlockIO2
+        );
+        if (EFI_ERROR(Status)) {
+            continue;
+        }
+
+        Media = BlockIO2->Media;
+        if (!Media->MediaPresent       ||
+            Media->BlockSize == 0      ||
+            Media->BlockSize > PREFETCH_SIZE
+        ) {
+            continue;
+        }
+
+        // Whole blocks only and no further than the end of the device
+        Size = PREFETCH_SIZE - (PREFETCH_SIZE % Media->BlockSize);
+        if (Media->LastBlock < (Size / Media->BlockSize)) {
+            Size = (UINTN) (Media->LastBlock + 1) * Media->BlockSize;
+        }
+
+        Entry         = &PrefetchList[PrefetchCount];
+        Entry->Buffer = AllocatePool (Size);
+        if (Entry->Buffer == NULL) {
+            continue;
+        }
+        if (Media->IoAlign > 1 && ((UINTN) Entry->Buffer % Media->IoAlign) != 0) {
+            // The device needs an alignment AllocatePool does not give
+            MY_FREE_POOL(Entry->Buffer);
+            continue;
+        }
+
+        Status = REFIT_CALL_5_WRAPPER(
+            gBS->CreateEvent, 0,
+            0, NULL,
+            NULL, &Entry->Token.Event
+        );
+        if (EFI_ERROR(Status)) {
+            MY_FREE_POOL(Entry->Buffer);
+            continue;
+        }
+
+        Entry->Token.TransactionStatus = EFI_SUCCESS;
+        Status = REFIT_CALL_6_WRAPPER(
+            BlockIO2->ReadBlocksEx, BlockIO2,
+            Media->MediaId, 0,
+            &Entry->Token, Size, Entry->Buffer
+        );
+        if (EFI_ERROR(Status)) {
+            REFIT_CALL_1_WRAPPER(gBS->CloseEvent, Entry->Token.Event);
+            Entry->Token.Event = NULL;
+            MY_FREE_POOL(Entry->Buffer);
+            continue;
+        }
+
+        Entry->BlockIO   = BlockIO;
+        Entry->MediaId   = Media->MediaId;
+        Entry->BlockSize = Media->BlockSize;
+        Entry->Size      = Size;
+        Entry->Pending   = TRUE;
+        PrefetchCount++;
+    } // for
+
+    #if REFIT_DEBUG > 0
+    ALT_LOG(1, LOG_LINE_NORMAL,
+        L"Queued Prefetch Reads on %d of %d Volumes",
+        PrefetchCount, HandleCount
+    );
+    #endif
+    #endif
+} // VOID PrefetchVolumes()
+
+// Same contract as 'ReadBlocks' on 'BlockIO'
+EFI_STATUS PrefetchReadBlocks (
+    IN  EFI_BLOCK_IO_PROTOCOL *BlockIO,
+    IN  UINT32                 MediaId,
+    IN  EFI_LBA                Lba,
+    IN  UINTN                  BufferSize,
+    OUT VOID                  *Buffer
+) {
+    UINTN           i;
+    UINTN           Offset;
+    PREFETCH_ENTRY *Entry;
+
+    for (i = 0; i < PrefetchCount; i++) {
+        Entry = &PrefetchList[i];
+        if (Entry->BlockIO != BlockIO) {
+            continue;
+        }
+
+        if (Entry->MediaId != MediaId                      ||
+            Entry->BlockSize != BlockIO->Media->BlockSize  ||
+            (BufferSize % Entry->BlockSize) != 0           ||
+            Lba >= (Entry->Size / Entry->BlockSize)
+        ) {
+            // Leave errors and partial blocks to 'ReadBlocks'
+            break;
+        }
+
+        Offset = (UINTN) Lba * Entry->BlockSize;
+        if (BufferSize > Entry->Size - Offset) {
+            break;
+        }
+
+        PrefetchWait (Entry);
+        if (Entry->Buffer == NULL) {
+            break;
+        }
+
+        CopyMem (Buffer, Entry->Buffer + Offset, BufferSize);
+
+        return EFI_SUCCESS;
+    } // for
+
+    return REFIT_CALL_5_WRAPPER(
+        BlockIO->ReadBlocks, BlockIO,
+        MediaId, Lba,
+        BufferSize, Buffer
+    );
+} // EFI_STATUS PrefetchReadBlocks()
+
+/* EOF */
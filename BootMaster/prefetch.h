@@ -0,0 +1,45 @@
+/*
+ * BootMaster/prefetch.h
+ * Headers related to prefetching volume boot sectors
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __PREFETCH_H_
+#define __PREFETCH_H_
+
+// Bytes read from the start of each device ... Must not be less than
+// SAMPLE_SIZE in lib.c and also covers the MBR, the GPT header and a
+// standard 128 entry GPT partition array
+#define PREFETCH_SIZE 69632
+
+VOID PrefetchVolumes (
+    IN EFI_HANDLE *Handles,
+    IN UINTN       HandleCount
+);
+VOID PrefetchFree (VOID);
+EFI_STATUS PrefetchReadBlocks (
+    IN  EFI_BLOCK_IO_PROTOCOL *BlockIO,
+    IN  UINT32                 MediaId,
+    IN  EFI_LBA                Lba,
+    IN  UINTN                  BufferSize,
+    OUT VOID                  *Buffer
+);
+
+#endif
+
+/* EOF */
@@ -0,0 +1,322 @@
+/*
+ * BootMaster/profile.c
+ * Optional boot-phase profiler
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+/*
+ * Named scopes are timed with TSC deltas and accumulated per name as a
+ * count, total and maximum. Scopes nest, so a phase such as 'ScanVolumes'
+ * includes the time of the 'ScanVolume' calls made within it. Phases are
+ * the top level steps of 'efi_main'; functions are selected calls inside
+ * them. When the main menu is first painted, the time since start-up is
+ * recorded and a summary is saved to 'BootProfile.txt' in the RefindPlus
+ * directory. The phase summary is also shown on the 'About' screen.
+ *
+ * Ticks are converted with the TSC frequency found by MemLogLib.
+ */
+
+#include "global.h"
+#include "lib.h"
+#include "menu.h"
+#include "mystrings.h"
+#include "profile.h"
+#include "../libeg/libeg.h"
+#include "../include/version.h"
+#include "../include/refit_call_wrapper.h"
+
+#if REFIT_PROFILE > 0
+
+#define PROFILE_MAX_SLOTS   48
+#define PROFILE_MAX_DEPTH   16
+#define PROFILE_FILE_NAME   L"BootProfile.txt"
+
+typedef struct {
+    CHAR16  *Name;
+    UINTN    Kind;
+    UINTN    Count;
+    UINT64   Total;
+    UINT64   Max;
+} PROFILE_SLOT;
+
+typedef struct {
+    UINTN    Slot;      // Zero when the slot table was full
+    UINT64   Start;
+} PROFILE_FRAME;
+
+extern UINT64 EFIAPI GetMemLogTscTicksPerSecond (VOID);
+
+static PROFILE_SLOT    ProfileSlots[PROFILE_MAX_SLOTS];
+static PROFILE_FRAME   ProfileStack[PROFILE_MAX_DEPTH];
+static UINTN           ProfileSlotCount = 0;
+static UINTN           ProfileDepth     = 0;
+static UINTN           ProfileDropped   = 0;
+static UINT64          ProfileStart     = 0;
+static UINT64          ProfileToMenu    = 0;
+
+VOID ProfileInit (VOID) {
+    ProfileStart = AsmReadTsc();
+} // VOID ProfileInit()
+
+VOID ProfileBegin (
+    IN OUT UINTN   *Slot,
+    IN     UINTN    Kind,
+    IN     CHAR16  *Name
+) {
+    UINTN i;
+
+    if (*Slot == 0) {
+        // First pass through this site ... Sites may share a name
+        for (i = 0; i < ProfileSlotCount; i++) {
+            if (ProfileSlots[i].Kind == Kind && StrCmp (ProfileSlots[i].Name, Name) == 0) {
+                *Slot = i + 1;
+                break;
+            }
+        }
+
+        if (*Slot == 0 && ProfileSlotCount < PROFILE_MAX_SLOTS) {
+            ProfileSlots[ProfileSlotCount].Name = Name;
+            ProfileSlots[ProfileSlotCount].Kind = Kind;
+            *Slot = ++ProfileSlotCount;
+        }
+    }
+
+    if (ProfileDepth < PROFILE_MAX_DEPTH) {
+        ProfileStack[ProfileDepth].Slot  = *Slot;
+        ProfileStack[ProfileDepth].Start = AsmReadTsc();
+    }
+    ProfileDepth++;
+} // VOID ProfileBegin()
+
+VOID ProfileEnd (VOID) {
+    UINT64         Ticks;
+    PROFILE_SLOT  *Entry;
+    PROFILE_FRAME *Frame;
+
+    if (ProfileDepth == 0) {
+        // Early Return ... Unbalanced
+        return;
+    }
+
+    ProfileDepth--;
+    if (ProfileDepth >= PROFILE_MAX_DEPTH) {
+        ProfileDropped++;
+
+        // Early Return ... Nested too deeply to record
+        return;
+    }
+
+    Frame = &ProfileStack[ProfileDepth];
+    if (Frame->Slot == 0) {
+        ProfileDropped++;
+
+        // Early Return ... No free slot
+        return;
+    }
+
+    Ticks = AsmReadTsc() - Frame->Start;
+    Entry = &ProfileSlots[Frame->Slot - 1];
+    Entry->Count++;
+    Entry->Total += Ticks;
+    if (Entry->Max < Ticks) {
+        Entry->Max = Ticks;
+    }
+} // VOID ProfileEnd()
+
+// Formats 'Ticks' as milliseconds with three decimals
+static
+CHAR16 * ProfileFormatMs (
+    IN UINT64 Ticks,
+    IN UINT64 TicksPerSec
+) {
+    UINT64 Micro;
+    UINT32 Rem;
+
+    if (TicksPerSec == 0) {
+        return StrDuplicate (L"?");
+    }
+
+    Micro = DivU64x64Remainder (MultU64x32 (Ticks, 1000000), TicksPerSec, NULL);
+    Micro = DivU64x32Remainder (Micro, 1000, &Rem);
+
+    return PoolPrint (L"%ld.%03d", Micro, Rem);
+} // static CHAR16 * ProfileFormatMs()
+
+static
+VOID ProfileAddReportLines (
+    IN OUT CHAR16 **Report,
+    IN     UINTN    Kind,
+    IN     UINT64   TicksPerSec
+) {
+    UINTN   i;
+    CHAR16 *Total;
+    CHAR16 *Max;
+    CHAR16 *Line;
+
+    Line = PoolPrint (
+        L"%-24s %8s %14s %14s",
+        (Kind == PROFILE_KIND_PHASE) ? L"Phase" : L"Function",
+        L"Count", L"Total ms", L"Max ms"
+    );
+    MergeStrings (Report, Line, L'\n');
+    MY_FREE_POOL(Line);
+
+    for (i = 0; i < ProfileSlotCount; i++) {
+        if (ProfileSlots[i].Kind != Kind) {
+            continue;
+        }
+
+        Total = ProfileFormatMs (ProfileSlots[i].Total, TicksPerSec);
+        Max   = ProfileFormatMs (ProfileSlots[i].Max,   TicksPerSec);
+        Line  = PoolPrint (
+            L"%-24s %8d %14s %14s",
+            ProfileSlots[i].Name, ProfileSlots[i].Count,
+            Total, Max
+        );
+        MergeStrings (Report, Line, L'\n');
+        MY_FREE_POOL(Line);
+        MY_FREE_POOL(Total);
+        MY_FREE_POOL(Max);
+    } // for
+
+    MergeStrings (Report, L"", L'\n');
+} // static VOID ProfileAddReportLines()
+
+// Saves the summary as ASCII text, replacing any earlier report
+static
+EFI_STATUS ProfileSaveReport (VOID) {
+    EFI_STATUS  Status;
+    UINT64      TicksPerSec;
+    CHAR16     *Report;
+    CHAR16     *Line;
+    CHAR16     *ToMenu;
+    CHAR8      *Text;
+    UINTN       Length;
+    UINTN       i;
+
+    TicksPerSec = GetMemLogTscTicksPerSecond();
+    ToMenu      = ProfileFormatMs (ProfileToMenu, TicksPerSec);
+
+    Report = PoolPrint (L"RefindPlus %s Boot Profile", REFINDPLUS_VERSION);
+    Line   = PoolPrint (L"Time to Menu: %s ms\n", ToMenu);
+    MergeStrings (&Report, Line, L'\n');
+    MY_FREE_POOL(Line);
+    MY_FREE_POOL(ToMenu);
+
+    ProfileAddReportLines (&Report, PROFILE_KIND_PHASE,    TicksPerSec);
+    ProfileAddReportLines (&Report, PROFILE_KIND_FUNCTION, TicksPerSec);
+
+    if (ProfileDropped > 0) {
+        Line = PoolPrint (L"Scopes not recorded: %d\n", ProfileDropped);
+        MergeStrings (&Report, Line, L'\n');
+        MY_FREE_POOL(Line);
+    }
+
+    Length = StrLen (Report);
+    Text   = AllocatePool (Length + 1);
+    if (Text == NULL) {
+        MY_FREE_POOL(Report);
+
+        // Early Return
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    for (i = 0; i < Length; i++) {
+        Text[i] = (Report[i] < 0x80) ? (CHAR8) Report[i] : '?';
+    }
+    Text[Length] = '\0';
+    MY_FREE_POOL(Report);
+
+    // Clear the current report
+    egSaveFile (SelfDir, PROFILE_FILE_NAME, NULL, 0);
+
+    // Store the new report
+    Status = egSaveFile (SelfDir, PROFILE_FILE_NAME, (UINT8 *) Text, Length);
+    MY_FREE_POOL(Text);
+
+    #if REFIT_DEBUG > 0
+    ALT_LOG(1, LOG_LINE_NORMAL,
+        L"Save Boot Profile to '%s' ... %r",
+        PROFILE_FILE_NAME, Status
+    );
+    #endif
+
+    return Status;
+} // static EFI_STATUS ProfileSaveReport()
+
+// Called on each full main menu paint ... Acts on the first only
+VOID ProfileFirstPaint (VOID) {
+    if (ProfileStart == 0 || ProfileToMenu != 0) {
+        // Early Return
+        return;
+    }
+
+    ProfileToMenu = AsmReadTsc() - ProfileStart;
+    ProfileSaveReport();
+} // VOID ProfileFirstPaint()
+
+VOID ProfileAddInfoLines (
+    IN REFIT_MENU_SCREEN *Screen
+) {
+    UINTN   i;
+    UINT64  TicksPerSec;
+    UINT64  BltTicks;
+    UINT64  DirectTicks;
+    CHAR16 *Time;
+
+    if (ProfileToMenu == 0) {
+        // Early Return
+        return;
+    }
+
+    TicksPerSec = GetMemLogTscTicksPerSecond();
+
+    AddMenuInfoLine (Screen, L"", FALSE);
+    Time = ProfileFormatMs (ProfileToMenu, TicksPerSec);
+    AddMenuInfoLine (Screen, PoolPrint (L"Time to Menu  : %s ms", Time), TRUE);
+    MY_FREE_POOL(Time);
+
+    egTimeScreenPaint (&BltTicks, &DirectTicks);
+    if (BltTicks != 0) {
+        Time = ProfileFormatMs (BltTicks, TicksPerSec);
+        AddMenuInfoLine (Screen, PoolPrint (L"Screen Paint  : %s ms (Blt)", Time), TRUE);
+        MY_FREE_POOL(Time);
+    }
+    if (DirectTicks != 0) {
+        Time = ProfileFormatMs (DirectTicks, TicksPerSec);
+        AddMenuInfoLine (Screen, PoolPrint (L"Screen Paint  : %s ms (Framebuffer)", Time), TRUE);
+        MY_FREE_POOL(Time);
+    }
+
+    for (i = 0; i < ProfileSlotCount; i++) {
+        if (ProfileSlots[i].Kind != PROFILE_KIND_PHASE) {
+            continue;
+        }
+
+        Time = ProfileFormatMs (ProfileSlots[i].Total, TicksPerSec);
+        AddMenuInfoLine (
+            Screen,
+            PoolPrint (L"  %-20s: %s ms", ProfileSlots[i].Name, Time),
+            TRUE
+        );
+        MY_FREE_POOL(Time);
+    } // for
+} // VOID ProfileAddInfoLines()
+
+#endif
+
+/* EOF */
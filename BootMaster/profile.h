@@ -0,0 +1,76 @@
+/*
+ * BootMaster/profile.h
+ * Headers related to the optional boot-phase profiler
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __PROFILE_H_
+#define __PROFILE_H_
+
+// Build with '-DREFIT_PROFILE=1' added to the compiler flags to enable.
+// All profiler macros compile to the bare call otherwise.
+#ifndef REFIT_PROFILE
+#define REFIT_PROFILE 0
+#endif
+
+#if REFIT_PROFILE > 0
+
+#ifndef __MAKEWITH_TIANO
+#error "REFIT_PROFILE requires a TianoCore build"
+#endif
+
+#include "menu.h"
+
+#define PROFILE_KIND_PHASE     (0)
+#define PROFILE_KIND_FUNCTION  (1)
+
+VOID ProfileInit (VOID);
+VOID ProfileBegin (
+    IN OUT UINTN   *Slot,
+    IN     UINTN    Kind,
+    IN     CHAR16  *Name
+);
+VOID ProfileEnd (VOID);
+VOID ProfileFirstPaint (VOID);
+VOID ProfileAddInfoLines (IN REFIT_MENU_SCREEN *Screen);
+
+// Times 'Call' under 'Name'. Each site caches its table slot, so only
+// the first pass through a site looks the name up.
+#define PROFILE_SCOPE(Kind, Name, Call)                      \
+    do {                                                     \
+        static UINTN ProfileSlot = 0;                        \
+        ProfileBegin (&ProfileSlot, (Kind), (Name));         \
+        Call;                                                \
+        ProfileEnd();                                        \
+    } while (0)
+
+#define PROFILE_PHASE(Name, Call)     PROFILE_SCOPE(PROFILE_KIND_PHASE,    Name, Call)
+#define PROFILE_FUNCTION(Name, Call)  PROFILE_SCOPE(PROFILE_KIND_FUNCTION, Name, Call)
+#define PROFILE_FIRST_PAINT()         ProfileFirstPaint()
+
+#else
+
+#define PROFILE_PHASE(Name, Call)     Call
+#define PROFILE_FUNCTION(Name, Call)  Call
+#define PROFILE_FIRST_PAINT()
+
+#endif
+
+#endif
+
+/* EOF */
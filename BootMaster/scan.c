@@ -55,13 +55,16 @@
 #include "mok.h"
 #include "apple.h"
 #include "mystrings.h"
+#include "profile.h"
 #include "security_policy.h"
 #include "driver_support.h"
 #include "launch_efi.h"
 #include "launch_legacy.h"
 #include "linux.h"
 #include "scan.h"
+#include "scan_cache.h"
 #include "install.h"
+#include "crc32.h"
 #include "../include/refit_call_wrapper.h"
 
 
@@ -111,6 +114,9 @@ EFI_GUID GlobalGuid = EFI_GLOBAL_VARIABLE;
 extern EFI_GUID GuidAPFS;
 extern EFI_GUID AppleVendorOsGuid;
 
+extern BOOLEAN  OneMainLoop;
+extern UINT32   ConfigFileCrc;
+
 #if REFIT_DEBUG > 0
 static CHAR16  *Spacer   = L"                ";
 
@@ -121,6 +127,22 @@ BOOLEAN  HasMacOS        = FALSE;
 BOOLEAN  ScanningLoaders = FALSE;
 BOOLEAN  FirstLoaderScan = FALSE;
 
+// Set when only the default loader volume was scanned for DirectBoot
+BOOLEAN  PartialLoaderScan = FALSE;
+
+// 'DynamicCSR' as it was before a partial scan
+static INTN  PartialScanCSR = 0;
+
+// Loader entries set aside by KeepScannedEntries() for a rescan
+static LOADER_ENTRY  **KeptEntries      = NULL;
+static UINTN           KeptEntryCount   = 0;
+static BOOLEAN         KeepPending      = FALSE;
+static BOOLEAN         ReuseKeptEntries = FALSE;
+
+// State of the last loader scan
+static BOOLEAN         LastScanComplete = FALSE;
+static UINT32          LastScanCrc      = 0;
+
 // Structure used to hold boot loader filenames and time stamps in
 // a linked list; used to sort entries within a directory.
 struct
@@ -224,6 +246,7 @@ REFIT_MENU_ENTRY * CopyMenuEntry (
         NewEntry->ShortcutDigit  =  Entry->ShortcutDigit;
         NewEntry->ShortcutLetter =  Entry->ShortcutLetter;
         NewEntry->Title          = (Entry->Title      != NULL) ? StrDuplicate (Entry->Title)       : NULL;
+        NewEntry->IconName       = (Entry->IconName   != NULL) ? StrDuplicate (Entry->IconName)    : NULL;
         NewEntry->Image          = (Entry->Image      != NULL) ? egCopyImage (Entry->Image)        : NULL;
         NewEntry->BadgeImage     = (Entry->BadgeImage != NULL) ? egCopyImage (Entry->BadgeImage)   : NULL;
         NewEntry->SubScreen      = (Entry->SubScreen  != NULL) ? CopyMenuScreen (Entry->SubScreen) : NULL;
@@ -1179,13 +1202,16 @@ VOID SetLoaderDefaults (
     if (GetImage) {
         #if REFIT_DEBUG > 0
         ALT_LOG(1, LOG_LINE_NORMAL,
-            L"Trying to Locate an Icon Based on Hints:- '%s'",
+            L"Deferring Icon Search Based on Hints:- '%s'",
             OSIconName
         );
         #endif
 
         BREAD_CRUMB(L"%s:  8a 1", FuncTag);
-        Entry->me.Image = LoadOSIcon (OSIconName, L"unknown", FALSE);
+        // Loaded by LoadEntryIcon() when first needed
+        MY_FREE_POOL(Entry->me.IconName);
+        Entry->me.IconName = (OSIconName != NULL) ? OSIconName : StrDuplicate (L"");
+        OSIconName         = NULL;
     }
 
     BREAD_CRUMB(L"%s:  9", FuncTag);
@@ -1718,10 +1744,11 @@ BOOLEAN ShouldScan (
     CHAR16                 *VolName;
     CHAR16                 *VolGuid;
     CHAR16                 *PathCopy;
-    CHAR16                 *DontScanDir;
     CHAR16                 *TmpVolNameA;
     CHAR16                 *TmpVolNameB;
     BOOLEAN                 ScanIt;
+    STRING_SET             *DontScanDirs;
+    STRING_SET_ITEM        *DontScanDir;
     APPLE_APFS_VOLUME_ROLE  VolumeRole;
 
 
@@ -1814,28 +1841,23 @@ BOOLEAN ShouldScan (
     MY_FREE_POOL(VolName);
 
     // See if Volume is in GlobalConfig.DontScanDirs.
-    i = 0;
-    while (ScanIt &&
-        (DontScanDir = FindCommaDelimited (GlobalConfig.DontScanDirs, i++))
-    ) {
-        SplitVolumeAndFilename (&DontScanDir, &VolName);
-        CleanUpPathNameSlashes (DontScanDir);
-        if (VolName != NULL) {
-            if (VolumeMatchesDescription (Volume, VolName)
-                && MyStriCmp (DontScanDir, Path)
+    DontScanDirs = StringSetAcquire (GlobalConfig.DontScanDirs, STRING_SET_DIRS);
+    for (i = 0; ScanIt && DontScanDirs != NULL && i < DontScanDirs->Count; i++) {
+        DontScanDir = &DontScanDirs->Items[i];
+        if (DontScanDir->VolName != NULL) {
+            if (VolumeMatchesDescription (Volume, DontScanDir->VolName)
+                && MyStriCmp (DontScanDir->Path, Path)
             ) {
                 ScanIt = FALSE;
             }
         }
         else {
-            if (MyStriCmp (DontScanDir, Path)) {
+            if (MyStriCmp (DontScanDir->Path, Path)) {
                 ScanIt = FALSE;
             }
         }
-
-        MY_FREE_POOL(DontScanDir);
-        MY_FREE_POOL(VolName);
-    } // while
+    } // for
+    StringSetRelease (&DontScanDirs);
 
     return ScanIt;
 } // BOOLEAN ShouldScan()
@@ -1994,14 +2016,20 @@ BOOLEAN ScanLoaderDir (
     CHAR16                  *Message;
     CHAR16                  *Extension;
     CHAR16                  *FullName;
+    CHAR16                 **CachedNames;
+    UINTN                    CachedCount;
+    UINTN                    i;
     struct LOADER_LIST      *NewLoader;
     struct LOADER_LIST      *LoaderList;
+    struct LOADER_LIST      *LastLoader;
     LOADER_ENTRY            *FirstKernel;
     LOADER_ENTRY            *LatestEntry;
+    SCAN_CACHE_KEY           CacheKey;
     BOOLEAN                  IsLinux;
     BOOLEAN                  InSelfPath;
     BOOLEAN                  SkipDir;
     BOOLEAN                  RetVal;
+    BOOLEAN                  CacheHit;
     BOOLEAN                  FoundFallbackDuplicate;
 
     #if REFIT_DEBUG > 1
@@ -2032,8 +2060,36 @@ BOOLEAN ScanLoaderDir (
         // Look through contents of the directory
         DirIterOpen (Volume->RootDir, Path, &DirIter);
 
+        // Reuse the loaders found on an earlier boot if the directory is unchanged.
+        // Cached names are already in sorted order.
+        CacheHit = ScanCacheFetch (
+            Volume, Path, Pattern, FALLBACK_FULLNAME,
+            &CacheKey, &CachedNames, &CachedCount,
+            &FoundFallbackDuplicate
+        );
+        if (CacheHit) {
+            LastLoader = NULL;
+            for (i = 0; i < CachedCount; i++) {
+                NewLoader = AllocateZeroPool (sizeof (struct LOADER_LIST));
+                if (NewLoader == NULL) {
+                    MY_FREE_POOL(CachedNames[i]);
+                    continue;
+                }
+
+                NewLoader->FileName = CachedNames[i];
+                if (LastLoader == NULL) {
+                    LoaderList = NewLoader;
+                }
+                else {
+                    LastLoader->NextEntry = NewLoader;
+                }
+                LastLoader = NewLoader;
+            } // for
+            MY_FREE_POOL(CachedNames);
+        }
+
         //BREAD_CRUMB(L"%s:  2a 2", FuncTag);
-        while (DirIterNext (&DirIter, 2, Pattern, &DirEntry)) {
+        while (!CacheHit && DirIterNext (&DirIter, 2, Pattern, &DirEntry)) {
             //LOG_SEP(L"X");
             //BREAD_CRUMB(L"%s:  2a 2a 1 - WHILE LOOP:- START", FuncTag);
             Extension = FindExtension (DirEntry->FileName);
@@ -2123,6 +2179,26 @@ BOOLEAN ScanLoaderDir (
             //LOG_SEP(L"X");
         } // while
 
+        if (!CacheHit && CacheKey.Valid) {
+            CachedCount = 0;
+            for (NewLoader = LoaderList; NewLoader != NULL; NewLoader = NewLoader->NextEntry) {
+                CachedCount++;
+            }
+
+            CachedNames = (CachedCount == 0)
+                ? NULL
+                : AllocatePool (sizeof (CHAR16 *) * CachedCount);
+            if (CachedCount == 0 || CachedNames != NULL) {
+                i = 0;
+                for (NewLoader = LoaderList; NewLoader != NULL; NewLoader = NewLoader->NextEntry) {
+                    CachedNames[i++] = NewLoader->FileName;
+                }
+
+                ScanCacheStore (&CacheKey, CachedNames, CachedCount, FoundFallbackDuplicate);
+                MY_FREE_POOL(CachedNames);
+            }
+        }
+
         //BREAD_CRUMB(L"%s:  2a 3", FuncTag);
         if (LoaderList != NULL) {
             IsLinux     = FALSE;
@@ -2813,6 +2889,109 @@ VOID ScanEfiFiles (
     //LOG_SEP(L"X");
 } // static VOID ScanEfiFiles()
 
+static
+VOID FreeKeptEntries (VOID) {
+    UINTN i;
+
+    for (i = 0; i < KeptEntryCount; i++) {
+        FreeMenuEntry ((REFIT_MENU_ENTRY **) &KeptEntries[i]);
+    }
+    MY_FREE_POOL(KeptEntries);
+    KeptEntryCount = 0;
+} // static VOID FreeKeptEntries()
+
+// Set aside the loader entries found on each volume by the last scan, so that
+// a rescan can put back those of unchanged volumes instead of scanning them
+// again. Must be called before the main menu is cleared. Entries own copies
+// of their volumes, so they stay valid when the volume list is rebuilt.
+VOID KeepScannedEntries (VOID) {
+    UINTN              i, j;
+    REFIT_MENU_ENTRY  *Entry;
+
+    FreeKeptEntries();
+    KeepPending = FALSE;
+
+    if (!LastScanComplete || MainMenu == NULL) {
+        // Early Return ... Some volumes were not scanned
+        return;
+    }
+
+    for (i = 0, j = 0; i < MainMenu->EntryCount; i++) {
+        Entry = MainMenu->Entries[i];
+        if (Entry->Tag == TAG_LOADER && ((LOADER_ENTRY *) Entry)->FoundOnVolume) {
+            AddListElement ((VOID ***) &KeptEntries, &KeptEntryCount, Entry);
+
+            continue;
+        }
+
+        MainMenu->Entries[j++] = Entry;
+    } // for
+    MainMenu->EntryCount = j;
+
+    KeepPending = TRUE;
+} // VOID KeepScannedEntries()
+
+// Checksum of the configuration that loader entries found on volumes depend on.
+// Taken once any temporary 'Dont Scan' amendments are in place.
+static
+UINT32 LoaderScanCrc (VOID) {
+    UINT32 Crc;
+
+    Crc = crc32refit (0, &ConfigFileCrc, sizeof (ConfigFileCrc));
+    if (GlobalConfig.DontScanFiles != NULL) {
+        Crc = crc32refit (Crc, GlobalConfig.DontScanFiles, StrSize (GlobalConfig.DontScanFiles));
+    }
+    if (GlobalConfig.DontScanDirs != NULL) {
+        Crc = crc32refit (Crc, GlobalConfig.DontScanDirs, StrSize (GlobalConfig.DontScanDirs));
+    }
+    if (GlobalConfig.DontScanVolumes != NULL) {
+        Crc = crc32refit (Crc, GlobalConfig.DontScanVolumes, StrSize (GlobalConfig.DontScanVolumes));
+    }
+
+    return Crc;
+} // static UINT32 LoaderScanCrc()
+
+// Scan a volume for EFI boot loaders. On a rescan, volumes that have not
+// changed get back the entries found on them by the last scan instead.
+static
+VOID ScanVolumeLoaders (
+    IN REFIT_VOLUME *Volume
+) {
+    UINTN          i;
+    UINTN          EntryCount;
+    LOADER_ENTRY  *Entry;
+
+    if (ReuseKeptEntries && !Volume->IsNewOnRescan) {
+        for (i = 0; i < KeptEntryCount; i++) {
+            Entry = KeptEntries[i];
+            if (Entry == NULL || !SameVolume (Entry->Volume, Volume)) {
+                continue;
+            }
+
+            // Shortcut keys are assigned afresh once the scan is done
+            Entry->me.ShortcutDigit = 0;
+            AddMenuEntry (MainMenu, (REFIT_MENU_ENTRY *) Entry);
+            KeptEntries[i] = NULL;
+
+            #if REFIT_DEBUG > 0
+            ALT_LOG(1, LOG_LINE_NORMAL, L"Kept Loader Entry:- '%s'", Entry->me.Title);
+            #endif
+        } // for
+
+        // Early Return ... Unchanged volume
+        return;
+    }
+
+    EntryCount = MainMenu->EntryCount;
+    PROFILE_FUNCTION(L"ScanEfiFiles", ScanEfiFiles (Volume));
+
+    for (i = EntryCount; i < MainMenu->EntryCount; i++) {
+        if (MainMenu->Entries[i]->Tag == TAG_LOADER) {
+            ((LOADER_ENTRY *) MainMenu->Entries[i])->FoundOnVolume = TRUE;
+        }
+    } // for
+} // static VOID ScanVolumeLoaders()
+
 // Scan internal disks for valid EFI boot loaders.
 static
 VOID ScanInternal (VOID) {
@@ -2833,7 +3012,7 @@ VOID ScanInternal (VOID) {
     FirstLoaderScan = TRUE;
     for (VolumeIndex = 0; VolumeIndex < VolumesCount; VolumeIndex++) {
         if (Volumes[VolumeIndex]->DiskKind == DISK_KIND_INTERNAL) {
-            ScanEfiFiles (Volumes[VolumeIndex]);
+            ScanVolumeLoaders (Volumes[VolumeIndex]);
         }
     } // for
 
@@ -2869,7 +3048,7 @@ VOID ScanExternal (VOID) {
     FirstLoaderScan = TRUE;
     for (VolumeIndex = 0; VolumeIndex < VolumesCount; VolumeIndex++) {
         if (Volumes[VolumeIndex]->DiskKind == DISK_KIND_EXTERNAL) {
-            ScanEfiFiles (Volumes[VolumeIndex]);
+            ScanVolumeLoaders (Volumes[VolumeIndex]);
         }
     } // for
 
@@ -2900,7 +3079,7 @@ VOID ScanOptical (VOID) {
     FirstLoaderScan = TRUE;
     for (VolumeIndex = 0; VolumeIndex < VolumesCount; VolumeIndex++) {
         if (Volumes[VolumeIndex]->DiskKind == DISK_KIND_OPTICAL) {
-            ScanEfiFiles (Volumes[VolumeIndex]);
+            ScanVolumeLoaders (Volumes[VolumeIndex]);
         }
     } // for
     FirstLoaderScan = FALSE;
@@ -2910,6 +3089,129 @@ VOID ScanOptical (VOID) {
     LOG_SEP(L"X");
 } // static VOID ScanOptical()
 
+// On the first DirectBoot run, scan only the volume named in the first
+// 'default_selection' item. Returns TRUE if that item then matches the title
+// of a loader found there, in which case other volumes are left unscanned.
+// Otherwise, any entries found are dropped so that the full scan adds them
+// in the usual order.
+static
+BOOLEAN ScanDefaultVolume (VOID) {
+    UINTN          i;
+    UINTN          Length;
+    UINTN          MaxLength;
+    UINTN          EntryCount;
+    CHAR16        *Default;
+    BOOLEAN        Found;
+    BOOLEAN        Unique;
+    BOOLEAN        ScanKind[3];
+    REFIT_VOLUME  *Volume;
+
+    if (!GlobalConfig.DirectBoot || OneMainLoop || ReuseKeptEntries) {
+        // Early Return ... Entries kept from an earlier scan must not be dropped below
+        return FALSE;
+    }
+
+    Default = FindCommaDelimited (GlobalConfig.DefaultSelection, 0);
+    if (Default == NULL || StrLen (Default) < 2) {
+        // Shortcut keys depend on the position in the full menu
+        MY_FREE_POOL(Default);
+
+        // Early Return
+        return FALSE;
+    }
+
+    ScanKind[DISK_KIND_INTERNAL] = ScanKind[DISK_KIND_EXTERNAL] = ScanKind[DISK_KIND_OPTICAL] = FALSE;
+    for (i = 0; i < NUM_SCAN_OPTIONS; i++) {
+        switch (GlobalConfig.ScanFor[i]) {
+            case 'i': case 'I': ScanKind[DISK_KIND_INTERNAL] = TRUE; break;
+            case 'e': case 'E': ScanKind[DISK_KIND_EXTERNAL] = TRUE; break;
+            case 'o': case 'O': ScanKind[DISK_KIND_OPTICAL]  = TRUE; break;
+        } // switch
+    } // for
+
+    // Pick the volume with the longest name found in the item
+    Volume    = NULL;
+    Unique    = FALSE;
+    MaxLength = 0;
+    for (i = 0; i < VolumesCount; i++) {
+        if (Volumes[i]->DiskKind > DISK_KIND_OPTICAL ||
+            !ScanKind[Volumes[i]->DiskKind]          ||
+            Volumes[i]->VolName == NULL              ||
+            !StriSubCmp (Volumes[i]->VolName, Default)
+        ) {
+            continue;
+        }
+
+        Length = StrLen (Volumes[i]->VolName);
+        if (Length > MaxLength) {
+            Volume    = Volumes[i];
+            Unique    = TRUE;
+            MaxLength = Length;
+        }
+        else if (Length == MaxLength) {
+            Unique    = FALSE;
+        }
+    } // for
+
+    if (Volume == NULL || !Unique) {
+        MY_FREE_POOL(Default);
+
+        // Early Return
+        return FALSE;
+    }
+
+    #if REFIT_DEBUG > 0
+    ALT_LOG(1, LOG_LINE_THIN_SEP,
+        L"Scan Default Loader Volume First:- '%s'",
+        Volume->VolName
+    );
+    #endif
+
+    // Scanned as in the full scan, so the scan cache applies here too
+    EntryCount      = MainMenu->EntryCount;
+    FirstLoaderScan = TRUE;
+    ScanVolumeLoaders (Volume);
+    FirstLoaderScan = FALSE;
+
+    // Require an exact title match as a partial match could be bettered elsewhere
+    Found = FALSE;
+    for (i = EntryCount; i < MainMenu->EntryCount; i++) {
+        if (MyStriCmp (Default, MainMenu->Entries[i]->Title)) {
+            Found = TRUE;
+            break;
+        }
+    } // for
+
+    if (!Found) {
+        for (i = EntryCount; i < MainMenu->EntryCount; i++) {
+            FreeMenuEntry (&MainMenu->Entries[i]);
+        }
+        MainMenu->EntryCount = EntryCount;
+    }
+
+    #if REFIT_DEBUG > 0
+    ALT_LOG(1, LOG_LINE_NORMAL,
+        L"Default Loader %s:- '%s'",
+        (Found) ? L"Found ... Skip Other Volumes" : L"Not Found ... Scan All Volumes",
+        Default
+    );
+    #endif
+
+    if (Found) {
+        // Kept to be restored if the other volumes are scanned later
+        PartialScanCSR = GlobalConfig.DynamicCSR;
+
+        if (!HasMacOS) {
+            // Disable DynamicCSR as ScanInternal() does ... Mac OS not detected
+            GlobalConfig.DynamicCSR = 0;
+        }
+    }
+
+    MY_FREE_POOL(Default);
+
+    return Found;
+} // static BOOLEAN ScanDefaultVolume()
+
 // Scan options stored in UEFI firmware's boot list. Adds discovered and allowed
 // items to the specified Row.
 // If MatchThis != NULL, only adds items with labels containing any element of
@@ -3108,6 +3410,7 @@ LOADER_ENTRY * AddToolEntry (
 VOID ScanForBootloaders (VOID) {
     UINTN     i;
     UINTN     SetOptions;
+    UINT32    ScanCrc;
     CHAR16    ShortCutKey;
     CHAR16   *HiddenTags;
     CHAR16   *HiddenLegacy;
@@ -3126,6 +3429,9 @@ VOID ScanForBootloaders (VOID) {
 
     ScanningLoaders = TRUE;
 
+    // Read each directory once while scanning
+    EnableDirSnapshots();
+
     #if REFIT_DEBUG > 0
     ALT_LOG(1, LOG_BLANK_LINE_SEP, L"X");
     MsgStr = StrDuplicate (L"S E E K   U E F I   L O A D E R S");
@@ -3163,6 +3469,9 @@ VOID ScanForBootloaders (VOID) {
         BdsAddNonExistingLegacyBootOptions();
     }
 
+    // The 'Dont Scan' lists may be amended below ... Compiled again after
+    FreeScanLists();
+
     OrigDontScanFiles = OrigDontScanVolumes = NULL;
     if (GlobalConfig.HiddenTags) {
         // We temporarily modify GlobalConfig.DontScanFiles and GlobalConfig.DontScanVolumes
@@ -3282,6 +3591,19 @@ VOID ScanForBootloaders (VOID) {
         #endif
     } // if GlobalConfig.SyncAPFS
 
+    // Parse the 'Dont Scan' lists now in effect once for the whole scan
+    CompileScanLists();
+
+    // Entries kept from the last scan are only valid for the same configuration
+    ScanCrc          = LoaderScanCrc();
+    ReuseKeptEntries = (KeepPending && ScanCrc == LastScanCrc);
+    if (!ReuseKeptEntries) {
+        FreeKeptEntries();
+    }
+
+    // Load cached loader directory scans for the 'Dont Scan' lists now in effect
+    ScanCacheBegin();
+
     // Get count of options set to be scanned
     SetOptions = 0;
     for (i = 0; i < NUM_SCAN_OPTIONS; i++) {
@@ -3299,8 +3621,16 @@ VOID ScanForBootloaders (VOID) {
         } // switch
     } // for
 
+    if (PartialLoaderScan) {
+        // The previous scan was partial ... Restore 'DynamicCSR' for the full scan
+        GlobalConfig.DynamicCSR = PartialScanCSR;
+    }
+
+    // Try the default loader volume on its own first with DirectBoot
+    PartialLoaderScan = ScanDefaultVolume();
+
     // scan for loaders and tools, add them to the menu
-    for (i = 0; i <= SetOptions; i++) {
+    for (i = 0; i <= SetOptions && !PartialLoaderScan; i++) {
         switch (GlobalConfig.ScanFor[i]) {
             case 'm': case 'M':
                 #if REFIT_DEBUG > 0
@@ -3409,6 +3739,16 @@ VOID ScanForBootloaders (VOID) {
     LogNewLine = FALSE;
     #endif
 
+    ScanCacheEnd();
+    FreeDirSnapshots();
+
+    // Drop entries of volumes that are gone or no longer scanned
+    FreeKeptEntries();
+    KeepPending      = ReuseKeptEntries = FALSE;
+    LastScanComplete = !PartialLoaderScan;
+    LastScanCrc      = ScanCrc;
+
+    FreeScanLists();
     if (GlobalConfig.HiddenTags) {
         // Restore the backed-up GlobalConfig.DontScan* variables
         MY_FREE_POOL(GlobalConfig.DontScanFiles);
@@ -3425,6 +3765,7 @@ VOID ScanForBootloaders (VOID) {
     else {
         MY_FREE_POOL(OrigDontScanDirs);
     }
+    CompileScanLists();
 
     if (MainMenu->EntryCount < 1) {
         #if REFIT_DEBUG > 0
@@ -65,6 +65,7 @@ REFIT_MENU_ENTRY * CopyMenuEntry (REFIT_MENU_ENTRY *Entry);
 VOID GenerateSubScreen(LOADER_ENTRY *Entry, IN REFIT_VOLUME *Volume, IN BOOLEAN GenerateReturn);
 VOID SetLoaderDefaults(LOADER_ENTRY *Entry, CHAR16 *LoaderPath, IN REFIT_VOLUME *Volume);
 VOID ScanForBootloaders(VOID);
+VOID KeepScannedEntries (VOID);
 VOID ScanForTools(VOID);
 CHAR16 * SetVolJoin (IN CHAR16 *InstanceName);
 CHAR16 * SetVolKind (IN CHAR16 *InstanceName, IN CHAR16 *VolumeName);
@@ -0,0 +1,623 @@
+/*
+ * BootMaster/scan_cache.c
+ * Persistent cache of loader directory scan results
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+/*
+ * Scanning a loader directory opens and checks every candidate file
+ * ('IsValidLoader', 'HasSignedCounterpart', 'DuplicatesFallback', etc).
+ * The outcome only changes when the directory contents, the fallback
+ * loader or the relevant configuration change, so the accepted loaders
+ * are recorded per volume and directory together with a fingerprint of
+ * the volume and of the directory's own size and modification time. When the fingerprint still matches on a later
+ * boot, the recorded loaders are used without probing the files again.
+ *
+ * The cache is stored in the 'ScanCache' RefindPlus variable, which is
+ * saved to NVRAM or to the emulated variable store on the ESP according
+ * to the 'use_nvram' setting. The results of the last scan are also kept
+ * in memory for rescans that follow menu changes. Rescans requested by the
+ * user probe every directory afresh (see 'ScanCacheBypass').
+ */
+
+#include "global.h"
+#include "lib.h"
+#include "mystrings.h"
+#include "crc32.h"
+#include "scan_cache.h"
+#include "../include/refit_call_wrapper.h"
+
+#define SCAN_CACHE_VAR_NAME   L"ScanCache"
+#define SCAN_CACHE_SIGNATURE  0x43535052   /* 'RPSC' */
+#define SCAN_CACHE_VERSION    2
+#define SCAN_CACHE_MAX_SIZE   8192
+#define SCAN_CACHE_FLAG_DUP   0x0001
+
+#pragma pack(1)
+typedef struct {
+    UINT32  Signature;
+    UINT32  Version;
+    UINT32  ConfigCrc;
+    UINT32  RecordCount;
+} SCAN_CACHE_HEADER;
+
+// Each record is followed by 'LoaderCount' names, stored as a UINT16
+// character count and the unterminated CHAR16 string, in menu order.
+typedef struct {
+    UINT32  KeyCrc;
+    UINT32  Fingerprint;
+    UINT16  Flags;
+    UINT16  LoaderCount;
+    UINT32  RecordSize;
+} SCAN_CACHE_RECORD;
+#pragma pack()
+
+extern EFI_GUID  GuidNull;
+
+BOOLEAN          ScanCacheBypass = FALSE;
+
+static BOOLEAN   CacheActive     = FALSE;
+static UINT32    CacheConfigCrc  = 0;
+static UINT8    *OldCache        = NULL;
+static UINTN     OldCacheSize    = 0;
+static UINT8    *NewCache        = NULL;
+static UINTN     NewCacheSize    = 0;
+static UINT32    NewRecordCount  = 0;
+static UINT8    *SessionCache    = NULL;
+static UINTN     SessionCacheSize = 0;
+
+
+// Locate the record for KeyCrc in a cache buffer.
+// Returns the offset of the record or 0 if absent or if the buffer is damaged.
+static
+UINTN ScanCacheFindRecord (
+    IN  UINT8              *Buffer,
+    IN  UINTN               BufferSize,
+    IN  UINT32              KeyCrc,
+    OUT SCAN_CACHE_RECORD  *Record
+) {
+    SCAN_CACHE_HEADER  Header;
+    UINTN              Offset;
+    UINT32             i;
+
+    if (Buffer == NULL || BufferSize < sizeof (SCAN_CACHE_HEADER)) {
+        // Early Return
+        return 0;
+    }
+
+    CopyMem (&Header, Buffer, sizeof (SCAN_CACHE_HEADER));
+    Offset = sizeof (SCAN_CACHE_HEADER);
+    for (i = 0; i < Header.RecordCount; i++) {
+        if (BufferSize - Offset < sizeof (SCAN_CACHE_RECORD)) {
+            break;
+        }
+
+        CopyMem (Record, Buffer + Offset, sizeof (SCAN_CACHE_RECORD));
+        if (Record->RecordSize < sizeof (SCAN_CACHE_RECORD) ||
+            Record->RecordSize > BufferSize - Offset
+        ) {
+            break;
+        }
+
+        if (Record->KeyCrc == KeyCrc) {
+            return Offset;
+        }
+
+        Offset += Record->RecordSize;
+    } // for
+
+    return 0;
+} // static UINTN ScanCacheFindRecord()
+
+// Append a complete record to the cache being built for this scan.
+// Records that do not fit are dropped.
+static
+VOID ScanCacheAppend (
+    IN UINT8  *Record,
+    IN UINTN   RecordSize
+) {
+    if (NewCache == NULL || RecordSize > SCAN_CACHE_MAX_SIZE - NewCacheSize) {
+        // Early Return
+        return;
+    }
+
+    CopyMem (NewCache + NewCacheSize, Record, RecordSize);
+    NewCacheSize += RecordSize;
+    NewRecordCount++;
+} // static VOID ScanCacheAppend()
+
+// Add the parts of a directory entry that identify its current state.
+// The EFI_TIME padding fields are left out as they are not meaningful.
+static
+UINT32 ScanCacheMixInfo (
+    IN UINT32         Crc,
+    IN EFI_FILE_INFO *FileInfo
+) {
+    EFI_TIME  ModTime;
+
+    ZeroMem (&ModTime, sizeof (EFI_TIME));
+    ModTime.Year       = FileInfo->ModificationTime.Year;
+    ModTime.Month      = FileInfo->ModificationTime.Month;
+    ModTime.Day        = FileInfo->ModificationTime.Day;
+    ModTime.Hour       = FileInfo->ModificationTime.Hour;
+    ModTime.Minute     = FileInfo->ModificationTime.Minute;
+    ModTime.Second     = FileInfo->ModificationTime.Second;
+    ModTime.Nanosecond = FileInfo->ModificationTime.Nanosecond;
+
+    Crc = crc32refit (Crc, FileInfo->FileName, StrSize (FileInfo->FileName));
+    Crc = crc32refit (Crc, &FileInfo->FileSize, sizeof (FileInfo->FileSize));
+    Crc = crc32refit (Crc, &FileInfo->Attribute, sizeof (FileInfo->Attribute));
+    Crc = crc32refit (Crc, &ModTime, sizeof (EFI_TIME));
+
+    return Crc;
+} // static UINT32 ScanCacheMixInfo()
+
+// Add the current state of a file or directory on a volume.
+// Returns EFI_NOT_FOUND, leaving 'Crc' as is, if the item is absent.
+static
+EFI_STATUS ScanCacheMixItem (
+    IN OUT UINT32        *Crc,
+    IN     REFIT_VOLUME  *Volume,
+    IN     CHAR16        *ItemName
+) {
+    EFI_STATUS       Status;
+    EFI_FILE_HANDLE  FileHandle;
+    EFI_FILE_INFO   *FileInfo;
+
+    Status = REFIT_CALL_5_WRAPPER(
+        Volume->RootDir->Open, Volume->RootDir,
+        &FileHandle, ItemName,
+        EFI_FILE_MODE_READ, 0
+    );
+    if (EFI_ERROR(Status)) {
+        // Early Return
+        return Status;
+    }
+
+    FileInfo = LibFileInfo (FileHandle);
+    if (FileInfo == NULL) {
+        Status = EFI_DEVICE_ERROR;
+    }
+    else {
+        *Crc = ScanCacheMixInfo (*Crc, FileInfo);
+    }
+    MY_FREE_POOL(FileInfo);
+    REFIT_CALL_1_WRAPPER(FileHandle->Close, FileHandle);
+
+    return Status;
+} // static EFI_STATUS ScanCacheMixItem()
+
+// Fingerprint a directory from the volume it is on and the size and
+// modification time of the directory itself, which change when entries
+// are added, removed or renamed. The fallback loader, which the scan
+// compares candidate loaders against, is added as well.
+static
+EFI_STATUS ScanCacheFingerprint (
+    IN  REFIT_VOLUME  *Volume,
+    IN  CHAR16        *Path,
+    IN  CHAR16        *FallbackName,
+    OUT UINT32        *Fingerprint
+) {
+    EFI_STATUS  Status;
+    UINT32      Crc;
+
+    Crc = crc32refit (0,   &(Volume->PartGuid), sizeof (EFI_GUID));
+    Crc = crc32refit (Crc, &(Volume->VolUuid),  sizeof (EFI_GUID));
+    Crc = crc32refit (Crc, &(Volume->FSType),   sizeof (Volume->FSType));
+
+    Status = ScanCacheMixItem (&Crc, Volume, (Path[0] == L'\0') ? L"\\" : Path);
+    if (EFI_ERROR(Status) && Status != EFI_NOT_FOUND) {
+        // Early Return
+        return Status;
+    }
+
+    // An absent fallback loader is part of the state too
+    ScanCacheMixItem (&Crc, Volume, FallbackName);
+
+    *Fingerprint = Crc;
+
+    return EFI_SUCCESS;
+} // static EFI_STATUS ScanCacheFingerprint()
+
+// Add a configuration list. Unset lists are marked as such, so that
+// moving an entry from one list to another changes the result.
+static
+UINT32 ScanCacheMixString (
+    IN UINT32  Crc,
+    IN CHAR16 *String
+) {
+    if (String == NULL) {
+        // Early Return
+        return crc32refit (Crc, L"", sizeof (CHAR16));
+    }
+
+    return crc32refit (Crc, String, StrSize (String));
+} // static UINT32 ScanCacheMixString()
+
+static
+VOID ScanCacheReset (VOID) {
+    MY_FREE_POOL(OldCache);
+    MY_FREE_POOL(NewCache);
+    OldCacheSize   = 0;
+    NewCacheSize   = 0;
+    NewRecordCount = 0;
+    CacheActive    = FALSE;
+} // static VOID ScanCacheReset()
+
+// Load the stored cache at the start of a loader scan.
+// Must be called once any temporary 'Dont Scan' amendments are in place,
+// as these form part of the configuration the cache is valid for.
+VOID ScanCacheBegin (VOID) {
+    EFI_STATUS         Status;
+    SCAN_CACHE_HEADER  Header;
+    UINT32             Version;
+
+    #if REFIT_DEBUG > 0
+    BOOLEAN CheckMute = FALSE;
+    #endif
+
+    ScanCacheReset();
+
+    if (!GlobalConfig.ScanCache) {
+        MY_FREE_POOL(SessionCache);
+        SessionCacheSize = 0;
+
+        // Early Return
+        return;
+    }
+
+    NewCache = AllocateZeroPool (SCAN_CACHE_MAX_SIZE);
+    if (NewCache == NULL) {
+        // Early Return
+        return;
+    }
+    NewCacheSize = sizeof (SCAN_CACHE_HEADER);
+
+    // Every setting that decides which loaders are found invalidates the cache
+    Version        = SCAN_CACHE_VERSION;
+    CacheConfigCrc = crc32refit (0, &Version, sizeof (Version));
+    CacheConfigCrc = crc32refit (
+        CacheConfigCrc,
+        GlobalConfig.ScanFor,
+        sizeof (GlobalConfig.ScanFor)
+    );
+    CacheConfigCrc = crc32refit (
+        CacheConfigCrc,
+        &GlobalConfig.FollowSymlinks,
+        sizeof (GlobalConfig.FollowSymlinks)
+    );
+    CacheConfigCrc = crc32refit (
+        CacheConfigCrc,
+        &GlobalConfig.ScanAllLinux,
+        sizeof (GlobalConfig.ScanAllLinux)
+    );
+    CacheConfigCrc = crc32refit (
+        CacheConfigCrc,
+        &GlobalConfig.ScanAllESP,
+        sizeof (GlobalConfig.ScanAllESP)
+    );
+    CacheConfigCrc = ScanCacheMixString (CacheConfigCrc, GlobalConfig.AlsoScan);
+    CacheConfigCrc = ScanCacheMixString (CacheConfigCrc, GlobalConfig.DontScanVolumes);
+    CacheConfigCrc = ScanCacheMixString (CacheConfigCrc, GlobalConfig.DontScanDirs);
+    CacheConfigCrc = ScanCacheMixString (CacheConfigCrc, GlobalConfig.DontScanFiles);
+    CacheConfigCrc = ScanCacheMixString (CacheConfigCrc, GlobalConfig.WindowsRecoveryFiles);
+    CacheConfigCrc = ScanCacheMixString (CacheConfigCrc, GlobalConfig.MacOSRecoveryFiles);
+    CacheConfigCrc = ScanCacheMixString (CacheConfigCrc, GlobalConfig.LinuxPrefixes);
+    CacheConfigCrc = ScanCacheMixString (CacheConfigCrc, GlobalConfig.LinuxMatchPatterns);
+
+    CacheActive = TRUE;
+
+    if (ScanCacheBypass) {
+        MY_FREE_POOL(SessionCache);
+        SessionCacheSize = 0;
+
+        #if REFIT_DEBUG > 0
+        ALT_LOG(1, LOG_LINE_NORMAL, L"Refreshing Scan Cache");
+        #endif
+
+        // Early Return ... Forced refresh
+        return;
+    }
+
+    if (SessionCache != NULL) {
+        // Rescan ... Use the results of the previous scan
+        OldCache         = SessionCache;
+        OldCacheSize     = SessionCacheSize;
+        SessionCache     = NULL;
+        SessionCacheSize = 0;
+        Status           = EFI_SUCCESS;
+    }
+    else {
+        #if REFIT_DEBUG > 0
+        MY_MUTELOGGER_SET;
+        #endif
+        Status = EfivarGetRaw (
+            &RefindPlusGuid, SCAN_CACHE_VAR_NAME,
+            (VOID **) &OldCache, &OldCacheSize
+        );
+        #if REFIT_DEBUG > 0
+        MY_MUTELOGGER_OFF;
+        #endif
+    }
+
+    if (EFI_ERROR(Status) || OldCacheSize < sizeof (SCAN_CACHE_HEADER)) {
+        MY_FREE_POOL(OldCache);
+        OldCacheSize = 0;
+
+        // Early Return
+        return;
+    }
+
+    CopyMem (&Header, OldCache, sizeof (SCAN_CACHE_HEADER));
+    if (Header.Signature != SCAN_CACHE_SIGNATURE ||
+        Header.Version   != SCAN_CACHE_VERSION   ||
+        Header.ConfigCrc != CacheConfigCrc
+    ) {
+        #if REFIT_DEBUG > 0
+        ALT_LOG(1, LOG_LINE_NORMAL, L"Discarding Outdated Scan Cache");
+        #endif
+
+        MY_FREE_POOL(OldCache);
+        OldCacheSize = 0;
+    }
+} // VOID ScanCacheBegin()
+
+// Save the cache, and keep it for rescans, at the end of a loader scan.
+// Records from the previous cache that were not used in this scan, such as
+// those for absent removable volumes, are kept while space permits.
+VOID ScanCacheEnd (VOID) {
+    EFI_STATUS         Status;
+    SCAN_CACHE_HEADER  Header;
+    SCAN_CACHE_RECORD  Record;
+    SCAN_CACHE_RECORD  Existing;
+    UINTN              Offset;
+    UINT32             i;
+
+    if (!CacheActive) {
+        ScanCacheBypass = FALSE;
+
+        // Early Return
+        return;
+    }
+
+    if (OldCache != NULL) {
+        CopyMem (&Header, OldCache, sizeof (SCAN_CACHE_HEADER));
+        Offset = sizeof (SCAN_CACHE_HEADER);
+        for (i = 0; i < Header.RecordCount; i++) {
+            if (OldCacheSize - Offset < sizeof (SCAN_CACHE_RECORD)) {
+                break;
+            }
+
+            CopyMem (&Record, OldCache + Offset, sizeof (SCAN_CACHE_RECORD));
+            if (Record.RecordSize < sizeof (SCAN_CACHE_RECORD) ||
+                Record.RecordSize > OldCacheSize - Offset
+            ) {
+                break;
+            }
+
+            if (ScanCacheFindRecord (NewCache, NewCacheSize, Record.KeyCrc, &Existing) == 0) {
+                ScanCacheAppend (OldCache + Offset, Record.RecordSize);
+            }
+
+            Offset += Record.RecordSize;
+        } // for
+    }
+
+    Header.Signature   = SCAN_CACHE_SIGNATURE;
+    Header.Version     = SCAN_CACHE_VERSION;
+    Header.ConfigCrc   = CacheConfigCrc;
+    Header.RecordCount = NewRecordCount;
+    CopyMem (NewCache, &Header, sizeof (SCAN_CACHE_HEADER));
+
+    Status = EfivarSetRaw (
+        &RefindPlusGuid, SCAN_CACHE_VAR_NAME,
+        NewCache, NewCacheSize, TRUE
+    );
+
+    #if REFIT_DEBUG > 0
+    ALT_LOG(1, LOG_LINE_NORMAL,
+        L"Saved Scan Cache (%d Record%s, %d Bytes):- '%r'",
+        NewRecordCount, (NewRecordCount == 1) ? L"" : L"s",
+        NewCacheSize, (Status == EFI_ALREADY_STARTED) ? EFI_SUCCESS : Status
+    );
+    #endif
+
+    MY_FREE_POOL(SessionCache);
+    SessionCache     = NewCache;
+    SessionCacheSize = NewCacheSize;
+    NewCache         = NULL;
+
+    ScanCacheReset();
+    ScanCacheBypass = FALSE;
+} // VOID ScanCacheEnd()
+
+// Look up a loader directory scan in the cache.
+// Returns TRUE with the loader names (full paths, in menu order) and the
+// fallback duplicate flag when the directory is unchanged since it was
+// cached. Otherwise returns FALSE, with 'Key' set up for ScanCacheStore().
+// The returned array and the names belong to the caller.
+BOOLEAN ScanCacheFetch (
+    IN  REFIT_VOLUME    *Volume,
+    IN  CHAR16          *Path,
+    IN  CHAR16          *Pattern,
+    IN  CHAR16          *FallbackName,
+    OUT SCAN_CACHE_KEY  *Key,
+    OUT CHAR16        ***LoaderNames,
+    OUT UINTN           *LoaderCount,
+    OUT BOOLEAN         *FallbackDuplicate
+) {
+    EFI_STATUS          Status;
+    SCAN_CACHE_RECORD   Record;
+    CHAR16            **Names;
+    UINTN               Offset;
+    UINTN               Pos;
+    UINTN               i;
+    UINT16              NameLen;
+    BOOLEAN             Damaged;
+
+    Key->Valid         = FALSE;
+    *LoaderNames       = NULL;
+    *LoaderCount       = 0;
+    *FallbackDuplicate = FALSE;
+
+    if (!CacheActive || Volume == NULL || Volume->RootDir == NULL) {
+        // Early Return
+        return FALSE;
+    }
+
+    if (GuidsAreEqual (&(Volume->PartGuid), &GuidNull) &&
+        GuidsAreEqual (&(Volume->VolUuid), &GuidNull)
+    ) {
+        // Early Return ... Volume cannot be identified across boots
+        return FALSE;
+    }
+
+    if (Path    == NULL) Path    = L"";
+    if (Pattern == NULL) Pattern = L"";
+
+    Key->KeyCrc = crc32refit (0,           &(Volume->PartGuid), sizeof (EFI_GUID));
+    Key->KeyCrc = crc32refit (Key->KeyCrc, &(Volume->VolUuid),  sizeof (EFI_GUID));
+    Key->KeyCrc = crc32refit (Key->KeyCrc, Path,    StrSize (Path));
+    Key->KeyCrc = crc32refit (Key->KeyCrc, Pattern, StrSize (Pattern));
+
+    Status = ScanCacheFingerprint (Volume, Path, FallbackName, &Key->Fingerprint);
+    if (EFI_ERROR(Status)) {
+        // Early Return
+        return FALSE;
+    }
+    Key->Valid = TRUE;
+
+    Offset = ScanCacheFindRecord (OldCache, OldCacheSize, Key->KeyCrc, &Record);
+    if (Offset == 0 || Record.Fingerprint != Key->Fingerprint) {
+        // Early Return ... Absent or stale
+        return FALSE;
+    }
+
+    Names = NULL;
+    if (Record.LoaderCount > 0) {
+        Names = AllocateZeroPool (sizeof (CHAR16 *) * Record.LoaderCount);
+        if (Names == NULL) {
+            // Early Return
+            return FALSE;
+        }
+    }
+
+    Damaged = FALSE;
+    Pos     = sizeof (SCAN_CACHE_RECORD);
+    for (i = 0; i < Record.LoaderCount; i++) {
+        if (Record.RecordSize - Pos < sizeof (UINT16)) {
+            Damaged = TRUE;
+            break;
+        }
+        CopyMem (&NameLen, OldCache + Offset + Pos, sizeof (UINT16));
+        Pos += sizeof (UINT16);
+
+        if (NameLen == 0 || Record.RecordSize - Pos < NameLen * sizeof (CHAR16)) {
+            Damaged = TRUE;
+            break;
+        }
+
+        Names[i] = AllocateZeroPool ((NameLen + 1) * sizeof (CHAR16));
+        if (Names[i] == NULL) {
+            Damaged = TRUE;
+            break;
+        }
+        CopyMem (Names[i], OldCache + Offset + Pos, NameLen * sizeof (CHAR16));
+        Pos += NameLen * sizeof (CHAR16);
+    } // for
+
+    if (Damaged) {
+        for (i = 0; i < Record.LoaderCount; i++) {
+            MY_FREE_POOL(Names[i]);
+        }
+        MY_FREE_POOL(Names);
+
+        // Early Return
+        return FALSE;
+    }
+
+    // Carry the record over to the cache being built
+    ScanCacheAppend (OldCache + Offset, Record.RecordSize);
+
+    #if REFIT_DEBUG > 0
+    ALT_LOG(1, LOG_LINE_NORMAL,
+        L"Using Cached Scan Result for '%s' ... %d Loader%s",
+        Path, Record.LoaderCount, (Record.LoaderCount == 1) ? L"" : L"s"
+    );
+    #endif
+
+    *LoaderNames       = Names;
+    *LoaderCount       = Record.LoaderCount;
+    *FallbackDuplicate = (Record.Flags & SCAN_CACHE_FLAG_DUP) ? TRUE : FALSE;
+
+    return TRUE;
+} // BOOLEAN ScanCacheFetch()
+
+// Record the outcome of a loader directory scan under a key set up by
+// ScanCacheFetch(). 'LoaderNames' are full paths in menu order.
+VOID ScanCacheStore (
+    IN SCAN_CACHE_KEY  *Key,
+    IN CHAR16         **LoaderNames,
+    IN UINTN            LoaderCount,
+    IN BOOLEAN          FallbackDuplicate
+) {
+    SCAN_CACHE_RECORD  Record;
+    UINT8             *Buffer;
+    UINTN              RecordSize;
+    UINTN              Pos;
+    UINTN              i;
+    UINT16             NameLen;
+
+    if (!CacheActive || Key == NULL || !Key->Valid || LoaderCount > 0xFFFF) {
+        // Early Return
+        return;
+    }
+
+    RecordSize = sizeof (SCAN_CACHE_RECORD);
+    for (i = 0; i < LoaderCount; i++) {
+        RecordSize += sizeof (UINT16) + StrLen (LoaderNames[i]) * sizeof (CHAR16);
+    }
+    if (RecordSize > SCAN_CACHE_MAX_SIZE - NewCacheSize) {
+        // Early Return ... Cache is full
+        return;
+    }
+
+    Buffer = AllocateZeroPool (RecordSize);
+    if (Buffer == NULL) {
+        // Early Return
+        return;
+    }
+
+    Record.KeyCrc      = Key->KeyCrc;
+    Record.Fingerprint = Key->Fingerprint;
+    Record.Flags       = FallbackDuplicate ? SCAN_CACHE_FLAG_DUP : 0;
+    Record.LoaderCount = (UINT16) LoaderCount;
+    Record.RecordSize  = (UINT32) RecordSize;
+    CopyMem (Buffer, &Record, sizeof (SCAN_CACHE_RECORD));
+
+    Pos = sizeof (SCAN_CACHE_RECORD);
+    for (i = 0; i < LoaderCount; i++) {
+        NameLen = (UINT16) StrLen (LoaderNames[i]);
+        CopyMem (Buffer + Pos, &NameLen, sizeof (UINT16));
+        Pos += sizeof (UINT16);
+        CopyMem (Buffer + Pos, LoaderNames[i], NameLen * sizeof (CHAR16));
+        Pos += NameLen * sizeof (CHAR16);
+    }
+
+    ScanCacheAppend (Buffer, RecordSize);
+    MY_FREE_POOL(Buffer);
+} // VOID ScanCacheStore()
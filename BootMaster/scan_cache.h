@@ -0,0 +1,57 @@
+/*
+ * BootMaster/scan_cache.h
+ * Headers related to the persistent loader scan cache
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SCAN_CACHE_H_
+#define __SCAN_CACHE_H_
+
+// Identifies one loader directory scan and the state of the directory
+// at the time it was looked up. Filled by ScanCacheFetch() and handed
+// back to ScanCacheStore() once the directory has been scanned.
+typedef struct {
+    UINT32   KeyCrc;
+    UINT32   Fingerprint;
+    BOOLEAN  Valid;
+} SCAN_CACHE_KEY;
+
+extern BOOLEAN ScanCacheBypass;
+
+VOID ScanCacheBegin (VOID);
+VOID ScanCacheEnd (VOID);
+BOOLEAN ScanCacheFetch (
+    IN  REFIT_VOLUME    *Volume,
+    IN  CHAR16          *Path,
+    IN  CHAR16          *Pattern,
+    IN  CHAR16          *FallbackName,
+    OUT SCAN_CACHE_KEY  *Key,
+    OUT CHAR16        ***LoaderNames,
+    OUT UINTN           *LoaderCount,
+    OUT BOOLEAN         *FallbackDuplicate
+);
+VOID ScanCacheStore (
+    IN SCAN_CACHE_KEY  *Key,
+    IN CHAR16         **LoaderNames,
+    IN UINTN            LoaderCount,
+    IN BOOLEAN          FallbackDuplicate
+);
+
+#endif
+
+/* EOF */
@@ -1496,7 +1496,11 @@ VOID BltClearScreen (
             #endif
 
             if (GlobalConfig.BannerFileName) {
-                Banner = egLoadImage (SelfDir, GlobalConfig.BannerFileName, FALSE);
+                // Full screen banners are scaled to fit below and
+                // may be decoded at a reduced size where possible
+                Banner = (GlobalConfig.BannerScale == BANNER_FILLSCREEN)
+                    ? egLoadScaledImage (SelfDir, GlobalConfig.BannerFileName, ScreenW, ScreenH, FALSE)
+                    : egLoadImage (SelfDir, GlobalConfig.BannerFileName, FALSE);
             }
 
             if (GlobalConfig.CustomScreenBG) {
@@ -1768,12 +1772,12 @@ VOID BltImageAlpha (
 //    GraphicsScreenDirty = TRUE;
 //} // VOID BltImageComposite()
 
-VOID BltImageCompositeBadge (
+// Returns a copy of 'BaseImage' with 'TopImage' centred on it and 'BadgeImage',
+// when set, in the lower right corner of 'TopImage'. Returns NULL on failure.
+EG_IMAGE * ComposeImageBadge (
     IN EG_IMAGE *BaseImage,
     IN EG_IMAGE *TopImage,
-    IN EG_IMAGE *BadgeImage,
-    IN UINTN     XPos,
-    IN UINTN     YPos
+    IN EG_IMAGE *BadgeImage
 ) {
     UINTN     TotalWidth  = 0;
     UINTN     TotalHeight = 0;
@@ -1819,6 +1823,20 @@ VOID BltImageCompositeBadge (
         egComposeImage (CompImage, BadgeImage, OffsetX, OffsetY);
     }
 
+    return CompImage;
+} // EG_IMAGE * ComposeImageBadge()
+
+VOID BltImageCompositeBadge (
+    IN EG_IMAGE *BaseImage,
+    IN EG_IMAGE *TopImage,
+    IN EG_IMAGE *BadgeImage,
+    IN UINTN     XPos,
+    IN UINTN     YPos
+) {
+    EG_IMAGE *CompImage;
+
+    CompImage = ComposeImageBadge (BaseImage, TopImage, BadgeImage);
+
     // blit to screen and clean up
     if (CompImage != NULL) {
         if (CompImage->HasAlpha) {
@@ -134,6 +134,11 @@ VOID BltImageAlpha (
     IN UINTN     YPos,
     IN EG_PIXEL *BackgroundPixel
 );
+EG_IMAGE * ComposeImageBadge (
+    IN EG_IMAGE *BaseImage,
+    IN EG_IMAGE *TopImage,
+    IN EG_IMAGE *BadgeImage
+);
 VOID BltImageCompositeBadge (
     IN EG_IMAGE *BaseImage,
     IN EG_IMAGE *TopImage,
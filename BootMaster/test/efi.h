@@ -0,0 +1,242 @@
+/*
+ * BootMaster/test/efi.h
+ * Minimal UEFI type definitions for host builds
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Stands in for the GNU-EFI <efi.h> when BootMaster sources are built as
+// host programs. Only the types and constants those sources use are here.
+
+#ifndef __HOST_EFI_H_
+#define __HOST_EFI_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define IN
+#define OUT
+#define OPTIONAL
+#define EFIAPI
+#define CONST const
+#define TRUE  ((BOOLEAN) 1)
+#define FALSE ((BOOLEAN) 0)
+
+typedef uint8_t    UINT8;
+typedef int8_t     INT8;
+typedef uint16_t   UINT16;
+typedef int16_t    INT16;
+typedef uint32_t   UINT32;
+typedef int32_t    INT32;
+typedef uint64_t   UINT64;
+typedef int64_t    INT64;
+typedef uintptr_t  UINTN;
+typedef intptr_t   INTN;
+typedef uint8_t    BOOLEAN;
+typedef char       CHAR8;
+typedef uint16_t   CHAR16;
+typedef void       VOID;
+typedef UINTN      EFI_STATUS;
+typedef VOID      *EFI_HANDLE;
+typedef VOID      *EFI_EVENT;
+typedef UINT64     EFI_LBA;
+typedef UINTN      EFI_TPL;
+typedef UINT64     EFI_PHYSICAL_ADDRESS;
+typedef UINT64     EFI_VIRTUAL_ADDRESS;
+
+typedef struct { UINT32 Data1; UINT16 Data2; UINT16 Data3; UINT8 Data4[8]; } EFI_GUID;
+typedef struct _LIST_ENTRY { struct _LIST_ENTRY *ForwardLink, *BackLink; } LIST_ENTRY;
+
+#define EFI_SUCCESS               0
+#define EFI_ERROR_BIT             ((UINTN) 1 << (sizeof (UINTN) * 8 - 1))
+#define EFIERR(a)                 (EFI_ERROR_BIT | (a))
+#define EFI_ERROR(a)              (((INTN) (a)) < 0)
+#define EFI_LOAD_ERROR            EFIERR(1)
+#define EFI_INVALID_PARAMETER     EFIERR(2)
+#define EFI_UNSUPPORTED           EFIERR(3)
+#define EFI_BAD_BUFFER_SIZE       EFIERR(4)
+#define EFI_BUFFER_TOO_SMALL      EFIERR(5)
+#define EFI_NOT_READY             EFIERR(6)
+#define EFI_DEVICE_ERROR          EFIERR(7)
+#define EFI_WRITE_PROTECTED       EFIERR(8)
+#define EFI_OUT_OF_RESOURCES      EFIERR(9)
+#define EFI_VOLUME_CORRUPTED      EFIERR(10)
+#define EFI_VOLUME_FULL           EFIERR(11)
+#define EFI_NO_MEDIA              EFIERR(12)
+#define EFI_MEDIA_CHANGED         EFIERR(13)
+#define EFI_NOT_FOUND             EFIERR(14)
+#define EFI_ACCESS_DENIED         EFIERR(15)
+#define EFI_NO_RESPONSE           EFIERR(16)
+#define EFI_NO_MAPPING            EFIERR(17)
+#define EFI_TIMEOUT               EFIERR(18)
+#define EFI_NOT_STARTED           EFIERR(19)
+#define EFI_ALREADY_STARTED       EFIERR(20)
+#define EFI_ABORTED               EFIERR(21)
+#define EFI_END_OF_FILE           EFIERR(31)
+#define EFI_SECURITY_VIOLATION    EFIERR(26)
+#define EFI_WARN_UNKNOWN_GLYPH    1
+
+#define EFI_VARIABLE_NON_VOLATILE        0x00000001
+#define EFI_VARIABLE_BOOTSERVICE_ACCESS  0x00000002
+#define EFI_VARIABLE_RUNTIME_ACCESS      0x00000004
+
+typedef enum { AllHandles, ByRegisterNotify, ByProtocol } EFI_LOCATE_SEARCH_TYPE;
+
+typedef struct {
+    UINT16   ScanCode;
+    CHAR16   UnicodeChar;
+} EFI_INPUT_KEY;
+
+typedef struct {
+    UINT16  Year;
+    UINT8   Month;
+    UINT8   Day;
+    UINT8   Hour;
+    UINT8   Minute;
+    UINT8   Second;
+    UINT8   Pad1;
+    UINT32  Nanosecond;
+    INT16   TimeZone;
+    UINT8   Daylight;
+    UINT8   Pad2;
+} EFI_TIME;
+
+typedef struct _EFI_DEVICE_PATH {
+    UINT8   Type;
+    UINT8   SubType;
+    UINT8   Length[2];
+} EFI_DEVICE_PATH;
+
+#define HARDWARE_DEVICE_PATH             0x01
+#define ACPI_DEVICE_PATH                 0x02
+#define MESSAGING_DEVICE_PATH            0x03
+#define MEDIA_DEVICE_PATH                0x04
+#define END_DEVICE_PATH_TYPE             0x7f
+#define END_ENTIRE_DEVICE_PATH_SUBTYPE   0xff
+#define END_DEVICE_PATH_LENGTH           (sizeof (EFI_DEVICE_PATH))
+#define MSG_ATAPI_DP                     0x01
+#define MSG_SCSI_DP                      0x02
+#define MSG_FIBRECHANNEL_DP              0x03
+#define MSG_1394_DP                      0x04
+#define MSG_USB_DP                       0x05
+#define MSG_USB_CLASS_DP                 0x0f
+#define MSG_SATA_DP                      0x12
+#define MSG_NVME_NAMESPACE_DP            0x17
+#define MEDIA_HARDDRIVE_DP               0x01
+#define MEDIA_CDROM_DP                   0x02
+#define MEDIA_FILEPATH_DP                0x04
+#define SIGNATURE_TYPE_MBR               0x01
+#define SIGNATURE_TYPE_GUID              0x02
+
+typedef struct {
+    EFI_DEVICE_PATH  Header;
+    UINT32           PartitionNumber;
+    UINT64           PartitionStart;
+    UINT64           PartitionSize;
+    UINT8            Signature[16];
+    UINT8            MBRType;
+    UINT8            SignatureType;
+} HARDDRIVE_DEVICE_PATH;
+
+#define EFI_FILE_MODE_READ       0x0000000000000001ULL
+#define EFI_FILE_MODE_WRITE      0x0000000000000002ULL
+#define EFI_FILE_MODE_CREATE     0x8000000000000000ULL
+#define EFI_FILE_READ_ONLY       0x0000000000000001ULL
+#define EFI_FILE_HIDDEN          0x0000000000000002ULL
+#define EFI_FILE_SYSTEM          0x0000000000000004ULL
+#define EFI_FILE_RESERVED        0x0000000000000008ULL
+#define EFI_FILE_DIRECTORY       0x0000000000000010ULL
+#define EFI_FILE_ARCHIVE         0x0000000000000020ULL
+#define EFI_FILE_VALID_ATTR      0x0000000000000037ULL
+
+typedef struct {
+    UINT64    Size;
+    UINT64    FileSize;
+    UINT64    PhysicalSize;
+    EFI_TIME  CreateTime;
+    EFI_TIME  LastAccessTime;
+    EFI_TIME  ModificationTime;
+    UINT64    Attribute;
+    CHAR16    FileName[1];
+} EFI_FILE_INFO;
+#define SIZE_OF_EFI_FILE_INFO  offsetof (EFI_FILE_INFO, FileName)
+
+typedef struct {
+    UINT64   Size;
+    BOOLEAN  ReadOnly;
+    UINT64   VolumeSize;
+    UINT64   FreeSpace;
+    UINT32   BlockSize;
+    CHAR16   VolumeLabel[1];
+} EFI_FILE_SYSTEM_INFO;
+
+typedef struct _EFI_FILE_HANDLE *EFI_FILE_HANDLE;
+typedef struct _EFI_FILE_HANDLE {
+    UINT64      Revision;
+    EFI_STATUS  (*Open) (EFI_FILE_HANDLE File, EFI_FILE_HANDLE *NewHandle, CHAR16 *FileName, UINT64 OpenMode, UINT64 Attributes);
+    EFI_STATUS  (*Close) (EFI_FILE_HANDLE File);
+    EFI_STATUS  (*Delete) (EFI_FILE_HANDLE File);
+    EFI_STATUS  (*Read) (EFI_FILE_HANDLE File, UINTN *BufferSize, VOID *Buffer);
+    EFI_STATUS  (*Write) (EFI_FILE_HANDLE File, UINTN *BufferSize, VOID *Buffer);
+    EFI_STATUS  (*GetPosition) (EFI_FILE_HANDLE File, UINT64 *Position);
+    EFI_STATUS  (*SetPosition) (EFI_FILE_HANDLE File, UINT64 Position);
+    EFI_STATUS  (*GetInfo) (EFI_FILE_HANDLE File, EFI_GUID *InformationType, UINTN *BufferSize, VOID *Buffer);
+    EFI_STATUS  (*SetInfo) (EFI_FILE_HANDLE File, EFI_GUID *InformationType, UINTN BufferSize, VOID *Buffer);
+    EFI_STATUS  (*Flush) (EFI_FILE_HANDLE File);
+} EFI_FILE, EFI_FILE_PROTOCOL;
+
+typedef struct {
+    UINT32   MediaId;
+    BOOLEAN  RemovableMedia;
+    BOOLEAN  MediaPresent;
+    BOOLEAN  LogicalPartition;
+    BOOLEAN  ReadOnly;
+    BOOLEAN  WriteCaching;
+    UINT32   BlockSize;
+    UINT32   IoAlign;
+    EFI_LBA  LastBlock;
+} EFI_BLOCK_IO_MEDIA;
+
+typedef struct _EFI_BLOCK_IO_PROTOCOL EFI_BLOCK_IO_PROTOCOL, EFI_BLOCK_IO;
+struct _EFI_BLOCK_IO_PROTOCOL {
+    UINT64               Revision;
+    EFI_BLOCK_IO_MEDIA  *Media;
+    EFI_STATUS  (*Reset) (EFI_BLOCK_IO_PROTOCOL *This, BOOLEAN ExtendedVerification);
+    EFI_STATUS  (*ReadBlocks) (EFI_BLOCK_IO_PROTOCOL *This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID *Buffer);
+    EFI_STATUS  (*WriteBlocks) (EFI_BLOCK_IO_PROTOCOL *This, UINT32 MediaId, EFI_LBA Lba, UINTN BufferSize, VOID *Buffer);
+    EFI_STATUS  (*FlushBlocks) (EFI_BLOCK_IO_PROTOCOL *This);
+};
+
+typedef struct {
+    UINT32            Revision;
+    EFI_HANDLE        ParentHandle;
+    VOID             *SystemTable;
+    EFI_HANDLE        DeviceHandle;
+    EFI_DEVICE_PATH  *FilePath;
+    VOID             *Reserved;
+    UINT32            LoadOptionsSize;
+    VOID             *LoadOptions;
+    VOID             *ImageBase;
+    UINT64            ImageSize;
+    UINT32            ImageCodeType;
+    UINT32            ImageDataType;
+    VOID             *Unload;
+} EFI_LOADED_IMAGE_PROTOCOL, EFI_LOADED_IMAGE;
+
+#endif
+
+/* EOF */
@@ -0,0 +1,132 @@
+/*
+ * BootMaster/test/efilib.h
+ * Minimal UEFI library declarations for host builds
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Stands in for the GNU-EFI <efilib.h> when BootMaster sources are built as
+// host programs. The functions are implemented in uefi_shim.c.
+
+#ifndef __HOST_EFILIB_H_
+#define __HOST_EFILIB_H_
+
+#include "efi.h"
+
+typedef struct {
+    CHAR16  *str;
+    UINTN    len;
+    UINTN    maxlen;
+} POOL_PRINT;
+
+// Only the services the host-built sources call are filled in
+typedef struct _EFI_RUNTIME_SERVICES {
+    EFI_STATUS  (*GetTime) (EFI_TIME *Time, VOID *Capabilities);
+    EFI_STATUS  (*GetVariable) (CHAR16 *Name, EFI_GUID *Guid, UINT32 *Attributes, UINTN *DataSize, VOID *Data);
+    EFI_STATUS  (*SetVariable) (CHAR16 *Name, EFI_GUID *Guid, UINT32 Attributes, UINTN DataSize, VOID *Data);
+} EFI_RUNTIME_SERVICES;
+
+typedef struct _EFI_BOOT_SERVICES {
+    EFI_STATUS  (*WaitForEvent) (UINTN NumberOfEvents, EFI_EVENT *Event, UINTN *Index);
+    EFI_STATUS  (*HandleProtocol) (EFI_HANDLE Handle, EFI_GUID *Protocol, VOID **Interface);
+    EFI_STATUS  (*LocateDevicePath) (EFI_GUID *Protocol, EFI_DEVICE_PATH **DevicePath, EFI_HANDLE *Device);
+    EFI_STATUS  (*LocateHandleBuffer) (EFI_LOCATE_SEARCH_TYPE SearchType, EFI_GUID *Protocol, VOID *SearchKey, UINTN *NoHandles, EFI_HANDLE **Buffer);
+    EFI_STATUS  (*LocateProtocol) (EFI_GUID *Protocol, VOID *Registration, VOID **Interface);
+} EFI_BOOT_SERVICES;
+
+typedef struct _SIMPLE_INPUT_INTERFACE SIMPLE_INPUT_INTERFACE;
+struct _SIMPLE_INPUT_INTERFACE {
+    EFI_STATUS  (*Reset) (SIMPLE_INPUT_INTERFACE *This, BOOLEAN ExtendedVerification);
+    EFI_STATUS  (*ReadKeyStroke) (SIMPLE_INPUT_INTERFACE *This, EFI_INPUT_KEY *Key);
+    EFI_EVENT     WaitForKey;
+};
+
+typedef struct _EFI_SYSTEM_TABLE {
+    SIMPLE_INPUT_INTERFACE  *ConIn;
+    EFI_RUNTIME_SERVICES    *RuntimeServices;
+    EFI_BOOT_SERVICES       *BootServices;
+} EFI_SYSTEM_TABLE;
+
+extern EFI_SYSTEM_TABLE     *ST;
+extern EFI_BOOT_SERVICES    *BS;
+extern EFI_RUNTIME_SERVICES *RT;
+#define gST ST
+
+#define uefi_call_wrapper(f, n, ...)  ((f) (__VA_ARGS__))
+
+#define ASSERT(x)  do { if (!(x)) ShimAssert (#x, __FILE__, __LINE__); } while (0)
+VOID ShimAssert (const char *Expr, const char *File, int Line);
+
+VOID   * AllocatePool (UINTN Size);
+VOID   * AllocateZeroPool (UINTN Size);
+VOID   * AllocateCopyPool (UINTN Size, CONST VOID *Buffer);
+VOID   * ReallocatePool (VOID *OldPool, UINTN OldSize, UINTN NewSize);
+VOID     FreePool (VOID *Buffer);
+VOID     CopyMem (VOID *Dest, CONST VOID *Src, UINTN Len);
+VOID     SetMem (VOID *Buffer, UINTN Size, UINT8 Value);
+VOID     ZeroMem (VOID *Buffer, UINTN Size);
+INTN     CompareMem (CONST VOID *Dest, CONST VOID *Src, UINTN Len);
+
+UINTN    StrLen (CONST CHAR16 *s1);
+UINTN    StrSize (CONST CHAR16 *s1);
+INTN     StrCmp (CONST CHAR16 *s1, CONST CHAR16 *s2);
+INTN     StrnCmp (CONST CHAR16 *s1, CONST CHAR16 *s2, UINTN len);
+INTN     StriCmp (CONST CHAR16 *s1, CONST CHAR16 *s2);
+VOID     StrCpy (CHAR16 *Dest, CONST CHAR16 *Src);
+VOID     StrnCpy (CHAR16 *Dest, CONST CHAR16 *Src, UINTN Len);
+VOID     StrCat (CHAR16 *Dest, CONST CHAR16 *Src);
+CHAR16 * StrDuplicate (CONST CHAR16 *Src);
+UINTN    Atoi (CONST CHAR16 *str);
+UINTN    xtoi (CONST CHAR16 *str);
+UINTN    AsciiStrLen (CONST CHAR8 *s1);
+UINTN    AsciiStrSize (CONST CHAR8 *s1);
+UINTN    strlena (CONST CHAR8 *s1);
+BOOLEAN  MetaiMatch (CHAR16 *String, CHAR16 *Pattern);
+
+UINTN    Print (CONST CHAR16 *fmt, ...);
+UINTN    SPrint (CHAR16 *Str, UINTN StrSize, CONST CHAR16 *fmt, ...);
+CHAR16 * PoolPrint (CONST CHAR16 *fmt, ...);
+
+extern EFI_GUID gEfiFileInfoGuid;
+extern EFI_GUID BlockIoProtocol;
+extern EFI_GUID DevicePathProtocol;
+extern EFI_GUID LoadedImageProtocol;
+extern EFI_DEVICE_PATH EndDevicePath[];
+#define GenericFileInfo gEfiFileInfoGuid
+EFI_FILE_INFO * LibFileInfo (EFI_FILE_HANDLE FHand);
+EFI_FILE_SYSTEM_INFO * LibFileSystemInfo (EFI_FILE_HANDLE FHand);
+EFI_FILE_HANDLE LibOpenRoot (EFI_HANDLE DeviceHandle);
+
+// apple.h only declares this for TianoCore builds, but lib.c calls it on all builds.
+// VolumeRole is an APPLE_APFS_VOLUME_ROLE, which apple.h defines as UINT32.
+EFI_STATUS RP_GetApfsVolumeInfo (EFI_HANDLE Device, EFI_GUID *ContainerGuid, EFI_GUID *VolumeGuid, UINT32 *VolumeRole);
+EFI_STATUS LibLocateHandle (EFI_LOCATE_SEARCH_TYPE SearchType, EFI_GUID *Protocol, VOID *SearchKey, UINTN *NoHandles, EFI_HANDLE **Buffer);
+
+#define DevicePathType(a)           (((a)->Type) & 0x7f)
+#define DevicePathSubType(a)        ((a)->SubType)
+#define DevicePathNodeLength(a)     ((UINTN) ((a)->Length[0] | ((a)->Length[1] << 8)))
+#define NextDevicePathNode(a)       ((EFI_DEVICE_PATH *) (((UINT8 *) (a)) + DevicePathNodeLength (a)))
+#define IsDevicePathEndType(a)      (DevicePathType (a) == END_DEVICE_PATH_TYPE)
+#define IsDevicePathEnd(a)          (IsDevicePathEndType (a) && DevicePathSubType (a) == END_ENTIRE_DEVICE_PATH_SUBTYPE)
+
+EFI_DEVICE_PATH * DevicePathFromHandle (EFI_HANDLE Handle);
+EFI_DEVICE_PATH * DuplicateDevicePath (EFI_DEVICE_PATH *DevPath);
+EFI_DEVICE_PATH * FileDevicePath (EFI_HANDLE Device, CHAR16 *FileName);
+
+#endif
+
+/* EOF */
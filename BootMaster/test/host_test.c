@@ -0,0 +1,974 @@
+/*
+ * BootMaster/test/host_test.c
+ * Host unit tests and micro-benchmarks for BootMaster string, config and
+ * Linux helpers
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "lib.h"
+#include "config.h"
+#include "crc32.h"
+#include "linux.h"
+#include "mystrings.h"
+#include "uefi_shim.h"
+#include "../include/refit_call_wrapper.h"
+#include "../include/crc32_core.h"
+
+// RP_ApfsFletcher.h expects these from RP_ApfsInternal.h and Apfs.h
+#define APFS_NX_MINIMUM_BLOCK_SIZE  0x1000
+#define APFS_NX_MAXIMUM_BLOCK_SIZE  0x10000
+#define APFS_MOD_MAX_UINT32(Value, Result) do { *(Result) = ((Value) % 0xFFFFFFFF); } while (0)
+#include "../Library/RP_ApfsLib/RP_ApfsFletcher.h"
+
+static int   TestsRun;
+static int   TestsFailed;
+static char  TempRoot[] = "/tmp/rp_host_test.XXXXXX";
+
+#define CHECK(Cond)                                                      \
+    do {                                                                 \
+        TestsRun++;                                                      \
+        if (!(Cond)) {                                                   \
+            TestsFailed++;                                               \
+            fprintf (stderr, "%s:%d: CHECK (%s) failed\n",              \
+                __FILE__, __LINE__, #Cond);                              \
+        }                                                                \
+    } while (0)
+
+#define CHECK_STR(Actual, Expected)                                      \
+    do {                                                                 \
+        const CHAR16 *_Act = (Actual);                                   \
+        const char   *_Exp = (Expected);                                 \
+        TestsRun++;                                                      \
+        if ((_Exp == NULL) != (_Act == NULL) ||                          \
+            (_Exp != NULL && strcmp (ShimNarrow (_Act), _Exp) != 0)      \
+        ) {                                                              \
+            TestsFailed++;                                               \
+            fprintf (stderr, "%s:%d: got '%s', expected '%s'\n",        \
+                __FILE__, __LINE__,                                      \
+                _Act ? ShimNarrow (_Act) : "(null)",                     \
+                _Exp ? _Exp : "(null)");                                 \
+        }                                                                \
+    } while (0)
+
+//
+// Scratch tree helpers
+//
+
+static
+VOID WriteHostFile (const char *RelPath, const char *Content) {
+    char  Path[4096];
+    char *Slash;
+    FILE *Fp;
+
+    snprintf (Path, sizeof (Path), "%s/%s", TempRoot, RelPath);
+    for (Slash = strchr (Path + strlen (TempRoot) + 1, '/'); Slash != NULL; Slash = strchr (Slash + 1, '/')) {
+        *Slash = '\0';
+        mkdir (Path, 0755);
+        *Slash = '/';
+    }
+
+    Fp = fopen (Path, "wb");
+    if (Fp == NULL) {
+        perror (Path);
+        exit (2);
+    }
+    fputs (Content, Fp);
+    fclose (Fp);
+}
+
+static
+VOID RemoveTree (const char *Path) {
+    char Command[4200];
+
+    snprintf (Command, sizeof (Command), "rm -rf '%s'", Path);
+    if (system (Command) != 0) {
+        fprintf (stderr, "Could not remove '%s'\n", Path);
+    }
+}
+
+static
+REFIT_VOLUME * NewHostVolume (VOID) {
+    REFIT_VOLUME *Volume;
+
+    Volume = AllocateZeroPool (sizeof (REFIT_VOLUME));
+    Volume->RootDir = ShimOpenRoot (TempRoot);
+    Volume->VolName = StrDuplicate (L"HostVol");
+    if (Volume->RootDir == NULL) {
+        fprintf (stderr, "Cannot open '%s'\n", TempRoot);
+        exit (2);
+    }
+
+    return Volume;
+}
+
+static
+VOID FreeHostVolume (REFIT_VOLUME *Volume) {
+    REFIT_CALL_1_WRAPPER(Volume->RootDir->Close, Volume->RootDir);
+    MY_FREE_POOL(Volume->VolName);
+    MY_FREE_POOL(Volume);
+}
+
+//
+// mystrings.c
+//
+
+static
+VOID TestMergeStrings (VOID) {
+    CHAR16 *Str = NULL;
+
+    MergeStrings (&Str, L"alpha", L',');
+    CHECK_STR(Str, "alpha");
+    MergeStrings (&Str, L"beta", L',');
+    CHECK_STR(Str, "alpha,beta");
+    MergeStrings (&Str, L"gamma", 0);
+    CHECK_STR(Str, "alpha,betagamma");
+    MergeStrings (&Str, NULL, L',');
+    CHECK_STR(Str, "alpha,betagamma,");
+    MY_FREE_POOL(Str);
+
+    // An empty first string takes no separator
+    Str = StrDuplicate (L"");
+    MergeStrings (&Str, L"delta", L',');
+    CHECK_STR(Str, "delta");
+    MY_FREE_POOL(Str);
+}
+
+static
+VOID TestFindNumbers (VOID) {
+    CHAR16 *Found;
+
+    Found = FindNumbers (L"vmlinuz-5.15.0-76-generic");
+    CHECK_STR(Found, "5.15.0-76");
+    MY_FREE_POOL(Found);
+
+    Found = FindNumbers (L"bzImage");
+    CHECK_STR(Found, NULL);
+
+    Found = FindNumbers (NULL);
+    CHECK_STR(Found, NULL);
+
+    GlobalConfig.ExtraKernelVersionStrings = StrDuplicate (L"linux-lts,linux");
+    Found = FindNumbers (L"vmlinuz-linux-lts");
+    CHECK_STR(Found, "linux-lts");
+    MY_FREE_POOL(Found);
+    MY_FREE_POOL(GlobalConfig.ExtraKernelVersionStrings);
+}
+
+static
+VOID TestNumCharsInCommon (VOID) {
+    CHECK(NumCharsInCommon (L"abcdef", L"abcxyz") == 3);
+    CHECK(NumCharsInCommon (L"abc", L"abc") == 3);
+    CHECK(NumCharsInCommon (L"abc", L"") == 0);
+    CHECK(NumCharsInCommon (NULL, L"abc") == 0);
+}
+
+static
+VOID TestTruncateString (VOID) {
+    CHAR16 *Str = StrDuplicate (L"RefindPlus");
+
+    CHECK(TruncateString (Str, 20) == FALSE);
+    CHECK_STR(Str, "RefindPlus");
+    CHECK(TruncateString (Str, 10) == FALSE);
+    CHECK(TruncateString (Str, 6) == TRUE);
+    CHECK_STR(Str, "Refind");
+    MY_FREE_POOL(Str);
+}
+
+static
+VOID TestCommaLists (VOID) {
+    CHAR16     *Item;
+    STRING_SET *Set;
+
+    Item = FindCommaDelimited (L"a,,c", 1);
+    CHECK_STR(Item, "");
+    MY_FREE_POOL(Item);
+    Item = FindCommaDelimited (L"a,,c", 2);
+    CHECK_STR(Item, "c");
+    MY_FREE_POOL(Item);
+    Item = FindCommaDelimited (L"a,,c", 3);
+    CHECK_STR(Item, NULL);
+
+    CHECK(IsIn (L"Foo", L"bar,FOO,baz"));
+    CHECK(!IsIn (L"Fo", L"bar,FOO,baz"));
+    CHECK(!IsIn (NULL, L"bar"));
+    CHECK(IsInSubstring (L"vmlinuz-linux", L"xyz,LINUX"));
+    CHECK(!IsInSubstring (L"vmlinuz", L"xyz,linux"));
+
+    Set = StringSetCompile (L"one,Two,,three", STRING_SET_PLAIN);
+    CHECK(Set != NULL);
+    if (Set != NULL) {
+        CHECK(Set->Count == 4);
+        CHECK(StringSetHas (Set, L"two"));
+        CHECK(StringSetHas (Set, L"THREE"));
+        CHECK(!StringSetHas (Set, L"four"));
+        CHECK(StringSetHasSubstring (Set, L"bigTHREEsome"));
+        StringSetFree (&Set);
+        CHECK(Set == NULL);
+    }
+}
+
+//
+// config.c
+//
+
+static
+VOID TestReadTokenLine (REFIT_VOLUME *Volume) {
+    EFI_STATUS   Status;
+    REFIT_FILE   File;
+    CHAR16     **TokenList;
+    UINTN        TokenCount;
+    UINTN        Size;
+
+    WriteHostFile (
+        "tokens.conf",
+        "# comment line\n"
+        "timeout 5\n"
+        "\n"
+        "   scanfor internal,external  # trailing comment\n"
+        "banner \"my banner.png\"\n"
+        "ID=fedora\n"
+    );
+
+    Status = RefitReadFile (Volume->RootDir, L"tokens.conf", &File, &Size);
+    CHECK(Status == EFI_SUCCESS);
+    if (EFI_ERROR(Status)) {
+        return;
+    }
+
+    TokenCount = ReadTokenLine (&File, &TokenList);
+    CHECK(TokenCount == 2);
+    if (TokenCount == 2) {
+        CHECK_STR(TokenList[0], "timeout");
+        CHECK_STR(TokenList[1], "5");
+    }
+    FreeTokenLine (&TokenList, &TokenCount);
+
+    TokenCount = ReadTokenLine (&File, &TokenList);
+    CHECK(TokenCount == 3);
+    if (TokenCount == 3) {
+        CHECK_STR(TokenList[0], "scanfor");
+        CHECK_STR(TokenList[1], "internal");
+        CHECK_STR(TokenList[2], "external");
+    }
+    FreeTokenLine (&TokenList, &TokenCount);
+
+    TokenCount = ReadTokenLine (&File, &TokenList);
+    CHECK(TokenCount == 2);
+    if (TokenCount == 2) {
+        CHECK_STR(TokenList[1], "my banner.png");
+    }
+    FreeTokenLine (&TokenList, &TokenCount);
+
+    TokenCount = ReadTokenLine (&File, &TokenList);
+    CHECK(TokenCount == 2);
+    if (TokenCount == 2) {
+        CHECK_STR(TokenList[0], "ID");
+        CHECK_STR(TokenList[1], "fedora");
+    }
+    FreeTokenLine (&TokenList, &TokenCount);
+
+    TokenCount = ReadTokenLine (&File, &TokenList);
+    CHECK(TokenCount == 0);
+    FreeTokenLine (&TokenList, &TokenCount);
+
+    MY_FREE_POOL(File.Buffer);
+}
+
+// Runs the real ReadConfig() to exercise HandleStrings() and friends
+static
+VOID TestReadConfig (REFIT_VOLUME *Volume) {
+    WriteHostFile ("icons/.keep", "");
+    WriteHostFile (
+        "refind.conf",
+        "timeout 12\n"
+        "dont_scan_dirs ESP:/EFI/foo,EFI/bar\n"
+        "dont_scan_files + extra.efi\n"
+        "linux_prefixes vmlinuz,bzImage\n"
+    );
+
+    SelfDir     = Volume->RootDir;
+    SelfVolume  = Volume;
+    GlobalConfig.ConfigFilename = L"refind.conf";
+
+    ReadConfig (GlobalConfig.ConfigFilename);
+
+    CHECK(GlobalConfig.Timeout == 12);
+    CHECK_STR(GlobalConfig.DontScanDirs, "ESP:\\EFI\\foo,EFI\\bar");
+    CHECK(IsIn (L"extra.efi", GlobalConfig.DontScanFiles));
+    CHECK(IsIn (L"shim.efi", GlobalConfig.DontScanFiles));
+    CHECK_STR(GlobalConfig.LinuxPrefixes, "vmlinuz,bzImage");
+
+    // Companion sets track the lists just read
+    CHECK(GlobalConfig.DontScanDirsSet != NULL);
+    CHECK(GlobalConfig.DontScanFilesSet != NULL);
+    CHECK(IsIn (L"bzImage", GlobalConfig.LinuxPrefixes));
+
+    // Lists edited in place are read directly until compiled again
+    FreeScanLists();
+    CHECK(GlobalConfig.LinuxPrefixesSet == NULL);
+    GlobalConfig.LinuxPrefixes[8] = L'Z';
+    CHECK(IsIn (L"Zzimage", GlobalConfig.LinuxPrefixes));
+    CHECK(!IsIn (L"bzImage", GlobalConfig.LinuxPrefixes));
+    CompileScanLists();
+    CHECK(GlobalConfig.LinuxPrefixesSet != NULL);
+    CHECK(IsIn (L"zzimage", GlobalConfig.LinuxPrefixes));
+    CHECK(IsInSubstring (L"/boot/vmlinuz-6.1", GlobalConfig.LinuxPrefixes));
+    CHECK(IsIn (L"b", L"a,b,c") && !IsIn (L"d", L"a,b,c"));
+
+    SelfDir    = NULL;
+    SelfVolume = NULL;
+}
+
+//
+// lib.c
+//
+
+static
+VOID TestFileAccess (REFIT_VOLUME *Volume) {
+    EFI_FILE_INFO  *DirEntry;
+    REFIT_DIR_ITER  DirIter;
+    UINTN           Count;
+    UINTN           Pass;
+    char            Seen[256];
+
+    WriteHostFile ("EFI/BOOT/BOOTX64.EFI", "x");
+    WriteHostFile ("EFI/tools/shell.efi", "x");
+    WriteHostFile ("EFI/tools/gdisk.efi", "x");
+    WriteHostFile ("EFI/tools/memtest.bin", "x");
+    WriteHostFile ("EFI/tools/sub/readme.txt", "x");
+
+    // Pass 0 reads the directory, pass 1 reads a snapshot of it
+    for (Pass = 0; Pass < 2; Pass++) {
+        if (Pass == 1) {
+            EnableDirSnapshots();
+        }
+
+        CHECK(FileExists (Volume->RootDir, L"\\EFI\\BOOT\\BOOTX64.EFI"));
+        CHECK(FileExists (Volume->RootDir, L"efi\\boot\\bootx64.efi"));
+        CHECK(!FileExists (Volume->RootDir, L"\\EFI\\BOOT\\missing.efi"));
+        CHECK(!FileExists (Volume->RootDir, L"\\NoSuchDir\\file"));
+
+        Seen[0] = '\0';
+        Count   = 0;
+        DirIterOpen (Volume->RootDir, L"\\EFI\\tools", &DirIter);
+        while (DirIterNext (&DirIter, 2, L"*.efi", &DirEntry)) {
+            strncat (Seen, ShimNarrow (DirEntry->FileName), sizeof (Seen) - strlen (Seen) - 2);
+            strcat (Seen, " ");
+            Count++;
+            MY_FREE_POOL(DirEntry);
+        }
+        DirIterClose (&DirIter);
+
+        CHECK(Count == 2);
+        CHECK(strcmp (Seen, "gdisk.efi shell.efi ") == 0);
+
+        Count = 0;
+        DirIterOpen (Volume->RootDir, L"\\EFI\\tools", &DirIter);
+        while (DirIterNext (&DirIter, 1, NULL, &DirEntry)) {
+            CHECK((DirEntry->Attribute & EFI_FILE_DIRECTORY) != 0);
+            Count++;
+            MY_FREE_POOL(DirEntry);
+        }
+        DirIterClose (&DirIter);
+        CHECK(Count == 1);
+    }
+
+    // A file written after the snapshot is only seen once the folder is flagged
+    WriteHostFile ("EFI/tools/vars.bin", "x");
+    CHECK(!FileExists (Volume->RootDir, L"\\EFI\\tools\\vars.bin"));
+    MarkDirSnapshotsStale (L"TOOLS");
+    CHECK(FileExists (Volume->RootDir, L"\\EFI\\tools\\vars.bin"));
+    FreeDirSnapshots();
+
+    CHECK(FilenameIn (Volume, L"\\EFI\\tools", L"shell.efi", L"gdisk.efi,SHELL.EFI"));
+    CHECK(!FilenameIn (Volume, L"\\EFI\\tools", L"shell.efi", L"gdisk.efi,memtest.bin"));
+    CHECK(FilenameIn (Volume, L"EFI\\tools", L"shell.efi", L"EFI\\tools\\shell.efi"));
+    CHECK(!FilenameIn (Volume, L"EFI\\other", L"shell.efi", L"EFI\\tools\\shell.efi"));
+    CHECK(FilenameIn (Volume, L"EFI\\tools", L"shell.efi", L"HostVol:EFI\\tools\\shell.efi"));
+    CHECK(!FilenameIn (Volume, L"EFI\\tools", L"shell.efi", L"OtherVol:EFI\\tools\\shell.efi"));
+}
+
+static
+VOID TestBootcodeSignatures (VOID) {
+    UINT8   Sector[4096];
+    BOOLEAN Matched[BOOTCODE_SIG_MAX];
+    UINTN   i, Count;
+
+    memset (Sector, 0xF6, sizeof (Sector));
+    MatchBootcodeSignatures (Sector, sizeof (Sector), Matched);
+    for (i = Count = 0; i < BOOTCODE_SIG_MAX; i++) {
+        Count += Matched[i] ? 1 : 0;
+    }
+    CHECK(Count == 0);
+
+    memcpy (Sector + 100,  "Geom\0Hard Disk\0Read\0 Error", 26);
+    memcpy (Sector + 600,  "OS2LDR", 6);
+    memcpy (Sector + 3000, "NTLDR", 5);
+    memcpy (Sector + 503,  "!Loading", 8);
+    memcpy (Sector + 4090, "BOOTMGR", 6);
+    MatchBootcodeSignatures (Sector, sizeof (Sector), Matched);
+    CHECK(Matched[BOOTCODE_SIG_GRUB]);
+    CHECK(Matched[BOOTCODE_SIG_NTLDR]);
+
+    // Windows end where the FindMem() calls stopped
+    CHECK(!Matched[BOOTCODE_SIG_OS2LDR]);
+    CHECK(FindMem (Sector, 512, "OS2LDR", 6) < 0);
+    CHECK(Matched[BOOTCODE_SIG_OBSD_LOADING]);
+    CHECK(FindMem (Sector, 512, "!Loading", 8) == 503);
+    memcpy (Sector + 503, "xx", 2);
+    memcpy (Sector + 504, "!Loading", 8);
+    MatchBootcodeSignatures (Sector, sizeof (Sector), Matched);
+    CHECK(!Matched[BOOTCODE_SIG_OBSD_LOADING]);
+    CHECK(FindMem (Sector, 512, "!Loading", 8) < 0);
+    CHECK(!Matched[BOOTCODE_SIG_BOOTMGR]);
+
+    CHECK(AddBootcodeSignature (L"MY\\x00BOOT", L"myos", L"My OS"));
+    CHECK(!AddBootcodeSignature (L"BAD\\x4", L"myos", L"My OS"));
+    CHECK(!AddBootcodeSignature (L"", L"myos", L"My OS"));
+    memcpy (Sector + 2000, "MY\0BOOT", 7);
+    MatchBootcodeSignatures (Sector, sizeof (Sector), Matched);
+    CHECK(Matched[BOOTCODE_SIG_BUILTIN]);
+    CHECK(!Matched[BOOTCODE_SIG_BUILTIN + 1]);
+
+    ClearBootcodeSignatures();
+    MatchBootcodeSignatures (Sector, sizeof (Sector), Matched);
+    CHECK(!Matched[BOOTCODE_SIG_BUILTIN]);
+    CHECK(Matched[BOOTCODE_SIG_NTLDR]);
+}
+
+// A volume on partition 'PartNum' of disk 'Handle', with a GPT partition GUID
+// and a filesystem UUID whose first byte is 'Uuid'.
+static
+REFIT_VOLUME * NewDiffVolume (UINTN Handle, UINT32 PartNum, UINT8 Uuid) {
+    REFIT_VOLUME           *Volume;
+    HARDDRIVE_DEVICE_PATH  *HdPath;
+    EFI_DEVICE_PATH        *EndPath;
+
+    Volume = AllocateZeroPool (sizeof (REFIT_VOLUME));
+    Volume->DeviceHandle = (EFI_HANDLE) Handle;
+    Volume->DevicePath   = AllocateZeroPool (sizeof (HARDDRIVE_DEVICE_PATH) + END_DEVICE_PATH_LENGTH);
+
+    HdPath = (HARDDRIVE_DEVICE_PATH *) Volume->DevicePath;
+    HdPath->Header.Type      = MEDIA_DEVICE_PATH;
+    HdPath->Header.SubType   = MEDIA_HARDDRIVE_DP;
+    HdPath->Header.Length[0] = (UINT8) sizeof (HARDDRIVE_DEVICE_PATH);
+    HdPath->PartitionNumber  = PartNum;
+    HdPath->SignatureType    = SIGNATURE_TYPE_GUID;
+
+    EndPath = NextDevicePathNode (Volume->DevicePath);
+    CopyMem (EndPath, EndDevicePath, END_DEVICE_PATH_LENGTH);
+
+    Volume->PartGuid.Data1 = PartNum;
+    Volume->VolUuid.Data4[0] = Uuid;
+
+    return Volume;
+}
+
+static
+VOID FreeDiffVolume (REFIT_VOLUME *Volume) {
+    MY_FREE_POOL(Volume->DevicePath);
+    MY_FREE_POOL(Volume->VolIconImage);
+    MY_FREE_POOL(Volume);
+}
+
+static
+VOID TestDiffVolumes (VOID) {
+    REFIT_VOLUME  *OldList[3];
+    REFIT_VOLUME  *NewList[4];
+    EG_IMAGE      *Icon;
+    UINTN          i;
+
+    // Before:  A, B and C
+    // After:   A, C reformatted (new UUID), D added and B removed
+    OldList[0] = NewDiffVolume (1, 1, 0xA0);
+    OldList[1] = NewDiffVolume (1, 2, 0xB0);
+    OldList[2] = NewDiffVolume (2, 1, 0xC0);
+    NewList[0] = NewDiffVolume (2, 1, 0xC1);
+    NewList[1] = NewDiffVolume (1, 1, 0xA0);
+    NewList[2] = NewDiffVolume (3, 1, 0xD0);
+    NewList[3] = NewDiffVolume (1, 1, 0xA0);
+
+    Icon = AllocateZeroPool (sizeof (EG_IMAGE));
+    OldList[0]->VolIconImage = Icon;
+
+    CHECK(SameVolume (OldList[0], NewList[1]));
+    CHECK(!SameVolume (OldList[0], OldList[1]));
+    CHECK(!SameVolume (OldList[2], NewList[0]));
+    CHECK(!SameVolume (OldList[0], NULL));
+
+    // Only the first three new volumes
+    CHECK(DiffVolumes (OldList, 3, NewList, 3) == 2);
+    CHECK(NewList[0]->IsNewOnRescan);
+    CHECK(!NewList[1]->IsNewOnRescan);
+    CHECK(NewList[2]->IsNewOnRescan);
+
+    // Unchanged volumes keep their loaded icon
+    CHECK(NewList[1]->VolIconImage == Icon);
+    CHECK(OldList[0]->VolIconImage == NULL);
+
+    // Each old volume matches one new volume at most
+    CHECK(DiffVolumes (OldList, 3, NewList, 4) == 2);
+    CHECK(!NewList[1]->IsNewOnRescan);
+    CHECK(NewList[3]->IsNewOnRescan);
+
+    // First scan: everything is new and nothing is removed
+    CHECK(DiffVolumes (NULL, 0, NewList, 4) == 0);
+    CHECK(NewList[1]->IsNewOnRescan);
+
+    for (i = 0; i < 3; i++) {
+        FreeDiffVolume (OldList[i]);
+    }
+    for (i = 0; i < 4; i++) {
+        FreeDiffVolume (NewList[i]);
+    }
+}
+
+//
+// crc32.c and crc32_core.h
+//
+
+// One bit at a time, straight from the polynomial
+static
+UINT32 CrcBitwise (UINT32 Poly, UINT32 Crc, const UINT8 *Buf, UINTN Size) {
+    UINTN i, j;
+
+    Crc = ~Crc;
+    for (i = 0; i < Size; i++) {
+        Crc ^= Buf[i];
+        for (j = 0; j < 8; j++) {
+            Crc = (Crc & 1) ? ((Crc >> 1) ^ Poly) : (Crc >> 1);
+        }
+    }
+
+    return ~Crc;
+}
+
+static
+VOID TestCrc32 (VOID) {
+    static UINT8 Buf[4096 + 16];
+    UINT32  Hardware;
+    UINT32  Expected;
+    UINTN   Errors[4];
+    UINTN   Lengths[] = { 4096, 4095, 1024, 1000, 512, 320, 255, 128 };
+    UINTN   Size, Offset, Pass, i;
+
+    CHECK(crc32refit (0, "123456789", 9) == 0xCBF43926);
+    CHECK(CrcCoreCrc32c (0, "123456789", 9) == 0xE3069283);
+    CHECK(crc32refit (0, "", 0) == 0);
+
+    srand (41);
+    for (i = 0; i < sizeof (Buf); i++) {
+        Buf[i] = (UINT8) rand();
+    }
+
+    // The hardware paths (when present) and the portable code must agree
+    // with the bitwise sum for every length and alignment
+    Hardware = CrcCoreFeatures();
+    memset (Errors, 0, sizeof (Errors));
+    for (Pass = 0; Pass < 2; Pass++) {
+        mCrcCoreFeatures = (Pass == 0) ? Hardware : CRC_CORE_PROBED;
+
+        for (Offset = 0; Offset < 16; Offset++) {
+            for (Size = 0; Size < 300 + sizeof (Lengths) / sizeof (Lengths[0]); Size++) {
+                i = (Size < 300) ? Size : Lengths[Size - 300];
+
+                Expected = CrcBitwise (CRC_CORE_POLY_CRC32, 0x5A5A5A5A, Buf + Offset, i);
+                Errors[Pass * 2]     += (CrcCoreCrc32 (0x5A5A5A5A, Buf + Offset, i) != Expected);
+
+                Expected = CrcBitwise (CRC_CORE_POLY_CRC32C, 0x5A5A5A5A, Buf + Offset, i);
+                Errors[Pass * 2 + 1] += (CrcCoreCrc32c (0x5A5A5A5A, Buf + Offset, i) != Expected);
+            }
+        }
+    }
+    mCrcCoreFeatures = Hardware;
+
+    CHECK(Errors[0] == 0);
+    CHECK(Errors[1] == 0);
+    CHECK(Errors[2] == 0);
+    CHECK(Errors[3] == 0);
+
+    // Summing in pieces gives the same result as one call
+    CHECK(crc32refit (0, Buf + 3, 4000) == CrcCoreCrc32 (0, Buf + 3, 4000));
+    CHECK(crc32refit (crc32refit (0, Buf, 100), Buf + 100, 4000) == crc32refit (0, Buf, 4100));
+    CHECK(CrcCoreCrc32c (CrcCoreCrc32c (1, Buf, 77), Buf + 77, 3000) == CrcCoreCrc32c (1, Buf, 3077));
+}
+
+//
+// RP_ApfsFletcher.h
+//
+
+// One word at a time, as RP_ApfsIo.c did before the rounds were folded
+static
+UINT64 FletcherReference (const UINT32 *Words, UINTN Count) {
+    UINT64 Sum1, Sum2;
+    UINTN  i;
+
+    Sum1 = 0;
+    Sum2 = 0;
+    for (i = 0; i < Count; i++) {
+        Sum1 += Words[i];
+        Sum2 += Sum1;
+    }
+
+    Sum2 = (UINT32) ~(UINT32) ((Sum2 + Sum1) % 0xFFFFFFFF);
+    Sum1 = (UINT32) ~(UINT32) ((Sum1 + Sum2) % 0xFFFFFFFF);
+
+    return (Sum1 << 32) | Sum2;
+}
+
+static
+VOID TestApfsFletcher (VOID) {
+    static UINT32 Words[0x10000 / 4];
+    UINTN   Count[] = { 0x1000 - 8, 0x1000 - 4, 0x1000, 0x1004, 0x100C, 0x2000 - 8, 0x8000 - 8, 0x10000 - 8 };
+    UINT32  Fill[]  = { 0, 1, 0x7FFFFFFF, 0xFFFFFFFE, 0xFFFFFFFF };
+    UINTN   Errors;
+    UINTN   Size, Pass, i, j;
+
+    Errors = 0;
+    srand (29);
+
+    // Random blocks, with word counts of every remainder mod four
+    for (Pass = 0; Pass < 8; Pass++) {
+        for (i = 0; i < sizeof (Words) / sizeof (Words[0]); i++) {
+            Words[i] = ((UINT32) rand() << 16) ^ (UINT32) rand();
+        }
+        for (i = 0; i < sizeof (Count) / sizeof (Count[0]); i++) {
+            Size = Count[i];
+            Errors += (ApfsFletcher64 (Words, Size) != FletcherReference (Words, Size / 4));
+        }
+    }
+    CHECK(Errors == 0);
+
+    // Constant blocks ... All ones gives the largest sums and words that are
+    // themselves equal to the modulus
+    Errors = 0;
+    for (j = 0; j < sizeof (Fill) / sizeof (Fill[0]); j++) {
+        for (i = 0; i < sizeof (Words) / sizeof (Words[0]); i++) {
+            Words[i] = Fill[j];
+        }
+        for (i = 0; i < sizeof (Count) / sizeof (Count[0]); i++) {
+            Size = Count[i];
+            Errors += (ApfsFletcher64 (Words, Size) != FletcherReference (Words, Size / 4));
+        }
+    }
+    CHECK(Errors == 0);
+
+    // A zero block sums to zero, so both halves come out as ~0
+    memset (Words, 0, sizeof (Words));
+    CHECK(ApfsFletcher64 (Words, 0x1000 - 8) == 0xFFFFFFFFFFFFFFFFULL);
+
+    // Make both sums land on multiples of the modulus before the final fold
+    Words[0] = 0xFFFFFFFF;
+    CHECK(ApfsFletcher64 (Words, 0x1000 - 8) == FletcherReference (Words, (0x1000 - 8) / 4));
+    Words[0] = 0;
+    Words[(0x1000 - 8) / 4 - 1] = 0xFFFFFFFF;
+    CHECK(ApfsFletcher64 (Words, 0x1000 - 8) == FletcherReference (Words, (0x1000 - 8) / 4));
+    CHECK(ApfsFletcher64 (Words, 0x1000 - 8) == 0xFFFFFFFFFFFFFFFFULL);
+}
+
+//
+// linux.c
+//
+
+static
+VOID TestLinux (REFIT_VOLUME *Volume) {
+    CHAR16 *Initrd;
+    CHAR16 *OSIconName;
+
+    WriteHostFile ("boot/vmlinuz-5.15.0-76-generic", "k");
+    WriteHostFile ("boot/initrd.img-5.15.0-76-generic", "i");
+    WriteHostFile ("boot/initrd.img-5.15.0-7-generic", "i");
+    WriteHostFile ("boot/initrd.img-15.15.0-76-generic", "i");
+    WriteHostFile ("boot/vmlinuz-6.1.0", "k");
+    WriteHostFile ("boot/initramfs-6.1.0.img", "i");
+    WriteHostFile ("boot/initramfs-6.1.0-fallback.img", "i");
+    WriteHostFile ("boot/vmlinuz-9.9", "k");
+
+    Initrd = FindInitrd (L"\\boot\\vmlinuz-5.15.0-76-generic", Volume);
+    CHECK_STR(Initrd, "\\boot\\initrd.img-5.15.0-76-generic");
+    MY_FREE_POOL(Initrd);
+
+    // The shorter name wins when both match equally well
+    Initrd = FindInitrd (L"\\boot\\vmlinuz-6.1.0", Volume);
+    CHECK_STR(Initrd, "\\boot\\initramfs-6.1.0.img");
+    MY_FREE_POOL(Initrd);
+
+    Initrd = FindInitrd (L"\\boot\\vmlinuz-9.9", Volume);
+    CHECK_STR(Initrd, NULL);
+
+    WriteHostFile ("etc/os-release", "NAME=\"Ubuntu\"\nVERSION=\"22.04\"\nID=ubuntu\n");
+    OSIconName = StrDuplicate (L"linux");
+    GuessLinuxDistribution (&OSIconName, Volume, L"\\boot\\vmlinuz-5.15.0-76-generic");
+    CHECK(IsIn (L"linux", OSIconName));
+    CHECK(IsIn (L"ubuntu", OSIconName));
+    CHECK(!IsIn (L"22.04", OSIconName));
+    MY_FREE_POOL(OSIconName);
+
+    OSIconName = StrDuplicate (L"linux");
+    GuessLinuxDistribution (&OSIconName, Volume, L"\\boot\\vmlinuz-6.2.9-300.fc38.x86_64");
+    CHECK(IsIn (L"fedora", OSIconName));
+    MY_FREE_POOL(OSIconName);
+}
+
+//
+// Micro-benchmarks
+//
+
+typedef VOID (*BENCH_FUNC) (REFIT_VOLUME *Volume, UINTN Iterations);
+
+static CHAR16 *BenchList;
+static UINT8   BenchSector[4096];
+
+static
+VOID BenchIsIn (REFIT_VOLUME *Volume, UINTN Iterations) {
+    UINTN i;
+
+    for (i = 0; i < Iterations; i++) {
+        IsIn (L"item39.efi", BenchList);
+    }
+}
+
+static
+VOID BenchFilenameIn (REFIT_VOLUME *Volume, UINTN Iterations) {
+    UINTN i;
+
+    for (i = 0; i < Iterations; i++) {
+        FilenameIn (Volume, L"EFI\\tools", L"item39.efi", BenchList);
+    }
+}
+
+static
+VOID BenchReadTokenLine (REFIT_VOLUME *Volume, UINTN Iterations) {
+    REFIT_FILE   File;
+    CHAR16     **TokenList;
+    UINTN        TokenCount;
+    UINTN        Size;
+    UINTN        i;
+
+    for (i = 0; i < Iterations; i++) {
+        if (RefitReadFile (Volume->RootDir, L"bench.conf", &File, &Size) != EFI_SUCCESS) {
+            return;
+        }
+        while ((TokenCount = ReadTokenLine (&File, &TokenList)) > 0) {
+            FreeTokenLine (&TokenList, &TokenCount);
+        }
+        MY_FREE_POOL(File.Buffer);
+    }
+}
+
+static
+VOID BenchDirIter (REFIT_VOLUME *Volume, UINTN Iterations) {
+    EFI_FILE_INFO  *DirEntry;
+    REFIT_DIR_ITER  DirIter;
+    UINTN           i;
+
+    for (i = 0; i < Iterations; i++) {
+        DirIterOpen (Volume->RootDir, L"\\bench", &DirIter);
+        while (DirIterNext (&DirIter, 2, L"vmlinuz*,bzImage*,kernel*", &DirEntry)) {
+            MY_FREE_POOL(DirEntry);
+        }
+        DirIterClose (&DirIter);
+    }
+}
+
+static
+VOID BenchDirIterSnapshot (REFIT_VOLUME *Volume, UINTN Iterations) {
+    EnableDirSnapshots();
+    BenchDirIter (Volume, Iterations);
+    FreeDirSnapshots();
+}
+
+// The FindMem() calls ScanVolumeBootcode() made for a sector with no match
+static
+VOID BenchBootcodeFindMem (REFIT_VOLUME *Volume, UINTN Iterations) {
+    UINTN i;
+    INTN  Found = 0;
+
+    for (i = 0; i < Iterations; i++) {
+        Found += FindMem (BenchSector, 512, "EXFAT", 5);
+        Found += FindMem (BenchSector, 4096, "ISOLINUX", 8);
+        Found += FindMem (BenchSector, 512, "Geom\0Hard Disk\0Read\0 Error", 26);
+        Found += FindMem (BenchSector, 4096, "Starting the BTX loader", 23);
+        Found += FindMem (BenchSector, 4096, "Boot loader too large", 21);
+        Found += FindMem (BenchSector, 512, "!Loading", 8);
+        Found += FindMem (BenchSector, 4096, "/cdboot\0/CDBOOT\0", 16);
+        Found += FindMem (BenchSector, 512, "Not a bootxx image", 18);
+        Found += FindMem (BenchSector, 4096, "NTLDR", 5);
+        Found += FindMem (BenchSector, 4096, "BOOTMGR", 7);
+        Found += FindMem (BenchSector, 512, "CPUBOOT SYS", 11);
+        Found += FindMem (BenchSector, 512, "KERNEL  SYS", 11);
+        Found += FindMem (BenchSector, 512, "OS2LDR", 6);
+        Found += FindMem (BenchSector, 512, "OS2BOOT", 7);
+        Found += FindMem (BenchSector, 512, "Be Boot Loader", 14);
+        Found += FindMem (BenchSector, 512, "yT Boot Loader", 14);
+        Found += FindMem (BenchSector, 512, "\x04" "beos\x06" "system\x05" "zbeos", 18);
+        Found += FindMem (BenchSector, 512, "\x06" "system\x0c" "haiku_loader", 20);
+    }
+    CHECK(Found == -18 * (INTN) Iterations);
+}
+
+static
+VOID BenchBootcodeMatch (REFIT_VOLUME *Volume, UINTN Iterations) {
+    UINTN   i;
+    BOOLEAN Matched[BOOTCODE_SIG_MAX];
+
+    for (i = 0; i < Iterations; i++) {
+        MatchBootcodeSignatures (BenchSector, sizeof (BenchSector), Matched);
+    }
+}
+
+static UINT8   BenchCrcBuffer[16384];
+static volatile UINT32 BenchCrcSum;
+
+static
+VOID BenchCrc32 (REFIT_VOLUME *Volume, UINTN Iterations) {
+    UINTN i;
+
+    for (i = 0; i < Iterations; i++) {
+        BenchCrcSum = CrcCoreCrc32 (0, BenchCrcBuffer, sizeof (BenchCrcBuffer));
+    }
+}
+
+static
+VOID BenchCrc32c (REFIT_VOLUME *Volume, UINTN Iterations) {
+    UINTN i;
+
+    for (i = 0; i < Iterations; i++) {
+        BenchCrcSum = CrcCoreCrc32c (0, BenchCrcBuffer, sizeof (BenchCrcBuffer));
+    }
+}
+
+static
+VOID RunBench (const char *Name, BENCH_FUNC Func, REFIT_VOLUME *Volume, UINTN Iterations) {
+    UINT64 Start;
+    UINT64 Elapsed;
+
+    Func (Volume, Iterations / 10 + 1);
+
+    Start   = ShimNanoseconds();
+    Func (Volume, Iterations);
+    Elapsed = ShimNanoseconds() - Start;
+
+    printf (
+        "%-24s %10lu iterations %12.1f ns/op\n",
+        Name, (unsigned long) Iterations, (double) Elapsed / (double) Iterations
+    );
+}
+
+static
+VOID RunBenchmarks (REFIT_VOLUME *Volume) {
+    char   Name[64];
+    char  *Config;
+    size_t Used;
+    UINTN  i;
+    UINT32 Features;
+
+    for (i = 0; i < 40; i++) {
+        snprintf (Name, sizeof (Name), "item%lu.efi", (unsigned long) i);
+        MergeStrings (&BenchList, ShimWide (Name), L',');
+    }
+
+    Config = malloc (2000 * 64);
+    Used   = 0;
+    for (i = 0; i < 2000; i++) {
+        Used += snprintf (Config + Used, 64, "option_%lu value%lu \"quoted %lu\",x\n",
+            (unsigned long) i, (unsigned long) i, (unsigned long) i);
+    }
+    WriteHostFile ("bench.conf", Config);
+    free (Config);
+
+    for (i = 0; i < 400; i++) {
+        snprintf (Name, sizeof (Name), "bench/%s-%lu", (i % 4 == 0) ? "vmlinuz" : "initrd", (unsigned long) i);
+        WriteHostFile (Name, "");
+    }
+
+    // Boot sector text without any signature
+    for (i = 0; i < sizeof (BenchSector); i++) {
+        BenchSector[i] = (UINT8) ("Missing operating system. Error loading OS. "[i % 44]);
+    }
+
+    RunBench ("IsIn",               BenchIsIn,            Volume, 200000);
+    RunBench ("FilenameIn",         BenchFilenameIn,      Volume, 200000);
+    RunBench ("ReadTokenLine",      BenchReadTokenLine,   Volume, 50);
+    RunBench ("DirIterNext",        BenchDirIter,         Volume, 200);
+    RunBench ("DirIterNext+snap",   BenchDirIterSnapshot, Volume, 200);
+    RunBench ("Bootcode FindMem",   BenchBootcodeFindMem, Volume, 20000);
+    RunBench ("Bootcode match",     BenchBootcodeMatch,   Volume, 20000);
+
+    // 16 KiB sums, with the hardware paths (if any) and then without
+    for (i = 0; i < sizeof (BenchCrcBuffer); i++) {
+        BenchCrcBuffer[i] = (UINT8) (i * 131 + 7);
+    }
+    Features = CrcCoreFeatures();
+    RunBench ("CRC32 16K",          BenchCrc32,           Volume, 20000);
+    RunBench ("CRC32C 16K",         BenchCrc32c,          Volume, 20000);
+    mCrcCoreFeatures = CRC_CORE_PROBED;
+    RunBench ("CRC32 16K portable", BenchCrc32,           Volume, 20000);
+    RunBench ("CRC32C 16K portable",BenchCrc32c,          Volume, 20000);
+    mCrcCoreFeatures = Features;
+
+    MY_FREE_POOL(BenchList);
+}
+
+int main (int argc, char **argv) {
+    REFIT_VOLUME *Volume;
+    BOOLEAN       Bench;
+
+    Bench = (argc > 1 && strcmp (argv[1], "--bench") == 0) ? TRUE : FALSE;
+
+    if (mkdtemp (TempRoot) == NULL) {
+        perror ("mkdtemp");
+        return 2;
+    }
+    Volume = NewHostVolume();
+
+    if (Bench) {
+        RunBenchmarks (Volume);
+    }
+    else {
+        TestMergeStrings();
+        TestFindNumbers();
+        TestNumCharsInCommon();
+        TestTruncateString();
+        TestCommaLists();
+        TestReadTokenLine (Volume);
+        TestFileAccess (Volume);
+        TestBootcodeSignatures();
+        TestDiffVolumes();
+        TestCrc32();
+        TestApfsFletcher();
+        TestLinux (Volume);
+        TestReadConfig (Volume);
+
+        printf ("%d checks, %d failed\n", TestsRun, TestsFailed);
+    }
+
+    FreeHostVolume (Volume);
+    RemoveTree (TempRoot);
+
+    return (TestsFailed == 0) ? 0 : 1;
+}
+
+/* EOF */
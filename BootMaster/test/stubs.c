@@ -0,0 +1,279 @@
+/*
+ * BootMaster/test/stubs.c
+ * Stand-ins for BootMaster globals and functions outside the tested files
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "global.h"
+#include "lib.h"
+#include "icns.h"
+#include "menu.h"
+#include "scan.h"
+#include "screenmgt.h"
+#include "gpt.h"
+#include "apple.h"
+#include "../libeg/libeg.h"
+#include "../include/refit_call_wrapper.h"
+
+// Code paths that need these are not exercised by the harness.
+// Reaching one means a test strayed outside the tested files.
+#define SHIM_UNREACHABLE()                                               \
+    do {                                                                 \
+        fprintf (stderr, "Unexpected call to stub '%s'\n", __func__);    \
+        abort ();                                                        \
+    } while (0)
+
+REFIT_CONFIG       GlobalConfig;
+REFIT_MENU_SCREEN *MainMenu          = NULL;
+BOOLEAN            AllowGraphicsMode = FALSE;
+BOOLEAN            AppleFirmware     = FALSE;
+BOOLEAN            ForceTextOnly     = FALSE;
+BOOLEAN            gKernelStarted    = FALSE;
+EFI_GUID           RefindPlusGuid    = REFINDPLUS_GUID;
+EFI_GUID           RefindPlusOldGuid = REFINDPLUS_OLD_GUID;
+
+//
+// Screen
+//
+
+BOOLEAN CheckError (
+    IN EFI_STATUS  Status,
+    IN CHAR16     *where
+) {
+    if (!EFI_ERROR(Status)) {
+        return FALSE;
+    }
+
+    Print (L"Error: '%r' %s\n", Status, where);
+
+    return TRUE;
+}
+
+BOOLEAN CheckFatalError (
+    IN EFI_STATUS  Status,
+    IN CHAR16     *where
+) {
+    return CheckError (Status, where);
+}
+
+VOID PrintUglyText (
+    IN CHAR16 *Text,
+    IN UINTN   PositionCode
+) {
+    Print (L"%s\n", Text);
+}
+
+VOID PauseForKey (VOID) {
+}
+
+VOID SwitchToText (IN BOOLEAN CursorEnabled) {
+}
+
+EFI_STATUS SwitchToGraphics (VOID) {
+    return EFI_SUCCESS;
+}
+
+//
+// libeg
+//
+
+EFI_STATUS egFindESP (OUT EFI_FILE_HANDLE *RootDir) {
+    return EFI_NOT_FOUND;
+}
+
+EFI_STATUS egLoadFile (
+    IN EFI_FILE_PROTOCOL  *BaseDir,
+    IN  CHAR16            *FileName,
+    OUT UINT8            **FileData,
+    OUT UINTN             *FileDataLength
+) {
+    EFI_STATUS       Status;
+    EFI_FILE_HANDLE  FileHandle;
+    EFI_FILE_INFO   *FileInfo;
+    UINT8           *Buffer;
+    UINTN            BufferSize;
+
+    if (BaseDir == NULL || FileName == NULL || FileData == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    Status = REFIT_CALL_5_WRAPPER(
+        BaseDir->Open, BaseDir,
+        &FileHandle, FileName,
+        EFI_FILE_MODE_READ, 0
+    );
+    if (EFI_ERROR(Status)) {
+        return Status;
+    }
+
+    FileInfo = LibFileInfo (FileHandle);
+    if (FileInfo == NULL) {
+        REFIT_CALL_1_WRAPPER(FileHandle->Close, FileHandle);
+        return EFI_NOT_FOUND;
+    }
+    BufferSize = (UINTN) FileInfo->FileSize;
+    MY_FREE_POOL(FileInfo);
+
+    Buffer = AllocatePool (BufferSize);
+    if (Buffer == NULL) {
+        REFIT_CALL_1_WRAPPER(FileHandle->Close, FileHandle);
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    Status = REFIT_CALL_3_WRAPPER(FileHandle->Read, FileHandle, &BufferSize, Buffer);
+    REFIT_CALL_1_WRAPPER(FileHandle->Close, FileHandle);
+    if (EFI_ERROR(Status)) {
+        MY_FREE_POOL(Buffer);
+        return Status;
+    }
+
+    *FileData = Buffer;
+    if (FileDataLength != NULL) {
+        *FileDataLength = BufferSize;
+    }
+
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS egSaveFile (
+    IN EFI_FILE_PROTOCOL  *BaseDir OPTIONAL,
+    IN CHAR16             *FileName,
+    IN UINT8              *FileData,
+    IN UINTN               FileDataLength
+) {
+    return EFI_UNSUPPORTED;
+}
+
+EG_IMAGE * egCopyImage (IN EG_IMAGE *Image) {
+    SHIM_UNREACHABLE();
+}
+
+EG_IMAGE * egLoadIcon (IN EFI_FILE* BaseDir, IN CHAR16 *FileName, IN UINTN IconSize) {
+    SHIM_UNREACHABLE();
+}
+
+EG_IMAGE * egLoadIconAnyType (
+    IN EFI_FILE_PROTOCOL  *BaseDir,
+    IN CHAR16             *SubdirName,
+    IN CHAR16             *BaseName,
+    IN UINTN               IconSize
+) {
+    SHIM_UNREACHABLE();
+}
+
+VOID egLoadFont (IN CHAR16 *Filename) {
+    SHIM_UNREACHABLE();
+}
+
+//
+// Menus, icons, partitions and scanning
+//
+
+VOID AddMenuEntry (IN REFIT_MENU_SCREEN *Screen, IN REFIT_MENU_ENTRY *Entry) {
+    SHIM_UNREACHABLE();
+}
+
+VOID AddSubMenuEntry (IN REFIT_MENU_SCREEN *SubScreen, IN REFIT_MENU_ENTRY *SubEntry) {
+    SHIM_UNREACHABLE();
+}
+
+VOID FreeMenuEntry (IN OUT REFIT_MENU_ENTRY **Entry) {
+    SHIM_UNREACHABLE();
+}
+
+VOID FreeMenuScreen (IN REFIT_MENU_SCREEN **Screen) {
+    SHIM_UNREACHABLE();
+}
+
+BOOLEAN GetReturnMenuEntry (IN OUT REFIT_MENU_SCREEN **Screen) {
+    SHIM_UNREACHABLE();
+}
+
+EG_IMAGE * BuiltinIcon (IN UINTN Id) {
+    SHIM_UNREACHABLE();
+}
+
+EG_IMAGE * DummyImage (IN UINTN PixelSize) {
+    SHIM_UNREACHABLE();
+}
+
+VOID LoadEntryIcon (IN REFIT_MENU_ENTRY *Entry) {
+    SHIM_UNREACHABLE();
+}
+
+VOID AddPartitionTable (REFIT_VOLUME *Volume) {
+    SHIM_UNREACHABLE();
+}
+
+VOID ForgetPartitionTables (VOID) {
+    SHIM_UNREACHABLE();
+}
+
+GPT_ENTRY * FindPartWithGuid (EFI_GUID *Guid) {
+    SHIM_UNREACHABLE();
+}
+
+EFI_STATUS RP_GetApfsVolumeInfo (
+    IN  EFI_HANDLE               Device,
+    OUT EFI_GUID                *ContainerGuid OPTIONAL,
+    OUT EFI_GUID                *VolumeGuid    OPTIONAL,
+    OUT APPLE_APFS_VOLUME_ROLE  *VolumeRole    OPTIONAL
+) {
+    return EFI_UNSUPPORTED;
+}
+
+LOADER_ENTRY * InitializeLoaderEntry (IN LOADER_ENTRY *Entry) {
+    SHIM_UNREACHABLE();
+}
+
+REFIT_MENU_SCREEN * InitializeSubScreen (IN LOADER_ENTRY *Entry) {
+    SHIM_UNREACHABLE();
+}
+
+VOID GenerateSubScreen (LOADER_ENTRY *Entry, IN REFIT_VOLUME *Volume, IN BOOLEAN GenerateReturn) {
+    SHIM_UNREACHABLE();
+}
+
+VOID SetLoaderDefaults (LOADER_ENTRY *Entry, CHAR16 *LoaderPath, IN REFIT_VOLUME *Volume) {
+    SHIM_UNREACHABLE();
+}
+
+CHAR16 * SetVolJoin (IN CHAR16 *InstanceName) {
+    SHIM_UNREACHABLE();
+}
+
+CHAR16 * SetVolKind (IN CHAR16 *InstanceName, IN CHAR16 *VolumeName) {
+    SHIM_UNREACHABLE();
+}
+
+CHAR16 * SetVolFlag (IN CHAR16 *InstanceName, IN CHAR16 *VolumeName) {
+    SHIM_UNREACHABLE();
+}
+
+CHAR16 * SetVolType (IN CHAR16 *InstanceName OPTIONAL, IN CHAR16 *VolumeName) {
+    SHIM_UNREACHABLE();
+}
+
+BOOLEAN ShouldScan (REFIT_VOLUME *Volume, CHAR16 *Path) {
+    SHIM_UNREACHABLE();
+}
+
+/* EOF */
@@ -0,0 +1,1287 @@
+/*
+ * BootMaster/test/uefi_shim.c
+ * Host implementations of the UEFI services used by BootMaster sources
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "efi.h"
+#include "efilib.h"
+#include "uefi_shim.h"
+
+// Needed by the device path helpers in EfiLib
+UINTN GetDevicePathSize (IN const EFI_DEVICE_PATH *DevicePath);
+CHAR16 * DevicePathToStr (IN EFI_DEVICE_PATH *DevPath);
+
+EFI_GUID gEfiFileInfoGuid       = { 0x09576e92, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiFileSystemInfoGuid = { 0x09576e93, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID DevicePathProtocol     = { 0x09576e91, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID BlockIoProtocol        = { 0x964e5b21, 0x6459, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID LoadedImageProtocol    = { 0x5b1b31a1, 0x9562, 0x11d2, { 0x8e, 0x3f, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+
+EFI_DEVICE_PATH EndDevicePath[] = {
+    { END_DEVICE_PATH_TYPE, END_ENTIRE_DEVICE_PATH_SUBTYPE, { END_DEVICE_PATH_LENGTH, 0 } }
+};
+
+VOID ShimAssert (
+    const char *Expr,
+    const char *File,
+    int         Line
+) {
+    fprintf (stderr, "%s:%d: ASSERT (%s) failed\n", File, Line, Expr);
+    abort ();
+}
+
+//
+// Memory
+//
+
+VOID * AllocatePool (UINTN Size) {
+    return malloc (Size ? Size : 1);
+}
+
+VOID * AllocateZeroPool (UINTN Size) {
+    return calloc (1, Size ? Size : 1);
+}
+
+VOID * AllocateCopyPool (UINTN Size, CONST VOID *Buffer) {
+    VOID *Copy = AllocatePool (Size);
+
+    if (Copy != NULL) {
+        memcpy (Copy, Buffer, Size);
+    }
+
+    return Copy;
+}
+
+VOID * ReallocatePool (VOID *OldPool, UINTN OldSize, UINTN NewSize) {
+    VOID *NewPool = AllocateZeroPool (NewSize);
+
+    if (NewPool != NULL && OldPool != NULL) {
+        memcpy (NewPool, OldPool, OldSize < NewSize ? OldSize : NewSize);
+    }
+    free (OldPool);
+
+    return NewPool;
+}
+
+VOID FreePool (VOID *Buffer) {
+    free (Buffer);
+}
+
+VOID CopyMem (VOID *Dest, CONST VOID *Src, UINTN Len) {
+    memmove (Dest, Src, Len);
+}
+
+VOID SetMem (VOID *Buffer, UINTN Size, UINT8 Value) {
+    memset (Buffer, Value, Size);
+}
+
+VOID ZeroMem (VOID *Buffer, UINTN Size) {
+    memset (Buffer, 0, Size);
+}
+
+INTN CompareMem (CONST VOID *Dest, CONST VOID *Src, UINTN Len) {
+    return memcmp (Dest, Src, Len);
+}
+
+//
+// Strings
+//
+
+static
+CHAR16 ShimUpper (CHAR16 c) {
+    return (c >= L'a' && c <= L'z') ? (CHAR16) (c - (L'a' - L'A')) : c;
+}
+
+UINTN StrLen (CONST CHAR16 *s1) {
+    UINTN Len = 0;
+
+    while (s1[Len] != 0) {
+        Len++;
+    }
+
+    return Len;
+}
+
+UINTN StrSize (CONST CHAR16 *s1) {
+    return (StrLen (s1) + 1) * sizeof (CHAR16);
+}
+
+INTN StrCmp (CONST CHAR16 *s1, CONST CHAR16 *s2) {
+    while (*s1 != 0 && *s1 == *s2) {
+        s1++;
+        s2++;
+    }
+
+    return (INTN) *s1 - (INTN) *s2;
+}
+
+INTN StrnCmp (CONST CHAR16 *s1, CONST CHAR16 *s2, UINTN len) {
+    while (len > 0 && *s1 != 0 && *s1 == *s2) {
+        s1++;
+        s2++;
+        len--;
+    }
+
+    return (len > 0) ? (INTN) *s1 - (INTN) *s2 : 0;
+}
+
+INTN StriCmp (CONST CHAR16 *s1, CONST CHAR16 *s2) {
+    while (*s1 != 0 && ShimUpper (*s1) == ShimUpper (*s2)) {
+        s1++;
+        s2++;
+    }
+
+    return (INTN) ShimUpper (*s1) - (INTN) ShimUpper (*s2);
+}
+
+VOID StrCpy (CHAR16 *Dest, CONST CHAR16 *Src) {
+    memmove (Dest, Src, StrSize (Src));
+}
+
+VOID StrnCpy (CHAR16 *Dest, CONST CHAR16 *Src, UINTN Len) {
+    UINTN i;
+
+    for (i = 0; i < Len && Src[i] != 0; i++) {
+        Dest[i] = Src[i];
+    }
+    for (; i < Len; i++) {
+        Dest[i] = 0;
+    }
+}
+
+VOID StrCat (CHAR16 *Dest, CONST CHAR16 *Src) {
+    StrCpy (Dest + StrLen (Dest), Src);
+}
+
+CHAR16 * StrDuplicate (CONST CHAR16 *Src) {
+    return AllocateCopyPool (StrSize (Src), Src);
+}
+
+UINTN Atoi (CONST CHAR16 *str) {
+    UINTN Value = 0;
+
+    while (*str == L' ' || *str == L'\t') {
+        str++;
+    }
+    while (*str >= L'0' && *str <= L'9') {
+        Value = Value * 10 + (*str++ - L'0');
+    }
+
+    return Value;
+}
+
+UINTN xtoi (CONST CHAR16 *str) {
+    UINTN  Value = 0;
+    CHAR16 c;
+
+    while (*str == L' ' || *str == L'\t') {
+        str++;
+    }
+    for (;;) {
+        c = ShimUpper (*str++);
+        if (c >= L'0' && c <= L'9') {
+            Value = (Value << 4) | (UINTN) (c - L'0');
+        }
+        else if (c >= L'A' && c <= L'F') {
+            Value = (Value << 4) | (UINTN) (c - L'A' + 10);
+        }
+        else {
+            break;
+        }
+    }
+
+    return Value;
+}
+
+UINTN AsciiStrLen (CONST CHAR8 *s1) {
+    return strlen (s1);
+}
+
+UINTN AsciiStrSize (CONST CHAR8 *s1) {
+    return strlen (s1) + 1;
+}
+
+UINTN strlena (CONST CHAR8 *s1) {
+    return strlen (s1);
+}
+
+// Case-insensitive glob match with '*', '?' and '[...]', as in GNU-EFI
+BOOLEAN MetaiMatch (CHAR16 *String, CHAR16 *Pattern) {
+    CHAR16   c, p, l;
+    BOOLEAN  Matched;
+
+    for (;;) {
+        p = *Pattern++;
+        switch (p) {
+            case 0:
+                return (*String == 0) ? TRUE : FALSE;
+
+            case L'*':
+                while (*String != 0) {
+                    if (MetaiMatch (String, Pattern)) {
+                        return TRUE;
+                    }
+                    String++;
+                }
+                return MetaiMatch (String, Pattern);
+
+            case L'?':
+                if (*String++ == 0) {
+                    return FALSE;
+                }
+                break;
+
+            case L'[':
+                c = ShimUpper (*String++);
+                if (c == 0) {
+                    return FALSE;
+                }
+
+                l       = 0;
+                Matched = FALSE;
+                while ((p = *Pattern++) != 0 && p != L']') {
+                    if (p == L'-' && l != 0 && *Pattern != 0 && *Pattern != L']') {
+                        p = *Pattern++;
+                        if (c >= ShimUpper (l) && c <= ShimUpper (p)) {
+                            Matched = TRUE;
+                        }
+                    }
+                    else if (c == ShimUpper (p)) {
+                        Matched = TRUE;
+                    }
+                    l = p;
+                }
+                if (!Matched) {
+                    return FALSE;
+                }
+                break;
+
+            default:
+                if (ShimUpper (*String++) != ShimUpper (p)) {
+                    return FALSE;
+                }
+                break;
+        } // switch
+    } // for
+}
+
+//
+// Formatted output
+//
+
+typedef struct {
+    CHAR16  *Buf;
+    UINTN    Len;
+    UINTN    Max;     // Characters, excluding the terminator
+    BOOLEAN  Grow;
+} SHIM_OUT;
+
+static
+VOID ShimPut (SHIM_OUT *Out, CHAR16 c) {
+    CHAR16 *NewBuf;
+
+    if (Out->Len >= Out->Max) {
+        if (!Out->Grow) {
+            return;
+        }
+
+        NewBuf = realloc (Out->Buf, (Out->Max * 2 + 1) * sizeof (CHAR16));
+        if (NewBuf == NULL) {
+            return;
+        }
+        Out->Buf = NewBuf;
+        Out->Max = Out->Max * 2;
+    }
+
+    Out->Buf[Out->Len++] = c;
+}
+
+static
+const char * ShimStatusString (EFI_STATUS Status) {
+    switch (Status) {
+        case EFI_SUCCESS:           return "Success";
+        case EFI_LOAD_ERROR:        return "Load Error";
+        case EFI_INVALID_PARAMETER: return "Invalid Parameter";
+        case EFI_UNSUPPORTED:       return "Unsupported";
+        case EFI_BAD_BUFFER_SIZE:   return "Bad Buffer Size";
+        case EFI_BUFFER_TOO_SMALL:  return "Buffer Too Small";
+        case EFI_NOT_READY:         return "Not Ready";
+        case EFI_DEVICE_ERROR:      return "Device Error";
+        case EFI_WRITE_PROTECTED:   return "Write Protected";
+        case EFI_OUT_OF_RESOURCES:  return "Out of Resources";
+        case EFI_VOLUME_CORRUPTED:  return "Volume Corrupt";
+        case EFI_VOLUME_FULL:       return "Volume Full";
+        case EFI_NO_MEDIA:          return "No Media";
+        case EFI_NOT_FOUND:         return "Not Found";
+        case EFI_ACCESS_DENIED:     return "Access Denied";
+        case EFI_TIMEOUT:           return "Time out";
+        case EFI_NOT_STARTED:       return "Not started";
+        case EFI_ALREADY_STARTED:   return "Already started";
+        case EFI_ABORTED:           return "Aborted";
+        case EFI_END_OF_FILE:       return "End of File";
+        default:                    return NULL;
+    }
+}
+
+static
+VOID ShimPutField (
+    SHIM_OUT    *Out,
+    const char  *Narrow,
+    CONST CHAR16 *Wide,
+    UINTN        Width,
+    BOOLEAN      LeftAlign,
+    CHAR16       Pad
+) {
+    UINTN Len, i;
+
+    Len = Narrow ? strlen (Narrow) : StrLen (Wide);
+    if (!LeftAlign) {
+        for (i = Len; i < Width; i++) {
+            ShimPut (Out, Pad);
+        }
+    }
+    for (i = 0; i < Len; i++) {
+        ShimPut (Out, Narrow ? (CHAR16) (unsigned char) Narrow[i] : Wide[i]);
+    }
+    if (LeftAlign) {
+        for (i = Len; i < Width; i++) {
+            ShimPut (Out, L' ');
+        }
+    }
+}
+
+static
+VOID ShimVFormat (
+    SHIM_OUT     *Out,
+    CONST CHAR16 *fmt,
+    va_list       args
+) {
+    char       Num[64];
+    const char *Str;
+    CHAR16     c;
+    UINTN      Width;
+    BOOLEAN    Long, LeftAlign;
+    CHAR16     Pad;
+    EFI_GUID  *Guid;
+    UINT64     Value;
+
+    while ((c = *fmt++) != 0) {
+        if (c != L'%') {
+            ShimPut (Out, c);
+            continue;
+        }
+
+        Width     = 0;
+        Long      = FALSE;
+        LeftAlign = FALSE;
+        Pad       = L' ';
+        for (;;) {
+            c = *fmt++;
+            if (c == L'-') {
+                LeftAlign = TRUE;
+            }
+            else if (c == L'0' && Width == 0) {
+                Pad = L'0';
+            }
+            else if (c >= L'0' && c <= L'9') {
+                Width = Width * 10 + (c - L'0');
+            }
+            else if (c == L'*') {
+                Width = va_arg (args, UINTN);
+            }
+            else if (c == L'l') {
+                Long = TRUE;
+            }
+            else {
+                break;
+            }
+        } // for
+
+        switch (c) {
+            case 0:
+                return;
+
+            case L's':
+                Str = NULL;
+                {
+                    CHAR16 *Wide = va_arg (args, CHAR16 *);
+                    ShimPutField (Out, Wide ? NULL : "(null)", Wide, Width, LeftAlign, L' ');
+                }
+                break;
+
+            case L'a':
+                Str = va_arg (args, char *);
+                ShimPutField (Out, Str ? Str : "(null)", NULL, Width, LeftAlign, L' ');
+                break;
+
+            case L'c':
+                ShimPut (Out, (CHAR16) va_arg (args, int));
+                break;
+
+            case L'd':
+            case L'i':
+                Value = Long ? (UINT64) va_arg (args, INT64) : (UINT64) (INT64) va_arg (args, int);
+                snprintf (Num, sizeof (Num), "%lld", (long long) (INT64) Value);
+                ShimPutField (Out, Num, NULL, Width, LeftAlign, Pad);
+                break;
+
+            case L'u':
+                Value = Long ? va_arg (args, UINT64) : (UINT64) va_arg (args, unsigned int);
+                snprintf (Num, sizeof (Num), "%llu", (unsigned long long) Value);
+                ShimPutField (Out, Num, NULL, Width, LeftAlign, Pad);
+                break;
+
+            case L'x':
+            case L'X':
+                Value = Long ? va_arg (args, UINT64) : (UINT64) va_arg (args, unsigned int);
+                snprintf (Num, sizeof (Num), (c == L'x') ? "%llx" : "%llX", (unsigned long long) Value);
+                ShimPutField (Out, Num, NULL, Width, LeftAlign, Pad);
+                break;
+
+            case L'p':
+                snprintf (Num, sizeof (Num), "%p", va_arg (args, VOID *));
+                ShimPutField (Out, Num, NULL, Width, LeftAlign, L' ');
+                break;
+
+            case L'r':
+                Value = va_arg (args, EFI_STATUS);
+                Str   = ShimStatusString ((EFI_STATUS) Value);
+                if (Str == NULL) {
+                    snprintf (Num, sizeof (Num), "%llx", (unsigned long long) Value);
+                    Str = Num;
+                }
+                ShimPutField (Out, Str, NULL, Width, LeftAlign, L' ');
+                break;
+
+            case L'g':
+                Guid = va_arg (args, EFI_GUID *);
+                snprintf (
+                    Num, sizeof (Num),
+                    "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+                    Guid->Data1, Guid->Data2, Guid->Data3,
+                    Guid->Data4[0], Guid->Data4[1], Guid->Data4[2], Guid->Data4[3],
+                    Guid->Data4[4], Guid->Data4[5], Guid->Data4[6], Guid->Data4[7]
+                );
+                ShimPutField (Out, Num, NULL, Width, LeftAlign, L' ');
+                break;
+
+            default:
+                ShimPut (Out, c);
+                break;
+        } // switch
+    } // while
+}
+
+static
+CHAR16 * ShimVPoolPrint (CONST CHAR16 *fmt, va_list args) {
+    SHIM_OUT Out;
+
+    Out.Max  = 64;
+    Out.Len  = 0;
+    Out.Grow = TRUE;
+    Out.Buf  = malloc ((Out.Max + 1) * sizeof (CHAR16));
+    if (Out.Buf == NULL) {
+        return NULL;
+    }
+
+    ShimVFormat (&Out, fmt, args);
+    Out.Buf[Out.Len] = 0;
+
+    return Out.Buf;
+}
+
+CHAR16 * PoolPrint (CONST CHAR16 *fmt, ...) {
+    CHAR16  *Result;
+    va_list  args;
+
+    va_start (args, fmt);
+    Result = ShimVPoolPrint (fmt, args);
+    va_end (args);
+
+    return Result;
+}
+
+UINTN SPrint (CHAR16 *Str, UINTN StrSize, CONST CHAR16 *fmt, ...) {
+    SHIM_OUT Out;
+    va_list  args;
+
+    if (StrSize < sizeof (CHAR16)) {
+        return 0;
+    }
+
+    Out.Buf  = Str;
+    Out.Len  = 0;
+    Out.Max  = StrSize / sizeof (CHAR16) - 1;
+    Out.Grow = FALSE;
+
+    va_start (args, fmt);
+    ShimVFormat (&Out, fmt, args);
+    va_end (args);
+    Str[Out.Len] = 0;
+
+    return Out.Len;
+}
+
+UINTN Print (CONST CHAR16 *fmt, ...) {
+    CHAR16  *Text;
+    UINTN    Len;
+    va_list  args;
+
+    va_start (args, fmt);
+    Text = ShimVPoolPrint (fmt, args);
+    va_end (args);
+    if (Text == NULL) {
+        return 0;
+    }
+
+    fputs (ShimNarrow (Text), stdout);
+    Len = StrLen (Text);
+    free (Text);
+
+    return Len;
+}
+
+//
+// Host string helpers
+//
+
+#define SHIM_RING_SIZE  8
+#define SHIM_RING_CHARS 4096
+
+CHAR16 * ShimWide (const char *Narrow) {
+    static CHAR16 Ring[SHIM_RING_SIZE][SHIM_RING_CHARS];
+    static UINTN  Next;
+    CHAR16       *Wide;
+    UINTN         i;
+
+    Wide = Ring[Next++ % SHIM_RING_SIZE];
+    for (i = 0; Narrow[i] != '\0' && i < SHIM_RING_CHARS - 1; i++) {
+        Wide[i] = (CHAR16) (unsigned char) Narrow[i];
+    }
+    Wide[i] = 0;
+
+    return Wide;
+}
+
+// Non-ASCII characters are written as '?'
+char * ShimNarrow (const CHAR16 *Wide) {
+    static char  Ring[SHIM_RING_SIZE][SHIM_RING_CHARS];
+    static UINTN Next;
+    char        *Narrow;
+    UINTN        i;
+
+    Narrow = Ring[Next++ % SHIM_RING_SIZE];
+    for (i = 0; Wide != NULL && Wide[i] != 0 && i < SHIM_RING_CHARS - 1; i++) {
+        Narrow[i] = (Wide[i] < 0x80) ? (char) Wide[i] : '?';
+    }
+    Narrow[i] = '\0';
+
+    return Narrow;
+}
+
+UINT64 ShimNanoseconds (VOID) {
+    struct timespec Now;
+
+    clock_gettime (CLOCK_MONOTONIC, &Now);
+
+    return (UINT64) Now.tv_sec * 1000000000ULL + (UINT64) Now.tv_nsec;
+}
+
+//
+// Directory-backed EFI_FILE_PROTOCOL
+//
+
+typedef struct {
+    EFI_FILE_PROTOCOL   Proto;      // Must be first
+    char               *HostPath;
+    char               *RootPath;
+    FILE               *Fp;
+    BOOLEAN             IsDir;
+    char              **Names;
+    size_t              NameCount;
+    size_t              NextName;
+} SHIM_FILE;
+
+static EFI_FILE_PROTOCOL ShimFileTemplate;
+
+static
+int ShimNameCmp (const void *a, const void *b) {
+    return strcmp (*(char * const *) a, *(char * const *) b);
+}
+
+static
+VOID ShimFreeNames (SHIM_FILE *File) {
+    size_t i;
+
+    for (i = 0; i < File->NameCount; i++) {
+        free (File->Names[i]);
+    }
+    free (File->Names);
+    File->Names     = NULL;
+    File->NameCount = 0;
+    File->NextName  = 0;
+}
+
+static
+VOID ShimLoadNames (SHIM_FILE *File) {
+    DIR           *Dir;
+    struct dirent *Ent;
+    size_t         Max;
+
+    ShimFreeNames (File);
+    Dir = opendir (File->HostPath);
+    if (Dir == NULL) {
+        return;
+    }
+
+    Max = 0;
+    while ((Ent = readdir (Dir)) != NULL) {
+        if (strcmp (Ent->d_name, ".") == 0 || strcmp (Ent->d_name, "..") == 0) {
+            continue;
+        }
+        if (File->NameCount == Max) {
+            Max = Max ? Max * 2 : 16;
+            File->Names = realloc (File->Names, Max * sizeof (char *));
+        }
+        File->Names[File->NameCount++] = strdup (Ent->d_name);
+    }
+    closedir (Dir);
+
+    if (File->NameCount > 1) {
+        qsort (File->Names, File->NameCount, sizeof (char *), ShimNameCmp);
+    }
+}
+
+// Appends Component to Path, matching an existing entry case-insensitively.
+// Returns FALSE if no entry matches, in which case Component is used as is.
+static
+BOOLEAN ShimAppend (char *Path, size_t Max, const char *Component) {
+    struct stat    St;
+    DIR           *Dir;
+    struct dirent *Ent;
+    size_t         Len;
+    BOOLEAN        Found;
+
+    Len = strlen (Path);
+    snprintf (Path + Len, Max - Len, "/%s", Component);
+    if (lstat (Path, &St) == 0) {
+        return TRUE;
+    }
+
+    Path[Len] = '\0';
+    Found = FALSE;
+    Dir   = opendir (Path);
+    if (Dir != NULL) {
+        while (!Found && (Ent = readdir (Dir)) != NULL) {
+            if (strcasecmp (Ent->d_name, Component) == 0) {
+                snprintf (Path + Len, Max - Len, "/%s", Ent->d_name);
+                Found = TRUE;
+            }
+        }
+        closedir (Dir);
+    }
+    if (!Found) {
+        snprintf (Path + Len, Max - Len, "/%s", Component);
+    }
+
+    return Found;
+}
+
+// Resolves FileName against Base. Sets *Exists for the final component.
+// Returns NULL if an intermediate directory does not exist.
+static
+char * ShimResolve (SHIM_FILE *Base, CHAR16 *FileName, BOOLEAN *Exists) {
+    char    Path[4096];
+    char   *Name, *Component, *Save;
+    size_t  RootLen;
+
+    Name = strdup (ShimNarrow (FileName));
+    for (Component = Name; *Component != '\0'; Component++) {
+        if (*Component == '\\') {
+            *Component = '/';
+        }
+    }
+
+    RootLen = strlen (Base->RootPath);
+    snprintf (Path, sizeof (Path), "%s", (Name[0] == '/') ? Base->RootPath : Base->HostPath);
+
+    *Exists = TRUE;
+    Save    = NULL;
+    for (Component = strtok_r (Name, "/", &Save); Component != NULL; Component = strtok_r (NULL, "/", &Save)) {
+        if (!*Exists) {
+            // A directory along the way is missing
+            free (Name);
+            return NULL;
+        }
+
+        if (strcmp (Component, ".") == 0) {
+            continue;
+        }
+        if (strcmp (Component, "..") == 0) {
+            if (strlen (Path) > RootLen) {
+                *strrchr (Path, '/') = '\0';
+            }
+            continue;
+        }
+
+        *Exists = ShimAppend (Path, sizeof (Path), Component);
+    } // for
+    free (Name);
+
+    return strdup (Path);
+}
+
+static
+EFI_FILE_INFO * ShimBuildInfo (const char *HostPath, const char *Name, UINTN *Size) {
+    struct stat    St;
+    struct tm      Tm;
+    EFI_FILE_INFO *Info;
+    CHAR16        *Wide;
+    EFI_TIME       Time;
+
+    if (stat (HostPath, &St) != 0) {
+        return NULL;
+    }
+
+    Wide  = ShimWide (Name);
+    *Size = SIZE_OF_EFI_FILE_INFO + StrSize (Wide);
+    Info  = AllocateZeroPool (*Size);
+    if (Info == NULL) {
+        return NULL;
+    }
+
+    localtime_r (&St.st_mtime, &Tm);
+    memset (&Time, 0, sizeof (Time));
+    Time.Year   = (UINT16) (Tm.tm_year + 1900);
+    Time.Month  = (UINT8) (Tm.tm_mon + 1);
+    Time.Day    = (UINT8) Tm.tm_mday;
+    Time.Hour   = (UINT8) Tm.tm_hour;
+    Time.Minute = (UINT8) Tm.tm_min;
+    Time.Second = (UINT8) Tm.tm_sec;
+
+    Info->Size             = *Size;
+    Info->FileSize         = S_ISDIR (St.st_mode) ? 0 : (UINT64) St.st_size;
+    Info->PhysicalSize     = (UINT64) St.st_blocks * 512;
+    Info->CreateTime       = Time;
+    Info->LastAccessTime   = Time;
+    Info->ModificationTime = Time;
+    Info->Attribute        = S_ISDIR (St.st_mode) ? EFI_FILE_DIRECTORY : 0;
+    memcpy (Info->FileName, Wide, StrSize (Wide));
+
+    return Info;
+}
+
+static
+SHIM_FILE * ShimNewFile (const char *HostPath, const char *RootPath) {
+    struct stat  St;
+    SHIM_FILE   *File;
+
+    if (stat (HostPath, &St) != 0) {
+        return NULL;
+    }
+
+    File = calloc (1, sizeof (SHIM_FILE));
+    if (File == NULL) {
+        return NULL;
+    }
+
+    File->Proto    = ShimFileTemplate;
+    File->HostPath = strdup (HostPath);
+    File->RootPath = strdup (RootPath);
+    File->IsDir    = S_ISDIR (St.st_mode) ? TRUE : FALSE;
+    if (File->IsDir) {
+        ShimLoadNames (File);
+    }
+
+    return File;
+}
+
+static
+EFI_STATUS ShimClose (EFI_FILE_HANDLE Handle) {
+    SHIM_FILE *File = (SHIM_FILE *) Handle;
+
+    if (File->Fp != NULL) {
+        fclose (File->Fp);
+    }
+    ShimFreeNames (File);
+    free (File->HostPath);
+    free (File->RootPath);
+    free (File);
+
+    return EFI_SUCCESS;
+}
+
+static
+EFI_STATUS ShimOpen (
+    EFI_FILE_HANDLE   Handle,
+    EFI_FILE_HANDLE  *NewHandle,
+    CHAR16           *FileName,
+    UINT64            OpenMode,
+    UINT64            Attributes
+) {
+    SHIM_FILE *Base = (SHIM_FILE *) Handle;
+    SHIM_FILE *File;
+    char      *HostPath;
+    FILE      *Fp;
+    BOOLEAN    Exists;
+
+    HostPath = ShimResolve (Base, FileName, &Exists);
+    if (HostPath == NULL) {
+        return EFI_NOT_FOUND;
+    }
+
+    if (!Exists) {
+        if (!(OpenMode & EFI_FILE_MODE_CREATE)) {
+            free (HostPath);
+            return EFI_NOT_FOUND;
+        }
+
+        if (Attributes & EFI_FILE_DIRECTORY) {
+            if (mkdir (HostPath, 0755) != 0) {
+                free (HostPath);
+                return EFI_ACCESS_DENIED;
+            }
+        }
+        else {
+            Fp = fopen (HostPath, "wb");
+            if (Fp == NULL) {
+                free (HostPath);
+                return EFI_ACCESS_DENIED;
+            }
+            fclose (Fp);
+        }
+    }
+
+    File = ShimNewFile (HostPath, Base->RootPath);
+    free (HostPath);
+    if (File == NULL) {
+        return EFI_NOT_FOUND;
+    }
+
+    if (!File->IsDir) {
+        File->Fp = fopen (File->HostPath, (OpenMode & EFI_FILE_MODE_WRITE) ? "r+b" : "rb");
+        if (File->Fp == NULL) {
+            ShimClose (&File->Proto);
+            return EFI_ACCESS_DENIED;
+        }
+    }
+
+    *NewHandle = &File->Proto;
+
+    return EFI_SUCCESS;
+}
+
+static
+EFI_STATUS ShimDelete (EFI_FILE_HANDLE Handle) {
+    SHIM_FILE *File = (SHIM_FILE *) Handle;
+    int        Result;
+
+    Result = File->IsDir ? rmdir (File->HostPath) : unlink (File->HostPath);
+    ShimClose (Handle);
+
+    return (Result == 0) ? EFI_SUCCESS : EFI_ACCESS_DENIED;
+}
+
+static
+EFI_STATUS ShimRead (EFI_FILE_HANDLE Handle, UINTN *BufferSize, VOID *Buffer) {
+    SHIM_FILE     *File = (SHIM_FILE *) Handle;
+    EFI_FILE_INFO *Info;
+    char           ChildPath[4096];
+    UINTN          Size;
+
+    if (!File->IsDir) {
+        *BufferSize = fread (Buffer, 1, *BufferSize, File->Fp);
+        return ferror (File->Fp) ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+    }
+
+    if (File->NextName >= File->NameCount) {
+        *BufferSize = 0;
+        return EFI_SUCCESS;
+    }
+
+    snprintf (ChildPath, sizeof (ChildPath), "%s/%s", File->HostPath, File->Names[File->NextName]);
+    Info = ShimBuildInfo (ChildPath, File->Names[File->NextName], &Size);
+    if (Info == NULL) {
+        // Vanished since the listing was taken ... Skip it
+        File->NextName++;
+        return ShimRead (Handle, BufferSize, Buffer);
+    }
+
+    if (*BufferSize < Size) {
+        *BufferSize = Size;
+        free (Info);
+        return EFI_BUFFER_TOO_SMALL;
+    }
+
+    memcpy (Buffer, Info, Size);
+    *BufferSize = Size;
+    File->NextName++;
+    free (Info);
+
+    return EFI_SUCCESS;
+}
+
+static
+EFI_STATUS ShimWrite (EFI_FILE_HANDLE Handle, UINTN *BufferSize, VOID *Buffer) {
+    SHIM_FILE *File = (SHIM_FILE *) Handle;
+
+    if (File->IsDir) {
+        return EFI_UNSUPPORTED;
+    }
+
+    *BufferSize = fwrite (Buffer, 1, *BufferSize, File->Fp);
+
+    return ferror (File->Fp) ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+}
+
+static
+EFI_STATUS ShimGetPosition (EFI_FILE_HANDLE Handle, UINT64 *Position) {
+    SHIM_FILE *File = (SHIM_FILE *) Handle;
+
+    if (File->IsDir) {
+        return EFI_UNSUPPORTED;
+    }
+
+    *Position = (UINT64) ftello (File->Fp);
+
+    return EFI_SUCCESS;
+}
+
+static
+EFI_STATUS ShimSetPosition (EFI_FILE_HANDLE Handle, UINT64 Position) {
+    SHIM_FILE *File = (SHIM_FILE *) Handle;
+
+    if (File->IsDir) {
+        if (Position != 0) {
+            return EFI_UNSUPPORTED;
+        }
+        File->NextName = 0;
+
+        return EFI_SUCCESS;
+    }
+
+    if (Position == ~(UINT64) 0) {
+        return (fseeko (File->Fp, 0, SEEK_END) == 0) ? EFI_SUCCESS : EFI_DEVICE_ERROR;
+    }
+
+    return (fseeko (File->Fp, (off_t) Position, SEEK_SET) == 0) ? EFI_SUCCESS : EFI_DEVICE_ERROR;
+}
+
+static
+EFI_STATUS ShimGetInfo (
+    EFI_FILE_HANDLE  Handle,
+    EFI_GUID        *InformationType,
+    UINTN           *BufferSize,
+    VOID            *Buffer
+) {
+    SHIM_FILE            *File = (SHIM_FILE *) Handle;
+    EFI_FILE_INFO        *Info;
+    EFI_FILE_SYSTEM_INFO *FsInfo;
+    const char           *Name;
+    CHAR16               *Label;
+    UINTN                 Size;
+
+    if (memcmp (InformationType, &gEfiFileInfoGuid, sizeof (EFI_GUID)) == 0) {
+        if (File->Fp != NULL) {
+            fflush (File->Fp);
+        }
+
+        Name = strrchr (File->HostPath, '/');
+        Name = (Name != NULL && strlen (File->HostPath) > strlen (File->RootPath)) ? Name + 1 : "";
+        Info = ShimBuildInfo (File->HostPath, Name, &Size);
+        if (Info == NULL) {
+            return EFI_DEVICE_ERROR;
+        }
+        if (*BufferSize < Size) {
+            *BufferSize = Size;
+            free (Info);
+            return EFI_BUFFER_TOO_SMALL;
+        }
+        memcpy (Buffer, Info, Size);
+        *BufferSize = Size;
+        free (Info);
+
+        return EFI_SUCCESS;
+    }
+
+    if (memcmp (InformationType, &gEfiFileSystemInfoGuid, sizeof (EFI_GUID)) == 0) {
+        Label = ShimWide ("HOST");
+        Size  = offsetof (EFI_FILE_SYSTEM_INFO, VolumeLabel) + StrSize (Label);
+        if (*BufferSize < Size) {
+            *BufferSize = Size;
+            return EFI_BUFFER_TOO_SMALL;
+        }
+        FsInfo = Buffer;
+        memset (FsInfo, 0, Size);
+        FsInfo->Size      = Size;
+        FsInfo->BlockSize = 512;
+        memcpy (FsInfo->VolumeLabel, Label, StrSize (Label));
+        *BufferSize = Size;
+
+        return EFI_SUCCESS;
+    }
+
+    return EFI_UNSUPPORTED;
+}
+
+static
+EFI_STATUS ShimSetInfo (
+    EFI_FILE_HANDLE  Handle,
+    EFI_GUID        *InformationType,
+    UINTN            BufferSize,
+    VOID            *Buffer
+) {
+    return EFI_SUCCESS;
+}
+
+static
+EFI_STATUS ShimFlush (EFI_FILE_HANDLE Handle) {
+    SHIM_FILE *File = (SHIM_FILE *) Handle;
+
+    if (File->Fp != NULL) {
+        fflush (File->Fp);
+    }
+
+    return EFI_SUCCESS;
+}
+
+static EFI_FILE_PROTOCOL ShimFileTemplate = {
+    0x00010000,
+    ShimOpen,
+    ShimClose,
+    ShimDelete,
+    ShimRead,
+    ShimWrite,
+    ShimGetPosition,
+    ShimSetPosition,
+    ShimGetInfo,
+    ShimSetInfo,
+    ShimFlush
+};
+
+EFI_FILE_HANDLE ShimOpenRoot (const char *HostDir) {
+    SHIM_FILE *File;
+    char      *Root;
+
+    Root = realpath (HostDir, NULL);
+    if (Root == NULL) {
+        return NULL;
+    }
+
+    File = ShimNewFile (Root, Root);
+    free (Root);
+    if (File == NULL || !File->IsDir) {
+        if (File != NULL) {
+            ShimClose (&File->Proto);
+        }
+        return NULL;
+    }
+
+    return &File->Proto;
+}
+
+//
+// GNU-EFI library helpers
+//
+
+static
+VOID * ShimLibInfo (EFI_FILE_HANDLE FHand, EFI_GUID *InfoType) {
+    EFI_STATUS  Status;
+    UINTN       Size;
+    VOID       *Buffer;
+
+    Size   = 0;
+    Status = FHand->GetInfo (FHand, InfoType, &Size, NULL);
+    if (Status != EFI_BUFFER_TOO_SMALL) {
+        return NULL;
+    }
+
+    Buffer = AllocateZeroPool (Size);
+    if (Buffer == NULL) {
+        return NULL;
+    }
+
+    Status = FHand->GetInfo (FHand, InfoType, &Size, Buffer);
+    if (EFI_ERROR(Status)) {
+        FreePool (Buffer);
+        return NULL;
+    }
+
+    return Buffer;
+}
+
+EFI_FILE_INFO * LibFileInfo (EFI_FILE_HANDLE FHand) {
+    return ShimLibInfo (FHand, &gEfiFileInfoGuid);
+}
+
+EFI_FILE_SYSTEM_INFO * LibFileSystemInfo (EFI_FILE_HANDLE FHand) {
+    return ShimLibInfo (FHand, &gEfiFileSystemInfoGuid);
+}
+
+EFI_FILE_HANDLE LibOpenRoot (EFI_HANDLE DeviceHandle) {
+    return NULL;
+}
+
+EFI_STATUS LibLocateHandle (
+    EFI_LOCATE_SEARCH_TYPE   SearchType,
+    EFI_GUID                *Protocol,
+    VOID                    *SearchKey,
+    UINTN                   *NoHandles,
+    EFI_HANDLE             **Buffer
+) {
+    *NoHandles = 0;
+    *Buffer    = NULL;
+
+    return EFI_NOT_FOUND;
+}
+
+UINTN GetDevicePathSize (IN const EFI_DEVICE_PATH *DevicePath) {
+    const EFI_DEVICE_PATH *Start = DevicePath;
+
+    if (DevicePath == NULL) {
+        return 0;
+    }
+
+    while (!IsDevicePathEnd (DevicePath)) {
+        DevicePath = NextDevicePathNode (DevicePath);
+    }
+
+    return (UINTN) ((const UINT8 *) DevicePath - (const UINT8 *) Start) + END_DEVICE_PATH_LENGTH;
+}
+
+EFI_DEVICE_PATH * DevicePathFromHandle (EFI_HANDLE Handle) {
+    return NULL;
+}
+
+EFI_DEVICE_PATH * DuplicateDevicePath (EFI_DEVICE_PATH *DevPath) {
+    if (DevPath == NULL) {
+        return NULL;
+    }
+
+    return AllocateCopyPool (GetDevicePathSize (DevPath), DevPath);
+}
+
+EFI_DEVICE_PATH * FileDevicePath (EFI_HANDLE Device, CHAR16 *FileName) {
+    return NULL;
+}
+
+CHAR16 * DevicePathToStr (EFI_DEVICE_PATH *DevPath) {
+    return StrDuplicate (L"");
+}
+
+//
+// Service tables
+//
+
+static
+EFI_STATUS ShimGetTime (EFI_TIME *Time, VOID *Capabilities) {
+    time_t    Now;
+    struct tm Tm;
+
+    Now = time (NULL);
+    localtime_r (&Now, &Tm);
+    memset (Time, 0, sizeof (EFI_TIME));
+    Time->Year   = (UINT16) (Tm.tm_year + 1900);
+    Time->Month  = (UINT8) (Tm.tm_mon + 1);
+    Time->Day    = (UINT8) Tm.tm_mday;
+    Time->Hour   = (UINT8) Tm.tm_hour;
+    Time->Minute = (UINT8) Tm.tm_min;
+    Time->Second = (UINT8) Tm.tm_sec;
+
+    return EFI_SUCCESS;
+}
+
+static
+EFI_STATUS ShimGetVariable (CHAR16 *Name, EFI_GUID *Guid, UINT32 *Attributes, UINTN *DataSize, VOID *Data) {
+    return EFI_NOT_FOUND;
+}
+
+static
+EFI_STATUS ShimSetVariable (CHAR16 *Name, EFI_GUID *Guid, UINT32 Attributes, UINTN DataSize, VOID *Data) {
+    return EFI_UNSUPPORTED;
+}
+
+static
+EFI_STATUS ShimWaitForEvent (UINTN NumberOfEvents, EFI_EVENT *Event, UINTN *Index) {
+    *Index = 0;
+
+    return EFI_SUCCESS;
+}
+
+static
+EFI_STATUS ShimHandleProtocol (EFI_HANDLE Handle, EFI_GUID *Protocol, VOID **Interface) {
+    return EFI_UNSUPPORTED;
+}
+
+static
+EFI_STATUS ShimLocateDevicePath (EFI_GUID *Protocol, EFI_DEVICE_PATH **DevicePath, EFI_HANDLE *Device) {
+    return EFI_NOT_FOUND;
+}
+
+static
+EFI_STATUS ShimLocateHandleBuffer (
+    EFI_LOCATE_SEARCH_TYPE   SearchType,
+    EFI_GUID                *Protocol,
+    VOID                    *SearchKey,
+    UINTN                   *NoHandles,
+    EFI_HANDLE             **Buffer
+) {
+    return LibLocateHandle (SearchType, Protocol, SearchKey, NoHandles, Buffer);
+}
+
+static
+EFI_STATUS ShimLocateProtocol (EFI_GUID *Protocol, VOID *Registration, VOID **Interface) {
+    return EFI_NOT_FOUND;
+}
+
+static
+EFI_STATUS ShimReset (SIMPLE_INPUT_INTERFACE *This, BOOLEAN ExtendedVerification) {
+    return EFI_SUCCESS;
+}
+
+static
+EFI_STATUS ShimReadKeyStroke (SIMPLE_INPUT_INTERFACE *This, EFI_INPUT_KEY *Key) {
+    return EFI_NOT_READY;
+}
+
+static EFI_RUNTIME_SERVICES   ShimRT    = { ShimGetTime, ShimGetVariable, ShimSetVariable };
+static EFI_BOOT_SERVICES      ShimBS    = {
+    ShimWaitForEvent, ShimHandleProtocol, ShimLocateDevicePath,
+    ShimLocateHandleBuffer, ShimLocateProtocol
+};
+static SIMPLE_INPUT_INTERFACE ShimConIn = { ShimReset, ShimReadKeyStroke, NULL };
+static EFI_SYSTEM_TABLE       ShimST    = { &ShimConIn, &ShimRT, &ShimBS };
+
+EFI_SYSTEM_TABLE     *ST = &ShimST;
+EFI_BOOT_SERVICES    *BS = &ShimBS;
+EFI_RUNTIME_SERVICES *RT = &ShimRT;
+
+/* EOF */
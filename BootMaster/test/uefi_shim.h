@@ -0,0 +1,41 @@
+/*
+ * BootMaster/test/uefi_shim.h
+ * Host-only helpers provided alongside the UEFI stand-ins
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __HOST_UEFI_SHIM_H_
+#define __HOST_UEFI_SHIM_H_
+
+#include "efi.h"
+
+// Opens a host directory as the root of an EFI_FILE_PROTOCOL tree.
+// Paths are resolved case-insensitively, as on FAT, and directory
+// entries are returned in name order so that runs are repeatable.
+EFI_FILE_HANDLE ShimOpenRoot (const char *HostDir);
+
+// Converts between host UTF-8 and CHAR16 strings in static rotating buffers.
+CHAR16 * ShimWide (const char *Narrow);
+char   * ShimNarrow (const CHAR16 *Wide);
+
+// Monotonic clock in nanoseconds for the benchmarks
+UINT64 ShimNanoseconds (VOID);
+
+#endif
+
+/* EOF */
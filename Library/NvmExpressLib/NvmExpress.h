@@ -65,8 +65,14 @@ extern EFI_DRIVER_SUPPORTED_EFI_VERSION_PROTOCOL  gNvmExpressDriverSupportedEfiV
 #define NVME_ASQ_SIZE                             1     // Number of admin submission queue entries, which is 0-based
 #define NVME_ACQ_SIZE                             1     // Number of admin completion queue entries, which is 0-based
 
-#define NVME_CSQ_SIZE                             1     // Number of I/O submission queue entries, which is 0-based
-#define NVME_CCQ_SIZE                             1     // Number of I/O completion queue entries, which is 0-based
+#define NVME_CSQ_SIZE                             15    // Number of I/O submission queue entries, which is 0-based
+#define NVME_CCQ_SIZE                             15    // Number of I/O completion queue entries, which is 0-based
+
+// Maximum number of read commands kept in flight on the synchronous I/O queue
+// by NvmeRead. This must not exceed NVME_CSQ_SIZE. Set to 1 to fall back to
+// issuing one command at a time, for instance when comparing throughput under
+// an emulated controller such as QEMU's '-device nvme'.
+#define NVME_SYNC_READ_DEPTH                      8
 
 // Number of asynchronous I/O submission queue entries, which is 0-based.
 // The asynchronous I/O submission queue size is 4kB in total.
@@ -571,6 +577,33 @@ EFI_STATUS EFIAPI NvmExpressPassThru (
     IN     EFI_EVENT                                    Event OPTIONAL
 );
 
+/**
+  Sends several blocking NVM I/O command packets to the synchronous I/O queue
+  together. All commands are placed in the submission queue before a single
+  doorbell write, and their completions are then reaped together.
+
+  Only I/O queue commands that transfer data through TransferBuffer are supported.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+  @param[in]     NamespaceId         The namespace ID to which the command packets will be sent.
+  @param[in,out] Packets             An array of pointers to NVM Express Command Packets.
+  @param[in]     PacketCount         The number of entries in Packets. Must not exceed NVME_CSQ_SIZE.
+
+  @retval EFI_SUCCESS                All command packets were executed successfully.
+  @retval EFI_INVALID_PARAMETER      A command packet is invalid or PacketCount is too large.
+                                     No commands were sent.
+  @retval EFI_OUT_OF_RESOURCES       A data buffer could not be mapped. No commands were sent.
+  @retval EFI_DEVICE_ERROR           At least one command packet completed with an error.
+  @retval EFI_TIMEOUT                A timeout occurred while waiting for the command packets to execute.
+
+**/
+EFI_STATUS NvmePipelinedPassThru (
+    IN     NVME_CONTROLLER_PRIVATE_DATA                *Private,
+    IN     UINT32                                       NamespaceId,
+    IN OUT EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET   **Packets,
+    IN     UINTN                                        PacketCount
+);
+
 /**
   Used to retrieve the next namespace ID for this NVM Express controller.
 
@@ -146,6 +146,11 @@ EFI_STATUS WriteSectors (
 /**
   Read some blocks from the device.
 
+  The request is split into chunks of at most the controller's maximum data
+  transfer size. Up to NVME_SYNC_READ_DEPTH chunks are submitted together on
+  the synchronous I/O queue and their completions reaped as a batch, so that
+  large reads do not run at a queue depth of one.
+
   @param  Device                 The pointer to the NVME_DEVICE_PRIVATE_DATA data structure.
   @param  Buffer                 The buffer used to store the data read from the device.
   @param  Lba                    The start block number.
@@ -161,12 +166,19 @@ EFI_STATUS NvmeRead (
     IN     UINT64                          Lba,
     IN     UINTN                           Blocks
 ) {
-    EFI_STATUS                        Status;
-    UINT32                            BlockSize;
-    NVME_CONTROLLER_PRIVATE_DATA     *Private;
-    UINT32                            MaxTransferBlocks;
-    BOOLEAN                           IsEmpty;
-    EFI_TPL                           OldTpl;
+    EFI_STATUS                                 Status;
+    UINT32                                     BlockSize;
+    NVME_CONTROLLER_PRIVATE_DATA              *Private;
+    UINT32                                     MaxTransferBlocks;
+    UINT32                                     ChunkBlocks;
+    UINTN                                      Depth;
+    UINTN                                      Count;
+    BOOLEAN                                    IsEmpty;
+    EFI_TPL                                    OldTpl;
+    EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET   CommandPacket[NVME_SYNC_READ_DEPTH];
+    EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET  *Packets[NVME_SYNC_READ_DEPTH];
+    EFI_NVM_EXPRESS_COMMAND                    Command[NVME_SYNC_READ_DEPTH];
+    EFI_NVM_EXPRESS_COMPLETION                 Completion[NVME_SYNC_READ_DEPTH];
 
     // Wait for the device's asynchronous I/O queue to become empty.
     while (TRUE) {
@@ -192,18 +204,54 @@ EFI_STATUS NvmeRead (
         MaxTransferBlocks = 1024;
     }
 
-    while (Blocks > 0) {
-        if (Blocks > MaxTransferBlocks) {
-            Status  = ReadSectors (Device, (UINT64) (UINTN) Buffer, Lba, MaxTransferBlocks);
-            Blocks -= MaxTransferBlocks;
-            Buffer  = (VOID *) (UINTN) ((UINT64) (UINTN) Buffer + MaxTransferBlocks * BlockSize);
-            Lba    += MaxTransferBlocks;
+    // Keep at least one submission queue slot free.
+    Depth = MIN(NVME_SYNC_READ_DEPTH, MIN(NVME_CSQ_SIZE, Private->Cap.Mqes));
+    if (Depth <= 1 || Blocks <= MaxTransferBlocks) {
+        while (Blocks > 0) {
+            ChunkBlocks = (Blocks > MaxTransferBlocks) ? MaxTransferBlocks : (UINT32) Blocks;
+            Status = ReadSectors (Device, (UINT64) (UINTN) Buffer, Lba, ChunkBlocks);
+            if (EFI_ERROR(Status)) {
+                break;
+            }
+
+            Blocks -= ChunkBlocks;
+            Buffer  = (VOID *) (UINTN) ((UINT64) (UINTN) Buffer + (UINT64) ChunkBlocks * BlockSize);
+            Lba    += ChunkBlocks;
         }
-        else {
-            Status = ReadSectors (Device, (UINT64) (UINTN) Buffer, Lba, (UINT32) Blocks);
-            Blocks = 0;
+
+        return Status;
+    }
+
+    while (Blocks > 0) {
+        ZeroMem (CommandPacket, sizeof (CommandPacket));
+        ZeroMem (Command,       sizeof (Command));
+        ZeroMem (Completion,    sizeof (Completion));
+
+        for (Count = 0; (Count < Depth) && (Blocks > 0); Count++) {
+            ChunkBlocks = (Blocks > MaxTransferBlocks) ? MaxTransferBlocks : (UINT32) Blocks;
+
+            CommandPacket[Count].NvmeCmd        = &Command[Count];
+            CommandPacket[Count].NvmeCompletion = &Completion[Count];
+            CommandPacket[Count].TransferBuffer = Buffer;
+            CommandPacket[Count].TransferLength = ChunkBlocks * BlockSize;
+            CommandPacket[Count].CommandTimeout = NVME_GENERIC_TIMEOUT;
+            CommandPacket[Count].QueueType      = NVME_IO_QUEUE;
+
+            Command[Count].Cdw0.Opcode = NVME_IO_READ_OPC;
+            Command[Count].Nsid        = Device->NamespaceId;
+            Command[Count].Cdw10       = (UINT32) Lba;
+            Command[Count].Cdw11       = (UINT32) RShiftU64 (Lba, 32);
+            Command[Count].Cdw12       = (ChunkBlocks - 1) & 0xFFFF;
+            Command[Count].Flags       = CDW10_VALID | CDW11_VALID | CDW12_VALID;
+
+            Packets[Count] = &CommandPacket[Count];
+
+            Blocks -= ChunkBlocks;
+            Buffer  = (VOID *) (UINTN) ((UINT64) (UINTN) Buffer + (UINT64) ChunkBlocks * BlockSize);
+            Lba    += ChunkBlocks;
         }
 
+        Status = NvmePipelinedPassThru (Private, Device->NamespaceId, Packets, Count);
         if (EFI_ERROR(Status)) {
             break;
         }
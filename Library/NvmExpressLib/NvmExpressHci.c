@@ -558,7 +558,12 @@ EFI_STATUS NvmeCreateIoCompletionQueue (
         CommandPacket.QueueType      = NVME_ADMIN_QUEUE;
 
         if (Index == 1) {
-            QueueSize = NVME_CCQ_SIZE;
+            if (Private->Cap.Mqes > NVME_CCQ_SIZE) {
+                QueueSize = NVME_CCQ_SIZE;
+            }
+            else {
+                QueueSize = Private->Cap.Mqes;
+            }
         }
         else {
             if (Private->Cap.Mqes > NVME_ASYNC_CCQ_SIZE) {
@@ -631,7 +636,12 @@ EFI_STATUS NvmeCreateIoSubmissionQueue (
         CommandPacket.QueueType      = NVME_ADMIN_QUEUE;
 
         if (Index == 1) {
-            QueueSize = NVME_CSQ_SIZE;
+            if (Private->Cap.Mqes > NVME_CSQ_SIZE) {
+                QueueSize = NVME_CSQ_SIZE;
+            }
+            else {
+                QueueSize = Private->Cap.Mqes;
+            }
         }
         else {
             if (Private->Cap.Mqes > NVME_ASYNC_CSQ_SIZE) {
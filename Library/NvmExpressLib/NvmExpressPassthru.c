@@ -519,6 +519,12 @@ EFI_STATUS EFIAPI NvmExpressPassThru (
             Private->SqTdbl[QueueId].Sqt =
             (Private->SqTdbl[QueueId].Sqt + 1) % QueueSize;
         }
+        else if (QueueId == 1) {
+            // The synchronous I/O queue holds more than two entries
+            // so that NvmePipelinedPassThru can batch commands on it.
+            Private->SqTdbl[QueueId].Sqt =
+            (Private->SqTdbl[QueueId].Sqt + 1) % (MIN(NVME_CSQ_SIZE, Private->Cap.Mqes) + 1);
+        }
         else {
             Private->SqTdbl[QueueId].Sqt ^= 1;
         }
@@ -641,7 +647,14 @@ EFI_STATUS EFIAPI NvmExpressPassThru (
             break;
         }
 
-        if ((Private->CqHdbl[QueueId].Cqh ^= 1) == 0) {
+        if (QueueId == 1) {
+            Private->CqHdbl[QueueId].Cqh++;
+            if (Private->CqHdbl[QueueId].Cqh > MIN(NVME_CCQ_SIZE, Private->Cap.Mqes)) {
+                Private->CqHdbl[QueueId].Cqh = 0;
+                Private->Pt[QueueId] ^= 1;
+            }
+        }
+        else if ((Private->CqHdbl[QueueId].Cqh ^= 1) == 0) {
             Private->Pt[QueueId] ^= 1;
         }
 
@@ -701,6 +714,329 @@ EFI_STATUS EFIAPI NvmExpressPassThru (
     return Status;
 }
 
+/**
+  Sends several blocking NVM I/O command packets to the synchronous I/O queue
+  together. All commands are placed in the submission queue before a single
+  doorbell write, and their completions are then reaped together.
+
+  Only I/O queue commands that transfer data through TransferBuffer are supported.
+
+  @param[in]     Private             The pointer to the NVME_CONTROLLER_PRIVATE_DATA data structure.
+  @param[in]     NamespaceId         The namespace ID to which the command packets will be sent.
+  @param[in,out] Packets             An array of pointers to NVM Express Command Packets.
+  @param[in]     PacketCount         The number of entries in Packets. Must not exceed NVME_CSQ_SIZE.
+
+  @retval EFI_SUCCESS                All command packets were executed successfully.
+  @retval EFI_INVALID_PARAMETER      A command packet is invalid or PacketCount is too large.
+                                     No commands were sent.
+  @retval EFI_OUT_OF_RESOURCES       A data buffer could not be mapped. No commands were sent.
+  @retval EFI_DEVICE_ERROR           At least one command packet completed with an error.
+  @retval EFI_TIMEOUT                A timeout occurred while waiting for the command packets to execute.
+
+**/
+EFI_STATUS NvmePipelinedPassThru (
+    IN     NVME_CONTROLLER_PRIVATE_DATA                *Private,
+    IN     UINT32                                       NamespaceId,
+    IN OUT EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET   **Packets,
+    IN     UINTN                                        PacketCount
+) {
+    EFI_STATUS                                 Status;
+    EFI_STATUS                                 PreviousStatus;
+    EFI_PCI_IO_PROTOCOL                       *PciIo;
+    EFI_NVM_EXPRESS_PASS_THRU_COMMAND_PACKET  *Packet;
+    NVME_SQ                                   *Sq;
+    NVME_CQ                                   *Cq;
+    UINT16                                     QueueSize;
+    UINT16                                     Cid[NVME_CSQ_SIZE];
+    UINT16                                     Offset;
+    UINT32                                     Bytes;
+    UINT32                                     Data;
+    UINT32                                     IoAlign;
+    UINT32                                     MaxTransLen;
+    UINTN                                      Index;
+    UINTN                                      Submitted;
+    UINTN                                      Reaped;
+    UINTN                                      MapLength;
+    UINTN                                      PrpListNo[NVME_CSQ_SIZE];
+    VOID                                      *MapData[NVME_CSQ_SIZE];
+    VOID                                      *MapPrpList[NVME_CSQ_SIZE];
+    VOID                                      *PrpListHost[NVME_CSQ_SIZE];
+    UINT64                                    *Prp[NVME_CSQ_SIZE];
+    EFI_PHYSICAL_ADDRESS                       PhyAddr;
+    EFI_PCI_IO_PROTOCOL_OPERATION              Flag;
+    EFI_EVENT                                  TimerEvent;
+
+    QueueSize = MIN(NVME_CSQ_SIZE, Private->Cap.Mqes) + 1;
+    if (PacketCount == 0 || PacketCount >= QueueSize) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    IoAlign     = Private->Passthru.Mode->IoAlign;
+    MaxTransLen = (Private->ControllerData->Mdts != 0)
+        ? (1 << (Private->ControllerData->Mdts)) * (1 << (Private->Cap.Mpsmin + 12))
+        : MAX_UINT32;
+
+    // Validate all packets up front so that either all or none are sent.
+    for (Index = 0; Index < PacketCount; Index++) {
+        Packet = Packets[Index];
+        if ((Packet == NULL)                                 ||
+            (Packet->NvmeCmd == NULL)                        ||
+            (Packet->NvmeCompletion == NULL)                 ||
+            (Packet->QueueType != NVME_IO_QUEUE)             ||
+            (Packet->NvmeCmd->Nsid != NamespaceId)           ||
+            (Packet->TransferBuffer == NULL)                 ||
+            (Packet->TransferLength == 0)                    ||
+            (Packet->TransferLength > MaxTransLen)           ||
+            (Packet->MetadataLength != 0)                    ||
+            ((Packet->NvmeCmd->Cdw0.Opcode & (BIT0 | BIT1)) == 0) ||
+            (IoAlign > 0 && (((UINTN) Packet->TransferBuffer & (IoAlign - 1)) != 0))
+        ) {
+            return EFI_INVALID_PARAMETER;
+        }
+    }
+
+    PciIo      = Private->PciIo;
+    TimerEvent = NULL;
+    Submitted  = 0;
+    Reaped     = 0;
+    Status     = EFI_SUCCESS;
+    ZeroMem (MapData,     sizeof (MapData));
+    ZeroMem (MapPrpList,  sizeof (MapPrpList));
+    ZeroMem (PrpListHost, sizeof (PrpListHost));
+    ZeroMem (PrpListNo,   sizeof (PrpListNo));
+    ZeroMem (Prp,         sizeof (Prp));
+
+    // Fill the submission queue.
+    for (Index = 0; Index < PacketCount; Index++) {
+        Packet = Packets[Index];
+        Sq     = Private->SqBuffer[1] + Private->SqTdbl[1].Sqt;
+
+        Flag = ((Packet->NvmeCmd->Cdw0.Opcode & BIT0) != 0)
+            ? EfiPciIoOperationBusMasterRead
+            : EfiPciIoOperationBusMasterWrite;
+
+        MapLength = Packet->TransferLength;
+        Status = PciIo->Map (
+            PciIo,
+            Flag,
+            Packet->TransferBuffer,
+            &MapLength,
+            &PhyAddr,
+            &MapData[Index]
+        );
+        if (EFI_ERROR (Status) || (Packet->TransferLength != MapLength)) {
+            Status = EFI_OUT_OF_RESOURCES;
+            break;
+        }
+
+        ZeroMem (Sq, sizeof (NVME_SQ));
+        Sq->Opc    = (UINT8) Packet->NvmeCmd->Cdw0.Opcode;
+        Sq->Fuse   = (UINT8) Packet->NvmeCmd->Cdw0.FusedOperation;
+        Sq->Cid    = Private->Cid[1]++;
+        Sq->Nsid   = Packet->NvmeCmd->Nsid;
+        Sq->Prp[0] = PhyAddr;
+        Sq->Prp[1] = 0;
+        Cid[Index] = Sq->Cid;
+
+        // If the buffer size spans more than two memory pages (page size as defined in CC.Mps),
+        // then build a PRP list in the second PRP submission queue entry.
+        Offset = ((UINT16) Sq->Prp[0]) & (EFI_PAGE_SIZE - 1);
+        Bytes  = Packet->TransferLength;
+
+        if ((Offset + Bytes) > (EFI_PAGE_SIZE * 2)) {
+            PhyAddr = (Sq->Prp[0] + EFI_PAGE_SIZE) & ~(EFI_PAGE_SIZE - 1);
+            Prp[Index] = NvmeCreatePrpList (
+                PciIo,
+                PhyAddr,
+                EFI_SIZE_TO_PAGES(Offset + Bytes) - 1,
+                &PrpListHost[Index],
+                &PrpListNo[Index],
+                &MapPrpList[Index]
+            );
+            if (Prp[Index] == NULL) {
+                Status = EFI_OUT_OF_RESOURCES;
+                break;
+            }
+
+            Sq->Prp[1] = (UINT64) (UINTN) Prp[Index];
+        }
+        else if ((Offset + Bytes) > EFI_PAGE_SIZE) {
+            Sq->Prp[1] = (Sq->Prp[0] + EFI_PAGE_SIZE) & ~(EFI_PAGE_SIZE - 1);
+        }
+
+        if (Packet->NvmeCmd->Flags & CDW10_VALID) {
+            Sq->Payload.Raw.Cdw10 = Packet->NvmeCmd->Cdw10;
+        }
+        if (Packet->NvmeCmd->Flags & CDW11_VALID) {
+            Sq->Payload.Raw.Cdw11 = Packet->NvmeCmd->Cdw11;
+        }
+        if (Packet->NvmeCmd->Flags & CDW12_VALID) {
+            Sq->Payload.Raw.Cdw12 = Packet->NvmeCmd->Cdw12;
+        }
+        if (Packet->NvmeCmd->Flags & CDW13_VALID) {
+            Sq->Payload.Raw.Cdw13 = Packet->NvmeCmd->Cdw13;
+        }
+        if (Packet->NvmeCmd->Flags & CDW14_VALID) {
+            Sq->Payload.Raw.Cdw14 = Packet->NvmeCmd->Cdw14;
+        }
+        if (Packet->NvmeCmd->Flags & CDW15_VALID) {
+            Sq->Payload.Raw.Cdw15 = Packet->NvmeCmd->Cdw15;
+        }
+
+        Private->SqTdbl[1].Sqt = (Private->SqTdbl[1].Sqt + 1) % QueueSize;
+        Submitted++;
+    } // for
+
+    if (EFI_ERROR(Status)) {
+        // Unwind entries that were written but not announced to the controller.
+        Private->SqTdbl[1].Sqt = (UINT16) ((Private->SqTdbl[1].Sqt + QueueSize - Submitted) % QueueSize);
+        Submitted = 0;
+    }
+
+    do {
+        if (Submitted == 0) {
+            break;
+        }
+
+        // Ring the submission queue doorbell once for the whole batch.
+        Data = ReadUnaligned32 ((UINT32*) &Private->SqTdbl[1]);
+        Status = PciIo->Mem.Write (
+            PciIo,
+            EfiPciIoWidthUint32,
+            NVME_BAR,
+            NVME_SQTDBL_OFFSET(1, Private->Cap.Dstrd),
+            1,
+            &Data
+        );
+        if (EFI_ERROR (Status)) {
+            break;
+        }
+
+        Status = NVME_CALL_5_WRAPPER(
+            gBS->CreateEvent, EVT_TIMER,
+            TPL_CALLBACK, NULL,
+            NULL, &TimerEvent
+        );
+        if (EFI_ERROR (Status)) {
+            break;
+        }
+
+        Status = NVME_CALL_3_WRAPPER(
+            gBS->SetTimer, TimerEvent,
+            TimerRelative, Packets[0]->CommandTimeout
+        );
+        if (EFI_ERROR(Status)) {
+            break;
+        }
+
+        // Reap completions in whatever order the controller posts them.
+        PreviousStatus = EFI_SUCCESS;
+        while (Reaped < Submitted) {
+            Cq = Private->CqBuffer[1] + Private->CqHdbl[1].Cqh;
+            if (Cq->Pt == Private->Pt[1]) {
+                if (!EFI_ERROR(NVME_CALL_1_WRAPPER(gBS->CheckEvent, TimerEvent))) {
+                    break;
+                }
+
+                continue;
+            }
+
+            for (Index = 0; Index < Submitted; Index++) {
+                if (Cid[Index] == Cq->Cid) {
+                    CopyMem (
+                        Packets[Index]->NvmeCompletion,
+                        Cq,
+                        sizeof (EFI_NVM_EXPRESS_COMPLETION)
+                    );
+
+                    break;
+                }
+            }
+
+            if ((Cq->Sct != 0) || (Cq->Sc != 0)) {
+                PreviousStatus = EFI_DEVICE_ERROR;
+            }
+
+            Private->CqHdbl[1].Cqh++;
+            if (Private->CqHdbl[1].Cqh > MIN(NVME_CCQ_SIZE, Private->Cap.Mqes)) {
+                Private->CqHdbl[1].Cqh = 0;
+                Private->Pt[1] ^= 1;
+            }
+
+            Reaped++;
+        } // while
+
+        if (Reaped < Submitted) {
+            // Disable the timer to trigger the process of async transfers temporarily.
+            Status = NVME_CALL_3_WRAPPER(
+                gBS->SetTimer, Private->TimerEvent,
+                TimerCancel, 0
+            );
+            if (EFI_ERROR (Status)) {
+                break;
+            }
+
+            // Reset the NVMe controller.
+            Status = NvmeControllerInit (Private);
+            if (!EFI_ERROR (Status)) {
+                Status = AbortAsyncPassThruTasks (Private);
+                if (!EFI_ERROR (Status)) {
+                    // Re-enable the timer to trigger the process of async transfers.
+                    Status = NVME_CALL_3_WRAPPER(
+                        gBS->SetTimer, Private->TimerEvent,
+                        TimerPeriodic, NVME_HC_ASYNC_TIMER
+                    );
+
+                    if (!EFI_ERROR (Status)) {
+                        // Return EFI_TIMEOUT to indicate a timeout occurs for NVMe PassThru command.
+                        Status = EFI_TIMEOUT;
+                    }
+                }
+            }
+            else {
+                Status = EFI_DEVICE_ERROR;
+            }
+
+            break;
+        }
+
+        // Release all reaped completion queue entries with one doorbell write.
+        Data = ReadUnaligned32 ((UINT32*) &Private->CqHdbl[1]);
+        Status = PciIo->Mem.Write (
+            PciIo,
+            EfiPciIoWidthUint32,
+            NVME_BAR,
+            NVME_CQHDBL_OFFSET(1, Private->Cap.Dstrd),
+            1,
+            &Data
+        );
+
+        // The return status of PciIo->Mem.Write should not override
+        // previous status if previous status contains error.
+        Status = EFI_ERROR(PreviousStatus) ? PreviousStatus : Status;
+    } while (0); // This 'loop' only runs once
+
+    for (Index = 0; Index < PacketCount; Index++) {
+        if (MapData[Index] != NULL) {
+            PciIo->Unmap (PciIo, MapData[Index]);
+        }
+
+        if (MapPrpList[Index] != NULL) {
+            PciIo->Unmap (PciIo, MapPrpList[Index]);
+        }
+
+        if (Prp[Index] != NULL) {
+            PciIo->FreeBuffer (PciIo, PrpListNo[Index], PrpListHost[Index]);
+        }
+    }
+
+    if (TimerEvent != NULL) {
+        NVME_CALL_1_WRAPPER(gBS->CloseEvent, TimerEvent);
+    }
+
+    return Status;
+}
+
 /**
   Used to retrieve the next namespace ID for this NVM Express controller.
 
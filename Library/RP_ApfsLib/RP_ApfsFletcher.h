@@ -0,0 +1,100 @@
+/** @file
+Copyright (C) 2020, vit9696. All rights reserved.
+
+Modified 2021, Dayo Akanji. (sf.net/u/dakanji/profile)
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+/**
+  APFS object checksum, kept in a header so that the BootMaster host tests
+  can check it against the plain Fletcher-64 loop. Include it in one source
+  file after RP_ApfsInternal.h, which supplies APFS_MOD_MAX_UINT32 and the
+  block size limits.
+**/
+
+#ifndef RP_APFS_FLETCHER_H
+#define RP_APFS_FLETCHER_H
+
+static
+UINT64 ApfsFletcher64 (
+  VOID    *Data,
+  UINTN   DataSize
+  )
+{
+  UINT32        *Walker;
+  UINT32        *WalkerEnd;
+  UINT32        *RoundEnd;
+  UINT64        Sum1;
+  UINT64        Sum2;
+  UINT64        Word0;
+  UINT64        Word1;
+  UINT64        Word2;
+  UINT64        Word3;
+  UINT32        Rem;
+
+  // For APFS we have the following guarantees (checked outside).
+  // - DataSize is always divisible by 4 (UINT32), the only potential exceptions
+  //   are multiples of block sizes of 1 and 2, which we do not support and filter out.
+  // - DataSize is always between 0x1000-8 and 0x10000-8, i.e. within UINT16.
+  ASSERT (DataSize >= APFS_NX_MINIMUM_BLOCK_SIZE - sizeof (UINT64));
+  ASSERT (DataSize <= APFS_NX_MAXIMUM_BLOCK_SIZE - sizeof (UINT64));
+  ASSERT (DataSize % sizeof (UINT32) == 0);
+
+  Sum1 = 0;
+  Sum2 = 0;
+
+  Walker     = Data;
+  WalkerEnd  = Walker + DataSize / sizeof (UINT32);
+  RoundEnd   = Walker + (DataSize / sizeof (UINT32) & ~(UINTN) 3);
+
+  // Fold four words per round. Four scalar rounds starting from Sum1 add
+  // 4 * Sum1 + 4 * W0 + 3 * W1 + 2 * W2 + W3 to Sum2 and W0 + W1 + W2 + W3
+  // to Sum1, so both halves are bit-exact with the scalar rounds below and
+  // stay within the same bounds, while the loads and products can overlap.
+  while (Walker < RoundEnd) {
+    Word0 = Walker[0];
+    Word1 = Walker[1];
+    Word2 = Walker[2];
+    Word3 = Walker[3];
+
+    Sum2 += (Sum1 << 2) + (Word0 << 2) + Word1 * 3 + (Word2 << 1) + Word3;
+    Sum1 += Word0 + Word1 + Word2 + Word3;
+    Walker += 4;
+  }
+
+  // Do usual Fletcher-64 rounds without modulo due to impossible overflow.
+  while (Walker < WalkerEnd) {
+    // Sum1 never overflows, because 0xFFFFFFFF * (0x10000-8) < MAX_UINT64.
+    // This is just a normal sum of data values.
+    Sum1 += *Walker;
+
+    // Sum2 never overflows, because 0xFFFFFFFF * (0x4000-1) * 0x1FFF < MAX_UINT64.
+    // This is just a normal arithmetical progression of sums.
+    Sum2 += Sum1;
+    ++Walker;
+  }
+
+  // Split Fletcher-64 halves.
+  // As per Chinese remainder theorem, perform the modulo now.
+  // No overflows also possible as seen from Sum1/Sum2 upper bounds above.
+  Sum2 += Sum1;
+  APFS_MOD_MAX_UINT32 (Sum2, &Rem);
+  Sum2  = ~Rem;
+
+  Sum1 += Sum2;
+  APFS_MOD_MAX_UINT32 (Sum1, &Rem);
+  Sum1  = ~Rem;
+
+  return (Sum1 << 32U) | Sum2;
+}
+
+#endif // RP_APFS_FLETCHER_H
@@ -54,11 +54,20 @@ RamDiskInitBlockIo (
   EFI_BLOCK_IO_PROTOCOL           *BlockIo;
   EFI_BLOCK_IO2_PROTOCOL          *BlockIo2;
   EFI_BLOCK_IO_MEDIA              *Media;
+  UINT64                          DiskSize;
 
   BlockIo  = &PrivateData->BlockIo;
   BlockIo2 = &PrivateData->BlockIo2;
   Media    = &PrivateData->Media;
 
+  //
+  // A compressed RAM disk is larger than the container it is registered with
+  //
+  DiskSize = PrivateData->Size;
+  if (PrivateData->Compressed != NULL) {
+    DiskSize = PrivateData->Compressed->DiskSize;
+  }
+
   CopyMem (BlockIo, &mRamDiskBlockIoTemplate, sizeof (EFI_BLOCK_IO_PROTOCOL));
   CopyMem (BlockIo2, &mRamDiskBlockIo2Template, sizeof (EFI_BLOCK_IO2_PROTOCOL));
 
@@ -71,7 +80,7 @@ RamDiskInitBlockIo (
   Media->WriteCaching     = FALSE;
   Media->BlockSize        = RAM_DISK_BLOCK_SIZE;
   Media->LastBlock        = DivU64x32 (
-                              PrivateData->Size + RAM_DISK_BLOCK_SIZE - 1,
+                              DiskSize + RAM_DISK_BLOCK_SIZE - 1,
                               RAM_DISK_BLOCK_SIZE
                               ) - 1;
 }
@@ -164,6 +173,15 @@ RamDiskBlkIoReadBlocks (
     return EFI_INVALID_PARAMETER;
   }
 
+  if (PrivateData->Compressed != NULL) {
+    return RamDiskCompressedRead (
+             PrivateData,
+             MultU64x32 (Lba, PrivateData->Media.BlockSize),
+             BufferSize,
+             Buffer
+             );
+  }
+
   CopyMem (
     Buffer,
     (VOID *)(UINTN)(PrivateData->StartingAddr + MultU64x32 (Lba, PrivateData->Media.BlockSize)),
@@ -243,6 +261,15 @@ RamDiskBlkIoWriteBlocks (
     return EFI_INVALID_PARAMETER;
   }
 
+  if (PrivateData->Compressed != NULL) {
+    return RamDiskCompressedWrite (
+             PrivateData,
+             MultU64x32 (Lba, PrivateData->Media.BlockSize),
+             BufferSize,
+             Buffer
+             );
+  }
+
   CopyMem (
     (VOID *)(UINTN)(PrivateData->StartingAddr + MultU64x32 (Lba, PrivateData->Media.BlockSize)),
     Buffer,
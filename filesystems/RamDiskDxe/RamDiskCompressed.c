@@ -0,0 +1,528 @@
+/** @file
+  Compressed, lazily inflated RAM disk images.
+
+  A compressed RAM disk keeps only its chunked LZO1X container in memory.
+  Chunks are inflated on first access into a small LRU cache, and chunks that
+  are written to are moved into a copy-on-write overlay, so the container is
+  never modified. Containers are built with the mkramdisklz host tool.
+
+  Copyright (c) 2023, Dayo Akanji (sf.net/u/dakanji/profile)
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "RamDiskImpl.h"
+
+#define LZO_CFG_FREESTANDING 1
+#define MINILZO_CFG_SKIP_LZO_PTR 1
+#define MINILZO_CFG_SKIP_LZO_UTIL 1
+#define MINILZO_CFG_SKIP_LZO_INIT 1
+#define MINILZO_CFG_SKIP_LZO1X_DECOMPRESS 1
+#define MINILZO_CFG_SKIP_LZO1X_1_COMPRESS 1
+#include "../minilzo.c"
+
+EFI_GUID mRamDiskCompressedGuid = RAM_DISK_COMPRESSED_GUID;
+
+
+/**
+  Return the container offset of a chunk boundary.
+
+  @param[in] Lz              Points to the compressed RAM disk data.
+  @param[in] Index           The boundary index, 0 to ChunkCount.
+
+  @return The offset of the boundary relative to the container start.
+
+**/
+STATIC
+UINT64
+RamDiskLzChunkOffset (
+  IN RAM_DISK_LZ_DATA             *Lz,
+  IN UINT32                       Index
+  )
+{
+  return ReadUnaligned64 ((UINT64 *) (Lz->ChunkOffset + MultU64x32 (Index, sizeof (UINT64))));
+}
+
+
+/**
+  Return the inflated length of a chunk. Only the last chunk can be short.
+
+  @param[in] Lz              Points to the compressed RAM disk data.
+  @param[in] Chunk           The chunk index.
+
+  @return The inflated length of the chunk in bytes.
+
+**/
+STATIC
+UINT32
+RamDiskLzChunkLength (
+  IN RAM_DISK_LZ_DATA             *Lz,
+  IN UINT32                       Chunk
+  )
+{
+  UINT64                          Start;
+
+  Start = LShiftU64 (Chunk, Lz->ChunkShift);
+  if (Lz->DiskSize - Start < Lz->ChunkSize) {
+    return (UINT32) (Lz->DiskSize - Start);
+  }
+
+  return Lz->ChunkSize;
+}
+
+
+/**
+  Inflate a chunk of the container.
+
+  @param[in]  Lz             Points to the compressed RAM disk data.
+  @param[in]  Chunk          The chunk index.
+  @param[out] Buffer         Receives the inflated chunk. Must hold at least
+                             RamDiskLzChunkLength () bytes.
+
+  @retval EFI_SUCCESS             The chunk was inflated.
+  @retval EFI_DEVICE_ERROR        The chunk data is corrupt.
+
+**/
+STATIC
+EFI_STATUS
+RamDiskLzInflate (
+  IN  RAM_DISK_LZ_DATA            *Lz,
+  IN  UINT32                      Chunk,
+  OUT UINT8                       *Buffer
+  )
+{
+  UINT64                          Start;
+  UINT32                          Stored;
+  UINT32                          Length;
+  lzo_uint                        OutLength;
+
+  Start  = RamDiskLzChunkOffset (Lz, Chunk);
+  Stored = (UINT32) (RamDiskLzChunkOffset (Lz, Chunk + 1) - Start);
+  Length = RamDiskLzChunkLength (Lz, Chunk);
+
+  if (Stored == Length) {
+    CopyMem (Buffer, Lz->Container + Start, Length);
+    return EFI_SUCCESS;
+  }
+
+  OutLength = Length;
+  if (lzo1x_decompress_safe (
+        (lzo_bytep) (Lz->Container + Start),
+        Stored,
+        (lzo_bytep) Buffer,
+        &OutLength,
+        NULL
+        ) != LZO_E_OK || OutLength != Length) {
+    DEBUG ((EFI_D_ERROR, "RamDiskLzInflate: chunk %u is corrupt\n", Chunk));
+    return EFI_DEVICE_ERROR;
+  }
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Find a chunk in the read cache, inflating it into the least recently used
+  slot on a miss.
+
+  @param[in]  Lz             Points to the compressed RAM disk data.
+  @param[in]  Chunk          The chunk index.
+  @param[out] Data           Receives a pointer to the inflated chunk.
+
+  @retval EFI_SUCCESS             Data points to the inflated chunk.
+  @retval EFI_DEVICE_ERROR        The chunk data is corrupt.
+  @retval EFI_OUT_OF_RESOURCES    No memory for the cache slot.
+
+**/
+STATIC
+EFI_STATUS
+RamDiskLzCachedChunk (
+  IN  RAM_DISK_LZ_DATA            *Lz,
+  IN  UINT32                      Chunk,
+  OUT UINT8                       **Data
+  )
+{
+  EFI_STATUS                      Status;
+  RAM_DISK_LZ_CACHE_SLOT          *Slot;
+  UINTN                           Index;
+
+  Slot = &Lz->Cache[0];
+  for (Index = 0; Index < RAM_DISK_LZ_CACHE_SLOTS; Index++) {
+    if (Lz->Cache[Index].Data != NULL && Lz->Cache[Index].Chunk == Chunk) {
+      Lz->Cache[Index].LastUse = ++Lz->UseCounter;
+      *Data = Lz->Cache[Index].Data;
+      return EFI_SUCCESS;
+    }
+
+    if (Lz->Cache[Index].LastUse < Slot->LastUse) {
+      Slot = &Lz->Cache[Index];
+    }
+  }
+
+  if (Slot->Data == NULL) {
+    Slot->Data = AllocatePool (Lz->ChunkSize);
+    if (Slot->Data == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  Status = RamDiskLzInflate (Lz, Chunk, Slot->Data);
+  if (EFI_ERROR(Status)) {
+    //
+    // Keep the slot allocated but make sure it never matches.
+    //
+    Slot->LastUse = 0;
+    Slot->Chunk   = MAX_UINT32;
+    return Status;
+  }
+
+  Slot->Chunk   = Chunk;
+  Slot->LastUse = ++Lz->UseCounter;
+  *Data         = Slot->Data;
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Check whether a memory buffer starts with a compressed RAM disk container.
+
+  @param[in] Buffer          Points to the buffer.
+  @param[in] BufferSize      The size of the buffer.
+
+  @retval TRUE               The buffer holds a compressed container header.
+  @retval FALSE              The buffer does not.
+
+**/
+BOOLEAN
+RamDiskIsCompressedImage (
+  IN VOID                         *Buffer,
+  IN UINT64                       BufferSize
+  )
+{
+  RAM_DISK_LZ_HEADER              *Header;
+
+  if (Buffer == NULL || BufferSize < sizeof (RAM_DISK_LZ_HEADER)) {
+    return FALSE;
+  }
+
+  Header = (RAM_DISK_LZ_HEADER *) Buffer;
+
+  return (BOOLEAN) (
+    ReadUnaligned64 (&Header->Signature) == RAM_DISK_LZ_SIGNATURE &&
+    ReadUnaligned32 (&Header->Version) == RAM_DISK_LZ_VERSION
+    );
+}
+
+
+/**
+  Validate the compressed container of a RAM disk and set up its chunk cache
+  and copy-on-write overlay.
+
+  @param[in, out] PrivateData     Points to RAM disk private data. The
+                                  StartingAddr and Size fields describe the
+                                  container.
+
+  @retval EFI_SUCCESS             The compressed RAM disk is ready for use.
+  @retval EFI_VOLUME_CORRUPTED    The container is malformed.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the bookkeeping.
+
+**/
+EFI_STATUS
+RamDiskCompressedInit (
+  IN OUT RAM_DISK_PRIVATE_DATA    *PrivateData
+  )
+{
+  RAM_DISK_LZ_HEADER              *Header;
+  RAM_DISK_LZ_DATA                *Lz;
+  UINT64                          TableEnd;
+  UINT64                          Previous;
+  UINT64                          Current;
+  UINT32                          Index;
+
+  if (!RamDiskIsCompressedImage ((VOID *)(UINTN) PrivateData->StartingAddr, PrivateData->Size)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  Header = (RAM_DISK_LZ_HEADER *)(UINTN) PrivateData->StartingAddr;
+
+  Lz = AllocateZeroPool (sizeof (RAM_DISK_LZ_DATA));
+  if (Lz == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Lz->Container     = (UINT8 *)(UINTN) PrivateData->StartingAddr;
+  Lz->ContainerSize = PrivateData->Size;
+  Lz->ChunkOffset   = Lz->Container + sizeof (RAM_DISK_LZ_HEADER);
+  Lz->DiskSize      = ReadUnaligned64 (&Header->DiskSize);
+  Lz->ChunkShift    = ReadUnaligned32 (&Header->ChunkShift);
+  Lz->ChunkCount    = ReadUnaligned32 (&Header->ChunkCount);
+
+  if (Lz->ChunkShift < RAM_DISK_LZ_MIN_CHUNK_SHIFT ||
+      Lz->ChunkShift > RAM_DISK_LZ_MAX_CHUNK_SHIFT ||
+      Lz->DiskSize == 0 ||
+      (Lz->DiskSize % RAM_DISK_BLOCK_SIZE) != 0 ||
+      Lz->DiskSize > ((UINTN) -1) - RAM_DISK_BLOCK_SIZE + 1) {
+    goto Corrupted;
+  }
+
+  Lz->ChunkSize = 1U << Lz->ChunkShift;
+  if (RShiftU64 (Lz->DiskSize + Lz->ChunkSize - 1, Lz->ChunkShift) != Lz->ChunkCount) {
+    goto Corrupted;
+  }
+
+  //
+  // The offset table must fit, be monotonic, stay within the container and
+  // never store a chunk larger than its inflated length.
+  //
+  TableEnd = sizeof (RAM_DISK_LZ_HEADER) + MultU64x32 ((UINT64) Lz->ChunkCount + 1, sizeof (UINT64));
+  if (TableEnd > Lz->ContainerSize) {
+    goto Corrupted;
+  }
+
+  Previous = RamDiskLzChunkOffset (Lz, 0);
+  if (Previous < TableEnd) {
+    goto Corrupted;
+  }
+
+  for (Index = 0; Index < Lz->ChunkCount; Index++) {
+    Current = RamDiskLzChunkOffset (Lz, Index + 1);
+    if (Current <= Previous ||
+        Current > Lz->ContainerSize ||
+        Current - Previous > RamDiskLzChunkLength (Lz, Index)) {
+      goto Corrupted;
+    }
+
+    Previous = Current;
+  }
+
+  Lz->Overlay = AllocateZeroPool (Lz->ChunkCount * sizeof (UINT8 *));
+  if (Lz->Overlay == NULL) {
+    FreePool (Lz);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  PrivateData->Compressed = Lz;
+
+  return EFI_SUCCESS;
+
+Corrupted:
+  DEBUG ((EFI_D_ERROR, "RamDiskCompressedInit: malformed container\n"));
+  FreePool (Lz);
+
+  return EFI_VOLUME_CORRUPTED;
+}
+
+
+/**
+  Release the chunk cache and copy-on-write overlay of a compressed RAM disk.
+
+  @param[in, out] PrivateData     Points to RAM disk private data.
+
+**/
+VOID
+RamDiskCompressedFree (
+  IN OUT RAM_DISK_PRIVATE_DATA    *PrivateData
+  )
+{
+  RAM_DISK_LZ_DATA                *Lz;
+  UINTN                           Index;
+
+  Lz = PrivateData->Compressed;
+  if (Lz == NULL) {
+    return;
+  }
+
+  for (Index = 0; Index < RAM_DISK_LZ_CACHE_SLOTS; Index++) {
+    if (Lz->Cache[Index].Data != NULL) {
+      FreePool (Lz->Cache[Index].Data);
+    }
+  }
+
+  for (Index = 0; Index < Lz->ChunkCount; Index++) {
+    if (Lz->Overlay[Index] != NULL) {
+      FreePool (Lz->Overlay[Index]);
+    }
+  }
+
+  FreePool (Lz->Overlay);
+  FreePool (Lz);
+
+  PrivateData->Compressed = NULL;
+}
+
+
+/**
+  Read from a compressed RAM disk.
+
+  @param[in]  PrivateData    Points to RAM disk private data.
+  @param[in]  Offset         The byte offset to read from.
+  @param[in]  BufferSize     The number of bytes to read.
+  @param[out] Buffer         The destination buffer.
+
+  @retval EFI_SUCCESS             The data was read.
+  @retval EFI_DEVICE_ERROR        A chunk failed to decompress.
+  @retval EFI_OUT_OF_RESOURCES    No memory for a cache slot.
+
+**/
+EFI_STATUS
+RamDiskCompressedRead (
+  IN  RAM_DISK_PRIVATE_DATA       *PrivateData,
+  IN  UINT64                      Offset,
+  IN  UINTN                       BufferSize,
+  OUT VOID                        *Buffer
+  )
+{
+  EFI_STATUS                      Status;
+  RAM_DISK_LZ_DATA                *Lz;
+  UINT8                           *Dest;
+  UINT8                           *Data;
+  UINT32                          Chunk;
+  UINT32                          Within;
+  UINT32                          Length;
+  UINTN                           Index;
+
+  Lz   = PrivateData->Compressed;
+  Dest = (UINT8 *) Buffer;
+
+  while (BufferSize > 0) {
+    Chunk  = (UINT32) RShiftU64 (Offset, Lz->ChunkShift);
+    Within = (UINT32) (Offset & (Lz->ChunkSize - 1));
+    Length = RamDiskLzChunkLength (Lz, Chunk) - Within;
+    if (Length > BufferSize) {
+      Length = (UINT32) BufferSize;
+    }
+
+    if (Lz->Overlay[Chunk] != NULL) {
+      CopyMem (Dest, Lz->Overlay[Chunk] + Within, Length);
+    } else {
+      //
+      // Whole chunks that are not already cached are inflated straight into
+      // the caller's buffer so large sequential reads do not churn the cache.
+      //
+      Data = NULL;
+      if (Within == 0 && Length == RamDiskLzChunkLength (Lz, Chunk)) {
+        for (Index = 0; Index < RAM_DISK_LZ_CACHE_SLOTS; Index++) {
+          if (Lz->Cache[Index].Data != NULL && Lz->Cache[Index].Chunk == Chunk) {
+            Data = Lz->Cache[Index].Data;
+            break;
+          }
+        }
+
+        if (Data == NULL) {
+          Status = RamDiskLzInflate (Lz, Chunk, Dest);
+          if (EFI_ERROR(Status)) {
+            return Status;
+          }
+        }
+      } else {
+        Status = RamDiskLzCachedChunk (Lz, Chunk, &Data);
+        if (EFI_ERROR(Status)) {
+          return Status;
+        }
+      }
+
+      if (Data != NULL) {
+        CopyMem (Dest, Data + Within, Length);
+      }
+    }
+
+    Dest       += Length;
+    Offset     += Length;
+    BufferSize -= Length;
+  }
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Write to a compressed RAM disk.  Written chunks are inflated into the
+  copy-on-write overlay; the container itself is never modified.
+
+  @param[in] PrivateData     Points to RAM disk private data.
+  @param[in] Offset          The byte offset to write to.
+  @param[in] BufferSize      The number of bytes to write.
+  @param[in] Buffer          The source buffer.
+
+  @retval EFI_SUCCESS             The data was written.
+  @retval EFI_DEVICE_ERROR        A chunk failed to decompress.
+  @retval EFI_OUT_OF_RESOURCES    No memory for an overlay chunk.
+
+**/
+EFI_STATUS
+RamDiskCompressedWrite (
+  IN RAM_DISK_PRIVATE_DATA        *PrivateData,
+  IN UINT64                       Offset,
+  IN UINTN                        BufferSize,
+  IN VOID                         *Buffer
+  )
+{
+  EFI_STATUS                      Status;
+  RAM_DISK_LZ_DATA                *Lz;
+  UINT8                           *Source;
+  UINT8                           *Copy;
+  UINT32                          Chunk;
+  UINT32                          Within;
+  UINT32                          Length;
+  UINTN                           Index;
+
+  Lz     = PrivateData->Compressed;
+  Source = (UINT8 *) Buffer;
+
+  while (BufferSize > 0) {
+    Chunk  = (UINT32) RShiftU64 (Offset, Lz->ChunkShift);
+    Within = (UINT32) (Offset & (Lz->ChunkSize - 1));
+    Length = RamDiskLzChunkLength (Lz, Chunk) - Within;
+    if (Length > BufferSize) {
+      Length = (UINT32) BufferSize;
+    }
+
+    if (Lz->Overlay[Chunk] == NULL) {
+      //
+      // Take over a cached copy when there is one. Otherwise inflate the
+      // chunk, unless the write replaces it entirely.
+      //
+      Copy = NULL;
+      for (Index = 0; Index < RAM_DISK_LZ_CACHE_SLOTS; Index++) {
+        if (Lz->Cache[Index].Data != NULL && Lz->Cache[Index].Chunk == Chunk) {
+          Copy                     = Lz->Cache[Index].Data;
+          Lz->Cache[Index].Data    = NULL;
+          Lz->Cache[Index].LastUse = 0;
+          break;
+        }
+      }
+
+      if (Copy == NULL) {
+        Copy = AllocatePool (Lz->ChunkSize);
+        if (Copy == NULL) {
+          return EFI_OUT_OF_RESOURCES;
+        }
+
+        if (Length != RamDiskLzChunkLength (Lz, Chunk)) {
+          Status = RamDiskLzInflate (Lz, Chunk, Copy);
+          if (EFI_ERROR(Status)) {
+            FreePool (Copy);
+            return Status;
+          }
+        }
+      }
+
+      Lz->Overlay[Chunk] = Copy;
+    }
+
+    CopyMem (Lz->Overlay[Chunk] + Within, Source, Length);
+
+    Source     += Length;
+    Offset     += Length;
+    BufferSize -= Length;
+  }
+
+  return EFI_SUCCESS;
+}
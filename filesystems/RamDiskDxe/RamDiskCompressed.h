@@ -0,0 +1,78 @@
+/** @file
+  Header file for the compressed RAM disk container layout.
+
+  Only needs the base types, so that the container code can also be built
+  by the host tests in mkramdisklz.
+
+  Copyright (c) 2023, Dayo Akanji (sf.net/u/dakanji/profile)
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _RAM_DISK_COMPRESSED_H_
+#define _RAM_DISK_COMPRESSED_H_
+
+//
+// Vendor RAM disk type for disks registered from a compressed chunk container
+// (see RamDiskCompressed.c).  The memory range handed to RamDiskRegister ()
+// holds the container and the disk content is inflated on demand.
+//
+#define RAM_DISK_COMPRESSED_GUID \
+  { 0x651a1352, 0x2526, 0x4211, { 0x8f, 0xef, 0xe8, 0xe0, 0xf3, 0xff, 0x84, 0xc9 } }
+
+extern  EFI_GUID                  mRamDiskCompressedGuid;
+
+//
+// Compressed container layout.  All fields are little endian.  The header is
+// followed by ChunkCount + 1 UINT64 offsets, relative to the container start,
+// that delimit the LZO1X compressed chunks.  A chunk whose stored length is
+// equal to its inflated length is kept uncompressed.
+//
+#define RAM_DISK_LZ_SIGNATURE       SIGNATURE_64 ('R', 'D', 'S', 'K', 'L', 'Z', 'O', '1')
+#define RAM_DISK_LZ_VERSION         1
+#define RAM_DISK_LZ_MIN_CHUNK_SHIFT 12
+#define RAM_DISK_LZ_MAX_CHUNK_SHIFT 20
+
+#pragma pack(1)
+typedef struct {
+  UINT64                          Signature;
+  UINT32                          Version;
+  UINT32                          ChunkShift;
+  UINT64                          DiskSize;
+  UINT32                          ChunkCount;
+  UINT32                          Reserved;
+} RAM_DISK_LZ_HEADER;
+#pragma pack()
+
+//
+// Number of inflated chunks kept around for reads.  Chunks that have been
+// written to live in the copy-on-write overlay instead and are never evicted.
+//
+#define RAM_DISK_LZ_CACHE_SLOTS     16
+
+typedef struct {
+  UINT32                          Chunk;
+  UINT64                          LastUse;
+  UINT8                           *Data;
+} RAM_DISK_LZ_CACHE_SLOT;
+
+typedef struct {
+  UINT8                           *Container;
+  UINT64                          ContainerSize;
+  UINT8                           *ChunkOffset;
+  UINT64                          DiskSize;
+  UINT32                          ChunkShift;
+  UINT32                          ChunkSize;
+  UINT32                          ChunkCount;
+  UINT64                          UseCounter;
+  RAM_DISK_LZ_CACHE_SLOT          Cache[RAM_DISK_LZ_CACHE_SLOTS];
+  UINT8                           **Overlay;
+} RAM_DISK_LZ_DATA;
+
+#endif
@@ -196,6 +196,7 @@ UnregisterAllRamDisks (
         FreePool ((VOID *)(UINTN) PrivateData->StartingAddr);
       }
 
+      RamDiskCompressedFree (PrivateData);
       FreePool (PrivateData->DevicePath);
       FreePool (PrivateData);
     }
@@ -310,9 +311,11 @@ HiiCreateRamDisk (
   EFI_DEVICE_PATH_PROTOCOL        *DevicePath;
   RAM_DISK_PRIVATE_DATA           *PrivateData;
   EFI_FILE_INFO                   *FileInformation;
+  EFI_GUID                        *RamDiskType;
 
   FileInformation = NULL;
   StartingAddr    = NULL;
+  RamDiskType     = &gEfiVirtualDiskGuid;
 
   if (FileHandle != NULL) {
     //
@@ -414,6 +417,14 @@ HiiCreateRamDisk (
 
       return EFI_DEVICE_ERROR;
     }
+
+    //
+    // Files built by mkramdisklz are registered as compressed RAM disks and
+    // only cost the size of the container.
+    //
+    if (RamDiskIsCompressedImage (StartingAddr, Size)) {
+      RamDiskType = &mRamDiskCompressedGuid;
+    }
   }
 
   //
@@ -422,7 +433,7 @@ HiiCreateRamDisk (
   Status = RamDiskRegister (
              ((UINT64)(UINTN) StartingAddr),
              Size,
-             &gEfiVirtualDiskGuid,
+             RamDiskType,
              NULL,
              &DevicePath
              );
@@ -43,6 +43,7 @@
 #include <IndustryStandard/Acpi61.h>
 
 #include "RamDiskNVData.h"
+#include "RamDiskCompressed.h"
 
 ///
 /// RAM disk general definitions and declarations
@@ -110,6 +111,11 @@ typedef struct {
   EFI_QUESTION_ID                 CheckBoxId;
   BOOLEAN                         CheckBoxChecked;
 
+  //
+  // Non-NULL when StartingAddr/Size describe a compressed container
+  //
+  RAM_DISK_LZ_DATA                *Compressed;
+
   LIST_ENTRY                      ThisInstance;
 } RAM_DISK_PRIVATE_DATA;
 
@@ -659,4 +665,97 @@ RamDiskPublishNfit (
   IN RAM_DISK_PRIVATE_DATA        *PrivateData
   );
 
+
+/**
+  Check whether a memory buffer starts with a compressed RAM disk container.
+
+  @param[in] Buffer          Points to the buffer.
+  @param[in] BufferSize      The size of the buffer.
+
+  @retval TRUE               The buffer holds a compressed container header.
+  @retval FALSE              The buffer does not.
+
+**/
+BOOLEAN
+RamDiskIsCompressedImage (
+  IN VOID                         *Buffer,
+  IN UINT64                       BufferSize
+  );
+
+
+/**
+  Validate the compressed container of a RAM disk and set up its chunk cache
+  and copy-on-write overlay.
+
+  @param[in, out] PrivateData     Points to RAM disk private data. The
+                                  StartingAddr and Size fields describe the
+                                  container.
+
+  @retval EFI_SUCCESS             The compressed RAM disk is ready for use.
+  @retval EFI_VOLUME_CORRUPTED    The container is malformed.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the bookkeeping.
+
+**/
+EFI_STATUS
+RamDiskCompressedInit (
+  IN OUT RAM_DISK_PRIVATE_DATA    *PrivateData
+  );
+
+
+/**
+  Release the chunk cache and copy-on-write overlay of a compressed RAM disk.
+
+  @param[in, out] PrivateData     Points to RAM disk private data.
+
+**/
+VOID
+RamDiskCompressedFree (
+  IN OUT RAM_DISK_PRIVATE_DATA    *PrivateData
+  );
+
+
+/**
+  Read from a compressed RAM disk.
+
+  @param[in]  PrivateData    Points to RAM disk private data.
+  @param[in]  Offset         The byte offset to read from.
+  @param[in]  BufferSize     The number of bytes to read.
+  @param[out] Buffer         The destination buffer.
+
+  @retval EFI_SUCCESS             The data was read.
+  @retval EFI_DEVICE_ERROR        A chunk failed to decompress.
+  @retval EFI_OUT_OF_RESOURCES    No memory for a cache slot.
+
+**/
+EFI_STATUS
+RamDiskCompressedRead (
+  IN  RAM_DISK_PRIVATE_DATA       *PrivateData,
+  IN  UINT64                      Offset,
+  IN  UINTN                       BufferSize,
+  OUT VOID                        *Buffer
+  );
+
+
+/**
+  Write to a compressed RAM disk.  Written chunks are inflated into the
+  copy-on-write overlay; the container itself is never modified.
+
+  @param[in] PrivateData     Points to RAM disk private data.
+  @param[in] Offset          The byte offset to write to.
+  @param[in] BufferSize      The number of bytes to write.
+  @param[in] Buffer          The source buffer.
+
+  @retval EFI_SUCCESS             The data was written.
+  @retval EFI_DEVICE_ERROR        A chunk failed to decompress.
+  @retval EFI_OUT_OF_RESOURCES    No memory for an overlay chunk.
+
+**/
+EFI_STATUS
+RamDiskCompressedWrite (
+  IN RAM_DISK_PRIVATE_DATA        *PrivateData,
+  IN UINT64                       Offset,
+  IN UINTN                        BufferSize,
+  IN VOID                         *Buffer
+  );
+
 #endif
@@ -158,6 +158,13 @@ RamDiskPublishNfit (
   UINT8                                         Checksum;
   BOOLEAN                                       MemoryFound;
 
+  //
+  // The memory range of a compressed RAM disk does not hold the disk content
+  //
+  if (PrivateData->Compressed != NULL) {
+    return EFI_UNSUPPORTED;
+  }
+
   //
   // Get the EFI memory map.
   //
@@ -637,6 +644,17 @@ RamDiskRegister (
   CopyGuid (&PrivateData->TypeGuid, RamDiskType);
   InitializeListHead (&PrivateData->ThisInstance);
 
+  //
+  // The memory of a compressed RAM disk holds a chunk container that is
+  // inflated on demand rather than the disk content itself
+  //
+  if (CompareGuid (RamDiskType, &mRamDiskCompressedGuid)) {
+    Status = RamDiskCompressedInit (PrivateData);
+    if (EFI_ERROR(Status)) {
+      goto ErrorExit;
+    }
+  }
+
   //
   // Generate device path information for the registered RAM disk
   //
@@ -735,6 +753,7 @@ ErrorExit:
       FreePool (PrivateData->DevicePath);
     }
 
+    RamDiskCompressedFree (PrivateData);
     FreePool (PrivateData);
   }
 
@@ -846,6 +865,7 @@ RamDiskUnregister (
           FreePool ((VOID *)(UINTN) PrivateData->StartingAddr);
         }
 
+        RamDiskCompressedFree (PrivateData);
         FreePool (PrivateData->DevicePath);
         FreePool (PrivateData);
         Found = TRUE;
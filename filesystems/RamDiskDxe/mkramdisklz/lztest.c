@@ -0,0 +1,366 @@
+/*
+ * filesystems/RamDiskDxe/mkramdisklz/lztest.c
+ * Host test of the RamDiskDxe compressed container code
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is distributed under the terms of the BSD License, see
+ * the RamDiskDxe sources for details.
+ *
+ * RamDiskCompressed.c is built here against a minimal stand-in for the
+ * EDK2 base library, so that containers written by mkramdisklz are read
+ * back with the same code the driver uses. See 'make -f Make.unix check'.
+ *
+ * Usage: lztest gen <disk image>
+ *        lztest check <disk image> <container>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// stand-in for the EDK2 base types and library functions used by the driver
+
+typedef uint8_t             UINT8;
+typedef uint16_t            UINT16;
+typedef uint32_t            UINT32;
+typedef uint64_t            UINT64;
+typedef uintptr_t           UINTN;
+typedef intptr_t            INTN;
+typedef unsigned char       BOOLEAN;
+typedef UINTN               EFI_STATUS;
+typedef void                VOID;
+
+typedef struct {
+    UINT32  Data1;
+    UINT16  Data2;
+    UINT16  Data3;
+    UINT8   Data4[8];
+} EFI_GUID;
+
+#define IN
+#define OUT
+#define STATIC              static
+#define TRUE                ((BOOLEAN)1)
+#define FALSE               ((BOOLEAN)0)
+#define MAX_UINT32          ((UINT32)0xFFFFFFFF)
+
+#define EFIERR(a)           ((EFI_STATUS)1 << (sizeof(EFI_STATUS) * 8 - 1) | (a))
+#define EFI_ERROR(a)        ((INTN)(EFI_STATUS)(a) < 0)
+#define EFI_SUCCESS         0
+#define EFI_DEVICE_ERROR    EFIERR(7)
+#define EFI_VOLUME_CORRUPTED EFIERR(10)
+#define EFI_OUT_OF_RESOURCES EFIERR(9)
+
+#define SIGNATURE_16(A, B)  ((A) | ((B) << 8))
+#define SIGNATURE_32(A, B, C, D) (SIGNATURE_16(A, B) | (SIGNATURE_16(C, D) << 16))
+#define SIGNATURE_64(A, B, C, D, E, F, G, H) \
+    (SIGNATURE_32(A, B, C, D) | ((UINT64)(SIGNATURE_32(E, F, G, H)) << 32))
+
+#define DEBUG(x)
+#define EFI_D_ERROR         0
+
+#define CopyMem(d, s, n)    memmove((d), (s), (n))
+#define AllocatePool(n)     malloc(n)
+#define AllocateZeroPool(n) calloc(1, (n))
+#define FreePool(p)         free(p)
+#define MultU64x32(a, b)    ((UINT64)(a) * (UINT32)(b))
+#define LShiftU64(a, n)     ((UINT64)(a) << (n))
+#define RShiftU64(a, n)     ((UINT64)(a) >> (n))
+
+static UINT64 ReadUnaligned64(const UINT64 *p)
+{
+    UINT64 v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static UINT32 ReadUnaligned32(const UINT32 *p)
+{
+    UINT32 v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// the parts of RamDiskImpl.h the container code needs
+
+#define _RAM_DISK_IMPL_H_
+#define RAM_DISK_BLOCK_SIZE 512
+
+#include "../RamDiskCompressed.h"
+
+typedef struct {
+    UINT64            StartingAddr;
+    UINT64            Size;
+    RAM_DISK_LZ_DATA  *Compressed;
+} RAM_DISK_PRIVATE_DATA;
+
+#include "../RamDiskCompressed.c"
+
+// test helpers
+
+static int checks, failures;
+
+#define CHECK(cond, ...) do { \
+    checks++; \
+    if (!(cond)) { \
+        failures++; \
+        printf("FAIL: "); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+static uint32_t rand_state = 12345;
+
+static uint32_t next_rand(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+static unsigned char *read_file(const char *name, size_t *size)
+{
+    FILE           *f;
+    unsigned char  *data;
+    long            len;
+
+    f = fopen(name, "rb");
+    if (f == NULL || fseek(f, 0, SEEK_END) != 0 || (len = ftell(f)) < 0) {
+        fprintf(stderr, "lztest: cannot read %s\n", name);
+        exit(2);
+    }
+    rewind(f);
+
+    // padded like mkramdisklz pads the disk image
+    data = calloc(1, (size_t)len + RAM_DISK_BLOCK_SIZE);
+    if (data == NULL || fread(data, 1, (size_t)len, f) != (size_t)len) {
+        fprintf(stderr, "lztest: cannot read %s\n", name);
+        exit(2);
+    }
+    fclose(f);
+
+    *size = (size_t)len;
+    return data;
+}
+
+static EFI_STATUS open_container(RAM_DISK_PRIVATE_DATA *disk, unsigned char *data, size_t size)
+{
+    memset(disk, 0, sizeof(*disk));
+    disk->StartingAddr = (UINT64)(UINTN)data;
+    disk->Size         = size;
+
+    return RamDiskCompressedInit(disk);
+}
+
+// a container with one header or table field replaced must be rejected
+static void check_damaged(const unsigned char *data, size_t size, size_t field,
+                          uint64_t value, int width, const char *what)
+{
+    RAM_DISK_PRIVATE_DATA  disk;
+    EFI_STATUS             status;
+    unsigned char         *copy;
+
+    copy = malloc(size);
+    memcpy(copy, data, size);
+    memcpy(copy + field, &value, width);
+
+    status = open_container(&disk, copy, size);
+    CHECK(status == EFI_VOLUME_CORRUPTED, "%s accepted", what);
+    if (status == EFI_SUCCESS)
+        RamDiskCompressedFree(&disk);
+    free(copy);
+}
+
+//
+// generate a sample disk image with zero, repetitive and random runs; the
+// size is not a multiple of the block size
+//
+
+static int gen(const char *name)
+{
+    FILE     *f;
+    size_t    i;
+    int       c;
+
+    f = fopen(name, "wb");
+    if (f == NULL)
+        return 2;
+
+    for (i = 0; i < 300123; i++) {
+        if (i < 70000 || i >= 250000)
+            c = 0;
+        else if (i < 170000)
+            c = "RefindPlus RAM disk test data\n"[i % 30];
+        else
+            c = next_rand() & 0xff;
+        putc(c, f);
+    }
+
+    return fclose(f) == 0 ? 0 : 2;
+}
+
+//
+// read a container back and compare it with the disk image
+//
+
+static int check(const char *image_name, const char *container_name)
+{
+    RAM_DISK_PRIVATE_DATA  disk;
+    RAM_DISK_LZ_HEADER    *header;
+    EFI_STATUS             status;
+    unsigned char         *image, *container, *saved, *buf;
+    size_t                 image_size, container_size, disk_size, size, offset, len;
+    unsigned char          saved_image[300];
+    size_t                 cut[7];
+    uint64_t               start, end;
+    uint32_t               chunk, length;
+    int                    i;
+
+    image     = read_file(image_name, &image_size);
+    container = read_file(container_name, &container_size);
+    disk_size = (image_size + RAM_DISK_BLOCK_SIZE - 1) & ~(size_t)(RAM_DISK_BLOCK_SIZE - 1);
+    header    = (RAM_DISK_LZ_HEADER *)container;
+
+    saved = malloc(container_size);
+    buf   = malloc(disk_size);
+    memcpy(saved, container, container_size);
+
+    CHECK(RamDiskIsCompressedImage(container, container_size), "container signature not found");
+    CHECK(!RamDiskIsCompressedImage(image, image_size), "disk image taken for a container");
+
+    status = open_container(&disk, container, container_size);
+    CHECK(status == EFI_SUCCESS, "init failed");
+    if (status != EFI_SUCCESS)
+        return 1;
+    CHECK(disk.Compressed->DiskSize == disk_size, "disk size %llu, expected %zu",
+          (unsigned long long)disk.Compressed->DiskSize, disk_size);
+
+    // whole disk at once, inflated straight into the buffer
+    memset(buf, 0xAA, disk_size);
+    status = RamDiskCompressedRead(&disk, 0, disk_size, buf);
+    CHECK(status == EFI_SUCCESS && memcmp(buf, image, disk_size) == 0, "whole disk read differs");
+
+    // short reads across chunk boundaries, through the chunk cache
+    for (i = 0; i < 4000; i++) {
+        offset = next_rand() % disk_size;
+        len    = 1 + next_rand() % 9000;
+        if (len > disk_size - offset)
+            len = disk_size - offset;
+        status = RamDiskCompressedRead(&disk, offset, len, buf);
+        if (status != EFI_SUCCESS || memcmp(buf, image + offset, len) != 0) {
+            CHECK(0, "read of %zu bytes at %zu differs", len, offset);
+            break;
+        }
+    }
+    CHECK(i == 4000, "random reads");
+
+    // writes go to the overlay and leave the container alone
+    offset = disk.Compressed->ChunkSize - 100;
+    memcpy(saved_image, image + offset, 300);
+    memset(image + offset, 0x5A, 300);
+    memset(buf, 0x5A, 300);
+    status = RamDiskCompressedWrite(&disk, offset, 300, buf);
+    CHECK(status == EFI_SUCCESS, "write failed");
+    status = RamDiskCompressedRead(&disk, 0, disk_size, buf);
+    CHECK(status == EFI_SUCCESS && memcmp(buf, image, disk_size) == 0, "read after write differs");
+    CHECK(memcmp(container, saved, container_size) == 0, "write changed the container");
+
+    RamDiskCompressedFree(&disk);
+    CHECK(disk.Compressed == NULL, "free left the data set");
+
+    memcpy(image + offset, saved_image, 300);
+
+    // truncated containers are rejected up front
+    cut[0] = 0;
+    cut[1] = 16;
+    cut[2] = sizeof(RAM_DISK_LZ_HEADER);
+    cut[3] = sizeof(RAM_DISK_LZ_HEADER) + 8;
+    cut[4] = container_size / 2;
+    cut[5] = container_size - 100;
+    cut[6] = container_size - 1;
+    for (i = 0; i < 7; i++) {
+        status = open_container(&disk, container, cut[i]);
+        CHECK(status == EFI_VOLUME_CORRUPTED, "truncated to %zu bytes accepted", cut[i]);
+        if (status == EFI_SUCCESS)
+            RamDiskCompressedFree(&disk);
+    }
+
+    // so are damaged headers and offset tables
+    check_damaged(container, container_size, 12, RAM_DISK_LZ_MIN_CHUNK_SHIFT - 1, 4, "small chunk shift");
+    check_damaged(container, container_size, 12, RAM_DISK_LZ_MAX_CHUNK_SHIFT + 1, 4, "large chunk shift");
+    check_damaged(container, container_size, 16, disk_size - 1, 8, "unaligned disk size");
+    check_damaged(container, container_size, 16, 0, 8, "empty disk");
+    check_damaged(container, container_size, 24, header->ChunkCount + 1, 4, "wrong chunk count");
+    check_damaged(container, container_size, sizeof(RAM_DISK_LZ_HEADER),
+                  sizeof(RAM_DISK_LZ_HEADER), 8, "chunk inside the offset table");
+    check_damaged(container, container_size, sizeof(RAM_DISK_LZ_HEADER) + 8, 0, 8,
+                  "offsets out of order");
+
+    // a damaged chunk fails to read, the others still read back
+    disk.Compressed = NULL;
+    status = open_container(&disk, container, container_size);
+    CHECK(status == EFI_SUCCESS, "init failed");
+    if (status != EFI_SUCCESS)
+        return 1;
+
+    start  = end = 0;
+    length = 0;
+    for (chunk = 0; chunk < disk.Compressed->ChunkCount; chunk++) {
+        start  = RamDiskLzChunkOffset(disk.Compressed, chunk);
+        end    = RamDiskLzChunkOffset(disk.Compressed, chunk + 1);
+        length = RamDiskLzChunkLength(disk.Compressed, chunk);
+        if (end - start < length)
+            break;
+    }
+    CHECK(chunk < disk.Compressed->ChunkCount, "no compressed chunk in the sample");
+
+    if (chunk < disk.Compressed->ChunkCount) {
+        memset(container + start, 0, (size_t)(end - start));
+        offset = (size_t)chunk << disk.Compressed->ChunkShift;
+
+        status = RamDiskCompressedRead(&disk, offset, length, buf);
+        CHECK(status == EFI_DEVICE_ERROR, "whole damaged chunk read");
+        status = RamDiskCompressedRead(&disk, offset + 1, 100, buf);
+        CHECK(status == EFI_DEVICE_ERROR, "partial damaged chunk read");
+        status = RamDiskCompressedWrite(&disk, offset + 1, 100, buf);
+        CHECK(status == EFI_DEVICE_ERROR, "partial write over damaged chunk");
+
+        for (i = 0; i < (int)disk.Compressed->ChunkCount; i++) {
+            if ((uint32_t)i == chunk)
+                continue;
+            size = RamDiskLzChunkLength(disk.Compressed, i);
+            status = RamDiskCompressedRead(&disk, (size_t)i << disk.Compressed->ChunkShift, size, buf);
+            if (status != EFI_SUCCESS ||
+                memcmp(buf, image + ((size_t)i << disk.Compressed->ChunkShift), size) != 0) {
+                CHECK(0, "chunk %d differs next to a damaged chunk", i);
+                break;
+            }
+        }
+    }
+    RamDiskCompressedFree(&disk);
+
+    printf("%s: %d checks, %d failed\n", container_name, checks, failures);
+
+    free(buf);
+    free(saved);
+    free(container);
+    free(image);
+
+    return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc == 3 && strcmp(argv[1], "gen") == 0)
+        return gen(argv[2]);
+    if (argc == 4 && strcmp(argv[1], "check") == 0)
+        return check(argv[2], argv[3]);
+
+    fprintf(stderr, "Usage: lztest gen <disk image>\n");
+    fprintf(stderr, "       lztest check <disk image> <container>\n");
+    return 2;
+}
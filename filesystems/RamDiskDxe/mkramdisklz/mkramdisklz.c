@@ -0,0 +1,182 @@
+/*
+ * filesystems/RamDiskDxe/mkramdisklz/mkramdisklz.c
+ * Build a compressed RAM disk container for RamDiskDxe
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is distributed under the terms of the BSD License, see
+ * the RamDiskDxe sources for details.
+ *
+ * The disk image is split into fixed size chunks that are compressed with
+ * LZO1X-1. Chunks that do not shrink are stored as is. The layout matches
+ * RAM_DISK_LZ_HEADER in RamDiskImpl.h:
+ *
+ *   header (32 bytes), ChunkCount + 1 little endian UINT64 offsets, chunks
+ *
+ * Usage: mkramdisklz [-c <chunk KiB>] <disk image> <container>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#define MINILZO_CFG_SKIP_LZO_PTR 1
+#define MINILZO_CFG_SKIP_LZO_UTIL 1
+#define MINILZO_CFG_SKIP_LZO1X_DECOMPRESS 1
+#include "../../minilzo.c"
+
+#define RAM_DISK_BLOCK_SIZE  512
+#define LZ_SIGNATURE         "RDSKLZO1"
+#define LZ_VERSION           1
+#define LZ_MIN_CHUNK_SHIFT   12
+#define LZ_MAX_CHUNK_SHIFT   20
+#define LZ_DEF_CHUNK_SHIFT   16
+#define LZ_HEADER_SIZE       32
+
+static void put_le32(unsigned char *p, uint32_t v)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_le64(unsigned char *p, uint64_t v)
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mkramdisklz [-c <chunk KiB>] <disk image> <container>\n");
+    fprintf(stderr, "  chunk size is a power of two from 4 to 1024 KiB (default 64)\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    FILE           *in, *out;
+    unsigned char  *image, *packed, *table;
+    unsigned char   header[LZ_HEADER_SIZE];
+    lzo_align_t    *wrkmem;
+    uint64_t        disk_size, padded, offset;
+    uint32_t        chunk_shift, chunk_size, chunk_count, i, len;
+    lzo_uint        packed_len;
+    long            file_size;
+    int             argi;
+
+    chunk_shift = LZ_DEF_CHUNK_SHIFT;
+    argi = 1;
+    if (argc > 2 && strcmp(argv[1], "-c") == 0) {
+        unsigned long kib = strtoul(argv[2], NULL, 10);
+
+        for (chunk_shift = LZ_MIN_CHUNK_SHIFT; chunk_shift <= LZ_MAX_CHUNK_SHIFT; chunk_shift++) {
+            if ((1UL << chunk_shift) == kib * 1024)
+                break;
+        }
+        if (chunk_shift > LZ_MAX_CHUNK_SHIFT)
+            usage();
+        argi = 3;
+    }
+    if (argc - argi != 2)
+        usage();
+
+    if (lzo_init() != LZO_E_OK) {
+        fprintf(stderr, "mkramdisklz: LZO initialisation failed\n");
+        return 1;
+    }
+
+    // read the whole image; the tail is zero padded to the block size
+    in = fopen(argv[argi], "rb");
+    if (in == NULL || fseek(in, 0, SEEK_END) != 0 || (file_size = ftell(in)) <= 0) {
+        fprintf(stderr, "mkramdisklz: cannot read %s: %s\n", argv[argi], strerror(errno));
+        return 1;
+    }
+    rewind(in);
+
+    disk_size = (uint64_t)file_size;
+    padded    = (disk_size + RAM_DISK_BLOCK_SIZE - 1) & ~(uint64_t)(RAM_DISK_BLOCK_SIZE - 1);
+    image     = calloc(1, (size_t)padded);
+    if (image == NULL || fread(image, 1, (size_t)disk_size, in) != disk_size) {
+        fprintf(stderr, "mkramdisklz: cannot read %s\n", argv[argi]);
+        return 1;
+    }
+    fclose(in);
+    disk_size = padded;
+
+    chunk_size  = 1U << chunk_shift;
+    chunk_count = (uint32_t)((disk_size + chunk_size - 1) >> chunk_shift);
+    packed      = malloc(chunk_size + chunk_size / 16 + 64 + 3);
+    table       = calloc((size_t)chunk_count + 1, 8);
+    wrkmem      = malloc(LZO1X_1_MEM_COMPRESS);
+    if (packed == NULL || table == NULL || wrkmem == NULL) {
+        fprintf(stderr, "mkramdisklz: out of memory\n");
+        return 1;
+    }
+
+    out = fopen(argv[argi + 1], "wb");
+    if (out == NULL) {
+        fprintf(stderr, "mkramdisklz: cannot create %s: %s\n", argv[argi + 1], strerror(errno));
+        return 1;
+    }
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, LZ_SIGNATURE, 8);
+    put_le32(header + 8, LZ_VERSION);
+    put_le32(header + 12, chunk_shift);
+    put_le64(header + 16, disk_size);
+    put_le32(header + 24, chunk_count);
+
+    // the offset table is rewritten once the chunk sizes are known
+    offset = LZ_HEADER_SIZE + ((uint64_t)chunk_count + 1) * 8;
+    if (fwrite(header, 1, LZ_HEADER_SIZE, out) != LZ_HEADER_SIZE ||
+        fwrite(table, 1, ((size_t)chunk_count + 1) * 8, out) != ((size_t)chunk_count + 1) * 8) {
+        fprintf(stderr, "mkramdisklz: write error\n");
+        return 1;
+    }
+
+    for (i = 0; i < chunk_count; i++) {
+        unsigned char *chunk = image + ((uint64_t)i << chunk_shift);
+
+        len = chunk_size;
+        if (disk_size - ((uint64_t)i << chunk_shift) < chunk_size)
+            len = (uint32_t)(disk_size - ((uint64_t)i << chunk_shift));
+
+        put_le64(table + (size_t)i * 8, offset);
+        if (lzo1x_1_compress(chunk, len, packed, &packed_len, wrkmem) != LZO_E_OK ||
+            packed_len >= len) {
+            // store incompressible chunks raw
+            packed_len = len;
+            memcpy(packed, chunk, len);
+        }
+        if (fwrite(packed, 1, packed_len, out) != packed_len) {
+            fprintf(stderr, "mkramdisklz: write error\n");
+            return 1;
+        }
+        offset += packed_len;
+    }
+    put_le64(table + (size_t)chunk_count * 8, offset);
+
+    if (fseek(out, LZ_HEADER_SIZE, SEEK_SET) != 0 ||
+        fwrite(table, 1, ((size_t)chunk_count + 1) * 8, out) != ((size_t)chunk_count + 1) * 8 ||
+        fclose(out) != 0) {
+        fprintf(stderr, "mkramdisklz: write error\n");
+        return 1;
+    }
+
+    printf("%s: %llu bytes in %u chunks of %u KiB -> %llu bytes\n", argv[argi + 1],
+           (unsigned long long)disk_size, chunk_count, chunk_size / 1024,
+           (unsigned long long)offset);
+
+    free(wrkmem);
+    free(table);
+    free(packed);
+    free(image);
+
+    return 0;
+}
@@ -67,7 +67,13 @@
 #define MINILZO_CFG_SKIP_LZO1X_DECOMPRESS 1
 #define MINILZO_CFG_SKIP_LZO1X_1_COMPRESS 1
 #include "minilzo.c"
+#ifndef HOST_POSIX
 #include "scandisk.c"
+#else
+/* the POSIX test host mounts a single image, there are no other disks to scan */
+static struct fsw_volume *clone_dummy_volume(struct fsw_volume *vol) { return NULL; }
+static int scan_disks(int (*hook)(struct fsw_volume *, struct fsw_volume *), struct fsw_volume *master) { return 0; }
+#endif
 
 #define BTRFS_DEFAULT_BLOCK_SIZE 4096
 #define GRUB_BTRFS_SIGNATURE "_BHRfS_M"
@@ -115,7 +121,9 @@ struct btrfs_superblock
     uint32_t sectorsize;
     uint32_t nodesize;
 
-    uint8_t dummy3[0x31];
+    uint8_t dummy3[0x2c];
+    uint16_t csum_type;
+    uint8_t dummy5[3];
     struct btrfs_device this_device;
     char label[0x100];
     uint8_t dummy4[0x100];
@@ -137,6 +145,13 @@ struct fsw_btrfs_device_desc
     uint64_t id;
 };
 
+#define BTRFS_CSUM_TYPE_CRC32C  0
+#define BTRFS_CSUM_SIZE         0x20
+#define BTRFS_SUPERBLOCK_SIZE   0x1000
+
+/* Initial slots of the set of tree nodes whose checksum was already verified */
+#define VERIFIED_NODES_SIZE     256
+
 #define RECOVER_CACHE_SIZE 17
 struct fsw_btrfs_recover_cache
 {
@@ -161,8 +176,17 @@ struct fsw_btrfs_volume
     unsigned num_devices;
     unsigned sectorshift;
     unsigned sectorsize;
+    unsigned nodesize;
     int is_master;
     int rescan_once;
+    int csum_verify;                //!< Verify crc32c of tree nodes on read
+    uint64_t *verified_nodes;       //!< Open addressed set of verified node addresses
+    unsigned n_verified_nodes;      //!< Used slots in verified_nodes
+    unsigned verified_nodes_size;   //!< Slots in verified_nodes, a power of two
+
+    /* chunk tree, sorted by logical start; NULL until fully loaded */
+    struct fsw_btrfs_chunk_map *chunk_map;
+    unsigned n_chunk_map;
 
     struct fsw_btrfs_device_desc *devices_attached;
     unsigned n_devices_attached;
@@ -223,6 +247,15 @@ struct btrfs_chunk_stripe
     btrfs_uuid_t device_uuid;
 } __attribute__ ((__packed__));
 
+/* One chunk of the logical address space, as loaded from the chunk tree */
+struct fsw_btrfs_chunk_map
+{
+    uint64_t start;                 /* logical start, host order */
+    uint64_t end;                   /* logical end (exclusive), host order */
+    struct btrfs_key key;           /* chunk item key as on disk */
+    struct btrfs_chunk_item *chunk; /* chunk item followed by its stripes */
+};
+
 struct btrfs_leaf_node
 {
     struct btrfs_key key;
@@ -387,6 +420,7 @@ static fsw_status_t btrfs_set_superblock_info(struct fsw_btrfs_volume *vol, stru
     vol->root_tree = sb->root_tree;
     vol->total_bytes = fsw_u64_le_swap(sb->total_bytes);
     vol->bytes_used = fsw_u64_le_swap(sb->bytes_used);
+    vol->nodesize = fsw_u32_le_swap(sb->nodesize);
 
     vol->sectorshift = 0;
     vol->sectorsize = fsw_u32_le_swap(sb->sectorsize);
@@ -414,9 +448,25 @@ static uint64_t superblock_pos[4] = {
 static fsw_status_t fsw_btrfs_read_logical(struct fsw_btrfs_volume *vol,
         uint64_t addr, void *buf, fsw_size_t size, int rdepth, int cache_level);
 
+/**
+ * Check the crc32c of a superblock copy. Copies using another checksum
+ * type are let through, as are all copies when verification is off.
+ */
+static int btrfs_superblock_csum_ok (struct fsw_volume *vol, uint8_t *buffer)
+{
+    struct btrfs_superblock *sb = (struct btrfs_superblock *)buffer;
+
+    if (!FSW_VERIFY_CSUM(vol) || fsw_u16_le_swap (sb->csum_type) != BTRFS_CSUM_TYPE_CRC32C)
+        return 1;
+
+    return grub_getcrc32c (0, buffer + BTRFS_CSUM_SIZE, BTRFS_SUPERBLOCK_SIZE - BTRFS_CSUM_SIZE)
+        == fsw_u32_le_swap (*(uint32_t *)sb->checksum);
+}
+
 static fsw_status_t btrfs_read_superblock (struct fsw_volume *vol, struct btrfs_superblock *sb_out)
 {
     unsigned i;
+    int found = 0;
     uint64_t total_blocks = 1024;
     fsw_status_t err = FSW_SUCCESS;
 
@@ -443,10 +493,15 @@ static fsw_status_t btrfs_read_superblock (struct fsw_volume *vol, struct btrfs_
             fsw_block_release(vol, superblock_pos[i], buffer);
             break;
         }
-        if (i == 0 || fsw_u64_le_swap (sb->generation) > fsw_u64_le_swap (sb_out->generation))
+        if (!btrfs_superblock_csum_ok (vol, buffer))
+        {
+            DPRINT(L"btrfs: superblock copy %d checksum mismatch\n", i);
+        }
+        else if (!found || fsw_u64_le_swap (sb->generation) > fsw_u64_le_swap (sb_out->generation))
         {
             fsw_memcpy (sb_out, sb, sizeof (*sb));
             total_blocks = fsw_u64_le_swap (sb->this_device.size) >> 12;
+            found = 1;
         }
         fsw_block_release(vol, superblock_pos[i], buffer);
     }
@@ -454,6 +509,9 @@ static fsw_status_t btrfs_read_superblock (struct fsw_volume *vol, struct btrfs_
     if ((err == FSW_UNSUPPORTED || !err) && i == 0)
         return FSW_UNSUPPORTED;
 
+    if (!err && !found)
+        return FSW_VOLUME_CORRUPTED;
+
     if (err == FSW_UNSUPPORTED)
         err = FSW_SUCCESS;
 
@@ -511,6 +569,96 @@ static fsw_status_t save_ref (struct fsw_btrfs_leaf_descriptor *desc,
     return FSW_SUCCESS;
 }
 
+static uint64_t *btrfs_verified_slot (uint64_t *set, unsigned size, uint64_t addr)
+{
+    unsigned i = (unsigned) ((addr >> 12) ^ (addr >> 24)) & (size - 1);
+
+    while (set[i] != 0 && set[i] != addr)
+        i = (i + 1) & (size - 1);
+    return &set[i];
+}
+
+/**
+ * Remember a tree node whose checksum matched. The set grows instead of
+ * evicting, so a node is never checked twice; if it cannot grow the node
+ * is simply checked again next time.
+ */
+static void btrfs_add_verified_node (struct fsw_btrfs_volume *vol, uint64_t addr)
+{
+    uint64_t *slot;
+
+    if ((vol->n_verified_nodes + 1) * 4 > vol->verified_nodes_size * 3)
+    {
+        uint64_t *newset;
+        unsigned newsize = vol->verified_nodes_size * 2;
+        unsigned i;
+
+        if (fsw_alloc_zero (sizeof (uint64_t) * newsize, (void **) &newset))
+            return;
+        for (i = 0; i < vol->verified_nodes_size; i++)
+            if (vol->verified_nodes[i])
+                *btrfs_verified_slot (newset, newsize, vol->verified_nodes[i])
+                    = vol->verified_nodes[i];
+        FreePool (vol->verified_nodes);
+        vol->verified_nodes = newset;
+        vol->verified_nodes_size = newsize;
+    }
+
+    slot = btrfs_verified_slot (vol->verified_nodes, vol->verified_nodes_size, addr);
+    if (*slot == 0)
+    {
+        *slot = addr;
+        vol->n_verified_nodes++;
+    }
+}
+
+/**
+ * Read the whole tree node at the logical address into nodebuf and verify
+ * its crc32c on that copy, once per node.
+ */
+static fsw_status_t btrfs_read_node (struct fsw_btrfs_volume *vol,
+        uint64_t addr, uint8_t *nodebuf, int rdepth, int cache_level)
+{
+    fsw_status_t err;
+
+    err = fsw_btrfs_read_logical (vol, addr, nodebuf, vol->nodesize, rdepth, cache_level);
+    if (err)
+        return err;
+
+    /* 0 marks a free slot, so a node there is checked every time */
+    if (addr != 0 && *btrfs_verified_slot (vol->verified_nodes,
+                vol->verified_nodes_size, addr) == addr)
+        return FSW_SUCCESS;
+
+    if (grub_getcrc32c (0, nodebuf + BTRFS_CSUM_SIZE, vol->nodesize - BTRFS_CSUM_SIZE)
+            != fsw_u32_le_swap (*(uint32_t *)nodebuf))
+    {
+        DPRINT(L"btrfs: tree node %lx checksum mismatch\n", addr);
+        return FSW_VOLUME_CORRUPTED;
+    }
+
+    if (addr != 0)
+        btrfs_add_verified_node (vol, addr);
+    return FSW_SUCCESS;
+}
+
+/**
+ * Read part of the tree node at node_addr, from its verified copy in nodebuf
+ * when checksums are checked, otherwise straight from the volume.
+ */
+static fsw_status_t btrfs_read_node_part (struct fsw_btrfs_volume *vol,
+        uint8_t *nodebuf, uint64_t node_addr, uint64_t addr,
+        void *buf, fsw_size_t size, int rdepth, int cache_level)
+{
+    if (nodebuf == NULL)
+        return fsw_btrfs_read_logical (vol, addr, buf, size, rdepth, cache_level);
+
+    if (addr < node_addr || addr - node_addr + size > vol->nodesize)
+        return FSW_VOLUME_CORRUPTED;
+    fsw_memcpy (buf, nodebuf + (addr - node_addr), size);
+    return FSW_SUCCESS;
+}
+
 static int next (struct fsw_btrfs_volume *vol,
         struct fsw_btrfs_leaf_descriptor *desc,
         uint64_t * outaddr, fsw_size_t * outsize,
@@ -542,8 +690,19 @@ static int next (struct fsw_btrfs_volume *vol,
         if (err)
             return -err;
 
-        err = fsw_btrfs_read_logical (vol, fsw_u64_le_swap (node.addr),
-                &head, sizeof (head), 0, 1);
+        if (vol->csum_verify)
+        {
+            uint8_t *nodebuf = AllocatePool (vol->nodesize);
+            if (!nodebuf)
+                return -FSW_OUT_OF_MEMORY;
+            err = btrfs_read_node (vol, fsw_u64_le_swap (node.addr), nodebuf, 0, 1);
+            if (!err)
+                fsw_memcpy (&head, nodebuf, sizeof (head));
+            FreePool (nodebuf);
+        }
+        else
+            err = fsw_btrfs_read_logical (vol, fsw_u64_le_swap (node.addr),
+                    &head, sizeof (head), 0, 1);
         if (err)
             return -err;
 
@@ -565,15 +724,16 @@ static int next (struct fsw_btrfs_volume *vol,
 }
 
 #define depth2cache(x)  ((x) >= 4 ? 1 : 5-(x))
-static fsw_status_t lower_bound (struct fsw_btrfs_volume *vol,
+static fsw_status_t lower_bound_walk (struct fsw_btrfs_volume *vol,
         const struct btrfs_key *key_in,
         struct btrfs_key *key_out,
         uint64_t root,
         uint64_t *outaddr, fsw_size_t *outsize,
         struct fsw_btrfs_leaf_descriptor *desc,
-        int rdepth)
+        int rdepth, uint8_t *nodebuf)
 {
     uint64_t addr = fsw_u64_le_swap (root);
+    uint64_t node_addr;
     int depth = -1;
 
     if (desc)
@@ -601,9 +761,14 @@ static fsw_status_t lower_bound (struct fsw_btrfs_volume *vol,
 
 reiter:
         depth++;
+        node_addr = addr;
+        err = FSW_SUCCESS;
         /* FIXME: preread few nodes into buffer. */
-        err = fsw_btrfs_read_logical (vol, addr, &head, sizeof (head),
-                rdepth + 1, depth2cache(rdepth));
+        if (nodebuf)
+            err = btrfs_read_node (vol, addr, nodebuf, rdepth + 1, depth2cache(rdepth));
+        if (!err)
+            err = btrfs_read_node_part (vol, nodebuf, node_addr, addr, &head, sizeof (head),
+                    rdepth + 1, depth2cache(rdepth));
         if (err)
             return err;
         addr += sizeof (head);
@@ -615,7 +780,7 @@ reiter:
             fsw_memzero (&node_last, sizeof (node_last));
             for (i = 0; i < fsw_u32_le_swap (head.nitems); i++)
             {
-                err = fsw_btrfs_read_logical (vol, addr + i * sizeof (node),
+                err = btrfs_read_node_part (vol, nodebuf, node_addr, addr + i * sizeof (node),
                         &node, sizeof (node), rdepth + 1, depth2cache(rdepth));
                 if (err)
                     return err;
@@ -667,7 +832,7 @@ reiter:
             leaf_last.offset = 0;
             for (i = 0; i < fsw_u32_le_swap (head.nitems); i++)
             {
-                err = fsw_btrfs_read_logical (vol, addr + i * sizeof (leaf),
+                err = btrfs_read_node_part (vol, nodebuf, node_addr, addr + i * sizeof (leaf),
                         &leaf, sizeof (leaf), rdepth + 1, depth2cache(rdepth));
                 if (err)
                     return err;
@@ -714,6 +879,33 @@ reiter:
     }
 }
 
+static fsw_status_t lower_bound (struct fsw_btrfs_volume *vol,
+        const struct btrfs_key *key_in,
+        struct btrfs_key *key_out,
+        uint64_t root,
+        uint64_t *outaddr, fsw_size_t *outsize,
+        struct fsw_btrfs_leaf_descriptor *desc,
+        int rdepth)
+{
+    fsw_status_t err;
+    uint8_t *nodebuf = NULL;
+
+    /* checked nodes are read whole once and parsed from that copy */
+    if (vol->csum_verify)
+    {
+        nodebuf = AllocatePool (vol->nodesize);
+        if (!nodebuf)
+            return FSW_OUT_OF_MEMORY;
+    }
+
+    err = lower_bound_walk (vol, key_in, key_out, root, outaddr, outsize,
+            desc, rdepth, nodebuf);
+
+    if (nodebuf)
+        FreePool (nodebuf);
+    return err;
+}
+
 static int btrfs_add_multi_device(struct fsw_btrfs_volume *master, struct fsw_volume *slave, struct btrfs_superblock *sb)
 {
     int i;
@@ -867,7 +1059,7 @@ static struct fsw_btrfs_recover_cache *get_recover_cache(struct fsw_btrfs_volume
 	if(fsw_alloc_zero(sizeof (struct fsw_btrfs_recover_cache) * RECOVER_CACHE_SIZE, (void **) &vol->rcache) != FSW_SUCCESS)
 	    return NULL;
     }
-#ifdef __MAKEWITH_TIANO
+#if defined(__MAKEWITH_TIANO) || defined(HOST_POSIX)
     unsigned hash;
 #else
     UINTN hash;
@@ -886,6 +1078,128 @@ static struct fsw_btrfs_recover_cache *get_recover_cache(struct fsw_btrfs_volume
     return rc;
 }
 
+static void free_chunk_map (struct fsw_btrfs_chunk_map *map, unsigned n)
+{
+    unsigned i;
+
+    for (i = 0; i < n; i++)
+        FreePool (map[i].chunk);
+    FreePool (map);
+}
+
+/*
+ * Load every chunk item of the chunk tree into a map sorted by logical
+ * start, so that logical addresses resolve without walking the tree.
+ * Reads made while loading still go through the chunk tree. A map that
+ * cannot be loaded is dropped and the tree is walked as before.
+ */
+static void load_chunk_map (struct fsw_btrfs_volume *vol)
+{
+    struct btrfs_key key_in, key_out;
+    struct fsw_btrfs_leaf_descriptor desc;
+    struct fsw_btrfs_chunk_map *map = NULL, *newmap;
+    struct btrfs_chunk_item *chunk;
+    unsigned n = 0, allocated = 0;
+    uint64_t elemaddr;
+    fsw_size_t elemsize;
+    fsw_status_t err;
+    int r;
+
+    key_in.object_id = fsw_u64_le_swap (GRUB_BTRFS_OBJECT_ID_CHUNK);
+    key_in.type = GRUB_BTRFS_ITEM_TYPE_CHUNK;
+    key_in.offset = 0;
+    err = lower_bound (vol, &key_in, &key_out, vol->chunk_tree, &elemaddr, &elemsize, &desc, 0);
+    if (err)
+        return;
+
+    r = 1;
+    if (key_out.type != GRUB_BTRFS_ITEM_TYPE_CHUNK
+            || key_out.object_id != key_in.object_id)
+        r = next (vol, &desc, &elemaddr, &elemsize, &key_out);
+
+    while (r > 0 && key_out.type == GRUB_BTRFS_ITEM_TYPE_CHUNK
+            && key_out.object_id == key_in.object_id)
+    {
+        if (elemsize < sizeof (*chunk))
+        {
+            r = -FSW_VOLUME_CORRUPTED;
+            break;
+        }
+        if (n == allocated)
+        {
+            allocated = allocated ? 2 * allocated : 16;
+            newmap = AllocatePool (sizeof (*map) * allocated);
+            if (!newmap)
+            {
+                r = -FSW_OUT_OF_MEMORY;
+                break;
+            }
+            if (map)
+            {
+                fsw_memcpy (newmap, map, sizeof (*map) * n);
+                FreePool (map);
+            }
+            map = newmap;
+        }
+
+        chunk = AllocatePool (elemsize);
+        if (!chunk)
+        {
+            r = -FSW_OUT_OF_MEMORY;
+            break;
+        }
+        err = fsw_btrfs_read_logical (vol, elemaddr, chunk, elemsize, 0, 1);
+        if (err
+                || elemsize < sizeof (*chunk) + sizeof (struct btrfs_chunk_stripe)
+                * fsw_u16_le_swap (chunk->nstripes)
+                || (n > 0 && fsw_u64_le_swap (key_out.offset) < map[n - 1].end))
+        {
+            FreePool (chunk);
+            r = err ? -err : -FSW_VOLUME_CORRUPTED;
+            break;
+        }
+
+        map[n].start = fsw_u64_le_swap (key_out.offset);
+        map[n].end = map[n].start + fsw_u64_le_swap (chunk->size);
+        map[n].key = key_out;
+        map[n].chunk = chunk;
+        n++;
+
+        r = next (vol, &desc, &elemaddr, &elemsize, &key_out);
+    }
+    free_iterator (&desc);
+
+    if (r < 0 || n == 0)
+    {
+        DPRINT (L"btrfs: chunk map not loaded (%d)\n", -r);
+        if (map)
+            free_chunk_map (map, n);
+        return;
+    }
+
+    DPRINT (L"btrfs: chunk map loaded with %d chunks\n", n);
+    vol->chunk_map = map;
+    vol->n_chunk_map = n;
+}
+
+/* Binary search of the chunk map for the chunk holding a logical address */
+static struct fsw_btrfs_chunk_map *find_chunk_map (struct fsw_btrfs_volume *vol, uint64_t addr)
+{
+    unsigned lo = 0, hi = vol->n_chunk_map, mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (addr < vol->chunk_map[mid].start)
+            hi = mid;
+        else if (addr >= vol->chunk_map[mid].end)
+            lo = mid + 1;
+        else
+            return &vol->chunk_map[mid];
+    }
+    return NULL;
+}
+
 static fsw_status_t fsw_btrfs_read_logical (struct fsw_btrfs_volume *vol, uint64_t addr,
         void *buf, fsw_size_t size, int rdepth, int cache_level)
 {
@@ -904,6 +1218,17 @@ static fsw_status_t fsw_btrfs_read_logical (struct fsw_btrfs_volume *vol, uint64
         uint64_t chaddr;
 
 	err = 0;
+        if (vol->chunk_map)
+        {
+            struct fsw_btrfs_chunk_map *map = find_chunk_map (vol, addr);
+            if (map)
+            {
+                key = &map->key;
+                chunk = map->chunk;
+                goto chunk_found;
+            }
+        }
+
         for (ptr = vol->bootstrap_mapping; ptr < vol->bootstrap_mapping + sizeof (vol->bootstrap_mapping) - sizeof (struct btrfs_key);)
         {
             key = (struct btrfs_key *) ptr;
@@ -1311,8 +1636,6 @@ static fsw_status_t fsw_btrfs_volume_mount(struct fsw_volume *volg) {
     fsw_status_t err;
     int i;
 
-    init_crc32c_table();
-
     err = btrfs_read_superblock (volg, &sblock);
     if (err)
         return err;
@@ -1341,6 +1664,19 @@ static fsw_status_t fsw_btrfs_volume_mount(struct fsw_volume *volg) {
     }
 
     fsw_set_blocksize(volg, vol->sectorsize, vol->sectorsize);
+
+    if (FSW_VERIFY_CSUM(volg)
+            && fsw_u16_le_swap (sblock.csum_type) == BTRFS_CSUM_TYPE_CRC32C
+            && vol->nodesize > BTRFS_CSUM_SIZE)
+    {
+        err = fsw_alloc_zero(sizeof (uint64_t) * VERIFIED_NODES_SIZE,
+            (void **) &vol->verified_nodes);
+        if (err)
+            return err;
+        vol->verified_nodes_size = VERIFIED_NODES_SIZE;
+        vol->csum_verify = 1;
+    }
+
     vol->n_devices_allocated = vol->num_devices;
     vol->rescan_once = vol->num_devices > 1;
     err = fsw_alloc(sizeof (struct fsw_btrfs_device_desc) * vol->n_devices_allocated,
@@ -1366,6 +1702,8 @@ static fsw_status_t fsw_btrfs_volume_mount(struct fsw_volume *volg) {
         return err;
     }
 
+    load_chunk_map(vol);
+
     err = fsw_btrfs_get_default_root(vol, sblock.root_dir_objectid);
     if (err) {
         DPRINT(L"root not found\n");
@@ -1398,6 +1736,10 @@ static void fsw_btrfs_volume_free(struct fsw_volume *volg)
     }
     if(vol->extent)
         FreePool (vol->extent);
+    if(vol->verified_nodes)
+        FreePool (vol->verified_nodes);
+    if(vol->chunk_map)
+        free_chunk_map (vol->chunk_map, vol->n_chunk_map);
     if(vol->rcache) {
 	for(i = 0; i < RECOVER_CACHE_SIZE; i++)
 	    if(vol->rcache->buffer)
@@ -1780,7 +2122,7 @@ static fsw_status_t fsw_btrfs_get_extent(struct fsw_volume *volg, struct fsw_dno
                 FreePool (tmp);
 
                 if (ret != (fsw_ssize_t) csize) {
-                    FreePool(tmp);
+                    FreePool(buf);
                     return -FSW_VOLUME_CORRUPTED;
                 }
 
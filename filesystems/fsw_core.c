@@ -38,7 +38,9 @@
  */
 
 #include "fsw_core.h"
+#ifndef HOST_POSIX
 #include "fsw_efi.h"
+#endif
 
 
 // functions
@@ -231,6 +233,7 @@ fsw_status_t fsw_block_get(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, fsw_u32
         for (i = vol->bcache_size; i < new_bcache_size; i++) {
             new_bcache[i].refcount = 0;
             new_bcache[i].cache_level = 0;
+            new_bcache[i].flags = 0;
             new_bcache[i].phys_bno = (fsw_u64)FSW_INVALID_BNO;
             new_bcache[i].data = NULL;
         }
@@ -256,11 +259,52 @@ fsw_status_t fsw_block_get(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, fsw_u32
 
     vol->bcache[i].phys_bno = phys_bno;
     vol->bcache[i].cache_level = cache_level;
+    vol->bcache[i].flags = 0;
     vol->bcache[i].refcount = 1;
     *buffer_out = vol->bcache[i].data;
     return FSW_SUCCESS;
 }
 
+/**
+ * Get a block like fsw_block_get, and if the host asked for metadata checksums
+ * to be verified, let the file system driver check it. The check runs once, when
+ * the block enters the cache; later calls for the cached block skip it. A block
+ * that fails is released and dropped from the cache, and FSW_VOLUME_CORRUPTED
+ * is returned.
+ */
+
+fsw_status_t fsw_block_get_checked(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, fsw_u32 cache_level,
+                                   fsw_block_check_t check, void *check_data, void **buffer_out)
+{
+    fsw_status_t    status;
+    fsw_u32         i;
+
+    status = fsw_block_get(vol, phys_bno, cache_level, buffer_out);
+    if (status || check == NULL || !FSW_VERIFY_CSUM(vol))
+        return status;
+
+    for (i = 0; i < vol->bcache_size; i++) {
+        if (vol->bcache[i].data == *buffer_out)
+            break;
+    }
+    if (i >= vol->bcache_size || (vol->bcache[i].flags & FSW_BCACHE_CHECKED))
+        return FSW_SUCCESS;
+
+    status = check(vol, check_data, *buffer_out);
+    if (status) {
+        FSW_MSG_DEBUG((FSW_MSGSTR("fsw_block_get_checked: block %d failed its metadata check\n"),
+                        (int)phys_bno));
+        fsw_block_release(vol, phys_bno, *buffer_out);
+        if (vol->bcache[i].refcount == 0)
+            vol->bcache[i].phys_bno = (fsw_u64)FSW_INVALID_BNO;
+        *buffer_out = NULL;
+        return status;
+    }
+
+    vol->bcache[i].flags |= FSW_BCACHE_CHECKED;
+    return FSW_SUCCESS;
+}
+
 /**
  * Releases a disk block. This function must be called to release disk blocks returned
  * from fsw_block_get.
@@ -298,7 +342,9 @@ static void fsw_blockcache_free(struct fsw_volume *vol)
         vol->bcache = NULL;
     }
     vol->bcache_size = 0;
+#ifndef HOST_POSIX
     fsw_efi_clear_cache();
+#endif
 }
 
 /**
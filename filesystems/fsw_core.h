@@ -211,10 +211,14 @@ struct fsw_fstype_table;
 struct fsw_blockcache {
     fsw_u32     refcount;           //!< Reference count
     fsw_u32     cache_level;        //!< Level of importance of this block
+    fsw_u32     flags;              //!< FSW_BCACHE_* flags, cleared on each read
     fsw_u64     phys_bno;           //!< Physical block number
     void        *data;              //!< Block data buffer
 };
 
+/** Block cache flag: the block passed its metadata check since it was read. */
+#define FSW_BCACHE_CHECKED (1)
+
 /**
  * Core: Represents a mounted volume.
  */
@@ -343,8 +347,23 @@ struct fsw_host_table
                                      fsw_u32 old_phys_blocksize, fsw_u32 old_log_blocksize,
                                      fsw_u32 new_phys_blocksize, fsw_u32 new_log_blocksize);
     fsw_status_t EFIAPI (*read_block)(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer);
+
+    fsw_u32     flags;              //!< FSW_HOST_* option flags
 };
 
+/** Host option flag: verify metadata checksums where the file system has them. */
+#define FSW_HOST_VERIFY_CSUM (1)
+
+/** Checks if the host asked for metadata checksums to be verified on a volume. */
+#define FSW_VERIFY_CSUM(vol) (((vol)->host_table->flags & FSW_HOST_VERIFY_CSUM) != 0)
+
+/**
+ * Core: Metadata check callback for fsw_block_get_checked. Returns FSW_SUCCESS
+ * if the block is intact and FSW_VOLUME_CORRUPTED otherwise.
+ */
+
+typedef fsw_status_t (*fsw_block_check_t)(struct VOLSTRUCTNAME *vol, void *check_data, void *buffer);
+
 /**
  * Core: Function table for a file system driver.
  */
@@ -389,6 +408,8 @@ fsw_status_t fsw_volume_stat(struct fsw_volume *vol, struct fsw_volume_stat *sb)
 
 void         fsw_set_blocksize(struct VOLSTRUCTNAME *vol, fsw_u32 phys_blocksize, fsw_u32 log_blocksize);
 fsw_status_t fsw_block_get(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, fsw_u32 cache_level, void **buffer_out);
+fsw_status_t fsw_block_get_checked(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, fsw_u32 cache_level,
+                                   fsw_block_check_t check, void *check_data, void **buffer_out);
 void         fsw_block_release(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, void *buffer);
 
 /*@}*/
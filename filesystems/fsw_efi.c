@@ -80,6 +80,11 @@ EFI_GUID gMyEfiFileInfoGuid                    = EFI_FILE_INFO_ID;
 EFI_GUID gMyEfiFileSystemInfoGuid              = EFI_FILE_SYSTEM_INFO_ID;
 EFI_GUID gMyEfiFileSystemVolumeLabelInfoIdGuid = EFI_FILE_SYSTEM_VOLUME_LABEL_INFO_ID;
 
+/** RefindPlus variables, for the options it passes to drivers it loads. */
+#define FSW_EFI_REFINDPLUS_GUID \
+    { 0x36D08FA7, 0xCF0B, 0x42F5, {0x8F, 0x14, 0x68, 0xDF, 0x73, 0xED, 0x37, 0x40} }
+EFI_GUID gMyRefindPlusGuid                     = FSW_EFI_REFINDPLUS_GUID;
+
 /** Helper macro for stringification. */
 #define FSW_EFI_STRINGIFY(x) #x
 /** Expands to the UEFI driver name given the file system type name. */
@@ -225,7 +230,8 @@ REFINDPLUS_EFI_COMPONENT_NAME_PROTOCOL fsw_efi_ComponentName_table = {
 struct fsw_host_table   fsw_efi_host_table = {
     FSW_STRING_TYPE_UTF16,
     fsw_efi_change_blocksize,
-    fsw_efi_read_block
+    fsw_efi_read_block,
+    0
 };
 
 extern struct fsw_fstype_table   FSW_FSTYPE_TABLE_NAME(FSTYPE);
@@ -292,6 +298,32 @@ EFI_STATUS EFIAPI fsw_efi_main(
 EFI_DRIVER_ENTRY_POINT(fsw_efi_main)
 #endif
 
+/**
+ * Picks up host options set by RefindPlus. Its 'verify_fs_checksums' setting is
+ * passed in the volatile 'VerifyFsChecksums' variable, which is set before any
+ * drivers are loaded and read again on each mount.
+ */
+
+static VOID fsw_efi_read_options(VOID)
+{
+    EFI_STATUS  Status;
+    UINTN       Size;
+    UINT8       Value;
+
+    Size  = sizeof (Value);
+    Value = 0;
+    Status = REFIT_CALL_5_WRAPPER(
+        gRT->GetVariable, L"VerifyFsChecksums",
+        &gMyRefindPlusGuid, NULL, &Size, &Value
+    );
+    if (!EFI_ERROR(Status) && Value != 0) {
+        fsw_efi_host_table.flags |= FSW_HOST_VERIFY_CSUM;
+    }
+    else {
+        fsw_efi_host_table.flags &= ~FSW_HOST_VERIFY_CSUM;
+    }
+}
+
 /**
  * Driver Binding EFI protocol, Supported function. This function is called by EFI
  * to test if this driver can handle a certain device. Our implementation only checks
@@ -395,6 +427,7 @@ fsw_efi_DriverBinding_Start(
     Volume->LastIOStatus    = EFI_SUCCESS;
 
     // mount the filesystem
+    fsw_efi_read_options();
     Status = fsw_efi_map_status(
         fsw_mount(
             Volume,
@@ -23,6 +23,7 @@
  */
 
 #include "fsw_ext4.h"
+#include "../include/crc32_core.h"
 
 
 // functions
@@ -100,6 +101,128 @@ fsw_ext4_group_first_block_no(struct ext4_super_block *sb, fsw_u32 group_no)
                 sb->s_first_data_block;
 }
 
+/**
+ * Metadata checksums (metadata_csum feature). ext4 stores crc32c values without
+ * the final inversion, chained from a seed derived from the file system UUID.
+ * These are only used when the host asked for verification.
+ */
+
+static fsw_u32 fsw_ext4_crc32c(fsw_u32 crc, const void *buf, fsw_u32 size)
+{
+    return ~CrcCoreCrc32c(~crc, buf, size);
+}
+
+static fsw_status_t fsw_ext4_check_superblock(struct ext4_super_block *sb)
+{
+    fsw_u32         size;
+
+    size = (fsw_u32)((fsw_u8 *)&sb->s_checksum - (fsw_u8 *)sb);
+    if (fsw_ext4_crc32c(~0U, sb, size) != sb->s_checksum)
+        return FSW_VOLUME_CORRUPTED;
+
+    return FSW_SUCCESS;
+}
+
+static fsw_status_t fsw_ext4_check_group_desc(struct fsw_ext4_volume *vol, fsw_u32 groupno,
+                                              struct ext4_group_desc *gdesc)
+{
+    fsw_u32         crc, offset;
+    fsw_u16         zero = 0;
+
+    // The checksum field itself is summed as zero
+    offset = (fsw_u32)((fsw_u8 *)&gdesc->bg_checksum - (fsw_u8 *)gdesc);
+    crc = fsw_ext4_crc32c(vol->csum_seed, &groupno, sizeof (groupno));
+    crc = fsw_ext4_crc32c(crc, gdesc, offset);
+    crc = fsw_ext4_crc32c(crc, &zero, sizeof (zero));
+    offset += sizeof (zero);
+    if (offset < vol->sb->s_desc_size)
+        crc = fsw_ext4_crc32c(crc, (fsw_u8 *)gdesc + offset, vol->sb->s_desc_size - offset);
+
+    if ((crc & 0xFFFF) != gdesc->bg_checksum)
+        return FSW_VOLUME_CORRUPTED;
+
+    return FSW_SUCCESS;
+}
+
+static fsw_status_t fsw_ext4_check_inode(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno)
+{
+    struct ext4_inode *raw = dno->raw;
+    fsw_u8          *bytes = (fsw_u8 *)raw;
+    fsw_u32         crc, offset, stored;
+    fsw_u16         zero = 0;
+    int             has_hi = 0;
+
+    // Both checksum halves are summed as zero
+    offset = (fsw_u32)((fsw_u8 *)&raw->osd2.linux2.l_i_checksum_lo - bytes);
+    crc = fsw_ext4_crc32c(dno->csum_seed, bytes, offset);
+    crc = fsw_ext4_crc32c(crc, &zero, sizeof (zero));
+    offset += sizeof (zero);
+    crc = fsw_ext4_crc32c(crc, bytes + offset, EXT4_GOOD_OLD_INODE_SIZE - offset);
+    stored = raw->osd2.linux2.l_i_checksum_lo;
+
+    if (vol->inode_size > EXT4_GOOD_OLD_INODE_SIZE) {
+        offset = (fsw_u32)((fsw_u8 *)&raw->i_checksum_hi - bytes);
+        crc = fsw_ext4_crc32c(crc, bytes + EXT4_GOOD_OLD_INODE_SIZE, offset - EXT4_GOOD_OLD_INODE_SIZE);
+        if (EXT4_GOOD_OLD_INODE_SIZE + raw->i_extra_isize >= offset + sizeof (zero)) {
+            crc = fsw_ext4_crc32c(crc, &zero, sizeof (zero));
+            offset += sizeof (zero);
+            stored |= (fsw_u32)raw->i_checksum_hi << 16;
+            has_hi = 1;
+        }
+        crc = fsw_ext4_crc32c(crc, bytes + offset, vol->inode_size - offset);
+    }
+    if (!has_hi)
+        crc &= 0xFFFF;
+
+    if (crc != stored)
+        return FSW_VOLUME_CORRUPTED;
+
+    return FSW_SUCCESS;
+}
+
+/**
+ * Return the bitmap of verified inodes for a block group, allocating it on first
+ * use. Returns NULL if memory is short, in which case inodes are verified on
+ * every load.
+ */
+
+static fsw_u8 *fsw_ext4_ino_checked_map(struct fsw_ext4_volume *vol, fsw_u32 groupno)
+{
+    if (vol->ino_checked == NULL || groupno >= vol->group_count)
+        return NULL;
+
+    if (vol->ino_checked[groupno] == NULL)
+        fsw_alloc_zero((vol->sb->s_inodes_per_group + 7) / 8, (void **) &vol->ino_checked[groupno]);
+
+    return vol->ino_checked[groupno];
+}
+
+/**
+ * Block check for fsw_block_get_checked. Extent tree blocks end their entry
+ * array with a tail holding the checksum, seeded from the owning inode.
+ */
+
+static fsw_status_t fsw_ext4_check_extent_block(struct fsw_ext4_volume *vol, void *check_data, void *buffer)
+{
+    struct fsw_ext4_dnode *dno = (struct fsw_ext4_dnode *)check_data;
+    struct ext4_extent_header *eh = (struct ext4_extent_header *)buffer;
+    struct ext4_extent_tail *tail;
+    fsw_u32         offset;
+
+    if (eh->eh_magic != EXT4_EXT_MAGIC)
+        return FSW_VOLUME_CORRUPTED;
+
+    offset = sizeof (struct ext4_extent_header) + eh->eh_max * sizeof (struct ext4_extent);
+    if (offset + sizeof (struct ext4_extent_tail) > vol->g.phys_blocksize)
+        return FSW_VOLUME_CORRUPTED;
+
+    tail = (struct ext4_extent_tail *)((fsw_u8 *)buffer + offset);
+    if (fsw_ext4_crc32c(dno->csum_seed, buffer, offset) != tail->et_checksum)
+        return FSW_VOLUME_CORRUPTED;
+
+    return FSW_SUCCESS;
+}
+
 /**
  * Mount an ext4 volume. Reads the superblock and constructs the
  * root directory dnode.
@@ -142,9 +265,25 @@ static fsw_status_t fsw_ext4_volume_mount(struct fsw_ext4_volume *vol)
         (vol->sb->s_feature_incompat & ~(EXT4_FEATURE_INCOMPAT_FILETYPE | EXT4_FEATURE_INCOMPAT_RECOVER |
                                          EXT4_FEATURE_INCOMPAT_EXTENTS | EXT4_FEATURE_INCOMPAT_FLEX_BG |
                                          EXT4_FEATURE_INCOMPAT_64BIT | EXT4_FEATURE_INCOMPAT_META_BG |
-                                         EXT4_FEATURE_INCOMPAT_ENCRYPT)))
+                                         EXT4_FEATURE_INCOMPAT_CSUM_SEED | EXT4_FEATURE_INCOMPAT_ENCRYPT)))
         return FSW_UNSUPPORTED;
 
+    // Metadata checksums are verified only when the host asks for it
+    vol->csum_verify = (FSW_VERIFY_CSUM(&vol->g) &&
+                        (vol->sb->s_feature_ro_compat & EXT4_FEATURE_RO_COMPAT_METADATA_CSUM) &&
+                        vol->sb->s_checksum_type == EXT4_CRC32C_CHKSUM);
+    if (vol->csum_verify) {
+        status = fsw_ext4_check_superblock(vol->sb);
+        if (status)
+            return status;
+
+        // With csum_seed, the seed is kept in the superblock so that the UUID can change
+        if (vol->sb->s_feature_incompat & EXT4_FEATURE_INCOMPAT_CSUM_SEED)
+            vol->csum_seed = vol->sb->s_checksum_seed;
+        else
+            vol->csum_seed = fsw_ext4_crc32c(~0U, vol->sb->s_uuid, sizeof (vol->sb->s_uuid));
+    }
+
     if (vol->sb->s_rev_level == EXT4_DYNAMIC_REV &&
         (vol->sb->s_feature_incompat & EXT4_FEATURE_INCOMPAT_RECOVER))
     {
@@ -192,6 +331,14 @@ static fsw_status_t fsw_ext4_volume_mount(struct fsw_ext4_volume *vol)
     status = fsw_alloc(sizeof (fsw_u64) * groupcnt, &vol->inotab_bno);
     if (status)
         return status;
+    vol->group_count = groupcnt;
+
+    // Inodes are verified once per mount, the group bitmaps are allocated on first use
+    if (vol->csum_verify) {
+        status = fsw_alloc_zero(sizeof (fsw_u8 *) * groupcnt, (void **) &vol->ino_checked);
+        if (status)
+            return status;
+    }
 
     // Loop through all block group descriptors in order to get inode table locations
     for (groupno = 0; groupno < groupcnt; groupno++) {
@@ -221,6 +368,13 @@ static fsw_status_t fsw_ext4_volume_mount(struct fsw_ext4_volume *vol)
 
         // Get group descriptor table and block number of inode table...
         gdesc = (struct ext4_group_desc *)((char *)buffer + gdesc_index * vol->sb->s_desc_size);
+        if (vol->csum_verify) {
+            status = fsw_ext4_check_group_desc(vol, groupno, gdesc);
+            if (status) {
+                fsw_block_release(vol, gdesc_bno, buffer);
+                return status;
+            }
+        }
         vol->inotab_bno[groupno] = gdesc->bg_inode_table_lo;
         if (vol->sb->s_desc_size >= EXT4_MIN_DESC_SIZE_64BIT)
             vol->inotab_bno[groupno] |= (fsw_u64)gdesc->bg_inode_table_hi << 32;
@@ -246,10 +400,19 @@ static fsw_status_t fsw_ext4_volume_mount(struct fsw_ext4_volume *vol)
 
 static void fsw_ext4_volume_free(struct fsw_ext4_volume *vol)
 {
+    fsw_u32         i;
+
     if (vol->sb)
         fsw_free(vol->sb);
     if (vol->inotab_bno)
         fsw_free(vol->inotab_bno);
+    if (vol->ino_checked) {
+        for (i = 0; i < vol->group_count; i++) {
+            if (vol->ino_checked[i])
+                fsw_free(vol->ino_checked[i]);
+        }
+        fsw_free(vol->ino_checked);
+    }
 }
 
 /**
@@ -284,9 +447,10 @@ static fsw_status_t fsw_ext4_volume_stat(struct fsw_ext4_volume *vol, struct fsw
 static fsw_status_t fsw_ext4_dnode_fill(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno)
 {
     fsw_status_t    status;
-    fsw_u32         groupno, ino_in_group, ino_index;
+    fsw_u32         groupno, ino_in_group, ino_index, ino;
     fsw_u64         ino_bno;
     fsw_u8          *buffer;
+    fsw_u8          *checked;
 
     if (dno->raw)
         return FSW_SUCCESS;
@@ -309,6 +473,28 @@ static fsw_status_t fsw_ext4_dnode_fill(struct fsw_ext4_volume *vol, struct fsw_
     if (status)
         return status;
 
+    if (vol->csum_verify) {
+        // The seed chains the inode number and generation onto the volume seed
+        ino = (fsw_u32)dno->g.dnode_id;
+        dno->csum_seed = fsw_ext4_crc32c(vol->csum_seed, &ino, sizeof (ino));
+        dno->csum_seed = fsw_ext4_crc32c(dno->csum_seed, &dno->raw->i_generation, sizeof (fsw_u32));
+
+        // Skip inodes that already passed, the dnode may have been freed and filled again
+        checked = fsw_ext4_ino_checked_map(vol, groupno);
+        if (vol->sb->s_creator_os == EXT4_OS_LINUX &&
+            (checked == NULL || !(checked[ino_in_group / 8] & (1 << (ino_in_group % 8)))))
+        {
+            status = fsw_ext4_check_inode(vol, dno);
+            if (status) {
+                fsw_free(dno->raw);
+                dno->raw = NULL;
+                return status;
+            }
+            if (checked)
+                checked[ino_in_group / 8] |= (fsw_u8)(1 << (ino_in_group % 8));
+        }
+    }
+
     // Get info from the inode
     dno->g.size = dno->raw->i_size_lo; // TODO: check docs for 64-bit sized files
 
@@ -452,7 +638,9 @@ static fsw_status_t fsw_ext4_get_by_extent(struct fsw_ext4_volume *vol, struct f
                 {
                     // Follow extent tree...
                     fsw_u64 phys_bno = ((fsw_u64)ext4_extent_idx->ei_leaf_hi << 32) | ext4_extent_idx->ei_leaf_lo;
-                    status = fsw_block_get(vol, phys_bno, 1, (void **) &buffer);
+                    status = fsw_block_get_checked(vol, phys_bno, 1,
+                                                   vol->csum_verify ? fsw_ext4_check_extent_block : NULL,
+                                                   dno, (void **) &buffer);
                     if (status)
                         return status;
                     buf_offset = 0;
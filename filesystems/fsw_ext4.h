@@ -50,6 +50,10 @@ struct fsw_ext4_volume {
     fsw_u32     ind_bcnt;           //!< Number of blocks addressable through an indirect block
     fsw_u32     dind_bcnt;          //!< Number of blocks addressable through a double-indirect block
     fsw_u32     inode_size;         //!< Size of inode structure in bytes
+    int         csum_verify;        //!< Verify metadata checksums (host option and metadata_csum)
+    fsw_u32     csum_seed;          //!< Checksum seed from the superblock or the file system UUID
+    fsw_u32     group_count;        //!< Number of block groups
+    fsw_u8      **ino_checked;      //!< Per group bitmaps of inodes whose checksum was verified
 };
 
 /**
@@ -60,6 +64,7 @@ struct fsw_ext4_dnode {
     struct fsw_dnode g;             //!< Generic dnode structure
     
     struct ext4_inode *raw;         //!< Full raw inode structure
+    fsw_u32     csum_seed;          //!< Checksum seed for the inode's extent blocks
 };
 
 
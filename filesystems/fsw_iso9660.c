@@ -84,6 +84,12 @@
 
 // extern CHAR8     *msgCursor;
 // extern MESSAGE_LOG_PROTOCOL *Msg;
+//! Offset of the System Use area in a directory record. A padding byte follows
+//! the identifier if its length is even.
+#define ISO9660_SUA_OFFSET(dirrec) \
+    (sizeof (struct iso9660_dirrec) - 1 + (dirrec)->file_identifier_length + \
+     (((dirrec)->file_identifier_length & 1) ^ 1))
+
 // functions
 
 static fsw_status_t fsw_iso9660_volume_mount(struct fsw_iso9660_volume *vol);
@@ -102,6 +108,7 @@ static fsw_status_t fsw_iso9660_dir_lookup(struct fsw_iso9660_volume *vol, struc
 static fsw_status_t fsw_iso9660_dir_read(struct fsw_iso9660_volume *vol, struct fsw_iso9660_dnode *dno,
                                          struct fsw_shandle *shand, struct fsw_iso9660_dnode **child_dno);
 static fsw_status_t fsw_iso9660_read_dirrec(struct fsw_iso9660_volume *vol, struct fsw_shandle *shand, struct iso9660_dirrec_buffer *dirrec_buffer);
+static void         fsw_iso9660_index_free(struct fsw_iso9660_dir_index *index);
 
 static fsw_status_t fsw_iso9660_readlink(struct fsw_iso9660_volume *vol, struct fsw_iso9660_dnode *dno,
                                          struct fsw_string *link);
@@ -136,7 +143,7 @@ static fsw_status_t rr_find_sp(struct iso9660_dirrec *dirrec, struct fsw_rock_ri
     fsw_u8 *r;
     int off = 0;
     struct fsw_rock_ridge_susp_sp *sp;
-    r = (fsw_u8 *)((fsw_u8 *)dirrec + sizeof (*dirrec) + dirrec->file_identifier_length);
+    r = (fsw_u8 *)((fsw_u8 *)dirrec + ISO9660_SUA_OFFSET(dirrec));
     off = (int)(r - (fsw_u8 *)dirrec);
     while(off < dirrec->dirrec_length)
     {
@@ -412,8 +419,14 @@ static fsw_status_t fsw_iso9660_volume_mount(struct fsw_iso9660_volume *vol)
 
 static void fsw_iso9660_volume_free(struct fsw_iso9660_volume *vol)
 {
+    int             i;
+
     if (vol->primary_voldesc)
         fsw_free(vol->primary_voldesc);
+    for (i = 0; i < ISO9660_DIR_INDEX_SLOTS; i++) {
+        if (vol->dir_index[i])
+            fsw_iso9660_index_free(vol->dir_index[i]);
+    }
 }
 
 /**
@@ -501,58 +514,302 @@ static fsw_status_t fsw_iso9660_get_extent(struct fsw_iso9660_volume *vol, struc
 }
 
 /**
- * Lookup a directory's child dnode by name. This function is called on a directory
- * to retrieve the directory entry with the given name. A dnode is constructed for
- * this entry and returned. The core makes sure that fsw_iso9660_dnode_fill has been called
- * and the dnode is actually a directory.
+ * Case folding for name lookups. Names are compared as ISO-8859-1, so this
+ * folds ASCII and Latin-1 lower case letters. Wider characters never match.
  */
 
-static fsw_status_t fsw_iso9660_dir_lookup(struct fsw_iso9660_volume *vol, struct fsw_iso9660_dnode *dno,
-                                           struct fsw_string *lookup_name, struct fsw_iso9660_dnode **child_dno_out)
+static fsw_u32 fsw_iso9660_fold(fsw_u32 c)
+{
+    if ((c >= 'a' && c <= 'z') || (c >= 0xe0 && c <= 0xfe && c != 0xf7))
+        return c - 0x20;
+    return c;
+}
+
+static int fsw_iso9660_name_cmp(const fsw_u8 *name1, fsw_u32 len1, const fsw_u8 *name2, fsw_u32 len2)
+{
+    fsw_u32         i, c1, c2;
+
+    for (i = 0; i < len1 && i < len2; i++) {
+        c1 = fsw_iso9660_fold(name1[i]);
+        c2 = fsw_iso9660_fold(name2[i]);
+        if (c1 != c2)
+            return (c1 < c2) ? -1 : 1;
+    }
+    return (len1 < len2) ? -1 : (len1 > len2);
+}
+
+static int fsw_iso9660_key_cmp(const fsw_u8 *name, fsw_u32 len, const fsw_u16 *key, fsw_u32 key_len)
+{
+    fsw_u32         i, c1, c2;
+
+    for (i = 0; i < len && i < key_len; i++) {
+        c1 = fsw_iso9660_fold(name[i]);
+        c2 = fsw_iso9660_fold(key[i]);
+        if (c1 != c2)
+            return (c1 < c2) ? -1 : 1;
+    }
+    return (len < key_len) ? -1 : (len > key_len);
+}
+
+static void fsw_iso9660_index_free(struct fsw_iso9660_dir_index *index)
+{
+    if (index->entries)
+        fsw_free(index->entries);
+    if (index->names)
+        fsw_free(index->names);
+    fsw_free(index);
+}
+
+/**
+ * Sort the entries of a directory name index by case folded name (heapsort).
+ */
+
+static void fsw_iso9660_index_sort(struct fsw_iso9660_dir_index *index)
+{
+    struct fsw_iso9660_index_entry *e = index->entries;
+    struct fsw_iso9660_index_entry tmp;
+    fsw_u32         n, start, root, child;
+
+#define ENTRY_LESS(a, b) (fsw_iso9660_name_cmp((fsw_u8 *)index->names + e[a].name_offset, e[a].name_len, \
+                                               (fsw_u8 *)index->names + e[b].name_offset, e[b].name_len) < 0)
+
+    n = index->count;
+    if (n < 2)
+        return;
+
+    for (start = n / 2; ; ) {
+        if (start > 0) {
+            start--;            // build the heap
+        } else {
+            n--;                // move the largest entry to the end
+            if (n == 0)
+                break;
+            tmp = e[0]; e[0] = e[n]; e[n] = tmp;
+        }
+        for (root = start; (child = 2 * root + 1) < n; root = child) {
+            if (child + 1 < n && ENTRY_LESS(child, child + 1))
+                child++;
+            if (!ENTRY_LESS(root, child))
+                break;
+            tmp = e[root]; e[root] = e[child]; e[child] = tmp;
+        }
+    }
+
+#undef ENTRY_LESS
+}
+
+/**
+ * Build the name index of a directory. Every record is read once, including
+ * any Rock Ridge continuation areas, and its name is the one that
+ * fsw_iso9660_dir_read reports for it.
+ */
+
+static fsw_status_t fsw_iso9660_index_build(struct fsw_iso9660_volume *vol, struct fsw_iso9660_dnode *dno,
+                                            struct fsw_iso9660_dir_index **index_out)
 {
     fsw_status_t    status;
     struct fsw_shandle shand;
     struct iso9660_dirrec_buffer dirrec_buffer;
     struct iso9660_dirrec *dirrec = &dirrec_buffer.dirrec;
+    struct fsw_iso9660_dir_index *index;
+    struct fsw_iso9660_index_entry *entry;
+    void            *grown;
+    fsw_u32         entries_allocated = 0, names_allocated = 0, names_used = 0;
+    fsw_u64         pos;
+    int             rr_name;
+
+    status = fsw_alloc_zero(sizeof (struct fsw_iso9660_dir_index), (void **) &index);
+    if (status)
+        return status;
+    index->extent_location = ISOINT(dno->dirrec.extent_location);
 
-    // Preconditions: The caller has checked that dno is a directory node.
-
-    // setup handle to read the directory
     status = fsw_shandle_open(dno, &shand);
-    if (status)
+    if (status) {
+        fsw_free(index);
         return status;
+    }
 
     dirrec_buffer.ino = 0;
-
-    // scan the directory for the file
-    while (1) {
-        // read next entry
+    while (shand.pos < dno->g.size) {
+        pos = shand.pos;
         status = fsw_iso9660_read_dirrec(vol, &shand, &dirrec_buffer);
         if (status)
-            goto errorexit;
+            break;
         if (dirrec->dirrec_length == 0) {
-            // end of directory reached
-            status = FSW_NOT_FOUND;
-            goto errorexit;
+            // try the next block, counting from where the padding started
+            shand.pos = (pos & ~(vol->g.log_blocksize - 1)) + vol->g.log_blocksize;
+            continue;
         }
+        rr_name = (dirrec_buffer.name.data != dirrec->file_identifier);
 
         // skip . and ..
         if (dirrec->file_identifier_length == 1 &&
-            (dirrec->file_identifier[0] == 0 || dirrec->file_identifier[0] == 1))
+            (dirrec->file_identifier[0] == 0 || dirrec->file_identifier[0] == 1)) {
+            if (rr_name && dirrec_buffer.name.data)
+                fsw_free(dirrec_buffer.name.data);
             continue;
+        }
+
+        if (index->count == entries_allocated) {
+            entries_allocated = entries_allocated ? 2 * entries_allocated : 32;
+            status = fsw_alloc(entries_allocated * sizeof (struct fsw_iso9660_index_entry), &grown);
+            if (status == FSW_SUCCESS && index->entries) {
+                fsw_memcpy(grown, index->entries, index->count * sizeof (struct fsw_iso9660_index_entry));
+                fsw_free(index->entries);
+            }
+            if (status == FSW_SUCCESS)
+                index->entries = grown;
+        }
+        if (status == FSW_SUCCESS && names_used + dirrec_buffer.name.size > names_allocated) {
+            names_allocated = 2 * (names_allocated + dirrec_buffer.name.size) + 256;
+            status = fsw_alloc(names_allocated, &grown);
+            if (status == FSW_SUCCESS && index->names) {
+                fsw_memcpy(grown, index->names, names_used);
+                fsw_free(index->names);
+            }
+            if (status == FSW_SUCCESS)
+                index->names = grown;
+        }
+        if (status == FSW_SUCCESS) {
+            entry = &index->entries[index->count++];
+            entry->ino = dirrec_buffer.ino;
+            entry->name_offset = names_used;
+            entry->name_len = dirrec_buffer.name.len;
+            fsw_memcpy(&entry->dirrec, dirrec, sizeof (struct iso9660_dirrec));
+            fsw_memcpy(index->names + names_used, dirrec_buffer.name.data, dirrec_buffer.name.size);
+            names_used += dirrec_buffer.name.size;
+        }
 
-        // compare name
-        if (fsw_streq(lookup_name, &dirrec_buffer.name))  // TODO: compare case-insensitively
+        if (rr_name && dirrec_buffer.name.data)
+            fsw_free(dirrec_buffer.name.data);
+        if (status)
             break;
     }
+    fsw_shandle_close(&shand);
+
+    if (status) {
+        fsw_iso9660_index_free(index);
+        return status;
+    }
+
+    fsw_iso9660_index_sort(index);
+    *index_out = index;
+    return FSW_SUCCESS;
+}
+
+/**
+ * Get the name index of a directory, building it on first use. The volume
+ * keeps the most recently built indexes, as directory dnodes may come and go.
+ */
+
+static fsw_status_t fsw_iso9660_index_get(struct fsw_iso9660_volume *vol, struct fsw_iso9660_dnode *dno,
+                                          struct fsw_iso9660_dir_index **index_out)
+{
+    fsw_status_t    status;
+    fsw_u32         extent_location = ISOINT(dno->dirrec.extent_location);
+    int             i;
+
+    for (i = 0; i < ISO9660_DIR_INDEX_SLOTS; i++) {
+        if (vol->dir_index[i] && vol->dir_index[i]->extent_location == extent_location) {
+            *index_out = vol->dir_index[i];
+            return FSW_SUCCESS;
+        }
+    }
+
+    status = fsw_iso9660_index_build(vol, dno, index_out);
+    if (status)
+        return status;
+
+    i = vol->dir_index_next;
+    vol->dir_index_next = (i + 1) % ISO9660_DIR_INDEX_SLOTS;
+    if (vol->dir_index[i])
+        fsw_iso9660_index_free(vol->dir_index[i]);
+    vol->dir_index[i] = *index_out;
+    return FSW_SUCCESS;
+}
+
+/**
+ * Lookup a directory's child dnode by name. This function is called on a directory
+ * to retrieve the directory entry with the given name. A dnode is constructed for
+ * this entry and returned. The core makes sure that fsw_iso9660_dnode_fill has been called
+ * and the dnode is actually a directory.
+ *
+ * Names are matched case-insensitively by binary search of the directory's name index.
+ * An entry matching in case is preferred over one that only matches when folded.
+ */
+
+static fsw_status_t fsw_iso9660_dir_lookup(struct fsw_iso9660_volume *vol, struct fsw_iso9660_dnode *dno,
+                                           struct fsw_string *lookup_name, struct fsw_iso9660_dnode **child_dno_out)
+{
+    fsw_status_t    status;
+    struct fsw_iso9660_dir_index *index;
+    struct fsw_iso9660_index_entry *entry, *found;
+    struct fsw_string key, name;
+    fsw_u8          *entry_name;
+    fsw_u16         *key_data;
+    fsw_u32         lo, hi, mid, i;
+
+    // Preconditions: The caller has checked that dno is a directory node.
+
+    if (lookup_name->type == FSW_STRING_TYPE_EMPTY || lookup_name->len == 0)
+        return FSW_NOT_FOUND;
+
+    status = fsw_iso9660_index_get(vol, dno, &index);
+    if (status)
+        return status;
+
+    // compare in UTF-16 code units, so wide characters cannot alias Latin-1 ones
+    key.type = FSW_STRING_TYPE_EMPTY;
+    if (lookup_name->type == FSW_STRING_TYPE_UTF16) {
+        key_data = (fsw_u16 *)lookup_name->data;
+    } else {
+        status = fsw_strdup_coerce(&key, FSW_STRING_TYPE_UTF16, lookup_name);
+        if (status)
+            return status;
+        key_data = (fsw_u16 *)key.data;
+    }
+
+    // find the first entry not below the name
+    lo = 0;
+    hi = index->count;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        entry = &index->entries[mid];
+        if (fsw_iso9660_key_cmp((fsw_u8 *)index->names + entry->name_offset, entry->name_len,
+                                key_data, lookup_name->len) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    found = NULL;
+    for (; lo < index->count; lo++) {
+        entry = &index->entries[lo];
+        entry_name = (fsw_u8 *)index->names + entry->name_offset;
+        if (fsw_iso9660_key_cmp(entry_name, entry->name_len, key_data, lookup_name->len) != 0)
+            break;
+        if (found == NULL)
+            found = entry;
+        for (i = 0; i < entry->name_len && entry_name[i] == key_data[i]; i++)
+            ;
+        if (i == entry->name_len) {
+            found = entry;
+            break;
+        }
+    }
+    fsw_strfree(&key);
+
+    if (found == NULL)
+        return FSW_NOT_FOUND;
 
     // setup a dnode for the child item
-    status = fsw_dnode_create(dno, dirrec_buffer.ino, FSW_DNODE_TYPE_UNKNOWN, &dirrec_buffer.name, child_dno_out);
+    name.type = FSW_STRING_TYPE_ISO88591;
+    name.len = name.size = found->name_len;
+    name.data = index->names + found->name_offset;
+    status = fsw_dnode_create(dno, found->ino, FSW_DNODE_TYPE_UNKNOWN, &name, child_dno_out);
     if (status == FSW_SUCCESS)
-        fsw_memcpy(&(*child_dno_out)->dirrec, dirrec, sizeof (struct iso9660_dirrec));
+        fsw_memcpy(&(*child_dno_out)->dirrec, &found->dirrec, sizeof (struct iso9660_dirrec));
 
-errorexit:
-    fsw_shandle_close(&shand);
     return status;
 }
 
@@ -570,6 +827,7 @@ static fsw_status_t fsw_iso9660_dir_read(struct fsw_iso9660_volume *vol, struct
     fsw_status_t    status;
     struct iso9660_dirrec_buffer dirrec_buffer;
     struct iso9660_dirrec *dirrec = &dirrec_buffer.dirrec;
+    fsw_u64         pos;
 
     // Preconditions: The caller has checked that dno is a directory node. The caller
     //  has opened a storage handle to the directory's storage and keeps it around between
@@ -584,20 +842,24 @@ static fsw_status_t fsw_iso9660_dir_read(struct fsw_iso9660_volume *vol, struct
         // read next entry
         if (shand->pos >= dno->g.size)
             return FSW_NOT_FOUND; // end of directory
+        pos = shand->pos;
         status = fsw_iso9660_read_dirrec(vol, shand, &dirrec_buffer);
         if (status)
             return status;
         if (dirrec->dirrec_length == 0)
         {
-            // try the next block
-            shand->pos =(shand->pos & ~(vol->g.log_blocksize - 1)) + vol->g.log_blocksize;
+            // try the next block; the read may have run past the padding into it
+            shand->pos = (pos & ~(vol->g.log_blocksize - 1)) + vol->g.log_blocksize;
             continue;
         }
 
         // skip . and ..
         if (dirrec->file_identifier_length == 1 &&
-            (dirrec->file_identifier[0] == 0 || dirrec->file_identifier[0] == 1))
+            (dirrec->file_identifier[0] == 0 || dirrec->file_identifier[0] == 1)) {
+            if (dirrec_buffer.name.data != dirrec->file_identifier && dirrec_buffer.name.data)
+                fsw_free(dirrec_buffer.name.data);
             continue;
+        }
         break;
     }
 
@@ -606,6 +868,10 @@ static fsw_status_t fsw_iso9660_dir_read(struct fsw_iso9660_volume *vol, struct
     if (status == FSW_SUCCESS)
         fsw_memcpy(&(*child_dno_out)->dirrec, dirrec, sizeof (struct iso9660_dirrec));
 
+    // Rock Ridge names are allocated by rr_find_nm, the dnode holds its own copy
+    if (dirrec_buffer.name.data != dirrec->file_identifier && dirrec_buffer.name.data)
+        fsw_free(dirrec_buffer.name.data);
+
     return status;
 }
 
@@ -663,7 +929,7 @@ static fsw_status_t fsw_iso9660_read_dirrec(struct fsw_iso9660_volume *vol, stru
 //     dump_dirrec(dirrec);
      if (vol->fRockRidge)
      {
-         sp_off = sizeof (*dirrec) + dirrec->file_identifier_length;
+         sp_off = ISO9660_SUA_OFFSET(dirrec);
          rc = rr_find_sp(dirrec, &sp);
          if (   rc == FSW_SUCCESS
              && sp != NULL)
@@ -140,6 +140,32 @@ struct iso9660_dirrec_buffer {
 };
 
 
+/**
+ * ISO9660: One directory record in a directory name index.
+ */
+
+struct fsw_iso9660_index_entry {
+    fsw_u32     ino;                //!< Inode number, as from fsw_iso9660_read_dirrec
+    fsw_u32     name_offset;        //!< Offset of the name in the index name pool
+    fsw_u32     name_len;           //!< Length of the name (ISO-8859-1)
+    struct iso9660_dirrec dirrec;   //!< Fixed part of the directory record
+};
+
+/**
+ * ISO9660: Name index of a directory, sorted by case folded name. Built on the
+ * first lookup in a directory and kept per volume, keyed by directory extent.
+ */
+
+struct fsw_iso9660_dir_index {
+    fsw_u32     extent_location;    //!< Extent of the indexed directory
+    fsw_u32     count;              //!< Number of entries
+    struct fsw_iso9660_index_entry *entries;
+    char        *names;             //!< Name pool
+};
+
+//! Number of directory name indexes kept per volume.
+#define ISO9660_DIR_INDEX_SLOTS 16
+
 /**
  * ISO9660: Volume structure with ISO9660-specific data.
  */
@@ -153,6 +179,9 @@ struct fsw_iso9660_volume {
     /*Rock Ridge specific fields*/
     int rr_susp_skip;
 
+    struct fsw_iso9660_dir_index *dir_index[ISO9660_DIR_INDEX_SLOTS];  //!< Directory name indexes
+    int dir_index_next;             //!< Slot to reuse next
+
     struct iso9660_primary_volume_descriptor *primary_voldesc;  //!< Full Primary Volume Descriptor
 };
 
@@ -281,7 +281,11 @@ static ush mask_bits[] =
 
 /* DA-TAG: Modified by Dayo Akanji (sf.net/u/dakanji/profile). 28 Nov 2021 */
 // Make conditional to remove MacOS Clang compile warning
-#if !defined(__has_warning) || __has_warning("-Wunsafe-loop-optimizations")
+#if defined(__has_warning)
+#if __has_warning("-Wunsafe-loop-optimizations")
+#pragma GCC diagnostic ignored "-Wunsafe-loop-optimizations"
+#endif
+#else
 #pragma GCC diagnostic ignored "-Wunsafe-loop-optimizations"
 #endif
 
@@ -0,0 +1,69 @@
+#!/bin/sh
+#
+# csum_test.sh
+# Check metadata checksum verification of the ext4 and btrfs drivers with lslr
+#
+# Each image is read with and without '-c'. Clean images must read both ways,
+# corrupted ones only without verification. Needs mkfs.ext4, tune2fs and
+# debugfs for the ext4 images; the btrfs images come from mkbtrfs.py.
+#
+
+MAKE=${MAKE:-make}
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+FAILED=0
+
+# expect <verify exit> <image> <description>
+expect() {
+    if ./lslr "$2" >/dev/null 2>&1; then
+        PLAIN=0
+    else
+        PLAIN=1
+    fi
+    ./lslr -c "$2" >/dev/null 2>&1
+    CHECKED=$?
+    if [ $PLAIN -ne 0 ] || [ $CHECKED -ne "$1" ]; then
+        echo "FAIL: $3 (plain $PLAIN, verified $CHECKED)"
+        FAILED=$((FAILED + 1))
+    else
+        echo "ok:   $3"
+    fi
+}
+
+# corrupt <image> <byte offset>
+corrupt() {
+    printf '\125' | dd of="$1" bs=1 seek="$2" conv=notrunc 2>/dev/null
+}
+
+mkdir -p "$TMP/root/boot"
+printf 'ext4 checksum test file\n' > "$TMP/root/boot/testfile.txt"
+
+$MAKE -s clean && $MAKE -s DRIVERNAME=ext4 >/dev/null 2>&1 || exit 1
+
+mkfs.ext4 -q -F -O metadata_csum -d "$TMP/root" "$TMP/ext4.img" 4M >/dev/null || exit 1
+expect 0 "$TMP/ext4.img" "ext4 metadata_csum"
+
+# The seed stays in the superblock, so checksums survive a UUID change
+mkfs.ext4 -q -F -O metadata_csum,metadata_csum_seed -d "$TMP/root" "$TMP/seed.img" 4M >/dev/null || exit 1
+tune2fs -U random "$TMP/seed.img" >/dev/null || exit 1
+expect 0 "$TMP/seed.img" "ext4 metadata_csum_seed after UUID change"
+
+# Flip a byte of the atime of the test file inode
+LOC=$(debugfs -R "imap /boot/testfile.txt" "$TMP/seed.img" 2>/dev/null | sed -n 's/.*located at block \([0-9]*\), offset \(0x[0-9a-f]*\).*/\1 \2/p')
+BSIZE=$(dumpe2fs -h "$TMP/seed.img" 2>/dev/null | sed -n 's/^Block size: *//p')
+set -- $LOC
+corrupt "$TMP/seed.img" $(($1 * BSIZE + $2 + 8))
+expect 1 "$TMP/seed.img" "ext4 corrupted inode"
+
+$MAKE -s clean && $MAKE -s DRIVERNAME=btrfs >/dev/null 2>&1 || exit 1
+
+python3 mkbtrfs.py "$TMP/btrfs.img" || exit 1
+expect 0 "$TMP/btrfs.img" "btrfs two level fs tree"
+
+python3 mkbtrfs.py "$TMP/btrfs-bad.img" corrupt || exit 1
+expect 1 "$TMP/btrfs-bad.img" "btrfs corrupted leaf"
+
+$MAKE -s clean
+
+echo "$FAILED failed"
+[ $FAILED -eq 0 ]
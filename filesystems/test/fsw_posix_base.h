@@ -61,11 +61,29 @@ typedef uint32_t            fsw_u32;
 typedef int64_t             fsw_s64;
 typedef uint64_t            fsw_u64;
 
+// basic UEFI types, for headers shared with the EFI host
+
+typedef uint8_t             UINT8;
+typedef uint16_t            UINT16;
+typedef uint32_t            UINT32;
+typedef uint64_t            UINT64;
+typedef uintptr_t           UINTN;
+typedef uint8_t             BOOLEAN;
+#define VOID                void
+#define CONST               const
+#define IN
+#define OUT
+#define TRUE                ((BOOLEAN)1)
+#define FALSE               ((BOOLEAN)0)
+#define EFIAPI
+
 
 // allocation functions
 
 #define fsw_alloc(size, ptrptr) (((*(ptrptr) = malloc(size)) == NULL) ? FSW_OUT_OF_MEMORY : FSW_SUCCESS)
 #define fsw_free(ptr) free(ptr)
+#define AllocatePool(size) malloc(size)
+#define FreePool(ptr) free(ptr)
 
 // memory functions
 
@@ -82,6 +100,13 @@ typedef uint64_t            fsw_u64;
 
 #define FSW_U64_SHR(val,shiftbits) ((val) >> (shiftbits))
 #define FSW_U64_DIV(val,divisor) ((val) / (divisor))
+
+static inline fsw_u64 DivU64x32Remainder(fsw_u64 val, fsw_u32 divisor, fsw_u32 *rem)
+{
+    if (rem)
+        *rem = (fsw_u32)(val % divisor);
+    return val / divisor;
+}
 #define DEBUG(x)
 
 #define RShiftU64(val, shift) ((val) >> (shift))
@@ -40,6 +40,10 @@
 
 #include "fsw_posix.h"
 
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
 
 //extern struct fsw_fstype_table FSW_FSTYPE_TABLE_NAME(ext2);
 //extern struct fsw_fstype_table FSW_FSTYPE_TABLE_NAME(reiserfs);
@@ -52,11 +56,13 @@ static struct fsw_fstype_table *fstypes[] = {
     NULL
 };
 
+static int quiet = 0;
+
 static int listdir(struct fsw_posix_volume *vol, char *path, int level)
 {
     struct fsw_posix_dir *dir;
     struct dirent *dent;
-    int i;
+    int i, err = 0;
     char subpath[4096];
 
     dir = fsw_posix_opendir(vol, path);
@@ -65,19 +71,21 @@ static int listdir(struct fsw_posix_volume *vol, char *path, int level)
         return 1;
     }
     while ((dent = fsw_posix_readdir(dir)) != NULL) {
-        for (i = 0; i < level*2; i++)
-            fputc(' ', stderr);
-        fprintf(stderr, "%d  %s\n", dent->d_type, dent->d_name);
+        if (!quiet) {
+            for (i = 0; i < level*2; i++)
+                fputc(' ', stderr);
+            fprintf(stderr, "%d  %s\n", dent->d_type, dent->d_name);
+        }
 
         if (dent->d_type == DT_DIR) {
             snprintf(subpath, 4095, "%s%s/", path, dent->d_name);
-            listdir(vol, subpath, level + 1);
+            err |= listdir(vol, subpath, level + 1);
         }
     }
 
     fsw_posix_closedir(dir);
 
-    return 0;
+    return err;
 }
 
 static int catfile(struct fsw_posix_volume *vol, char *path)
@@ -95,44 +103,76 @@ static int catfile(struct fsw_posix_volume *vol, char *path)
     while ((r=fsw_posix_read(file, buf, sizeof (buf))) > 0)
     {
         int i;
-        for (i=0; i<r; i++)
+        for (i=0; i<r && !quiet; i++)
         {
            printf("%c", buf[i]);
         }
     }
     fsw_posix_close(file);
 
+    if (r < 0) {
+        fprintf(stderr, "read(%s) call failed.\n", path);
+        return 1;
+    }
     return 0;
 }
 
 int main(int argc, char **argv)
 {
     struct fsw_posix_volume *vol;
-    int i;
-
-    if (argc != 2) {
-        fprintf(stderr, "Usage: lslr <file/device>\n");
-        return 1;
-    }
-
-    for (i = 0; fstypes[i]; i++) {
-        vol = fsw_posix_mount(argv[1], fstypes[i]);
-        if (vol != NULL) {
-            fprintf(stderr, "Mounted as '%s'.\n", fstypes[i]->name.data);
+    struct timeval start, end;
+    int i, opt, pass, passes = 1, err = 0;
+
+    while ((opt = getopt(argc, argv, "ct:")) != -1) {
+        switch (opt) {
+        case 'c':
+            /* verify metadata checksums, as with 'verify_fs_checksums' */
+            fsw_posix_host_table.flags |= FSW_HOST_VERIFY_CSUM;
+            break;
+        case 't':
+            /* time repeated mount and walk passes, without output */
+            passes = atoi(optarg);
+            quiet = 1;
+            break;
+        default:
+            passes = 0;
             break;
         }
     }
-    if (vol == NULL) {
-        fprintf(stderr, "Mounting failed.\n");
+
+    if (optind != argc - 1 || passes < 1) {
+        fprintf(stderr, "Usage: lslr [-c] [-t passes] <file/device>\n");
         return 1;
     }
 
-    listdir(vol, "/boot/", 0);
-    catfile(vol, "/boot/testfile.txt");
+    gettimeofday(&start, NULL);
+    for (pass = 0; pass < passes; pass++) {
+        vol = NULL;
+        for (i = 0; fstypes[i]; i++) {
+            vol = fsw_posix_mount(argv[optind], fstypes[i]);
+            if (vol != NULL) {
+                if (!quiet)
+                    fprintf(stderr, "Mounted as '%s'.\n", fstypes[i]->name.data);
+                break;
+            }
+        }
+        if (vol == NULL) {
+            fprintf(stderr, "Mounting failed.\n");
+            return 1;
+        }
 
-    fsw_posix_unmount(vol);
+        err |= listdir(vol, "/boot/", 0);
+        err |= catfile(vol, "/boot/testfile.txt");
 
-    return 0;
+        fsw_posix_unmount(vol);
+    }
+    gettimeofday(&end, NULL);
+
+    if (quiet)
+        fprintf(stderr, "%d passes, %.1f us per mount and walk\n", passes,
+            ((end.tv_sec - start.tv_sec) * 1e6 + (end.tv_usec - start.tv_usec)) / passes);
+
+    return err;
 }
 
 // EOF
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+
+#
+# mkbtrfs.py
+# Write a minimal single device btrfs image for the lslr checksum tests
+#
+# The image holds /boot/testfile.txt in a two level fs tree, so that
+# lookups descend through an internal node and directory reads step from
+# one leaf into the next. All tree nodes carry crc32c checksums.
+#
+# Usage: mkbtrfs.py <image> [corrupt]
+#
+# With 'corrupt', one unused byte of the second fs tree leaf is flipped
+# after checksumming: the image still reads without verification, but
+# fails with it.
+#
+
+import struct
+import sys
+
+SECTORSIZE = 4096
+NODESIZE = 16384
+IMAGE_SIZE = 4 * 1024 * 1024
+SUPER_OFFSET = 0x10000
+
+CHUNK_START = 0x100000
+CHUNK_TREE = CHUNK_START
+ROOT_TREE = CHUNK_START + NODESIZE
+FS_TREE = CHUNK_START + 2 * NODESIZE
+FS_LEAF1 = CHUNK_START + 3 * NODESIZE
+FS_LEAF2 = CHUNK_START + 4 * NODESIZE
+
+FSID = bytes(range(0x10, 0x20))
+GENERATION = 1
+
+INODE_ITEM = 0x01
+DIR_ITEM = 0x54
+EXTENT_DATA = 0x6c
+ROOT_ITEM = 0x84
+CHUNK_ITEM = 0xe4
+
+HEADER_SIZE = 0x65
+TESTFILE = b"btrfs checksum test file\n"
+
+
+def crc32c(data, crc=0):
+    crc ^= 0xffffffff
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ (0x82f63b78 if crc & 1 else 0)
+    return crc ^ 0xffffffff
+
+
+def name_hash(name):
+    return ~crc32c(name, 1) & 0xffffffff
+
+
+def key(objectid, type, offset):
+    return struct.pack("<QBQ", objectid, type, offset)
+
+
+def header(bytenr, owner, nritems, level):
+    return (bytes(0x20) + FSID + struct.pack("<QQ", bytenr, 1) + bytes(16)
+            + struct.pack("<QQIB", GENERATION, owner, nritems, level))
+
+
+def seal(node):
+    node = bytearray(node)
+    struct.pack_into("<I", node, 0, crc32c(bytes(node[0x20:])))
+    return node
+
+
+def leaf(bytenr, owner, items):
+    """items: sorted list of (key bytes, data bytes)"""
+    node = bytearray(NODESIZE)
+    node[0:HEADER_SIZE] = header(bytenr, owner, len(items), 0)
+    data_end = NODESIZE - HEADER_SIZE
+    for i, (k, data) in enumerate(items):
+        data_end -= len(data)
+        off = HEADER_SIZE + i * 25
+        node[off:off + 25] = k + struct.pack("<II", data_end, len(data))
+        node[HEADER_SIZE + data_end:HEADER_SIZE + data_end + len(data)] = data
+    return seal(node)
+
+
+def internal(bytenr, owner, ptrs):
+    """ptrs: sorted list of (key bytes, child bytenr)"""
+    node = bytearray(NODESIZE)
+    node[0:HEADER_SIZE] = header(bytenr, owner, len(ptrs), 1)
+    for i, (k, child) in enumerate(ptrs):
+        off = HEADER_SIZE + i * 33
+        node[off:off + 33] = k + struct.pack("<QQ", child, GENERATION)
+    return seal(node)
+
+
+def inode_item(mode, size, nlink):
+    item = struct.pack("<QQQQQIIIIQQQ", GENERATION, GENERATION, size, size, 0,
+                       nlink, 0, 0, mode, 0, 0, 0)
+    item += bytes(32)
+    item += struct.pack("<qI", 1700000000, 0) * 4
+    return item
+
+
+def dir_item(location, type, name):
+    return location + struct.pack("<QHHB", GENERATION, 0, len(name), type) + name
+
+
+def chunk_item():
+    # one single stripe chunk, mapped 1:1 onto device 1
+    return (struct.pack("<QQQQIIIHH", IMAGE_SIZE - CHUNK_START, 2, 0x10000, 7,
+                        SECTORSIZE, SECTORSIZE, SECTORSIZE, 1, 0)
+            + struct.pack("<QQ", 1, CHUNK_START) + bytes(16))
+
+
+def root_item(bytenr):
+    item = bytearray(439)
+    item[0:0xa0] = inode_item(0o40755, 3, 1)
+    struct.pack_into("<QQQ", item, 0xa0, GENERATION, 256, bytenr)
+    return bytes(item)
+
+
+def superblock():
+    sb = bytearray(SECTORSIZE)
+    chunk_key = key(256, CHUNK_ITEM, CHUNK_START)
+    sys_chunks = chunk_key + chunk_item()
+    sb[0x20:0x30] = FSID
+    struct.pack_into("<QQ", sb, 0x30, SUPER_OFFSET, 0)
+    sb[0x40:0x48] = b"_BHRfS_M"
+    struct.pack_into("<QQQ", sb, 0x48, GENERATION, ROOT_TREE, CHUNK_TREE)
+    struct.pack_into("<QQQQ", sb, 0x70, IMAGE_SIZE, 5 * NODESIZE, 6, 1)
+    struct.pack_into("<IIII", sb, 0x90, SECTORSIZE, NODESIZE, NODESIZE, SECTORSIZE)
+    struct.pack_into("<II", sb, 0xa0, len(sys_chunks), GENERATION)
+    struct.pack_into("<H", sb, 0xc4, 0)
+    struct.pack_into("<QQQ", sb, 0xc9, 1, IMAGE_SIZE, 5 * NODESIZE)
+    sb[0x12b:0x12b + 5] = b"btrfs"
+    sb[0x32b:0x32b + len(sys_chunks)] = sys_chunks
+    return seal(sb)
+
+
+def main():
+    if len(sys.argv) not in (2, 3) or (len(sys.argv) == 3 and sys.argv[2] != "corrupt"):
+        sys.stderr.write("Usage: mkbtrfs.py <image> [corrupt]\n")
+        return 1
+
+    boot = b"boot"
+    testfile = b"testfile.txt"
+    leaf1_items = [
+        (key(256, INODE_ITEM, 0), inode_item(0o40755, 2 * len(boot), 1)),
+        (key(256, DIR_ITEM, name_hash(boot)),
+            dir_item(key(257, INODE_ITEM, 0), 2, boot)),
+        (key(257, INODE_ITEM, 0), inode_item(0o40755, 2 * len(testfile), 1)),
+    ]
+    leaf2_items = [
+        (key(257, DIR_ITEM, name_hash(testfile)),
+            dir_item(key(258, INODE_ITEM, 0), 1, testfile)),
+        (key(258, INODE_ITEM, 0), inode_item(0o100644, len(TESTFILE), 1)),
+        (key(258, EXTENT_DATA, 0),
+            struct.pack("<QQBBHB", GENERATION, len(TESTFILE), 0, 0, 0, 0) + TESTFILE),
+    ]
+
+    nodes = {
+        CHUNK_TREE: leaf(CHUNK_TREE, 3, [(key(256, CHUNK_ITEM, CHUNK_START), chunk_item())]),
+        ROOT_TREE: leaf(ROOT_TREE, 1, [(key(5, ROOT_ITEM, 0), root_item(FS_TREE))]),
+        FS_TREE: internal(FS_TREE, 5, [(leaf1_items[0][0], FS_LEAF1),
+                                       (leaf2_items[0][0], FS_LEAF2)]),
+        FS_LEAF1: leaf(FS_LEAF1, 5, leaf1_items),
+        FS_LEAF2: leaf(FS_LEAF2, 5, leaf2_items),
+    }
+    if len(sys.argv) == 3:
+        nodes[FS_LEAF2][NODESIZE // 2] ^= 0xff
+
+    image = bytearray(IMAGE_SIZE)
+    image[SUPER_OFFSET:SUPER_OFFSET + SECTORSIZE] = superblock()
+    for bytenr, node in nodes.items():
+        image[bytenr:bytenr + NODESIZE] = node
+
+    with open(sys.argv[1], "wb") as f:
+        f.write(image)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -16,7 +16,10 @@
 # "Mono" will turn up most suitable candidates.
 #
 # Usage:
-# ./mkfont.sh font-name font-size font-Y-offset bitmap-filename.png
+# ./mkfont.sh font-name font-size font-Y-offset bitmap-filename.png [first-code-point]
+#
+# When a first code point is given, in hex, a font range file holding the
+# 128 glyphs from that code point is created instead of the ASCII font.
 #
 # This script is part of the rEFInd package. Version numbers refer to
 # the rEFInd version with which the script was released.
@@ -33,13 +36,15 @@
 ###
 
 
-if [[ $# != 4 ]] ; then
-   echo "Usage: $0 font-name font-size y-offset bitmap-filename.png"
+if [[ $# != 4 && $# != 5 ]] ; then
+   echo "Usage: $0 font-name font-size y-offset bitmap-filename.png [first-code-point]"
    echo "   font-name: Name of font (use 'convert -list font | less' to get list)"
    echo "              NOTE: Font MUST be monospaced!!"
    echo "   font-size: Font size in points"
    echo "   y-offset: pixels font is shifted (may be negative)"
    echo "   bitmap-filename.png: output filename"
+   echo "   first-code-point: first of 128 code points (hex, multiple of 80) for a"
+   echo "                     font range file, such as 0400 for Cyrillic"
    echo ""
    exit 1
 fi
@@ -55,6 +60,24 @@ fi
 Height=$2
 let CellWidth=(${Height}*6+5)/10
 #let CellWidth=(${Height}*5)/10
+
+if [[ $# == 5 ]] ; then
+   let First=16#$5
+   if (( First < 128 || First > 65408 || First % 128 != 0 )) ; then
+      echo "The first code point must be a multiple of 80 from 0080 to FF80"
+      exit 1
+   fi
+   Text=""
+   for (( Code = First ; Code < First + 128 ; Code++ )) ; do
+      Text+="$(printf "\\u$(printf %04x ${Code})")"
+   done
+   let Width=${CellWidth}*128
+   echo "Creating ${Width}x${Height} font range bitmap."
+   $Convert -size ${Width}x${Height} xc:transparent -gravity NorthWest -font $1 -pointsize $2 \
+         -draw "text 0,$3 '${Text}'" $4
+   exit $?
+fi
+
 let Width=${CellWidth}*96
 echo "Creating ${Width}x${Height} font bitmap."
 $Convert -size ${Width}x${Height} xc:transparent -gravity NorthWest -font $1 -pointsize $2 \
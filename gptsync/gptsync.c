@@ -46,7 +46,9 @@
 #include "../include/version.h"
 
 #include "../include/syslinux_mbr.h"
+#ifdef CONFIG_EFI
 #define memcpy(a, b, c) CopyMem(a, b, c)
+#endif
 
 //
 // MBR functions
@@ -400,13 +402,16 @@ VOID generate_hybrid_mbr(VOID) {
     } // for
 } // VOID generate_hybrid_mbr()
 
-// Examine partitions and decide whether a rewrite is in order.
-// Note that this function MAY ask user for advice.
-// Note that this function assumes the new hybrid MBR has already
-// been computed and stored in new_mbr_parts[].
+#define SYNC_IDENTICAL      (0)
+#define SYNC_REWRITE        (1)
+#define SYNC_DROP_HYBRID    (2)
+#define SYNC_REPLACE_HYBRID (3)
+
+// Compare the proposed hybrid MBR in new_mbr_parts[] with the current one.
+// Returns one of the SYNC_* values above.
 static
-BOOLEAN should_rewrite(VOID) {
-   BOOLEAN retval, all_identical, invalid;
+UINTN compare_mbr(VOID) {
+   BOOLEAN all_identical;
    UINTN i, num_existing_hybrid, num_new_hybrid;
 
    // Check to see if the proposed table is identical to the current one;
@@ -429,48 +434,63 @@ BOOLEAN should_rewrite(VOID) {
          num_new_hybrid++;
    } // for
 
-   if (all_identical) {
-      Print(L"Tables are synchronized, no need to sync.\n");
-      return FALSE;
-   }
+   if (all_identical)
+      return SYNC_IDENTICAL;
+   if ((num_new_hybrid == 0) && (num_existing_hybrid > 0))
+      return SYNC_DROP_HYBRID;
+   if ((num_new_hybrid > 0) && (num_existing_hybrid > 0))
+      return SYNC_REPLACE_HYBRID;
+
+   return SYNC_REWRITE;
+} // UINTN compare_mbr()
+
+// Examine partitions and decide whether a rewrite is in order.
+// Note that this function MAY ask user for advice.
+// Note that this function assumes the new hybrid MBR has already
+// been computed and stored in new_mbr_parts[].
+static
+BOOLEAN should_rewrite(VOID) {
+   BOOLEAN retval, invalid;
 
-   // If there is nothing to hybridize, but an existing hybrid MBR exists, offer to replace
-   // the hybrid MBR with a protective MBR.
    retval = TRUE;
-   if ((num_new_hybrid == 0) && (num_existing_hybrid > 0)) {
-      Print(L"Found no partitions that could be hybridized, but an existing hybrid MBR exists.\n");
-      Print(L"If you proceed, a fresh protective MBR will be created. Do you want to create\n");
-      invalid = input_boolean(STR("this new protective MBR, erasing the hybrid MBR? [y/N] "), &retval);
-      if (invalid)
-         retval = FALSE;
-   } // if
-
-   // If existing hybrid MBR that is NOT identical to the new one, ask the user
-   // before overwriting the old one.
-   if ((num_new_hybrid > 0) && (num_existing_hybrid > 0)) {
-      Print(L"Existing hybrid MBR detected, but it is not identical to what this program\n");
-      Print(L"would generate. Do you want to see the hybrid MBR that this program would\n");
-      invalid = input_boolean(STR("generate? [y/N] "), &retval);
-      if (invalid)
+   switch (compare_mbr()) {
+      case SYNC_IDENTICAL:
+         Print(L"Tables are synchronized, no need to sync.\n");
          retval = FALSE;
-   } // if
+         break;
+
+      // If there is nothing to hybridize, but an existing hybrid MBR exists, offer to replace
+      // the hybrid MBR with a protective MBR.
+      case SYNC_DROP_HYBRID:
+         Print(L"Found no partitions that could be hybridized, but an existing hybrid MBR exists.\n");
+         Print(L"If you proceed, a fresh protective MBR will be created. Do you want to create\n");
+         invalid = input_boolean(STR("this new protective MBR, erasing the hybrid MBR? [y/N] "), &retval);
+         if (invalid)
+            retval = FALSE;
+         break;
+
+      // If existing hybrid MBR that is NOT identical to the new one, ask the user
+      // before overwriting the old one.
+      case SYNC_REPLACE_HYBRID:
+         Print(L"Existing hybrid MBR detected, but it is not identical to what this program\n");
+         Print(L"would generate. Do you want to see the hybrid MBR that this program would\n");
+         invalid = input_boolean(STR("generate? [y/N] "), &retval);
+         if (invalid)
+            retval = FALSE;
+         break;
+   } // switch
 
    return retval;
 } // BOOLEAN should_rewrite()
 
+// Determine the MBR type of each GPT partition, looking at the data in
+// Basic Data partitions.
 static
-UINTN analyze (VOID) {
+VOID detect_mbr_types(VOID) {
     UINTN   i, detected_parttype;
     CHARN   *fsname;
     UINTN   status;
 
-    new_mbr_part_count = 0;
-
-    // determine correct MBR types for GPT partitions
-    if (gpt_part_count == 0) {
-        Print(L"Status: No GPT partitions defined, nothing to sync.\n");
-        return 0;
-    }
     for (i = 0; i < gpt_part_count; i++) {
         gpt_parts[i].mbr_type = gpt_parts[i].gpt_parttype->mbr_type;
         if (gpt_parts[i].gpt_parttype->kind == GPT_KIND_BASIC_DATA) {
@@ -485,6 +505,20 @@ UINTN analyze (VOID) {
         }
         // NOTE: mbr_type may still be 0 if content detection fails for exotic GPT types or file systems
     } // for
+} // VOID detect_mbr_types()
+
+static
+UINTN analyze (VOID) {
+    UINTN   i;
+
+    new_mbr_part_count = 0;
+
+    // determine correct MBR types for GPT partitions
+    if (gpt_part_count == 0) {
+        Print(L"Status: No GPT partitions defined, nothing to sync.\n");
+        return 0;
+    }
+    detect_mbr_types();
 
     // generate the new table
     generate_hybrid_mbr();
@@ -551,3 +585,60 @@ UINTN gptsync(VOID) {
 
     return status;
 }
+
+#ifndef CONFIG_EFI
+
+//
+// batch analysis entry point; never prompts and never writes
+//
+
+UINTN gptsync_batch(VOID) {
+    UINTN   status;
+    UINTN   status_gpt, status_mbr;
+    UINTN   i, verdict;
+    BOOLEAN hybrid;
+    static const char *verdict_names[] = {
+        "synchronized", "rewrite", "drop-hybrid", "replace-hybrid"
+    };
+
+    status_gpt = read_gpt();
+    status_mbr = read_mbr();
+    if (status_gpt != 0 || status_mbr != 0)
+        return 1;
+
+    report_parts("mbr", mbr_parts, mbr_part_count, FALSE);
+    report_parts("gpt", gpt_parts, gpt_part_count, TRUE);
+
+    hybrid = FALSE;
+    for (i = 0; i < mbr_part_count; i++) {
+        if ((mbr_parts[i].mbr_type != 0x00) && (mbr_parts[i].mbr_type != 0xEE))
+            hybrid = TRUE;
+    }
+    report(",\"hybrid\":%s", hybrid ? "true" : "false");
+
+    // same checks as the interactive mode, reported instead of aborting
+    status = check_gpt();
+    if (status == 0)
+        status = check_mbr();
+    if (status != 0) {
+        report(",\"verdict\":\"unsupported\",\"should_rewrite\":false");
+        report_reason();
+        return 0;
+    }
+
+    new_mbr_part_count = 0;
+    detect_mbr_types();
+    generate_hybrid_mbr();
+    report_parts("proposed_mbr", new_mbr_parts, new_mbr_part_count, FALSE);
+
+    // the hybrid verdicts are those the interactive mode asks about first
+    verdict = compare_mbr();
+    report(",\"verdict\":\"%s\",\"should_rewrite\":%s,\"confirm\":%s",
+           verdict_names[verdict],
+           (verdict != SYNC_IDENTICAL) ? "true" : "false",
+           (verdict == SYNC_DROP_HYBRID || verdict == SYNC_REPLACE_HYBRID) ? "true" : "false");
+
+    return 0;
+} // UINTN gptsync_batch()
+
+#endif
@@ -76,20 +76,19 @@ typedef CHAR16 CHARN;
 #include <unistd.h>
 #include <errno.h>
 
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <fcntl.h>
 
-/*
-typedef int                 INTN;
-typedef unsigned int        UINTN;
-typedef unsigned char       UINT8;
-typedef unsigned short      UINT16;
-typedef unsigned long       UINT32;
-typedef unsigned long long  UINT64;
+typedef intptr_t            INTN;
+typedef uintptr_t           UINTN;
+typedef uint8_t             UINT8;
+typedef uint16_t            UINT16;
+typedef uint32_t            UINT32;
+typedef uint64_t            UINT64;
 typedef void                VOID;
-*/
 
 typedef int                 BOOLEAN;
 #ifndef FALSE
@@ -107,12 +106,23 @@ void Print(wchar_t *format, ...);
 
 // FUTURE: use STR(),  #define Print printf
 
+#define CopyMem(dest, src, len)      (memcpy(dest, src, len))
+#define SetMem(buf, len, value)      (memset(buf, value, len))
+#define CompareMem(buf1, buf2, len)  (memcmp(buf1, buf2, len))
+
 #define copy_guid(destguid, srcguid) (CopyMem(destguid, srcguid, 16))
 #define guids_are_equal(guid1, guid2) (memcmp(guid1, guid2, 16) == 0)
 
 #define EFI_UNSUPPORTED 1
 #define EFI_ABORTED     2
 
+// per-disk state is kept per thread so batch mode can analyze images in parallel
+#define DISK_LOCAL __thread
+
+#endif
+
+#ifndef DISK_LOCAL
+#define DISK_LOCAL
 #endif
 
 #define GPT_KIND_SYSTEM     (0)
@@ -198,15 +208,15 @@ UINTN input_boolean(CHARN *prompt, BOOLEAN *bool_out);
 
 extern UINT8           empty_guid[16];
 
-extern PARTITION_INFO  mbr_parts[4];
-extern UINTN           mbr_part_count;
-extern PARTITION_INFO  gpt_parts[128];
-extern UINTN           gpt_part_count;
+extern DISK_LOCAL PARTITION_INFO  mbr_parts[4];
+extern DISK_LOCAL UINTN           mbr_part_count;
+extern DISK_LOCAL PARTITION_INFO  gpt_parts[128];
+extern DISK_LOCAL UINTN           gpt_part_count;
 
-extern PARTITION_INFO  new_mbr_parts[4];
-extern UINTN           new_mbr_part_count;
+extern DISK_LOCAL PARTITION_INFO  new_mbr_parts[4];
+extern DISK_LOCAL UINTN           new_mbr_part_count;
 
-extern UINT8           sector[512];
+extern DISK_LOCAL UINT8           sector[512];
 
 extern MBR_PARTTYPE    mbr_types[];
 extern GPT_PARTTYPE    gpt_types[];
@@ -227,4 +237,20 @@ UINTN detect_mbrtype_fs(UINT64 partlba, UINTN *parttype, CHARN **fsname);
 UINTN gptsync(VOID);
 UINTN showpart(VOID);
 
+#ifndef CONFIG_EFI
+
+//
+// batch mode, one JSON line per disk image (Unix only)
+//
+
+void report(const char *format, ...);
+void report_string(const char *text);
+void report_reason(VOID);
+void report_parts(const char *key, PARTITION_INFO *parts, UINTN count, BOOLEAN from_gpt);
+
+UINTN gptsync_batch(VOID);
+UINTN showpart_batch(VOID);
+
+#endif
+
 /* EOF */
@@ -40,15 +40,15 @@
 
 UINT8           empty_guid[16] = { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 };
 
-PARTITION_INFO  mbr_parts[4];
-UINTN           mbr_part_count = 0;
-PARTITION_INFO  gpt_parts[128];
-UINTN           gpt_part_count = 0;
+DISK_LOCAL PARTITION_INFO  mbr_parts[4];
+DISK_LOCAL UINTN           mbr_part_count = 0;
+DISK_LOCAL PARTITION_INFO  gpt_parts[128];
+DISK_LOCAL UINTN           gpt_part_count = 0;
 
-PARTITION_INFO  new_mbr_parts[4];
-UINTN           new_mbr_part_count = 0;
+DISK_LOCAL PARTITION_INFO  new_mbr_parts[4];
+DISK_LOCAL UINTN           new_mbr_part_count = 0;
 
-UINT8           sector[512];
+DISK_LOCAL UINT8           sector[512];
 
 MBR_PARTTYPE    mbr_types[] = {
     { 0x01, STR("FAT12 (CHS)") },
@@ -37,14 +37,43 @@
 #include "gptsync.h"
 
 #include <stdarg.h>
+#include <pthread.h>
 
 #define STRINGIFY(s) #s
 #define STRINGIFY2(s) STRINGIFY(s)
 #define PROGNAME_S STRINGIFY2(PROGNAME)
 
+#define BATCHNAME2(s) s##_batch
+#define BATCHNAME(s) BATCHNAME2(s)
+
+// sectors are read in aligned runs and kept in a small direct-mapped cache
+#define CACHE_RUN_SECTORS   (8)
+#define CACHE_RUNS          (16)
+
+typedef struct {
+    UINT64  first_lba;
+    UINTN   count;      // sectors held, 0 if unused
+    UINT8   data[CACHE_RUN_SECTORS * 512];
+} SECTOR_RUN;
+
 // variables
 
-static int      fd;
+static DISK_LOCAL int        fd;
+static DISK_LOCAL SECTOR_RUN cache[CACHE_RUNS];
+
+// batch mode state; Print() output and errors are collected, not shown
+static DISK_LOCAL BOOLEAN    batch;
+static DISK_LOCAL char       transcript[4096];
+static DISK_LOCAL size_t     transcript_len;
+static DISK_LOCAL char       batch_error[512];
+static DISK_LOCAL char      *report_buf;
+static DISK_LOCAL size_t     report_len, report_size;
+
+static char            **batch_images;
+static int               batch_count;
+static int               batch_next;
+static int               batch_failed;
+static pthread_mutex_t   batch_lock = PTHREAD_MUTEX_INITIALIZER;
 
 //
 // error functions
@@ -59,6 +88,10 @@ void error(const char *msg, ...)
     vsnprintf(buf, 4096, msg, par);
     va_end(par);
 
+    if (batch) {
+        snprintf(batch_error, sizeof(batch_error), "%.400s", buf);
+        return;
+    }
     fprintf(stderr, PROGNAME_S ": %s\n", buf);
 }
 
@@ -71,6 +104,10 @@ void errore(const char *msg, ...)
     vsnprintf(buf, 4096, msg, par);
     va_end(par);
 
+    if (batch) {
+        snprintf(batch_error, sizeof(batch_error), "%.400s: %.100s", buf, strerror(errno));
+        return;
+    }
     fprintf(stderr, PROGNAME_S ": %s: %s\n", buf, strerror(errno));
 }
 
@@ -83,53 +120,69 @@ UINT64 disk_size(VOID) {
    return (UINT64) 0xFFFFFFFF;
 } // UINT64 disk_size()
 
+static VOID flush_cache(VOID)
+{
+    UINTN i;
+
+    for (i = 0; i < CACHE_RUNS; i++)
+        cache[i].count = 0;
+}
+
 UINTN read_sector(UINT64 lba, UINT8 *buffer)
 {
+    SECTOR_RUN *run;
+    UINT64  first_lba;
     off_t   offset;
-    off_t   result_seek;
     ssize_t result_read;
 
-    offset = lba * 512;
-    result_seek = lseek(fd, offset, SEEK_SET);
-    if (result_seek != offset) {
-        errore("Seek to %llu failed", offset);
-        return 1;
-    }
+    first_lba = lba - (lba % CACHE_RUN_SECTORS);
+    run = &cache[(first_lba / CACHE_RUN_SECTORS) % CACHE_RUNS];
 
-    result_read = read(fd, buffer, 512);
-    if (result_read < 0) {
-        errore("Data read failed at position %llu", offset);
-        return 1;
+    if (run->count == 0 || run->first_lba != first_lba) {
+        run->count = 0;
+
+        offset = first_lba * 512;
+        result_read = pread(fd, run->data, sizeof(run->data), offset);
+        if (result_read < 0) {
+            errore("Data read failed at position %llu", offset);
+            return 1;
+        }
+        run->first_lba = first_lba;
+        run->count     = result_read / 512;
     }
-    if (result_read != 512) {
-        errore("Data read fell short at position %llu", offset);
+
+    if (lba - first_lba >= run->count) {
+        error("Data read fell short at position %llu", lba * 512);
         return 1;
     }
+
+    CopyMem(buffer, run->data + (lba - first_lba) * 512, 512);
     return 0;
 }
 
 UINTN write_sector(UINT64 lba, UINT8 *buffer)
 {
+    SECTOR_RUN *run;
     off_t   offset;
-    off_t   result_seek;
     ssize_t result_write;
 
     offset = lba * 512;
-    result_seek = lseek(fd, offset, SEEK_SET);
-    if (result_seek != offset) {
-        errore("Seek to %llu failed", offset);
-        return 1;
-    }
-
-    result_write = write(fd, buffer, 512);
+    result_write = pwrite(fd, buffer, 512, offset);
     if (result_write < 0) {
         errore("Data write failed at position %llu", offset);
         return 1;
     }
     if (result_write != 512) {
-        errore("Data write fell short at position %llu", offset);
+        error("Data write fell short at position %llu", offset);
         return 1;
     }
+
+    // keep a cached copy of the sector current
+    run = &cache[(lba / CACHE_RUN_SECTORS) % CACHE_RUNS];
+    if (run->count > 0 && run->first_lba == lba - (lba % CACHE_RUN_SECTORS) &&
+        lba - run->first_lba < run->count)
+        CopyMem(run->data + (lba - run->first_lba) * 512, buffer, 512);
+
     return 0;
 }
 
@@ -178,9 +231,235 @@ void Print(wchar_t *format, ...)
     vsnprintf(buf, 4096, formatbuf, par);
     va_end(par);
 
+    if (batch) {
+        transcript_len += snprintf(transcript + transcript_len,
+                                   sizeof(transcript) - transcript_len, "%s", buf);
+        if (transcript_len >= sizeof(transcript))
+            transcript_len = sizeof(transcript) - 1;
+        return;
+    }
     printf("%s", buf);
 }
 
+//
+// batch mode output
+//
+
+void report(const char *format, ...)
+{
+    va_list par;
+    int     len;
+    char    *grown;
+
+    for (;;) {
+        va_start(par, format);
+        len = vsnprintf(report_buf + report_len, report_size - report_len, format, par);
+        va_end(par);
+        if (len < 0)
+            return;
+        if (report_len + len < report_size)
+            break;
+
+        grown = realloc(report_buf, report_size * 2 + len);
+        if (grown == NULL)
+            return;
+        report_buf  = grown;
+        report_size = report_size * 2 + len;
+    }
+    report_len += len;
+}
+
+void report_string(const char *text)
+{
+    report("\"");
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\')
+            report("\\%c", *text);
+        else if ((unsigned char)*text < 0x20)
+            report("\\u%04x", (unsigned char)*text);
+        else
+            report("%c", *text);
+    }
+    report("\"");
+}
+
+// Adds the reason an image was rejected: the error, if any, or else the
+// last status message the analysis printed.
+void report_reason(VOID)
+{
+    char    reason[sizeof(transcript)];
+    char    *text, *last;
+    size_t  len;
+
+    if (batch_error[0]) {
+        text = batch_error;
+    } else {
+        text = transcript;
+        last = text;
+        while ((last = strstr(last, "Status: ")) != NULL)
+            text = last++;
+        if (text == transcript) {
+            // no status message, use the last line printed
+            len = strlen(transcript);
+            while (len > 0 && (transcript[len - 1] == '\n' || transcript[len - 1] == ' '))
+                transcript[--len] = 0;
+            last = strrchr(transcript, '\n');
+            if (last != NULL)
+                text = last + 1;
+        }
+    }
+
+    // fold the message onto one line
+    for (len = 0; *text && len < sizeof(reason) - 1; text++) {
+        if (*text == '\n' || *text == ' ') {
+            if (len > 0 && reason[len - 1] != ' ')
+                reason[len++] = ' ';
+        } else {
+            reason[len++] = *text;
+        }
+    }
+    while (len > 0 && reason[len - 1] == ' ')
+        len--;
+    reason[len] = 0;
+
+    report(",\"reason\":");
+    report_string(reason);
+}
+
+void report_parts(const char *key, PARTITION_INFO *parts, UINTN count, BOOLEAN from_gpt)
+{
+    UINTN i;
+
+    report(",\"%s\":[", key);
+    for (i = 0; i < count; i++) {
+        report("%s{\"index\":%u,\"start_lba\":%llu,\"end_lba\":%llu",
+               (i > 0) ? "," : "", (unsigned)parts[i].index + 1,
+               (unsigned long long)parts[i].start_lba,
+               (unsigned long long)parts[i].end_lba);
+        if (from_gpt) {
+            report(",\"type\":");
+            report_string(parts[i].gpt_parttype->name);
+        } else {
+            report(",\"active\":%s,\"mbr_type\":\"%02x\",\"type\":",
+                   parts[i].active ? "true" : "false", (unsigned)parts[i].mbr_type);
+            report_string(mbr_parttype_name(parts[i].mbr_type));
+        }
+        report("}");
+    }
+    report("]");
+}
+
+//
+// batch mode workers
+//
+
+static void batch_image(char *filename)
+{
+    UINTN status;
+
+    // start from a clean slate, as a fresh process would
+    SetMem(mbr_parts, sizeof(mbr_parts), 0);
+    SetMem(gpt_parts, sizeof(gpt_parts), 0);
+    SetMem(new_mbr_parts, sizeof(new_mbr_parts), 0);
+    mbr_part_count     = 0;
+    gpt_part_count     = 0;
+    new_mbr_part_count = 0;
+    transcript[0]      = 0;
+    transcript_len     = 0;
+    batch_error[0]     = 0;
+    report_len         = 0;
+    flush_cache();
+
+    report("{\"image\":");
+    report_string(filename);
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        errore("Can't open %.300s", filename);
+        status = 1;
+    } else {
+        status = BATCHNAME(PROGNAME)();
+        close(fd);
+    }
+
+    if (status != 0) {
+        report(",\"status\":\"error\"");
+        report_reason();
+    } else {
+        report(",\"status\":\"ok\"");
+    }
+    report("}\n");
+
+    pthread_mutex_lock(&batch_lock);
+    fwrite(report_buf, 1, report_len, stdout);
+    if (status != 0)
+        batch_failed = 1;
+    pthread_mutex_unlock(&batch_lock);
+}
+
+static void *batch_worker(void *arg)
+{
+    int i;
+
+    batch       = TRUE;
+    report_size = 4096;
+    report_buf  = malloc(report_size);
+    if (report_buf == NULL)
+        return NULL;
+
+    for (;;) {
+        pthread_mutex_lock(&batch_lock);
+        i = batch_next++;
+        pthread_mutex_unlock(&batch_lock);
+        if (i >= batch_count)
+            break;
+
+        batch_image(batch_images[i]);
+    }
+
+    free(report_buf);
+    return NULL;
+}
+
+static int batch_main(int jobs, int count, char **images)
+{
+    pthread_t   *threads;
+    int         i, started;
+
+    batch_images = images;
+    batch_count  = count;
+
+    if (jobs <= 0)
+        jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs <= 0)
+        jobs = 1;
+    if (jobs > count)
+        jobs = count;
+
+    threads = malloc(jobs * sizeof(pthread_t));
+    if (threads == NULL) {
+        error("Out of memory");
+        return 1;
+    }
+
+    started = 0;
+    for (i = 0; i < jobs; i++) {
+        if (pthread_create(&threads[started], NULL, batch_worker, NULL) == 0)
+            started++;
+    }
+    if (started == 0) {
+        // no threads available, analyze the images here
+        batch_worker(NULL);
+        batch = FALSE;
+    }
+    for (i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+
+    fflush(stdout);
+    return batch_failed || batch_next < batch_count;
+}
+
 //
 // main entry point
 //
@@ -190,13 +469,32 @@ int main(int argc, char *argv[])
     char        *filename;
     struct stat sb;
     int         filekind;
-    UINT64      filesize;
     char        *reason;
     int         status;
 
+    int         jobs;
+
+    // batch mode
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {
+        jobs = 0;
+        argv += 2;
+        argc -= 2;
+        if (argc >= 2 && strcmp(argv[0], "-j") == 0) {
+            jobs = atoi(argv[1]);
+            argv += 2;
+            argc -= 2;
+        }
+        if (argc < 1) {
+            fprintf(stderr, "Usage: " PROGNAME_S " --batch [-j <jobs>] <image>...\n");
+            return 1;
+        }
+        return batch_main(jobs, argc, argv);
+    }
+
     // argument check
     if (argc != 2) {
         fprintf(stderr, "Usage: " PROGNAME_S " <device>\n");
+        fprintf(stderr, "       " PROGNAME_S " --batch [-j <jobs>] <image>...\n");
         return 1;
     }
     filename = argv[1];
@@ -211,11 +509,9 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    filekind = 0;
-    filesize = 0;
     reason = NULL;
     if (S_ISREG(sb.st_mode))
-        filesize = sb.st_size;
+        filekind = 0;
     else if (S_ISBLK(sb.st_mode))
         filekind = 1;
     else if (S_ISCHR(sb.st_mode))
@@ -217,7 +217,7 @@ static UINTN analyze_parts(VOID)
     }
 
     // check partitions listed in MBR, but not in GPT
-    for (i = 0; i < mbr_part_count; i++) {
+    for (i = 0; status == 0 && i < mbr_part_count; i++) {
         if (mbr_parts[i].start_lba == 1 && mbr_parts[i].mbr_type == 0xee)
             continue;   // skip EFI Protective entry
 
@@ -258,3 +258,85 @@ UINTN showpart(VOID)
 
     return status;
 }
+
+#ifndef CONFIG_EFI
+
+//
+// batch analysis entry point
+//
+
+static UINTN report_part(UINT64 partlba, BOOLEAN first)
+{
+    UINTN   status;
+    CHARN   *bootcodename;
+    UINTN   parttype;
+    CHARN   *fsname;
+
+    status = detect_bootcode(partlba, &bootcodename);
+    if (status)
+        return status;
+    status = detect_mbrtype_fs(partlba, &parttype, &fsname);
+    if (status)
+        return status;
+
+    report("%s{\"start_lba\":%llu,\"boot_code\":", first ? "" : ",", (unsigned long long)partlba);
+    report_string(bootcodename);
+    report(",\"fs\":");
+    report_string(fsname);
+    report(",\"mbr_type\":\"%02x\"}", (unsigned)parttype);
+
+    return 0;
+}
+
+UINTN showpart_batch(VOID)
+{
+    UINTN   status;
+    UINTN   status_gpt, status_mbr;
+    UINTN   i, k, count;
+    CHARN   *bootcodename;
+    BOOLEAN is_dupe;
+
+    status_gpt = read_gpt();
+    status_mbr = read_mbr();
+    if (status_gpt != 0 || status_mbr != 0)
+        return 1;
+
+    report_parts("mbr", mbr_parts, mbr_part_count, FALSE);
+    report_parts("gpt", gpt_parts, gpt_part_count, TRUE);
+
+    // MBR (bootcode only)
+    status = detect_bootcode(0, &bootcodename);
+    if (status)
+        return status;
+    report(",\"boot_code\":");
+    report_string(bootcodename);
+
+    // the array is closed on read errors too, so the report stays valid JSON
+    report(",\"parts\":[");
+
+    // partitions listed in GPT, then those listed in MBR only, as analyze_parts() does
+    count = 0;
+    for (i = 0; i < gpt_part_count; i++) {
+        status = report_part(gpt_parts[i].start_lba, count++ == 0);
+        if (status)
+            break;
+    }
+    for (i = 0; status == 0 && i < mbr_part_count; i++) {
+        if (mbr_parts[i].start_lba == 1 && mbr_parts[i].mbr_type == 0xee)
+            continue;   // skip EFI Protective entry
+
+        is_dupe = FALSE;
+        for (k = 0; k < gpt_part_count; k++)
+            if (gpt_parts[k].start_lba == mbr_parts[i].start_lba)
+                is_dupe = TRUE;
+
+        if (!is_dupe) {
+            status = report_part(mbr_parts[i].start_lba, count++ == 0);
+        }
+    }
+    report("]");
+
+    return status;
+}
+
+#endif
@@ -0,0 +1,427 @@
+/*
+ * include/crc32_core.h
+ * CRC32 (IEEE 802.3) and CRC32C (Castagnoli) checksums
+ *
+ * Copyright (c) 2023 Dayo Akanji (sf.net/u/dakanji/profile)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+/*
+ * Shared by BootMaster (GPT headers and tables) and the filesystem drivers
+ * (btrfs, ext4), which are separate images, so the code is kept in this
+ * header and only needs the basic UEFI types. Include it in one source file
+ * per image and export wrappers from there.
+ *
+ * Both entry points take and return a finished checksum: the running value
+ * is inverted on entry and on exit, as with 'crc32refit' and 'grub_getcrc32c',
+ * so that a long buffer may be summed in pieces.
+ *
+ * Portable code uses slicing-by-8 tables that are built on first use.
+ * Where the CPU allows it, GCC and Clang builds also use:
+ *   - X64:     SSE4.2 'crc32' for CRC32C and PCLMULQDQ folding for CRC32
+ *   - AARCH64: ARMv8 'crc32x' and 'crc32cx'
+ * All paths give the same results. Other builds use the portable code only.
+ */
+
+#ifndef __CRC32_CORE_H_
+#define __CRC32_CORE_H_
+
+#ifdef _MSC_VER
+#define CRC_CORE_INLINE  __inline
+#else
+#define CRC_CORE_INLINE  inline
+#endif
+
+#define CRC_CORE_POLY_CRC32    0xEDB88320   /* Reflected IEEE 802.3     */
+#define CRC_CORE_POLY_CRC32C   0x82F63B78   /* Reflected Castagnoli     */
+
+#define CRC_CORE_TABLE_CRC32   0
+#define CRC_CORE_TABLE_CRC32C  1
+
+// Feature bits ... Clear the hardware bits in 'mCrcCoreFeatures' to force
+// the portable code (host tests compare the paths this way)
+#define CRC_CORE_PROBED        0x01
+#define CRC_CORE_HW_CRC32      0x02
+#define CRC_CORE_HW_CRC32C     0x04
+
+#if defined (__GNUC__) && defined (__x86_64__)
+#define CRC_CORE_X64           1
+#elif defined (__GNUC__) && defined (__aarch64__)
+#define CRC_CORE_AARCH64       1
+#endif
+
+static UINT32   mCrcCoreFeatures = 0;
+static BOOLEAN  mCrcCoreTableReady[2];
+static UINT32   mCrcCoreTable[2][8][256];
+
+static
+CRC_CORE_INLINE
+VOID CrcCoreBuildTable (
+    IN UINTN   Index,
+    IN UINT32  Poly
+) {
+    UINT32  Crc;
+    UINTN   i, j;
+
+    for (i = 0; i < 256; i++) {
+        Crc = (UINT32) i;
+        for (j = 0; j < 8; j++) {
+            Crc = (Crc & 1) ? ((Crc >> 1) ^ Poly) : (Crc >> 1);
+        }
+        mCrcCoreTable[Index][0][i] = Crc;
+    }
+
+    // Entry 'j' of slice 'k' is the effect of byte 'j' followed by 'k' zeros
+    for (i = 0; i < 256; i++) {
+        Crc = mCrcCoreTable[Index][0][i];
+        for (j = 1; j < 8; j++) {
+            Crc = (Crc >> 8) ^ mCrcCoreTable[Index][0][Crc & 0xFF];
+            mCrcCoreTable[Index][j][i] = Crc;
+        }
+    }
+
+    mCrcCoreTableReady[Index] = TRUE;
+} // static VOID CrcCoreBuildTable()
+
+// Slicing-by-8 on a raw (not inverted) running value
+static
+CRC_CORE_INLINE
+UINT32 CrcCoreSlice8 (
+    IN UINTN         Index,
+    IN UINT32        Crc,
+    IN CONST UINT8  *Buf,
+    IN UINTN         Size
+) {
+    UINT32   Low;
+    UINT32 (*T)[256];
+
+    if (!mCrcCoreTableReady[Index]) {
+        CrcCoreBuildTable (
+            Index,
+            (Index == CRC_CORE_TABLE_CRC32C)
+                ? CRC_CORE_POLY_CRC32C
+                : CRC_CORE_POLY_CRC32
+        );
+    }
+    T = mCrcCoreTable[Index];
+
+    while (Size > 0 && ((UINTN) Buf & 7) != 0) {
+        Crc = (Crc >> 8) ^ T[0][(Crc ^ *Buf++) & 0xFF];
+        Size--;
+    }
+
+    // Bytes are assembled by hand so that big endian hosts get the same result
+    while (Size >= 8) {
+        Low = Crc ^ (
+            (UINT32) Buf[0]         |
+            ((UINT32) Buf[1] <<  8) |
+            ((UINT32) Buf[2] << 16) |
+            ((UINT32) Buf[3] << 24)
+        );
+        Crc = T[7][Low & 0xFF]         ^
+              T[6][(Low >>  8) & 0xFF] ^
+              T[5][(Low >> 16) & 0xFF] ^
+              T[4][Low >> 24]          ^
+              T[3][Buf[4]]             ^
+              T[2][Buf[5]]             ^
+              T[1][Buf[6]]             ^
+              T[0][Buf[7]];
+
+        Buf  += 8;
+        Size -= 8;
+    } // while
+
+    while (Size > 0) {
+        Crc = (Crc >> 8) ^ T[0][(Crc ^ *Buf++) & 0xFF];
+        Size--;
+    }
+
+    return Crc;
+} // static UINT32 CrcCoreSlice8()
+
+#if defined (CRC_CORE_X64)
+
+typedef long long  CRC_CORE_V2DI __attribute__ ((vector_size (16)));
+typedef int        CRC_CORE_V4SI __attribute__ ((vector_size (16)));
+typedef long long  CRC_CORE_V2DI_U __attribute__ ((vector_size (16), aligned (1), may_alias));
+typedef UINT64     CRC_CORE_U64_A __attribute__ ((may_alias));
+
+static
+CRC_CORE_INLINE
+UINT32 CrcCoreProbe (VOID) {
+    UINT32  Eax, Ebx, Ecx, Edx;
+    UINT32  Features;
+
+    __asm__ __volatile__ (
+        "cpuid"
+        : "=a" (Eax), "=b" (Ebx), "=c" (Ecx), "=d" (Edx)
+        : "a" (1), "c" (0)
+    );
+
+    Features = CRC_CORE_PROBED;
+    if (Ecx & (1 << 20)) {
+        // SSE4.2
+        Features |= CRC_CORE_HW_CRC32C;
+        if (Ecx & (1 << 1)) {
+            // PCLMULQDQ
+            Features |= CRC_CORE_HW_CRC32;
+        }
+    }
+
+    return Features;
+} // static UINT32 CrcCoreProbe()
+
+static
+CRC_CORE_INLINE
+__attribute__ ((target ("sse4.2")))
+UINT32 CrcCoreHwCrc32c (
+    IN UINT32        Crc,
+    IN CONST UINT8  *Buf,
+    IN UINTN         Size
+) {
+    UINT64  Crc64;
+
+    while (Size > 0 && ((UINTN) Buf & 7) != 0) {
+        Crc = __builtin_ia32_crc32qi (Crc, *Buf++);
+        Size--;
+    }
+
+    Crc64 = Crc;
+    while (Size >= 8) {
+        Crc64 = __builtin_ia32_crc32di (Crc64, *(CONST CRC_CORE_U64_A *) Buf);
+        Buf  += 8;
+        Size -= 8;
+    }
+    Crc = (UINT32) Crc64;
+
+    while (Size > 0) {
+        Crc = __builtin_ia32_crc32qi (Crc, *Buf++);
+        Size--;
+    }
+
+    return Crc;
+} // static UINT32 CrcCoreHwCrc32c()
+
+// Folds 64 bytes at a time with carry-less multiplies, then does a Barrett
+// reduction. Constants are those of the bit reflected CRC32 polynomial from
+// "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ" (Intel).
+// 'Size' must be at least 64 and a multiple of 16.
+static
+CRC_CORE_INLINE
+__attribute__ ((target ("sse4.2,pclmul")))
+UINT32 CrcCoreHwCrc32 (
+    IN UINT32        Crc,
+    IN CONST UINT8  *Buf,
+    IN UINTN         Size
+) {
+    CRC_CORE_V2DI  K1K2 = { 0x0154442bd4LL, 0x01c6e41596LL };
+    CRC_CORE_V2DI  K3K4 = { 0x01751997d0LL, 0x00ccaa009eLL };
+    CRC_CORE_V2DI  K5K0 = { 0x0163cd6124LL, 0 };
+    CRC_CORE_V2DI  Poly = { 0x01db710641LL, 0x01f7011641LL };
+    CRC_CORE_V2DI  Mask = { 0xFFFFFFFFLL, 0xFFFFFFFFLL };
+    CRC_CORE_V2DI  X1, X2, X3, X4, X5, X6, X7, X8;
+    CRC_CORE_V4SI  W;
+
+    X1 = *(CONST CRC_CORE_V2DI_U *) (Buf + 0x00);
+    X2 = *(CONST CRC_CORE_V2DI_U *) (Buf + 0x10);
+    X3 = *(CONST CRC_CORE_V2DI_U *) (Buf + 0x20);
+    X4 = *(CONST CRC_CORE_V2DI_U *) (Buf + 0x30);
+
+    X1 ^= (CRC_CORE_V2DI) { (long long) Crc, 0 };
+
+    Buf  += 64;
+    Size -= 64;
+
+    while (Size >= 64) {
+        X5 = __builtin_ia32_pclmulqdq128 (X1, K1K2, 0x00);
+        X6 = __builtin_ia32_pclmulqdq128 (X2, K1K2, 0x00);
+        X7 = __builtin_ia32_pclmulqdq128 (X3, K1K2, 0x00);
+        X8 = __builtin_ia32_pclmulqdq128 (X4, K1K2, 0x00);
+
+        X1 = __builtin_ia32_pclmulqdq128 (X1, K1K2, 0x11);
+        X2 = __builtin_ia32_pclmulqdq128 (X2, K1K2, 0x11);
+        X3 = __builtin_ia32_pclmulqdq128 (X3, K1K2, 0x11);
+        X4 = __builtin_ia32_pclmulqdq128 (X4, K1K2, 0x11);
+
+        X1 ^= X5 ^ *(CONST CRC_CORE_V2DI_U *) (Buf + 0x00);
+        X2 ^= X6 ^ *(CONST CRC_CORE_V2DI_U *) (Buf + 0x10);
+        X3 ^= X7 ^ *(CONST CRC_CORE_V2DI_U *) (Buf + 0x20);
+        X4 ^= X8 ^ *(CONST CRC_CORE_V2DI_U *) (Buf + 0x30);
+
+        Buf  += 64;
+        Size -= 64;
+    } // while
+
+    // Fold the four lanes into one
+    X5 = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x00);
+    X1 = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x11) ^ X2 ^ X5;
+    X5 = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x00);
+    X1 = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x11) ^ X3 ^ X5;
+    X5 = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x00);
+    X1 = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x11) ^ X4 ^ X5;
+
+    while (Size >= 16) {
+        X5 = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x00);
+        X1 = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x11) ^ X5 ^
+            *(CONST CRC_CORE_V2DI_U *) Buf;
+
+        Buf  += 16;
+        Size -= 16;
+    }
+
+    // Fold 128 bits to 64 bits
+    X2 = __builtin_ia32_pclmulqdq128 (X1, K3K4, 0x10);
+    X1 = (CRC_CORE_V2DI) { X1[1], 0 } ^ X2;
+
+    W  = (CRC_CORE_V4SI) X1;
+    X2 = (CRC_CORE_V2DI) (CRC_CORE_V4SI) { W[1], W[2], W[3], 0 };
+    X1 = __builtin_ia32_pclmulqdq128 (X1 & Mask, K5K0, 0x00) ^ X2;
+
+    // Barrett reduction to 32 bits
+    X2 = __builtin_ia32_pclmulqdq128 (X1 & Mask, Poly, 0x10);
+    X2 = __builtin_ia32_pclmulqdq128 (X2 & Mask, Poly, 0x00);
+    X1 ^= X2;
+
+    return (UINT32) ((CRC_CORE_V4SI) X1)[1];
+} // static UINT32 CrcCoreHwCrc32()
+
+#elif defined (CRC_CORE_AARCH64)
+
+typedef UINT64     CRC_CORE_U64_A __attribute__ ((may_alias));
+
+static
+CRC_CORE_INLINE
+UINT32 CrcCoreProbe (VOID) {
+    UINT64  Isar0;
+
+    // ID_AA64ISAR0_EL1 bits 19:16 ... Non-zero when CRC32 is implemented
+    __asm__ __volatile__ ("mrs %0, id_aa64isar0_el1" : "=r" (Isar0));
+
+    return ((Isar0 >> 16) & 0xF)
+        ? (CRC_CORE_PROBED | CRC_CORE_HW_CRC32 | CRC_CORE_HW_CRC32C)
+        : CRC_CORE_PROBED;
+} // static UINT32 CrcCoreProbe()
+
+#define CRC_CORE_ARM_STEP(Insn, Crc, Value)                         \
+    __asm__ (".arch_extension crc\n\t" Insn " %w0, %w0, %1"       \
+        : "+r" (Crc) : "r" (Value))
+
+#define CRC_CORE_ARM_LOOP(Insn64, Insn8)                            \
+    while (Size > 0 && ((UINTN) Buf & 7) != 0) {                    \
+        CRC_CORE_ARM_STEP (Insn8, Crc, (UINT32) *Buf++);            \
+        Size--;                                                     \
+    }                                                               \
+    while (Size >= 8) {                                             \
+        __asm__ (".arch_extension crc\n\t" Insn64 " %w0, %w0, %x1"  \
+            : "+r" (Crc) : "r" (*(CONST CRC_CORE_U64_A *) Buf));    \
+        Buf  += 8;                                                  \
+        Size -= 8;                                                  \
+    }                                                               \
+    while (Size > 0) {                                              \
+        CRC_CORE_ARM_STEP (Insn8, Crc, (UINT32) *Buf++);            \
+        Size--;                                                     \
+    }                                                               \
+    return Crc
+
+static
+CRC_CORE_INLINE
+UINT32 CrcCoreHwCrc32c (
+    IN UINT32        Crc,
+    IN CONST UINT8  *Buf,
+    IN UINTN         Size
+) {
+    CRC_CORE_ARM_LOOP ("crc32cx", "crc32cb");
+} // static UINT32 CrcCoreHwCrc32c()
+
+static
+CRC_CORE_INLINE
+UINT32 CrcCoreHwCrc32 (
+    IN UINT32        Crc,
+    IN CONST UINT8  *Buf,
+    IN UINTN         Size
+) {
+    CRC_CORE_ARM_LOOP ("crc32x", "crc32b");
+} // static UINT32 CrcCoreHwCrc32()
+
+#endif
+
+static
+CRC_CORE_INLINE
+UINT32 CrcCoreFeatures (VOID) {
+    if (mCrcCoreFeatures == 0) {
+#if defined (CRC_CORE_X64) || defined (CRC_CORE_AARCH64)
+        mCrcCoreFeatures = CrcCoreProbe();
+#else
+        mCrcCoreFeatures = CRC_CORE_PROBED;
+#endif
+    }
+
+    return mCrcCoreFeatures;
+} // static UINT32 CrcCoreFeatures()
+
+// CRC32 with the IEEE 802.3 polynomial (GPT, Zip, PNG)
+static
+CRC_CORE_INLINE
+UINT32 CrcCoreCrc32 (
+    IN UINT32        Crc,
+    IN CONST VOID   *Buf,
+    IN UINTN         Size
+) {
+    CONST UINT8  *Data;
+#if defined (CRC_CORE_X64)
+    UINTN         Bulk;
+#endif
+
+    Data = (CONST UINT8 *) Buf;
+    Crc  = ~Crc;
+
+#if defined (CRC_CORE_X64)
+    if (Size >= 64 && (CrcCoreFeatures() & CRC_CORE_HW_CRC32)) {
+        Bulk  = Size & ~((UINTN) 15);
+        Crc   = CrcCoreHwCrc32 (Crc, Data, Bulk);
+        Data += Bulk;
+        Size -= Bulk;
+    }
+#elif defined (CRC_CORE_AARCH64)
+    if (CrcCoreFeatures() & CRC_CORE_HW_CRC32) {
+        return ~CrcCoreHwCrc32 (Crc, Data, Size);
+    }
+#endif
+
+    return ~CrcCoreSlice8 (CRC_CORE_TABLE_CRC32, Crc, Data, Size);
+} // static UINT32 CrcCoreCrc32()
+
+// CRC32C with the Castagnoli polynomial (btrfs, ext4 metadata_csum)
+static
+CRC_CORE_INLINE
+UINT32 CrcCoreCrc32c (
+    IN UINT32        Crc,
+    IN CONST VOID   *Buf,
+    IN UINTN         Size
+) {
+    Crc = ~Crc;
+
+#if defined (CRC_CORE_X64) || defined (CRC_CORE_AARCH64)
+    if (CrcCoreFeatures() & CRC_CORE_HW_CRC32C) {
+        return ~CrcCoreHwCrc32c (Crc, (CONST UINT8 *) Buf, Size);
+    }
+#endif
+
+    return ~CrcCoreSlice8 (CRC_CORE_TABLE_CRC32C, Crc, (CONST UINT8 *) Buf, Size);
+} // static UINT32 CrcCoreCrc32c()
+
+#endif
+
+/* EOF */
@@ -463,26 +463,34 @@ EFI_STATUS egSaveFile (
 //
 
 // Decode the specified image data. The IconSize parameter is relevant only
-// for ICNS, for which it selects which ICNS sub-image is decoded.
+// for ICNS, for which it selects which ICNS sub-image is decoded. MinWidth and
+// MinHeight are relevant only for JPEG, which may be decoded at a reduced
+// size that still covers them. Zero for either decodes at full size.
 // Returns a pointer to the resulting EG_IMAGE or NULL if decoding failed.
 static
 EG_IMAGE * egDecodeAny (
     IN UINT8    *FileData,
     IN UINTN     FileDataLength,
     IN UINTN     IconSize,
+    IN UINTN     MinWidth,
+    IN UINTN     MinHeight,
     IN BOOLEAN   WantAlpha
 ) {
     EG_IMAGE       *NewImage = egDecodePNG  (FileData, FileDataLength, IconSize, WantAlpha);
-    if (!NewImage)  NewImage = egDecodeJPEG (FileData, FileDataLength, IconSize, WantAlpha);
+    if (!NewImage)  NewImage = egDecodeJPEG (FileData, FileDataLength, MinWidth, MinHeight, WantAlpha);
     if (!NewImage)  NewImage = egDecodeBMP  (FileData, FileDataLength, IconSize, WantAlpha);
     if (!NewImage)  NewImage = egDecodeICNS (FileData, FileDataLength, IconSize, WantAlpha);
 
     return NewImage;
 } // static EG_IMAGE * egDecodeAny ()
 
-EG_IMAGE * egLoadImage (
+// Load an image that the caller will resize to at least MinWidth x MinHeight.
+// Formats that support it are decoded close to that size rather than in full.
+EG_IMAGE * egLoadScaledImage (
     IN EFI_FILE_PROTOCOL  *BaseDir,
     IN CHAR16             *FileName,
+    IN UINTN               MinWidth,
+    IN UINTN               MinHeight,
     IN BOOLEAN             WantAlpha
 ) {
     EFI_STATUS   Status;
@@ -492,7 +500,7 @@ EG_IMAGE * egLoadImage (
 
     if (BaseDir == NULL || FileName == NULL) {
         #if REFIT_DEBUG > 0
-        ALT_LOG(1, LOG_LINE_NORMAL, L"In egLoadImage ... Requirements Not Met!!");
+        ALT_LOG(1, LOG_LINE_NORMAL, L"In egLoadScaledImage ... Requirements Not Met!!");
         #endif
 
         // Early Return
@@ -504,7 +512,7 @@ EG_IMAGE * egLoadImage (
     if (EFI_ERROR(Status)) {
         #if REFIT_DEBUG > 0
         ALT_LOG(1, LOG_LINE_NORMAL,
-            L"In egLoadImage ... '%r' Returned While Attempting to Load File!!",
+            L"In egLoadScaledImage ... '%r' Returned While Attempting to Load File!!",
             Status
         );
         #endif
@@ -515,10 +523,18 @@ EG_IMAGE * egLoadImage (
 
     // Decode it
     // '128' can be any arbitrary value
-    NewImage = egDecodeAny (FileData, FileDataLength, 128, WantAlpha);
+    NewImage = egDecodeAny (FileData, FileDataLength, 128, MinWidth, MinHeight, WantAlpha);
     MY_FREE_POOL(FileData);
 
     return NewImage;
+} // EG_IMAGE * egLoadScaledImage()
+
+EG_IMAGE * egLoadImage (
+    IN EFI_FILE_PROTOCOL  *BaseDir,
+    IN CHAR16             *FileName,
+    IN BOOLEAN             WantAlpha
+) {
+    return egLoadScaledImage (BaseDir, FileName, 0, 0, WantAlpha);
 } // EG_IMAGE * egLoadImage()
 
 // Load an icon from (BaseDir)/Path, extracting the icon of size IconSize x IconSize.
@@ -579,7 +595,7 @@ EG_IMAGE * egLoadIcon (
     }
 
     // Decode it
-    Image = egDecodeAny (FileData, FileDataLength, IconSize, TRUE);
+    Image = egDecodeAny (FileData, FileDataLength, IconSize, IconSize, IconSize, TRUE);
     MY_FREE_POOL(FileData);
 
     // Return null if unable to decode
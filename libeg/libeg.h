@@ -152,6 +152,8 @@ VOID egDrawImageArea(
     IN UINTN     ScreenPosX,
     IN UINTN     ScreenPosY
 );
+// Only built with REFIT_PROFILE
+VOID egTimeScreenPaint (OUT UINT64 *BltTicks, OUT UINT64 *DirectTicks);
 
 
 BOOLEAN egHasGraphicsMode (VOID);
@@ -168,6 +170,13 @@ EG_IMAGE * egCopyScreenArea (UINTN XPos, UINTN YPos, UINTN Width, UINTN Height);
 EG_IMAGE * egCreateImage (IN UINTN Width, IN UINTN Height, IN BOOLEAN HasAlpha);
 EG_IMAGE * egLoadIcon (IN EFI_FILE* BaseDir, IN CHAR16 *FileName, IN UINTN IconSize);
 EG_IMAGE * egLoadImage (IN EFI_FILE* BaseDir, IN CHAR16 *FileName, IN BOOLEAN WantAlpha);
+EG_IMAGE * egLoadScaledImage (
+    IN EFI_FILE  *BaseDir,
+    IN CHAR16    *FileName,
+    IN UINTN      MinWidth,
+    IN UINTN      MinHeight,
+    IN BOOLEAN    WantAlpha
+);
 EG_IMAGE * egCreateFilledImage (
     IN UINTN     Width,
     IN UINTN     Height,
@@ -207,7 +216,8 @@ EG_IMAGE * egDecodePNG (
 EG_IMAGE * egDecodeJPEG (
     IN UINT8   *FileData,
     IN UINTN    FileDataLength,
-    IN UINTN    IconSize,
+    IN UINTN    MinWidth,
+    IN UINTN    MinHeight,
     IN BOOLEAN  WantAlpha
 );
 
@@ -172,6 +172,21 @@ unsigned char* njGetImage(void);
 // undefined.
 int njGetImageSize(void);
 
+// njSetMinSize: Request DCT-domain downscaling for subsequent njDecode()
+// calls. The image is decoded at the smallest of 1/1, 1/2, 1/4 or 1/8 scale
+// that still yields at least the given width and height. Zero for either
+// dimension selects full-size decoding (the default).
+// Modified: RefindPlus addition.
+void njSetMinSize(const int width, const int height);
+
+// njGetImageBGRA: Convert the most recently decoded image into 32-bit
+// blue/green/red/reserved pixels, as used by UEFI framebuffers, writing
+// njGetWidth() * njGetHeight() pixels to 'out'. The reserved byte is set to
+// 0xFF. Colour conversion and any remaining chroma upsampling are done in a
+// single pass, without the intermediate RGB buffer used by njGetImage().
+// Modified: RefindPlus addition.
+void njGetImageBGRA(unsigned char* out);
+
 // njDone: Uninitialize NanoJPEG.
 // Resets NanoJPEG's internal state and frees all memory that has been
 // allocated at run-time by NanoJPEG. It is still possible to decode another
@@ -312,6 +327,8 @@ typedef struct _nj_cmp {
     int ssx, ssy;
     int width, height;
     int stride;
+    int bs;         // Modified: Decoded block size (8, 4, 2 or 1)
+    int xs, ys;     // Modified: Remaining upsampling shifts for output
     int qtsel;
     int actabsel, dctabsel;
     int dcpred;
@@ -334,15 +351,20 @@ typedef struct _nj_ctx {
     nj_component_t comp[3];
     int qtused, qtavail;
     unsigned char qtab[4][64];
+    int qaan[4][64];
     nj_vlc_code_t *vlctab[4];
     int buf, bufbits;
     int block[64];
     int rstinterval;
+    int scale;
     unsigned char *rgb;
 } nj_context_t;
 
 static nj_context_t nj;
 
+// Modified: Kept outside 'nj' as njDecode() resets the context
+static int nj_minwidth, nj_minheight;
+
 nj_vlc_code_t *nj_vlctab[] = {NULL, NULL, NULL, NULL};
 
 static const char njZZ[64] = { 0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18,
@@ -354,105 +376,208 @@ NJ_FORCE_INLINE unsigned char njClip(const int x) {
     return (x < 0) ? 0 : ((x > 0xFF) ? 0xFF : (unsigned char) x);
 }
 
-#define W1 2841
-#define W2 2676
-#define W3 2408
-#define W5 1609
-#define W6 1108
-#define W7 565
-
-NJ_INLINE void njRowIDCT(int* blk) {
-    int x0, x1, x2, x3, x4, x5, x6, x7, x8;
-    if (!((x1 = blk[4] << 11)
-        | (x2 = blk[6])
-        | (x3 = blk[2])
-        | (x4 = blk[1])
-        | (x5 = blk[7])
-        | (x6 = blk[5])
-        | (x7 = blk[3])))
-    {
-        blk[0] = blk[1] = blk[2] = blk[3] = blk[4] = blk[5] = blk[6] = blk[7] = blk[0] << 3;
-        return;
+// Modified: The original Chen-Wang row/column IDCT has been replaced with the
+// AAN (Arai, Agui and Nakajima) scaled integer IDCT as used in the IJG "ifast"
+// decoder. Dequantisation absorbs the AAN scale factors (see njDecodeDQT()),
+// leaving five multiplications per 1-D pass. Reduced-size IDCTs (4x4, 2x2 and
+// 1x1) are used for DCT-domain downscaling, following the IJG "jidctred" code.
+// These operate on plainly dequantised coefficients.
+
+static const unsigned short njAANScale[64] = {
+    16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+    22725, 31521, 29692, 26722, 22725, 17855, 12299,  6270,
+    21407, 29692, 27969, 25172, 21407, 16819, 11585,  5906,
+    19266, 26722, 25172, 22654, 19266, 15137, 10426,  5315,
+    16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+    12873, 17855, 16819, 15137, 12873, 10114,  6967,  3552,
+     8867, 12299, 11585, 10426,  8867,  6967,  4799,  2446,
+     4520,  6270,  5906,  5315,  4520,  3552,  2446,  1247
+};
+
+// AAN constants: 8 fractional bits
+#define NJ_AAN_BITS      8
+#define NJ_AAN_1_082     277
+#define NJ_AAN_1_414     362
+#define NJ_AAN_1_847     473
+#define NJ_AAN_2_613     669
+#define NJ_AAN_MUL(v, c) (((v) * (c)) >> NJ_AAN_BITS)
+
+// Reduced IDCT constants: 13 fractional bits
+#define NJ_RED_BITS      13
+#define NJ_RED_0_211     1730
+#define NJ_RED_0_509     4176
+#define NJ_RED_0_601     4926
+#define NJ_RED_0_720     5906
+#define NJ_RED_0_765     6270
+#define NJ_RED_0_850     6967
+#define NJ_RED_0_899     7373
+#define NJ_RED_1_061     8697
+#define NJ_RED_1_272     10426
+#define NJ_RED_1_451     11893
+#define NJ_RED_1_847     15137
+#define NJ_RED_2_172     17799
+#define NJ_RED_2_562     20995
+#define NJ_RED_3_624     29692
+
+// Coefficients carry two extra fractional bits between the passes
+#define NJ_PASS1_BITS    2
+#define NJ_DESCALE(x, n) (((x) + (1 << ((n) - 1))) >> (n))
+
+NJ_INLINE void njIDCT8(const int* blk, unsigned char *out, int stride) {
+    int tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+    int tmp10, tmp11, tmp12, tmp13, z5, z10, z11, z12, z13;
+    int ws[64], *w, i;
+    const int *in;
+
+    // Pass 1: columns -> workspace
+    for (i = 0, in = blk, w = ws;  i < 8;  ++i, ++in, ++w) {
+        if (!(in[8] | in[16] | in[24] | in[32] | in[40] | in[48] | in[56])) {
+            w[0] = w[8] = w[16] = w[24] = w[32] = w[40] = w[48] = w[56] = in[0];
+            continue;
+        }
+        tmp10 = in[0] + in[32];
+        tmp11 = in[0] - in[32];
+        tmp13 = in[16] + in[48];
+        tmp12 = NJ_AAN_MUL(in[16] - in[48], NJ_AAN_1_414) - tmp13;
+        tmp0 = tmp10 + tmp13;
+        tmp3 = tmp10 - tmp13;
+        tmp1 = tmp11 + tmp12;
+        tmp2 = tmp11 - tmp12;
+        z13 = in[40] + in[24];
+        z10 = in[40] - in[24];
+        z11 = in[8] + in[56];
+        z12 = in[8] - in[56];
+        tmp7 = z11 + z13;
+        tmp11 = NJ_AAN_MUL(z11 - z13, NJ_AAN_1_414);
+        z5 = NJ_AAN_MUL(z10 + z12, NJ_AAN_1_847);
+        tmp10 = NJ_AAN_MUL(z12, NJ_AAN_1_082) - z5;
+        tmp12 = z5 - NJ_AAN_MUL(z10, NJ_AAN_2_613);
+        tmp6 = tmp12 - tmp7;
+        tmp5 = tmp11 - tmp6;
+        tmp4 = tmp10 + tmp5;
+        w[0]  = tmp0 + tmp7;
+        w[56] = tmp0 - tmp7;
+        w[8]  = tmp1 + tmp6;
+        w[48] = tmp1 - tmp6;
+        w[16] = tmp2 + tmp5;
+        w[40] = tmp2 - tmp5;
+        w[32] = tmp3 + tmp4;
+        w[24] = tmp3 - tmp4;
     }
-    x0 = (blk[0] << 11) + 128;
-    x8 = W7 * (x4 + x5);
-    x4 = x8 + (W1 - W7) * x4;
-    x5 = x8 - (W1 + W7) * x5;
-    x8 = W3 * (x6 + x7);
-    x6 = x8 - (W3 - W5) * x6;
-    x7 = x8 - (W3 + W5) * x7;
-    x8 = x0 + x1;
-    x0 -= x1;
-    x1 = W6 * (x3 + x2);
-    x2 = x1 - (W2 + W6) * x2;
-    x3 = x1 + (W2 - W6) * x3;
-    x1 = x4 + x6;
-    x4 -= x6;
-    x6 = x5 + x7;
-    x5 -= x7;
-    x7 = x8 + x3;
-    x8 -= x3;
-    x3 = x0 + x2;
-    x0 -= x2;
-    x2 = (181 * (x4 + x5) + 128) >> 8;
-    x4 = (181 * (x4 - x5) + 128) >> 8;
-    blk[0] = (x7 + x1) >> 8;
-    blk[1] = (x3 + x2) >> 8;
-    blk[2] = (x0 + x4) >> 8;
-    blk[3] = (x8 + x6) >> 8;
-    blk[4] = (x8 - x6) >> 8;
-    blk[5] = (x0 - x4) >> 8;
-    blk[6] = (x3 - x2) >> 8;
-    blk[7] = (x7 - x1) >> 8;
-}
-
-NJ_INLINE void njColIDCT(const int* blk, unsigned char *out, int stride) {
-    int x0, x1, x2, x3, x4, x5, x6, x7, x8;
-    if (!((x1 = blk[8*4] << 8)
-        | (x2 = blk[8*6])
-        | (x3 = blk[8*2])
-        | (x4 = blk[8*1])
-        | (x5 = blk[8*7])
-        | (x6 = blk[8*5])
-        | (x7 = blk[8*3])))
-    {
-        x1 = njClip(((blk[0] + 32) >> 6) + 128);
-        for (x0 = 8;  x0;  --x0) {
-            *out = (unsigned char) x1;
-            out += stride;
+
+    // Pass 2: rows -> pixels
+    for (i = 0, w = ws;  i < 8;  ++i, w += 8, out += stride) {
+        if (!(w[1] | w[2] | w[3] | w[4] | w[5] | w[6] | w[7])) {
+            tmp0 = njClip(NJ_DESCALE(w[0], NJ_PASS1_BITS + 3) + 128);
+            njFillMem(out, (unsigned char) tmp0, 8);
+            continue;
         }
-        return;
+        tmp10 = w[0] + w[4];
+        tmp11 = w[0] - w[4];
+        tmp13 = w[2] + w[6];
+        tmp12 = NJ_AAN_MUL(w[2] - w[6], NJ_AAN_1_414) - tmp13;
+        tmp0 = tmp10 + tmp13;
+        tmp3 = tmp10 - tmp13;
+        tmp1 = tmp11 + tmp12;
+        tmp2 = tmp11 - tmp12;
+        z13 = w[5] + w[3];
+        z10 = w[5] - w[3];
+        z11 = w[1] + w[7];
+        z12 = w[1] - w[7];
+        tmp7 = z11 + z13;
+        tmp11 = NJ_AAN_MUL(z11 - z13, NJ_AAN_1_414);
+        z5 = NJ_AAN_MUL(z10 + z12, NJ_AAN_1_847);
+        tmp10 = NJ_AAN_MUL(z12, NJ_AAN_1_082) - z5;
+        tmp12 = z5 - NJ_AAN_MUL(z10, NJ_AAN_2_613);
+        tmp6 = tmp12 - tmp7;
+        tmp5 = tmp11 - tmp6;
+        tmp4 = tmp10 + tmp5;
+        out[0] = njClip(NJ_DESCALE(tmp0 + tmp7, NJ_PASS1_BITS + 3) + 128);
+        out[7] = njClip(NJ_DESCALE(tmp0 - tmp7, NJ_PASS1_BITS + 3) + 128);
+        out[1] = njClip(NJ_DESCALE(tmp1 + tmp6, NJ_PASS1_BITS + 3) + 128);
+        out[6] = njClip(NJ_DESCALE(tmp1 - tmp6, NJ_PASS1_BITS + 3) + 128);
+        out[2] = njClip(NJ_DESCALE(tmp2 + tmp5, NJ_PASS1_BITS + 3) + 128);
+        out[5] = njClip(NJ_DESCALE(tmp2 - tmp5, NJ_PASS1_BITS + 3) + 128);
+        out[4] = njClip(NJ_DESCALE(tmp3 + tmp4, NJ_PASS1_BITS + 3) + 128);
+        out[3] = njClip(NJ_DESCALE(tmp3 - tmp4, NJ_PASS1_BITS + 3) + 128);
+    }
+}
+
+NJ_INLINE void njIDCT4(const int* blk, unsigned char *out, int stride) {
+    int tmp0, tmp2, tmp10, tmp12, z1, z2, z3, z4;
+    int ws[32], *w, i;
+    const int *in;
+
+    // Pass 1: columns -> workspace (column 4 is not needed by pass 2)
+    for (i = 0, in = blk, w = ws;  i < 8;  ++i, ++in, ++w) {
+        if (i == 4) continue;
+        if (!(in[8] | in[16] | in[24] | in[40] | in[48] | in[56])) {
+            w[0] = w[8] = w[16] = w[24] = in[0] << NJ_PASS1_BITS;
+            continue;
+        }
+        tmp0  = in[0] << (NJ_RED_BITS + 1);
+        tmp2  = in[16] * NJ_RED_1_847 - in[48] * NJ_RED_0_765;
+        tmp10 = tmp0 + tmp2;
+        tmp12 = tmp0 - tmp2;
+        z1 = in[56];  z2 = in[40];  z3 = in[24];  z4 = in[8];
+        tmp0 = - z1 * NJ_RED_0_211 + z2 * NJ_RED_1_451 - z3 * NJ_RED_2_172 + z4 * NJ_RED_1_061;
+        tmp2 = - z1 * NJ_RED_0_509 - z2 * NJ_RED_0_601 + z3 * NJ_RED_0_899 + z4 * NJ_RED_2_562;
+        w[0]  = NJ_DESCALE(tmp10 + tmp2, NJ_RED_BITS - NJ_PASS1_BITS + 1);
+        w[24] = NJ_DESCALE(tmp10 - tmp2, NJ_RED_BITS - NJ_PASS1_BITS + 1);
+        w[8]  = NJ_DESCALE(tmp12 + tmp0, NJ_RED_BITS - NJ_PASS1_BITS + 1);
+        w[16] = NJ_DESCALE(tmp12 - tmp0, NJ_RED_BITS - NJ_PASS1_BITS + 1);
+    }
+
+    // Pass 2: rows -> pixels
+    for (i = 0, w = ws;  i < 4;  ++i, w += 8, out += stride) {
+        if (!(w[1] | w[2] | w[3] | w[5] | w[6] | w[7])) {
+            out[0] = out[1] = out[2] = out[3] = njClip(NJ_DESCALE(w[0], NJ_PASS1_BITS + 3) + 128);
+            continue;
+        }
+        tmp0  = w[0] << (NJ_RED_BITS + 1);
+        tmp2  = w[2] * NJ_RED_1_847 - w[6] * NJ_RED_0_765;
+        tmp10 = tmp0 + tmp2;
+        tmp12 = tmp0 - tmp2;
+        z1 = w[7];  z2 = w[5];  z3 = w[3];  z4 = w[1];
+        tmp0 = - z1 * NJ_RED_0_211 + z2 * NJ_RED_1_451 - z3 * NJ_RED_2_172 + z4 * NJ_RED_1_061;
+        tmp2 = - z1 * NJ_RED_0_509 - z2 * NJ_RED_0_601 + z3 * NJ_RED_0_899 + z4 * NJ_RED_2_562;
+        out[0] = njClip(NJ_DESCALE(tmp10 + tmp2, NJ_RED_BITS + NJ_PASS1_BITS + 4) + 128);
+        out[3] = njClip(NJ_DESCALE(tmp10 - tmp2, NJ_RED_BITS + NJ_PASS1_BITS + 4) + 128);
+        out[1] = njClip(NJ_DESCALE(tmp12 + tmp0, NJ_RED_BITS + NJ_PASS1_BITS + 4) + 128);
+        out[2] = njClip(NJ_DESCALE(tmp12 - tmp0, NJ_RED_BITS + NJ_PASS1_BITS + 4) + 128);
     }
-    x0 = (blk[0] << 8) + 8192;
-    x8 = W7 * (x4 + x5) + 4;
-    x4 = (x8 + (W1 - W7) * x4) >> 3;
-    x5 = (x8 - (W1 + W7) * x5) >> 3;
-    x8 = W3 * (x6 + x7) + 4;
-    x6 = (x8 - (W3 - W5) * x6) >> 3;
-    x7 = (x8 - (W3 + W5) * x7) >> 3;
-    x8 = x0 + x1;
-    x0 -= x1;
-    x1 = W6 * (x3 + x2) + 4;
-    x2 = (x1 - (W2 + W6) * x2) >> 3;
-    x3 = (x1 + (W2 - W6) * x3) >> 3;
-    x1 = x4 + x6;
-    x4 -= x6;
-    x6 = x5 + x7;
-    x5 -= x7;
-    x7 = x8 + x3;
-    x8 -= x3;
-    x3 = x0 + x2;
-    x0 -= x2;
-    x2 = (181 * (x4 + x5) + 128) >> 8;
-    x4 = (181 * (x4 - x5) + 128) >> 8;
-    *out = njClip(((x7 + x1) >> 14) + 128);  out += stride;
-    *out = njClip(((x3 + x2) >> 14) + 128);  out += stride;
-    *out = njClip(((x0 + x4) >> 14) + 128);  out += stride;
-    *out = njClip(((x8 + x6) >> 14) + 128);  out += stride;
-    *out = njClip(((x8 - x6) >> 14) + 128);  out += stride;
-    *out = njClip(((x0 - x4) >> 14) + 128);  out += stride;
-    *out = njClip(((x3 - x2) >> 14) + 128);  out += stride;
-    *out = njClip(((x7 - x1) >> 14) + 128);
+}
+
+NJ_INLINE void njIDCT2(const int* blk, unsigned char *out, int stride) {
+    int tmp0, tmp10, ws[16], *w, i;
+    const int *in;
+
+    // Pass 1: columns -> workspace (only odd columns and column 0 are needed)
+    for (i = 0, in = blk, w = ws;  i < 8;  ++i, ++in, ++w) {
+        if ((i == 2) || (i == 4) || (i == 6)) continue;
+        if (!(in[8] | in[24] | in[40] | in[56])) {
+            w[0] = w[8] = in[0] << NJ_PASS1_BITS;
+            continue;
+        }
+        tmp10 = in[0] << (NJ_RED_BITS + 2);
+        tmp0  = - in[56] * NJ_RED_0_720 + in[40] * NJ_RED_0_850
+                - in[24] * NJ_RED_1_272 + in[8]  * NJ_RED_3_624;
+        w[0] = NJ_DESCALE(tmp10 + tmp0, NJ_RED_BITS - NJ_PASS1_BITS + 2);
+        w[8] = NJ_DESCALE(tmp10 - tmp0, NJ_RED_BITS - NJ_PASS1_BITS + 2);
+    }
+
+    // Pass 2: rows -> pixels
+    for (i = 0, w = ws;  i < 2;  ++i, w += 8, out += stride) {
+        tmp10 = w[0] << (NJ_RED_BITS + 2);
+        tmp0  = - w[7] * NJ_RED_0_720 + w[5] * NJ_RED_0_850
+                - w[3] * NJ_RED_1_272 + w[1] * NJ_RED_3_624;
+        out[0] = njClip(NJ_DESCALE(tmp10 + tmp0, NJ_RED_BITS + NJ_PASS1_BITS + 5) + 128);
+        out[1] = njClip(NJ_DESCALE(tmp10 - tmp0, NJ_RED_BITS + NJ_PASS1_BITS + 5) + 128);
+    }
+}
+
+NJ_INLINE void njIDCT1(const int* blk, unsigned char *out) {
+    *out = njClip(NJ_DESCALE(blk[0], 3) + 128);
 }
 
 #define njThrow(e) do { nj.error = e; return; } while (0)
@@ -534,8 +659,33 @@ NJ_INLINE void njSkipMarker(void) {
     njSkip(nj.length);
 }
 
+// Modified: Lay out the component planes for a decode at 1/(2^scale) size.
+// Subsampled components are reduced less in the DCT domain, so that they
+// need little or no upsampling afterwards.
+// Returns 1 if the layout is usable or 0 otherwise.
+static int njLayout(const int width, const int height, const int ssxmax, const int ssymax, const int scale) {
+    int i, shift, ratio;
+    nj_component_t* c;
+    nj.width  = (width  + (1 << scale) - 1) >> scale;
+    nj.height = (height + (1 << scale) - 1) >> scale;
+    nj.scale  = scale;
+    for (i = 0, c = nj.comp;  i < nj.ncomp;  ++i, ++c) {
+        shift = scale;
+        if ((ssxmax / c->ssx) == (ssymax / c->ssy)) {
+            for (ratio = ssxmax / c->ssx;  (ratio > 1) && shift;  ratio >>= 1)
+                --shift;
+        }
+        c->bs = 8 >> shift;
+        c->width = (width * c->ssx + (ssxmax << shift) - 1) / (ssxmax << shift);
+        c->height = (height * c->ssy + (ssymax << shift) - 1) / (ssymax << shift);
+        c->stride = nj.mbwidth * c->ssx * c->bs;
+        if (((c->width < 3) && (c->width < nj.width)) || ((c->height < 3) && (c->height < nj.height))) return 0;
+    }
+    return 1;
+}
+
 NJ_INLINE void njDecodeSOF(void) {
-    int i, ssxmax = 0, ssymax = 0;
+    int i, ssxmax = 0, ssymax = 0, width, height, scale = 0;
     nj_component_t* c;
     njDecodeLength();
     njCheckError();
@@ -574,16 +724,22 @@ NJ_INLINE void njDecodeSOF(void) {
     nj.mbsizey = ssymax << 3;
     nj.mbwidth = (nj.width + nj.mbsizex - 1) / nj.mbsizex;
     nj.mbheight = (nj.height + nj.mbsizey - 1) / nj.mbsizey;
-    for (i = 0, c = nj.comp;  i < nj.ncomp;  ++i, ++c) {
-        c->width = (nj.width * c->ssx + ssxmax - 1) / ssxmax;
-        c->height = (nj.height * c->ssy + ssymax - 1) / ssymax;
-        c->stride = nj.mbwidth * c->ssx << 3;
-        if (((c->width < 3) && (c->ssx != ssxmax)) || ((c->height < 3) && (c->ssy != ssymax))) njThrow(NJ_UNSUPPORTED);
-        if (!(c->pixels = (unsigned char*) njAllocMem(c->stride * nj.mbheight * c->ssy << 3))) njThrow(NJ_OUT_OF_MEM);
+    // Modified: Pick the smallest DCT scale that satisfies njSetMinSize()
+    width = nj.width;
+    height = nj.height;
+    if ((nj_minwidth > 0) && (nj_minheight > 0)) {
+        while ((scale < 3)
+            && (((width  >> (scale + 1)) >= nj_minwidth))
+            && (((height >> (scale + 1)) >= nj_minheight))
+        ) {
+            ++scale;
+        }
+    }
+    while (!njLayout(width, height, ssxmax, ssymax, scale)) {
+        if (!scale--) njThrow(NJ_UNSUPPORTED);
     }
-    if (nj.ncomp == 3) {
-        nj.rgb = (unsigned char*) njAllocMem(nj.width * nj.height * nj.ncomp);
-        if (!nj.rgb) njThrow(NJ_OUT_OF_MEM);
+    for (i = 0, c = nj.comp;  i < nj.ncomp;  ++i, ++c) {
+        if (!(c->pixels = (unsigned char*) njAllocMem(c->stride * nj.mbheight * c->ssy * c->bs))) njThrow(NJ_OUT_OF_MEM);
     }
     njSkip(nj.length);
 }
@@ -630,7 +786,7 @@ NJ_INLINE void njDecodeDHT(void) {
 }
 
 NJ_INLINE void njDecodeDQT(void) {
-    int i;
+    int i, *a;
     unsigned char *t;
     njDecodeLength();
     njCheckError();
@@ -639,8 +795,11 @@ NJ_INLINE void njDecodeDQT(void) {
         if (i & 0xFC) njThrow(NJ_SYNTAX_ERROR);
         nj.qtavail |= 1 << i;
         t = &nj.qtab[i][0];
-        for (i = 0;  i < 64;  ++i)
+        a = &nj.qaan[i][0];
+        for (i = 0;  i < 64;  ++i) {
             t[i] = nj.pos[i + 1];
+            a[i] = (t[i] * njAANScale[(int) njZZ[i]] + 2048) >> 12;
+        }
         njSkip(65);
     }
     if (nj.length) njThrow(NJ_SYNTAX_ERROR);
@@ -672,21 +831,37 @@ static int njGetVLC(nj_vlc_code_t* vlc, unsigned char* code) {
 NJ_INLINE void njDecodeBlock(nj_component_t* c, unsigned char* out) {
     unsigned char code = 0;
     int value, coef = 0;
+    const unsigned char *qt = nj.qtab[c->qtsel];
+    const int *qa = nj.qaan[c->qtsel];
     njFillMem(nj.block, 0, sizeof (nj.block));
     c->dcpred += njGetVLC(&nj.vlctab[c->dctabsel][0], NULL);
-    nj.block[0] = (c->dcpred) * nj.qtab[c->qtsel][0];
+    if (c->bs == 8) {
+        nj.block[0] = (c->dcpred) * qa[0];
+        do {
+            value = njGetVLC(&nj.vlctab[c->actabsel][0], &code);
+            if (!code) break;  // EOB
+            if (!(code & 0x0F) && (code != 0xF0)) njThrow(NJ_SYNTAX_ERROR);
+            coef += (code >> 4) + 1;
+            if (coef > 63) njThrow(NJ_SYNTAX_ERROR);
+            nj.block[(int) njZZ[coef]] = value * qa[coef];
+        } while (coef < 63);
+        njIDCT8(nj.block, out, c->stride);
+        return;
+    }
+    nj.block[0] = (c->dcpred) * qt[0];
     do {
         value = njGetVLC(&nj.vlctab[c->actabsel][0], &code);
         if (!code) break;  // EOB
         if (!(code & 0x0F) && (code != 0xF0)) njThrow(NJ_SYNTAX_ERROR);
         coef += (code >> 4) + 1;
         if (coef > 63) njThrow(NJ_SYNTAX_ERROR);
-        nj.block[(int) njZZ[coef]] = value * nj.qtab[c->qtsel][coef];
+        nj.block[(int) njZZ[coef]] = value * qt[coef];
     } while (coef < 63);
-    for (coef = 0;  coef < 64;  coef += 8)
-        njRowIDCT(&nj.block[coef]);
-    for (coef = 0;  coef < 8;  ++coef)
-        njColIDCT(&nj.block[coef], &out[coef], c->stride);
+    switch (c->bs) {
+        case 4:  njIDCT4(nj.block, out, c->stride); break;
+        case 2:  njIDCT2(nj.block, out, c->stride); break;
+        default: njIDCT1(nj.block, out);            break;
+    }
 }
 
 NJ_INLINE void njDecodeScan(void) {
@@ -711,7 +886,7 @@ NJ_INLINE void njDecodeScan(void) {
         for (i = 0, c = nj.comp;  i < nj.ncomp;  ++i, ++c)
             for (sby = 0;  sby < c->ssy;  ++sby)
                 for (sbx = 0;  sbx < c->ssx;  ++sbx) {
-                    njDecodeBlock(c, &c->pixels[((mby * c->ssy + sby) * c->stride + mbx * c->ssx + sbx) << 3]);
+                    njDecodeBlock(c, &c->pixels[(mby * c->ssy + sby) * c->bs * c->stride + (mbx * c->ssx + sbx) * c->bs]);
                     njCheckError();
                 }
         if (++mbx >= nj.mbwidth) {
@@ -832,6 +1007,13 @@ NJ_INLINE void njConvert(void) {
     int i;
     nj_component_t* c;
     for (i = 0, c = nj.comp;  i < nj.ncomp;  ++i, ++c) {
+        // Modified: Scaled decodes leave any remaining upsampling to the
+        // output conversion, which replicates chroma pixels on the fly.
+        if (nj.scale) {
+            while ((c->width << c->xs) < nj.width) ++c->xs;
+            while ((c->height << c->ys) < nj.height) ++c->ys;
+            continue;
+        }
         #if NJ_CHROMA_FILTER
             while ((c->width < nj.width) || (c->height < nj.height)) {
                 if (c->width < nj.width) njUpsampleH(c);
@@ -845,27 +1027,7 @@ NJ_INLINE void njConvert(void) {
         #endif
         if ((c->width < nj.width) || (c->height < nj.height)) njThrow(NJ_INTERNAL_ERR);
     }
-    if (nj.ncomp == 3) {
-        // convert to RGB
-        int x, yy;
-        unsigned char *prgb = nj.rgb;
-        const unsigned char *py  = nj.comp[0].pixels;
-        const unsigned char *pcb = nj.comp[1].pixels;
-        const unsigned char *pcr = nj.comp[2].pixels;
-        for (yy = nj.height;  yy;  --yy) {
-            for (x = 0;  x < nj.width;  ++x) {
-                register int y = py[x] << 8;
-                register int cb = pcb[x] - 128;
-                register int cr = pcr[x] - 128;
-                *prgb++ = njClip((y            + 359 * cr + 128) >> 8);
-                *prgb++ = njClip((y -  88 * cb - 183 * cr + 128) >> 8);
-                *prgb++ = njClip((y + 454 * cb            + 128) >> 8);
-            }
-            py += nj.comp[0].stride;
-            pcb += nj.comp[1].stride;
-            pcr += nj.comp[2].stride;
-        }
-    } else if (nj.comp[0].width != nj.comp[0].stride) {
+    if ((nj.ncomp == 1) && (nj.comp[0].width != nj.comp[0].stride)) {
         // grayscale -> only remove stride
         unsigned char *pin = &nj.comp[0].pixels[nj.comp[0].stride];
         unsigned char *pout = &nj.comp[0].pixels[nj.comp[0].width];
@@ -879,6 +1041,50 @@ NJ_INLINE void njConvert(void) {
     }
 }
 
+// Modified: YCbCr conversion is deferred until the caller asks for output and
+// writes either packed RGB (bpp = 3) or BGRA (bpp = 4) in one pass.
+static void njColorConvert(unsigned char *out, const int bpp) {
+    int x, yy;
+    const nj_component_t *cy = &nj.comp[0], *ccb = &nj.comp[1], *ccr = &nj.comp[2];
+    const unsigned char *py, *pcb, *pcr;
+    if (nj.ncomp == 1) {
+        for (yy = 0;  yy < nj.height;  ++yy) {
+            py = &cy->pixels[yy * cy->stride];
+            for (x = 0;  x < nj.width;  ++x) {
+                out[0] = out[1] = out[2] = py[x];
+                out[3] = 0xFF;
+                out += 4;
+            }
+        }
+        return;
+    }
+    for (yy = 0;  yy < nj.height;  ++yy) {
+        py  = &cy->pixels[(yy >> cy->ys) * cy->stride];
+        pcb = &ccb->pixels[(yy >> ccb->ys) * ccb->stride];
+        pcr = &ccr->pixels[(yy >> ccr->ys) * ccr->stride];
+        if (bpp == 3) {
+            for (x = 0;  x < nj.width;  ++x) {
+                register int y = py[x >> cy->xs] << 8;
+                register int cb = pcb[x >> ccb->xs] - 128;
+                register int cr = pcr[x >> ccr->xs] - 128;
+                *out++ = njClip((y            + 359 * cr + 128) >> 8);
+                *out++ = njClip((y -  88 * cb - 183 * cr + 128) >> 8);
+                *out++ = njClip((y + 454 * cb            + 128) >> 8);
+            }
+        } else {
+            for (x = 0;  x < nj.width;  ++x) {
+                register int y = py[x >> cy->xs] << 8;
+                register int cb = pcb[x >> ccb->xs] - 128;
+                register int cr = pcr[x >> ccr->xs] - 128;
+                *out++ = njClip((y + 454 * cb            + 128) >> 8);
+                *out++ = njClip((y -  88 * cb - 183 * cr + 128) >> 8);
+                *out++ = njClip((y            + 359 * cr + 128) >> 8);
+                *out++ = 0xFF;
+            }
+        }
+    }
+}
+
 // Modified njInit(); uses dynamic assignment of nj.vlctab[i] variable, to
 // avoid a 3x increase in binary size caused by the original static (stack)
 // definition.
@@ -921,6 +1127,11 @@ void njDone(void) {
     njInit();
 }
 
+void njSetMinSize(const int width, const int height) {
+    nj_minwidth  = width;
+    nj_minheight = height;
+}
+
 nj_result_t njDecode(const void* jpeg, const int size) {
     njDone();
     nj.pos = (const unsigned char*) jpeg;
@@ -954,7 +1165,21 @@ nj_result_t njDecode(const void* jpeg, const int size) {
 int njGetWidth(void)            { return nj.width; }
 int njGetHeight(void)           { return nj.height; }
 int njIsColor(void)             { return (nj.ncomp != 1); }
-unsigned char* njGetImage(void) { return (nj.ncomp == 1) ? nj.comp[0].pixels : nj.rgb; }
 int njGetImageSize(void)        { return nj.width * nj.height * nj.ncomp; }
 
+// Modified: The RGB buffer is only built on demand
+unsigned char* njGetImage(void) {
+    if (nj.ncomp == 1) return nj.comp[0].pixels;
+    if (!nj.rgb) {
+        nj.rgb = (unsigned char*) njAllocMem(nj.width * nj.height * 3);
+        if (!nj.rgb) return NULL;
+        njColorConvert(nj.rgb, 3);
+    }
+    return nj.rgb;
+}
+
+void njGetImageBGRA(unsigned char* out) {
+    njColorConvert(out, 4);
+}
+
 #endif // _NJ_INCLUDE_HEADER_ONLY
@@ -37,27 +37,31 @@
 #define _NJ_INCLUDE_HEADER_ONLY
 #include "nanojpeg.c"
 
-typedef struct _jpeg_color {
-   UINT8 red;
-   UINT8 green;
-   UINT8 blue;
-} jpeg_color;
-
 // Decode JPEG data into something libeg can use. This function is a wrapper around
-// various NanoJPEG functions.
-EG_IMAGE * egDecodeJPEG(IN UINT8 *FileData, IN UINTN FileDataLength, IN UINTN IconSize, IN BOOLEAN WantAlpha) {
+// various NanoJPEG functions. If MinWidth and MinHeight are both non-zero, the
+// image is scaled down by 1/2, 1/4 or 1/8 during decoding, as far as possible
+// while keeping it at least MinWidth x MinHeight pixels. Callers that resize
+// the result anyway then start from an image close to the final size.
+EG_IMAGE * egDecodeJPEG (
+    IN UINT8   *FileData,
+    IN UINTN    FileDataLength,
+    IN UINTN    MinWidth,
+    IN UINTN    MinHeight,
+    IN BOOLEAN  WantAlpha
+) {
     EG_IMAGE *NewImage;
     unsigned Width, Height;
-    jpeg_color *JpegData;
-    UINTN i;
     nj_result_t Result;
 
     if (!njInit()) {
         return NULL;
     }
 
-    Result = njDecode((VOID *) FileData, FileDataLength);
+    njSetMinSize ((int) MinWidth, (int) MinHeight);
+    Result = njDecode ((VOID *) FileData, FileDataLength);
+    njSetMinSize (0, 0);
     if (Result != NJ_OK) {
+        njDone();
         return NULL;
     }
 
@@ -65,26 +69,17 @@ EG_IMAGE * egDecodeJPEG(IN UINT8 *FileData, IN UINTN FileDataLength, IN UINTN Ic
     Height = njGetHeight();
 
     // allocate image structure and buffer
-    NewImage = egCreateImage(Width, Height, WantAlpha);
+    NewImage = egCreateImage (Width, Height, WantAlpha);
     if ((NewImage == NULL) || (NewImage->Width != Width) || (NewImage->Height != Height)) {
+        MY_FREE_IMAGE(NewImage);
+        njDone();
         return NULL;
     }
 
-    JpegData = (jpeg_color *) njGetImage();
-
-    // Annoyingly, EFI and NanoJPEG use different ordering of RGB values in
-    // their pixel data representations, so we must adjust them.
-    for (i = 0; i < (NewImage->Height * NewImage->Width); i++) {
-        NewImage->PixelData[i].r = JpegData[i].red;
-        NewImage->PixelData[i].g = JpegData[i].green;
-        NewImage->PixelData[i].b = JpegData[i].blue;
-        // NB: NanoJPEG does not appear to support alpha/transparency,
-        //     so if requested, set it to be fully opaque.
-        if (WantAlpha) {
-            NewImage->PixelData[i].a = 255;
-        }
-    }
-    FreePool(JpegData);
+    // NanoJPEG converts straight into the EFI (BGRA) pixel ordering.
+    // NB: NanoJPEG does not support alpha/transparency,
+    //     so the alpha byte is always set to be fully opaque.
+    njGetImageBGRA ((unsigned char *) NewImage->PixelData);
     njDone();
 
     return NewImage;
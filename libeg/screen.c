@@ -53,6 +53,7 @@
 #include "../BootMaster/apple.h"
 #include "../BootMaster/lib.h"
 #include "../BootMaster/mystrings.h"
+#include "../BootMaster/profile.h"
 #include "../include/refit_call_wrapper.h"
 #include "libeg.h"
 #include "lodepng.h"
@@ -2397,6 +2398,141 @@ VOID egSetGraphicsModeEnabled (
 // Drawing to the screen
 //
 
+// Returns the framebuffer address of 'ScreenPosX'/'ScreenPosY' when a 'Width' by 'Height'
+// area there can be written directly, with the row pitch in pixels in 'Pitch'.
+// Returns NULL, so that Blt is used instead, if the mode has no linear 32-bit
+// framebuffer or the area is not entirely within the reported framebuffer.
+static
+UINT32 * egFramebufferArea (
+    IN  UINTN  ScreenPosX,
+    IN  UINTN  ScreenPosY,
+    IN  UINTN  Width,
+    IN  UINTN  Height,
+    OUT UINTN *Pitch
+) {
+    EFI_GRAPHICS_OUTPUT_MODE_INFORMATION *Info;
+
+    if (GOPDraw                        == NULL ||
+        GOPDraw->Mode                  == NULL ||
+        GOPDraw->Mode->Info            == NULL ||
+        GOPDraw->Mode->FrameBufferBase == 0
+    ) {
+        // Early Return
+        return NULL;
+    }
+
+    Info = GOPDraw->Mode->Info;
+    if (Info->PixelFormat != PixelBlueGreenRedReserved8BitPerColor &&
+        Info->PixelFormat != PixelRedGreenBlueReserved8BitPerColor
+    ) {
+        // Early Return
+        return NULL;
+    }
+
+    if (Width  == 0 || Width  > Info->HorizontalResolution                ||
+        Height == 0 || Height > Info->VerticalResolution                  ||
+        ScreenPosX > Info->HorizontalResolution - Width                   ||
+        ScreenPosY > Info->VerticalResolution   - Height                  ||
+        Info->PixelsPerScanLine < Info->HorizontalResolution              ||
+        (
+            (ScreenPosY + Height - 1) * Info->PixelsPerScanLine + ScreenPosX + Width
+        ) * sizeof (UINT32) > GOPDraw->Mode->FrameBufferSize
+    ) {
+        // Early Return
+        return NULL;
+    }
+
+    *Pitch = Info->PixelsPerScanLine;
+
+    return (UINT32 *) (UINTN) GOPDraw->Mode->FrameBufferBase
+        + ScreenPosY * Info->PixelsPerScanLine + ScreenPosX;
+} // static UINT32 * egFramebufferArea()
+
+// Writes a 'Width' by 'Height' area of 'Pixels', whose rows are 'Delta' pixels
+// apart, to the framebuffer at 'ScreenPosX'/'ScreenPosY' without going through
+// Blt. BGR rows are copied as is and RGB rows have their red and blue swapped.
+// Returns FALSE, having written nothing, when Blt has to be used instead.
+static
+BOOLEAN egFramebufferDraw (
+    IN EG_PIXEL *Pixels,
+    IN UINTN     Delta,
+    IN UINTN     ScreenPosX,
+    IN UINTN     ScreenPosY,
+    IN UINTN     Width,
+    IN UINTN     Height
+) {
+    UINTN   x, y;
+    UINTN   Pitch;
+    UINT32  Value;
+    UINT32 *Src;
+    UINT32 *Dst;
+
+    Dst = egFramebufferArea (ScreenPosX, ScreenPosY, Width, Height, &Pitch);
+    if (Dst == NULL) {
+        // Early Return
+        return FALSE;
+    }
+
+    Src = (UINT32 *) Pixels;
+    if (GOPDraw->Mode->Info->PixelFormat == PixelBlueGreenRedReserved8BitPerColor) {
+        for (y = 0; y < Height; y++) {
+            CopyMem (Dst, Src, Width * sizeof (UINT32));
+            Src += Delta;
+            Dst += Pitch;
+        }
+    }
+    else {
+        for (y = 0; y < Height; y++) {
+            for (x = 0; x < Width; x++) {
+                Value  = Src[x];
+                Dst[x] = (Value & 0xFF00FF00) | ((Value >> 16) & 0xFF) | ((Value & 0xFF) << 16);
+            }
+            Src += Delta;
+            Dst += Pitch;
+        }
+    } // if/else PixelFormat
+
+    return TRUE;
+} // static BOOLEAN egFramebufferDraw()
+
+// Fills a 'Width' by 'Height' area at 'ScreenPosX'/'ScreenPosY' with 'Color'
+// without going through Blt. Returns FALSE when Blt has to be used instead.
+static
+BOOLEAN egFramebufferFill (
+    IN EFI_UGA_PIXEL *Color,
+    IN UINTN          ScreenPosX,
+    IN UINTN          ScreenPosY,
+    IN UINTN          Width,
+    IN UINTN          Height
+) {
+    UINTN   x, y;
+    UINTN   Pitch;
+    UINT32  Value;
+    UINT32 *Dst;
+
+    Dst = egFramebufferArea (ScreenPosX, ScreenPosY, Width, Height, &Pitch);
+    if (Dst == NULL) {
+        // Early Return
+        return FALSE;
+    }
+
+    if (GOPDraw->Mode->Info->PixelFormat == PixelBlueGreenRedReserved8BitPerColor) {
+        Value = Color->Blue | ((UINT32) Color->Green << 8) | ((UINT32) Color->Red  << 16);
+    }
+    else {
+        Value = Color->Red  | ((UINT32) Color->Green << 8) | ((UINT32) Color->Blue << 16);
+    }
+
+    for (y = 0; y < Height; y++) {
+        for (x = 0; x < Width; x++) {
+            Dst[x] = Value;
+        }
+        Dst += Pitch;
+    }
+
+    return TRUE;
+} // static BOOLEAN egFramebufferFill()
+
 VOID egClearScreen (
     IN EG_PIXEL *Color
 ) {
@@ -2439,8 +2575,13 @@ VOID egClearScreen (
     FillColor.Reserved = 0;
 
     BREAD_CRUMB(L"%s:  3", FuncTag);
-    if (GOPDraw != NULL) {
-        BREAD_CRUMB(L"%s:  3a 1 - (Apply Fill via GOP)", FuncTag);
+    if (GlobalConfig.PaintFramebuffer &&
+        egFramebufferFill (&FillColor, 0, 0, egScreenWidth, egScreenHeight)
+    ) {
+        BREAD_CRUMB(L"%s:  3a 1 - (Applied Fill via Framebuffer)", FuncTag);
+    }
+    else if (GOPDraw != NULL) {
+        BREAD_CRUMB(L"%s:  3b 1 - (Apply Fill via GOP)", FuncTag);
         // EFI_GRAPHICS_OUTPUT_BLT_PIXEL and EFI_UGA_PIXEL have the same
         // layout and the TianoCore header file actually defines them
         // as being the same type.
@@ -2453,7 +2594,7 @@ VOID egClearScreen (
          );
     }
     else if (UGADraw != NULL) {
-        BREAD_CRUMB(L"%s:  3b 1 - (Apply Fill via UGA)", FuncTag);
+        BREAD_CRUMB(L"%s:  3c 1 - (Apply Fill via UGA)", FuncTag);
         REFIT_CALL_10_WRAPPER(
             UGADraw->Blt, UGADraw,
             &FillColor, EfiUgaVideoFill,
@@ -2519,7 +2660,16 @@ VOID egDrawImage (
         SetImage = TRUE;
     }
 
-    if (GOPDraw != NULL) {
+    if (GlobalConfig.PaintFramebuffer &&
+        egFramebufferDraw (
+            CompImage->PixelData, CompImage->Width,
+            ScreenPosX, ScreenPosY,
+            CompImage->Width, CompImage->Height
+        )
+    ) {
+        // Painted ... Nothing else to do
+    }
+    else if (GOPDraw != NULL) {
         REFIT_CALL_10_WRAPPER(
             GOPDraw->Blt, GOPDraw,
             (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) CompImage->PixelData, EfiBltBufferToVideo,
@@ -2595,7 +2745,16 @@ VOID egDrawImageArea (
         return;
     }
 
-    if (GOPDraw != NULL) {
+    if (GlobalConfig.PaintFramebuffer &&
+        egFramebufferDraw (
+            Image->PixelData + AreaPosY * Image->Width + AreaPosX, Image->Width,
+            ScreenPosX, ScreenPosY,
+            AreaWidth, AreaHeight
+        )
+    ) {
+        // Painted ... Nothing else to do
+    }
+    else if (GOPDraw != NULL) {
         REFIT_CALL_10_WRAPPER(
             GOPDraw->Blt, GOPDraw,
             (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) Image->PixelData, EfiBltBufferToVideo,
@@ -2707,6 +2866,55 @@ VOID egDisplayMessage (
     }
 } // VOID egDisplayMessage()
 
+#if REFIT_PROFILE > 0
+// Times a full screen paint through GOP Blt and one through the framebuffer,
+// whether or not 'renderer_framebuffer' is set. The current screen is read
+// back and painted over itself, so nothing visibly changes. Either count is
+// left at zero when its path is not available in the current mode.
+VOID egTimeScreenPaint (
+    OUT UINT64 *BltTicks,
+    OUT UINT64 *DirectTicks
+) {
+    UINT64    Start;
+    EG_IMAGE *Screen;
+
+    *BltTicks    = 0;
+    *DirectTicks = 0;
+
+    if (!egHasGraphics || GOPDraw == NULL) {
+        // Early Return
+        return;
+    }
+
+    Screen = egCopyScreen();
+    if (Screen == NULL) {
+        // Early Return
+        return;
+    }
+
+    Start = AsmReadTsc();
+    REFIT_CALL_10_WRAPPER(
+        GOPDraw->Blt, GOPDraw,
+        (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) Screen->PixelData, EfiBltBufferToVideo,
+        0, 0,
+        0, 0,
+        Screen->Width, Screen->Height, 0
+    );
+    *BltTicks = AsmReadTsc() - Start;
+
+    Start = AsmReadTsc();
+    if (egFramebufferDraw (
+        Screen->PixelData, Screen->Width,
+        0, 0,
+        Screen->Width, Screen->Height
+    )) {
+        *DirectTicks = AsmReadTsc() - Start;
+    }
+
+    MY_FREE_IMAGE(Screen);
+} // VOID egTimeScreenPaint()
+#endif
+
 // Copy the current contents of the display into an EG_IMAGE.
 // Returns pointer if successful, NULL if not.
 EG_IMAGE * egCopyScreen (VOID) {
@@ -44,13 +44,38 @@
 
 #include "libegint.h"
 #include "../BootMaster/global.h"
+#include "../BootMaster/lib.h"
+#include "../BootMaster/mystrings.h"
 #include "../BootMaster/rp_funcs.h"
 #include "../BootMaster/screenmgt.h"
 #include "egemb_font.h"
 #include "egemb_font_small.h"
 #include "egemb_font_large.h"
 
-#define FONT_NUM_CHARS 96
+#define FONT_NUM_CHARS      96
+#define FONT_BAD_CHAR       95
+#define FONT_BLOCK_CHARS    128
+#define FONT_NUM_BLOCKS     (0x10000 / FONT_BLOCK_CHARS)
+#define TEXT_RUN_SLOTS      16
+#define TEXT_RUN_SEEN_SLOTS 64
+#define TEXT_RUN_MAX_CHARS  128
+
+// Glyphs for one range of FONT_BLOCK_CHARS code points beyond ASCII,
+// loaded from a font range file the first time one of them is drawn
+typedef struct {
+    EG_IMAGE *Dark;
+    EG_IMAGE *Light;
+    BOOLEAN   Tried;
+} FONT_BLOCK;
+
+// Glyphs of a previously drawn string, laid out as they are composed
+typedef struct {
+    UINT32    Hash;
+    BOOLEAN   Light;
+    CHAR16   *Text;
+    EG_IMAGE *Run;
+    UINTN     LastUse;
+} TEXT_RUN;
 
 extern BOOLEAN   DefaultBanner;
 extern BOOLEAN   FoundFontImage;
@@ -58,6 +83,14 @@ extern BOOLEAN   FoundFontImage;
 UINTN            FontCellWidth = 7;
 EG_IMAGE        *BaseFontImage = NULL;
 
+static EG_IMAGE   *DarkFontImage   = NULL;
+static EG_IMAGE   *LightFontImage  = NULL;
+static CHAR16     *FontRangeBase   = NULL;
+static FONT_BLOCK  FontBlocks[FONT_NUM_BLOCKS];
+static TEXT_RUN    TextRuns[TEXT_RUN_SLOTS];
+static UINTN       TextRunTick     = 0;
+static UINT32      TextRunSeen[TEXT_RUN_SEEN_SLOTS];
+
 //
 // Text rendering
 //
@@ -97,6 +130,268 @@ VOID egPrepareFont (VOID) {
     if (BaseFontImage != NULL) FontCellWidth = BaseFontImage->Width / FONT_NUM_CHARS;
 } // static VOID egPrepareFont();
 
+// Drops all glyphs and text runs derived from the current font
+static
+VOID egFreeFontAtlas (VOID) {
+    UINTN i;
+
+    MY_FREE_IMAGE(DarkFontImage);
+    MY_FREE_IMAGE(LightFontImage);
+
+    for (i = 0; i < FONT_NUM_BLOCKS; i++) {
+        MY_FREE_IMAGE(FontBlocks[i].Dark);
+        MY_FREE_IMAGE(FontBlocks[i].Light);
+        FontBlocks[i].Tried = FALSE;
+    }
+
+    for (i = 0; i < TEXT_RUN_SLOTS; i++) {
+        MY_FREE_POOL(TextRuns[i].Text);
+        MY_FREE_IMAGE(TextRuns[i].Run);
+    }
+    SetMem (TextRunSeen, sizeof (TextRunSeen), 0);
+    TextRunTick = 0;
+} // static VOID egFreeFontAtlas()
+
+// Returns a copy of a dark font image recoloured for dark backgrounds
+static
+EG_IMAGE * egLightFontCopy (
+    IN EG_IMAGE *FontImage
+) {
+    UINTN     i;
+    EG_IMAGE *LightImage;
+
+    LightImage = egCopyImage (FontImage);
+    if (LightImage == NULL) {
+        // Early Return
+        return NULL;
+    }
+
+    EG_PIXEL OurFont = {0xFF, 0xFF, 0xFF, 0};
+    if (DefaultBanner || GlobalConfig.HelpText) {
+        OurFont = FontComplement();
+    }
+
+    for (i = 0; i < (LightImage->Width * LightImage->Height); i++) {
+        if (LightImage->PixelData[i].r == 0 &&
+            LightImage->PixelData[i].g == 0 &&
+            LightImage->PixelData[i].b == 0
+        ) {
+            LightImage->PixelData[i].r = OurFont.r;
+            LightImage->PixelData[i].g = OurFont.g;
+            LightImage->PixelData[i].b = OurFont.b;
+        }
+        else {
+            LightImage->PixelData[i].r = 255 - LightImage->PixelData[i].r;
+            LightImage->PixelData[i].g = 255 - LightImage->PixelData[i].g;
+            LightImage->PixelData[i].b = 255 - LightImage->PixelData[i].b;
+        }
+    } // for
+
+    return LightImage;
+} // static EG_IMAGE * egLightFontCopy()
+
+// Loads the glyphs for range 'Index' on first use. Range files are named after
+// the font file with the first code point in hex appended, as in 'myfont-u0400.png',
+// or 'fonts\font-u0400.png' for the built-in font, and must hold FONT_BLOCK_CHARS
+// glyphs in cells of the same size as the font.
+static
+FONT_BLOCK * egGetFontBlock (
+    IN UINTN Index
+) {
+    CHAR16     *FileName;
+    FONT_BLOCK *Block;
+
+    Block = &FontBlocks[Index];
+    if (Block->Tried) {
+        // Early Return
+        return Block;
+    }
+    Block->Tried = TRUE;
+
+    FileName = PoolPrint (
+        L"%s-u%04X.png",
+        (FontRangeBase != NULL) ? FontRangeBase : L"fonts\\font",
+        Index * FONT_BLOCK_CHARS
+    );
+    if (FileName == NULL) {
+        // Early Return
+        return Block;
+    }
+
+    if (FileExists (SelfDir, FileName)) {
+        Block->Dark = egLoadImage (SelfDir, FileName, TRUE);
+        if (Block->Dark != NULL &&
+            (
+                Block->Dark->Width  != FONT_BLOCK_CHARS * FontCellWidth ||
+                Block->Dark->Height != BaseFontImage->Height
+            )
+        ) {
+            #if REFIT_DEBUG > 0
+            ALT_LOG(1, LOG_LINE_NORMAL,
+                L"Font Range File '%s' Does Not Match the Font Cell Size ... Ignoring",
+                FileName
+            );
+            #endif
+
+            MY_FREE_IMAGE(Block->Dark);
+        }
+    }
+    MY_FREE_POOL(FileName);
+
+    return Block;
+} // static FONT_BLOCK * egGetFontBlock()
+
+// Returns the font image holding the glyph for 'c', with its cell in 'Cell'
+static
+EG_IMAGE * egGetGlyph (
+    IN  CHAR16   c,
+    IN  BOOLEAN  Light,
+    OUT UINTN   *Cell
+) {
+    FONT_BLOCK *Block;
+
+    if (c >= FONT_BLOCK_CHARS) {
+        Block = egGetFontBlock (c / FONT_BLOCK_CHARS);
+        if (Block->Dark != NULL) {
+            if (!Light) {
+                *Cell = c % FONT_BLOCK_CHARS;
+
+                // Early Return
+                return Block->Dark;
+            }
+
+            if (Block->Light == NULL) {
+                Block->Light = egLightFontCopy (Block->Dark);
+            }
+            if (Block->Light != NULL) {
+                *Cell = c % FONT_BLOCK_CHARS;
+
+                // Early Return
+                return Block->Light;
+            }
+        }
+    }
+
+    *Cell = (c < 32 || c >= 127) ? FONT_BAD_CHAR : c - 32;
+
+    if (!Light) {
+        if (DarkFontImage == NULL) DarkFontImage = egCopyImage (BaseFontImage);
+
+        return DarkFontImage;
+    }
+
+    if (LightFontImage == NULL) LightFontImage = egLightFontCopy (BaseFontImage);
+
+    return LightFontImage;
+} // static EG_IMAGE * egGetGlyph()
+
+// Returns the glyphs of 'Text' laid out in a single image, from the text run
+// cache when 'Text' was drawn recently. A run is only built the second time
+// a string is drawn, and then replaces the least recently used run, so that
+// strings drawn once do not push out those that are redrawn. Returns NULL if
+// 'Text' is too long to be cached, is drawn for the first time, or the run
+// cannot be built.
+static
+EG_IMAGE * egGetTextRun (
+    IN CHAR16  *Text,
+    IN UINTN    TextLength,
+    IN BOOLEAN  Light
+) {
+    UINTN       i, y;
+    UINTN       Cell;
+    UINT32      Hash;
+    UINT32      Key;
+    EG_IMAGE   *Run;
+    EG_IMAGE   *FontImage;
+    TEXT_RUN   *Slot;
+    TEXT_RUN   *Oldest;
+
+    if (TextLength == 0 || TextLength > TEXT_RUN_MAX_CHARS) {
+        // Early Return
+        return NULL;
+    }
+
+    // FNV-1a
+    Hash = 2166136261U;
+    for (i = 0; i < TextLength; i++) {
+        Hash = (Hash ^ Text[i]) * 16777619U;
+    }
+
+    Oldest = &TextRuns[0];
+    for (i = 0; i < TEXT_RUN_SLOTS; i++) {
+        Slot = &TextRuns[i];
+        if (Slot->Run   != NULL  &&
+            Slot->Hash  == Hash  &&
+            Slot->Light == Light &&
+            StrCmp (Slot->Text, Text) == 0
+        ) {
+            Slot->LastUse = ++TextRunTick;
+
+            // Early Return
+            return Slot->Run;
+        }
+
+        if (Oldest->Run != NULL &&
+            (Slot->Run == NULL || Slot->LastUse < Oldest->LastUse)
+        ) {
+            Oldest = Slot;
+        }
+    } // for
+
+    // Only cache strings seen before ... Keyed on the colour as well
+    Key = Hash ^ (UINT32) Light;
+    if (TextRunSeen[Key % TEXT_RUN_SEEN_SLOTS] != Key) {
+        TextRunSeen[Key % TEXT_RUN_SEEN_SLOTS] = Key;
+
+        // Early Return
+        return NULL;
+    }
+
+    Run = egCreateImage (TextLength * FontCellWidth, BaseFontImage->Height, TRUE);
+    if (Run == NULL) {
+        // Early Return
+        return NULL;
+    }
+
+    for (i = 0; i < TextLength; i++) {
+        FontImage = egGetGlyph (Text[i], Light, &Cell);
+        if (FontImage == NULL) {
+            MY_FREE_IMAGE(Run);
+
+            // Early Return
+            return NULL;
+        }
+
+        for (y = 0; y < Run->Height; y++) {
+            CopyMem (
+                Run->PixelData + y * Run->Width + i * FontCellWidth,
+                FontImage->PixelData + y * FontImage->Width + Cell * FontCellWidth,
+                FontCellWidth * sizeof (EG_PIXEL)
+            );
+        }
+    } // for
+
+    Slot = Oldest;
+
+    MY_FREE_POOL(Slot->Text);
+    MY_FREE_IMAGE(Slot->Run);
+    Slot->Text = StrDuplicate (Text);
+    if (Slot->Text == NULL) {
+        // Drawn once uncached
+        Slot->Run = NULL;
+        MY_FREE_IMAGE(Run);
+
+        // Early Return
+        return NULL;
+    }
+    Slot->Hash    = Hash;
+    Slot->Light   = Light;
+    Slot->Run     = Run;
+    Slot->LastUse = ++TextRunTick;
+
+    return Run;
+} // static EG_IMAGE * egGetTextRun()
+
 UINTN egGetFontHeight (VOID) {
    egPrepareFont();
    return BaseFontImage->Height;
@@ -135,16 +430,13 @@ VOID egRenderText (
     IN UINTN         PosY,
     IN UINT8         BGBrightness
 ) {
+    EG_IMAGE        *Run;
     EG_IMAGE        *FontImage;
     EG_PIXEL        *BufferPtr;
-    EG_PIXEL        *FontPixelData;
+    BOOLEAN          Light;
     UINTN            BufferLineOffset;
-    UINTN            FontLineOffset;
     UINTN            TextLength;
-    UINTN            i, c;
-
-    static EG_IMAGE *DarkFontImage  = NULL;
-    static EG_IMAGE *LightFontImage = NULL;
+    UINTN            i, Cell;
 
     // Early Return if nothing was passed
     if (Text == NULL) return;
@@ -158,62 +450,33 @@ VOID egRenderText (
         TextLength = (CompImage->Width - PosX) / FontCellWidth;
     }
 
-    if (BGBrightness >= 128) {
-        if (DarkFontImage == NULL) DarkFontImage = egCopyImage (BaseFontImage);
-        if (DarkFontImage == NULL) return;
-
-        FontImage = DarkFontImage;
-    }
-    else {
-        if (LightFontImage == NULL) {
-            LightFontImage = egCopyImage (BaseFontImage);
-            if (LightFontImage == NULL) return;
-
-            EG_PIXEL OurFont = {0xFF, 0xFF, 0xFF, 0};
-            if (DefaultBanner || GlobalConfig.HelpText) {
-                OurFont = FontComplement();
-            }
-
-            for (i = 0; i < (LightFontImage->Width * LightFontImage->Height); i++) {
-                if (LightFontImage->PixelData[i].r == 0 &&
-                    LightFontImage->PixelData[i].g == 0 &&
-                    LightFontImage->PixelData[i].b == 0
-                ) {
-                    LightFontImage->PixelData[i].r = OurFont.r;
-                    LightFontImage->PixelData[i].g = OurFont.g;
-                    LightFontImage->PixelData[i].b = OurFont.b;
-                }
-                else {
-                    LightFontImage->PixelData[i].r = 255 - LightFontImage->PixelData[i].r;
-                    LightFontImage->PixelData[i].g = 255 - LightFontImage->PixelData[i].g;
-                    LightFontImage->PixelData[i].b = 255 - LightFontImage->PixelData[i].b;
-                }
-            } // for
-        } // if LightFontImage == NULL
-
-        FontImage = LightFontImage;
-    } // if/else BGBrightness >= 128
-
-    // Render it
+    Light             = (BGBrightness < 128);
     BufferPtr         = CompImage->PixelData;
     BufferLineOffset  = CompImage->Width;
     BufferPtr        += PosX + PosY * BufferLineOffset;
-    FontPixelData     = FontImage->PixelData;
-    FontLineOffset    = FontImage->Width;
 
+    // Compose text drawn repeatedly in one go
+    Run = egGetTextRun (Text, StrLen (Text), Light);
+    if (Run != NULL) {
+        egRawCompose (
+            BufferPtr, Run->PixelData,
+            TextLength * FontCellWidth, Run->Height,
+            BufferLineOffset, Run->Width
+        );
+
+        // Early Return
+        return;
+    }
+
+    // Render it
     for (i = 0; i < TextLength; i++) {
-        c = Text[i];
-        if (c < 32 || c >= 127) {
-            c = 95;
-        }
-        else {
-            c -= 32;
-        }
+        FontImage = egGetGlyph (Text[i], Light, &Cell);
+        if (FontImage == NULL) return;
 
         egRawCompose (
-            BufferPtr, FontPixelData + c * FontCellWidth,
+            BufferPtr, FontImage->PixelData + Cell * FontCellWidth,
             FontCellWidth, FontImage->Height,
-            BufferLineOffset, FontLineOffset
+            BufferLineOffset, FontImage->Width
         );
         BufferPtr += FontCellWidth;
     }
@@ -223,10 +486,22 @@ VOID egRenderText (
 VOID egLoadFont (
     IN CHAR16 *Filename
 ) {
+    UINTN Length;
+
+    egFreeFontAtlas();
+    MY_FREE_POOL(FontRangeBase);
     MY_FREE_IMAGE(BaseFontImage);
     BaseFontImage = egLoadImage (SelfDir, Filename, TRUE);
     if (BaseFontImage == NULL) {
         FoundFontImage = FALSE;
     }
+    else {
+        // Range files sit alongside the font file
+        FontRangeBase = StrDuplicate (Filename);
+        Length        = (FontRangeBase != NULL) ? StrLen (FontRangeBase) : 0;
+        if (Length > 4 && MyStriCmp (FontRangeBase + Length - 4, L".png")) {
+            FontRangeBase[Length - 4] = L'\0';
+        }
+    }
     egPrepareFont();
 } // VOID egLoadFont()